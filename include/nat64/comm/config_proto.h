@@ -13,15 +13,25 @@
 #include "nat64/comm/types.h"
 
 
-/* Netlink socket packet ID, configuration */
 /*
-#define MSG_TYPE_CONF (0x10 + 2)
-#define MSG_TYPE_ROUTE (0x10 + 3)
-*/
-#define MSG_TYPE_NAT64 (0x10 + 2)
+ * The module and the userspace application speak Generic Netlink. Each message's payload (after
+ * the genlmsghdr) is a request_hdr and its request, or, in the other direction, the response.
+ */
+#define JOOL_GENL_FAMILY "Jool"
+#define JOOL_GENL_VERSION 1
+/** Name of the multicast group the module publishes its events to. */
+#define JOOL_GENL_EVENTS_GROUP "events"
+/** Name of the multicast group the module publishes its session changes to (see sync.h). */
+#define JOOL_GENL_SYNC_GROUP "sync"
 
-#define MSG_SETCFG		0x11
-#define MSG_GETCFG		0x12
+enum jool_genl_command {
+	/** A request from userspace (request_hdr), or the module's response to it. */
+	JOOL_CMD_REQUEST = 1,
+	/** Some events (an array of struct event_us), published to the events group. */
+	JOOL_CMD_EVENTS,
+	/** A struct sync_batch and its records, published to the sync group. */
+	JOOL_CMD_SYNC,
+};
 
 enum config_mode {
 	MODE_POOL6 = 1,
@@ -31,14 +41,31 @@ enum config_mode {
 	MODE_FILTERING,
 	MODE_TRANSLATE,
 	MODE_FRAGMENTATION,
+	MODE_STATS,
+	MODE_EVENTS,
+	MODE_LATENCY,
+	MODE_BATCH,
+	MODE_SYNC,
+	MODE_CHANGES,
 };
 
 enum config_operation {
-	/* The following apply when mode is pool6, pool4, BIB or session. */
+	/*
+	 * The following apply when mode is pool6, pool4, BIB or session.
+	 * Stats and events only know display.
+	 * Sync knows display (the entire session table, as sync_sessions) and add (install the
+	 * sync_batch that follows).
+	 * Changes know count (the generations the change log covers; a changelog_range_us) and
+	 * display (the changes after request_changes.since, as change_us's).
+	 */
 	OP_DISPLAY,
 	OP_COUNT,
 	OP_ADD,
 	OP_REMOVE,
+	/* The following applies when mode is BIB. */
+	OP_IMPORT,
+	/* The following applies when mode is session. */
+	OP_FLUSH,
 
 	/* The following apply when mode is filtering or translate. */
 	#define RESET_TCLASS_MASK		(1 << 2)
@@ -57,8 +84,18 @@ enum config_operation {
 	#define ICMP_TIMEOUT_MASK		(1 << 4)
 	#define TCP_EST_TIMEOUT_MASK	(1 << 5)
 	#define TCP_TRANS_TIMEOUT_MASK 	(1 << 6)
+	#define BIB_MAX_MASK			(1 << 7)
+	#define SESSION_MAX_MASK		(1 << 8)
+	#define BIB_NODE_MAX_MASK		(1 << 9)
+	#define SESSION_NODE_MAX_MASK	(1 << 10)
+	#define SESSION_EVICT_MASK		(1 << 11)
+	#define DEFER_EXTERNAL_TCP_MASK	(1 << 12)
 
 	#define FRAGMENT_TIMEOUT_MASK 	(1 << 0)
+
+	/* The following apply when mode is latency. */
+	#define LATENCY_ENABLED_MASK	(1 << 0)
+	#define LATENCY_RESET_MASK		(1 << 1)
 };
 
 /**
@@ -73,6 +110,7 @@ struct bib_entry_us {
 	struct ipv4_tuple_address ipv4;
 	struct ipv6_tuple_address ipv6;
 	bool is_static;
+	__u64 generation;
 };
 
 /**
@@ -88,6 +126,117 @@ struct session_entry_us {
 	struct ipv4_pair ipv4;
 	__u64 dying_time;
 	l4_protocol l4_proto;
+	__u64 generation;
+};
+
+enum change_table {
+	CHANGE_BIB = 0,
+	CHANGE_SESSION,
+};
+
+enum change_type {
+	CHANGE_CREATED = 0,
+	/** Only sessions are updated (their TCP state changes). Renewals are not changes. */
+	CHANGE_UPDATED,
+	CHANGE_REMOVED,
+};
+
+/**
+ * An entry of the change log: a BIB entry or session which was created, updated or removed.
+ *
+ * Every change to the tables increases the tables' generation by one, and is stamped with the
+ * result. The entries remember the generation of their last change too (see bib_entry_us and
+ * session_entry_us).
+ */
+struct change_us {
+	__u64 generation;
+	/** An "enum change_table". */
+	__u8 table;
+	/** An "enum change_type". */
+	__u8 type;
+	/** An "l4_protocol". */
+	__u8 l4_proto;
+	/** BIB entries only. */
+	__u8 is_static;
+	/** BIB entries only fill in ipv6.remote and ipv4.local. */
+	struct ipv6_pair ipv6;
+	struct ipv4_pair ipv4;
+};
+
+/**
+ * The generations the change log can still account for.
+ */
+struct changelog_range_us {
+	/**
+	 * The changes which came after this generation are in the log. Asking for the changes since
+	 * an earlier generation is pointless; the tables have to be read again instead.
+	 */
+	__u64 oldest;
+	/** The tables' current generation. */
+	__u64 latest;
+};
+
+/**
+ * Narrows down a BIB or session display request. The module evaluates it while it walks the
+ * table, so only the entries userspace asked for are visited and sent.
+ *
+ * Offset and limit are applied after the filters; they can be used to page through the result.
+ */
+struct table_query {
+	/** Which of the filters below apply. */
+	__u32 flags;
+	#define QUERY_IPV6_MASK			(1 << 0)
+	#define QUERY_IPV4_MASK			(1 << 1)
+	#define QUERY_PORTS_MASK		(1 << 2)
+	#define QUERY_STATE_MASK		(1 << 3)
+	#define QUERY_LIFETIME_MASK		(1 << 4)
+
+	/** Prefix the IPv6 node's address must belong to. */
+	struct ipv6_prefix ipv6;
+	/** Jool's IPv4 address the entry must be using. */
+	struct in_addr ipv4;
+	/** Range Jool's IPv4 port (or ICMP identifier) must belong to, inclusive. */
+	__u16 port_min;
+	__u16 port_max;
+	/** State the session must be in (see enum tcp_states). Sessions only; TCP only. */
+	__u8 state;
+	/** Range the session's remaining lifetime must belong to, in milliseconds. Sessions only. */
+	__u64 lifetime_min;
+	__u64 lifetime_max;
+
+	/** Number of matching entries to skip. */
+	__u64 offset;
+	/** Maximum number of entries to return. Zero means no limit. */
+	__u64 limit;
+};
+
+/**
+ * A static BIB entry, as userspace sends them in bulk (see "struct request_bib".import).
+ */
+struct bib_import_us {
+	struct ipv6_tuple_address ipv6;
+	struct ipv4_tuple_address ipv4;
+	l4_protocol l4_proto;
+};
+
+/**
+ * Response to a BIB or session count request.
+ */
+struct table_count_us {
+	/** Number of entries in the table. */
+	__u64 count;
+	/** Memory the entries are using, in bytes. Does not include the allocator's overhead. */
+	__u64 bytes;
+};
+
+/**
+ * Response to a session flush request.
+ */
+struct flush_count_us {
+	/** Number of BIB entries which were removed. */
+	__u64 bib;
+	/** Number of sessions which were removed. */
+	__u64 session;
 };
 
 /**
@@ -107,6 +256,11 @@ struct filtering_config {
 	bool drop_icmp6_info;
 	/** Drop externally initiated TCP connections? (IPv4 initiated) */
 	bool drop_external_tcp;
+	/**
+	 * Forward externally initiated TCP connections without creating sessions until the IPv6 node
+	 * answers? (See pending_syn.h.)
+	 */
+	bool defer_external_tcp;
 	/** Current timeout values */
 	struct timeouts {
 		__u64 udp;
@@ -114,6 +268,25 @@ struct filtering_config {
 		__u64 tcp_est;
 		__u64 tcp_trans;
 	} to;
+	/**
+	 * Maximum number of entries the tables can hold, so a single node (or a flood of them) cannot
+	 * make Jool exhaust the kernel's memory. Zero means unlimited.
+	 */
+	struct limits {
+		/** BIB entries, adding up every protocol. */
+		__u64 bib;
+		/** Sessions, adding up every protocol. */
+		__u64 session;
+		/** BIB entries owned by any single IPv6 node. */
+		__u64 bib_per_node;
+		/** Sessions owned by any single IPv6 node. */
+		__u64 session_per_node;
+		/**
+		 * Number of sessions at which the least valuable ones start being expired early, to make
+		 * room for new ones. Also enables the shrinker. Zero disables early eviction.
+		 */
+		__u64 session_evict;
+	} max;
 };
 
 /**
@@ -181,6 +354,26 @@ struct request_hdr {
 	__u32 operation;
 };
 
+/**
+ * Returns whether the response to "hdr" is a table, which the module only hands out as a dump
+ * (ie. the request must be flagged NLM_F_DUMP). Tables can be arbitrarily large.
+ */
+static inline bool is_dump_request(struct request_hdr *hdr)
+{
+	switch (hdr->mode) {
+	case MODE_POOL6:
+	case MODE_POOL4:
+	case MODE_BIB:
+	case MODE_SESSION:
+	case MODE_EVENTS:
+	case MODE_SYNC:
+	case MODE_CHANGES:
+		return hdr->operation == OP_DISPLAY;
+	}
+
+	return false;
+}
+
 union request_pool6 {
 	struct {
 		/* Nothing needed here ATM. */
@@ -203,7 +396,7 @@ struct request_bib {
 	l4_protocol l4_proto;
 	union {
 		struct {
-			/* Nothing needed here. */
+			struct table_query query;
 		} display;
 		struct {
 			/* Nothing needed here. */
@@ -222,13 +415,45 @@ struct request_bib {
 		struct {
 			/* Nothing needed here. */
 		} clear;
+		struct {
+			/** Number of entries. They follow this structure. Protocols can be mixed. */
+			__u32 count;
+		} import;
 	};
 };
 
 struct request_session {
 	l4_protocol l4_proto;
+	union {
+		struct {
+			struct table_query query;
+		} display;
+		struct {
+			/** The IPv6 nodes whose state should be dropped. */
+			struct ipv6_prefix prefix;
+		} flush;
+	};
 };
 
+struct request_changes {
+	/** Only the changes which came after this generation are wanted. */
+	__u64 since;
+};
+
+/**
+ * Payload of MODE_BATCH requests. It is followed by "count" requests (each one a request_hdr and
+ * its payload, exactly as if it had been sent on its own). Each of them starts at a
+ * BATCH_ALIGN()ed offset.
+ *
+ * The module applies either all of them or none. Only pool6 and pool4 additions and removals,
+ * and filtering, translate and fragmentation updates can be part of a batch.
+ */
+struct request_batch {
+	__u32 count;
+};
+
+#define BATCH_ALIGN(len) (((len) + 3U) & ~3U)
+
 /*
  * Because of the somewhat intrusive nature of the netlink header, response header structures are
  * not really necessary.
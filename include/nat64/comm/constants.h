@@ -45,6 +45,19 @@
  * This value cannot be configured from the userspace app (this is on purpose).
  */
 #define TCP_INCOMING_SYN (6)
+/**
+ * Size of the table of IPv4 SYNs waiting for an IPv6 answer (see pending_syn.h). It is
+ * PENDING_SYN_BUCKETS buckets of PENDING_SYN_WAYS entries each; 16 bytes per entry.
+ */
+#define PENDING_SYN_BUCKETS 1024
+#define PENDING_SYN_WAYS 4
+/**
+ * Maximum amount of memory the stored IPv4 SYNs can use (see pkt_queue.h), in bytes. Includes the
+ * kernel's overhead for each packet.
+ */
+#define PKTQUEUE_MAX_BYTES (1024 * 1024)
+/** Maximum number of packets a single IPv4 node can have stored at any given time. */
+#define PKTQUEUE_MAX_PER_SOURCE 8
 /** Default time interval fragments are allowed to arrive in. In seconds. */
 #define FRAGMENT_MIN (2)
 /** Default session lifetime for ICMP bindings, in seconds. */
@@ -67,6 +80,39 @@
  */
 #define MIN_TIMER_SLEEP (255)
 
+/**
+ * Maximum number of sessions a single packet will evict once the session table reaches its
+ * high-water mark. Evicting more than one amortizes the cost over several new sessions, while the
+ * bound keeps a lowered mark from stalling the packet path.
+ */
+#define EVICT_BATCH 64
+
+/* -- Events -- */
+
+/**
+ * Maximum number of events of a single type each CPU will record per second. Anything beyond
+ * this is only counted (see STAT_EVENTS_SUPPRESSED), so a flood cannot make logging expensive.
+ */
+#define EVENTS_PER_SECOND (64)
+/** Number of events each CPU can hold until userspace fetches them. Must be a power of two. */
+#define EVENTS_RING_SIZE (512)
+
+/* -- Session synchronization -- */
+
+/**
+ * Number of session changes the module can hold until userspace fetches them (it does so ten times
+ * per second). If they overflow, the sender has to resend the entire table.
+ */
+#define SYNC_RING_SIZE (8192)
+
+/* -- Change log -- */
+
+/**
+ * Number of BIB and session changes the module remembers. Monitors which fall further behind than
+ * this have to read the tables again. Must be a power of two.
+ */
+#define CHANGELOG_SIZE (8192)
+
 /* -- Config defaults -- */
 #define POOL6_DEF { "64:ff9b::/96" }
 
@@ -75,6 +121,12 @@
 #define FILT_DEF_ADDR_DEPENDENT_FILTERING false
 #define FILT_DEF_FILTER_ICMPV6_INFO false
 #define FILT_DEF_DROP_EXTERNAL_CONNECTIONS false
+#define FILT_DEF_DEFER_EXTERNAL_CONNECTIONS false
+#define FILT_DEF_MAX_BIB 0
+#define FILT_DEF_MAX_SESSIONS 0
+#define FILT_DEF_MAX_BIB_PER_NODE 0
+#define FILT_DEF_MAX_SESSIONS_PER_NODE 0
+#define FILT_DEF_SESSION_EVICT 0
 
 #define TRAN_DEF_RESET_TRAFFIC_CLASS false
 #define TRAN_DEF_RESET_TOS false
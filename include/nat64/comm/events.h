@@ -0,0 +1,51 @@
+#ifndef _NF_NAT64_COMM_EVENTS_H
+#define _NF_NAT64_COMM_EVENTS_H
+
+/**
+ * @file
+ * Binary records of the noteworthy things that happen in the tables.
+ *
+ * Both the kernel module and the userspace application can see this file.
+ */
+
+#include "nat64/comm/types.h"
+
+
+/** Append new ones at the end only; userspace relies on the numbering. */
+enum event_type {
+	/** A BIB entry was created dynamically. "ipv6" and "ipv4" are its addresses. */
+	EVENT_BIB_CREATED = 0,
+	/** A dynamic BIB entry died. "ipv6" and "ipv4" are its addresses. */
+	EVENT_BIB_REMOVED,
+	/** A session was created. "ipv6" is the IPv6 node, "ipv4" is the IPv4 node. */
+	EVENT_SESSION_CREATED,
+	/** A session expired. "ipv6" is the IPv6 node, "ipv4" is the IPv4 node. */
+	EVENT_SESSION_EXPIRED,
+	/** pool4 could not provide a transport address. "ipv6" is the node which asked for it. */
+	EVENT_POOL4_EXHAUSTED,
+	/** A packet was dropped by filtering. "reason" says why, and the packet's source is stored. */
+	EVENT_DROP,
+
+	/** Number of event types; not an event type itself. */
+	EVENT_TYPE_COUNT,
+};
+
+/**
+ * An event, from the eyes of userspace ("us" stands for userspace).
+ * Addresses which do not apply to the event's type are zeroed.
+ */
+struct event_us {
+	/** Milliseconds that elapsed between the event and its retrieval. */
+	__u64 age;
+	/** An "enum event_type". */
+	__u16 type;
+	/** If type is EVENT_DROP, the "enum stat_counter" the drop was accounted in. */
+	__u16 reason;
+	/** An "l4_protocol". */
+	__u8 l4_proto;
+	struct ipv6_tuple_address ipv6;
+	struct ipv4_tuple_address ipv4;
+};
+
+
+#endif /* _NF_NAT64_COMM_EVENTS_H */
@@ -0,0 +1,51 @@
+#ifndef _NF_NAT64_COMM_LATENCY_H
+#define _NF_NAT64_COMM_LATENCY_H
+
+/**
+ * @file
+ * Identifiers and containers of the per-stage latency histograms.
+ *
+ * Both the kernel module and the userspace application can see this file.
+ */
+
+#include <linux/types.h>
+
+
+/** The steps of a packet's translation, as core_common() runs them. */
+enum latency_stage {
+	LATENCY_FRAGMENT = 0,
+	LATENCY_INCOMING_TUPLE,
+	LATENCY_FILTERING,
+	LATENCY_OUTGOING_TUPLE,
+	LATENCY_TRANSLATE,
+	/** send_pkt() or handling_hairpinning(); routing happens here. */
+	LATENCY_SEND,
+
+	/** Number of stages; not a stage itself. */
+	LATENCY_STAGE_COUNT,
+};
+
+/**
+ * Number of buckets of each histogram.
+ * Bucket 0 counts durations below 2 nanoseconds; bucket "i" counts durations within
+ * [2^i, 2^(i + 1)) nanoseconds. The last bucket also counts everything longer.
+ */
+#define LATENCY_BUCKETS 32
+
+/** The histograms, from the eyes of userspace ("us" stands for userspace). */
+struct latency_us {
+	/** Sum of the durations of each stage, in nanoseconds. */
+	__u64 total_ns[LATENCY_STAGE_COUNT];
+	__u64 histogram[LATENCY_STAGE_COUNT][LATENCY_BUCKETS];
+	/** Are the stages currently being measured? */
+	__u8 enabled;
+};
+
+/** Configuration of the latency histograms. */
+struct latency_config {
+	/** Measure the stages? */
+	__u8 enabled;
+};
+
+
+#endif /* _NF_NAT64_COMM_LATENCY_H */
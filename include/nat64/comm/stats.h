@@ -0,0 +1,119 @@
+#ifndef _NF_NAT64_COMM_STATS_H
+#define _NF_NAT64_COMM_STATS_H
+
+/**
+ * @file
+ * Identifiers of the counters Jool keeps track of.
+ *
+ * Both the kernel module and the userspace application can see this file.
+ */
+
+/**
+ * Indexes of the counters. Append new ones before STAT_COUNT only; userspace relies on the
+ * numbering.
+ */
+enum stat_counter {
+	/* Hooks and core. */
+	/** Packets which were not meant to be translated and were returned to the kernel as-is. */
+	STAT_ACCEPTED = 0,
+	/** Packets Jool took ownership of (translated, stored or dropped along the way). */
+	STAT_STOLEN,
+	/** Packets Jool told the kernel to drop. */
+	STAT_DROPPED,
+	/** Packets translated from IPv6 to IPv4, and their length once translated. */
+	STAT_PKTS_6TO4,
+	STAT_BYTES_6TO4,
+	/** Packets translated from IPv4 to IPv6, and their length once translated. */
+	STAT_PKTS_4TO6,
+	STAT_BYTES_4TO6,
+	/** Translated packets which had to be translated again because they were hairpinning. */
+	STAT_HAIRPINNED,
+	/** Packets which could not be translated. */
+	STAT_TRANSLATE_FAILED,
+
+	/* Fragment database. */
+	/** Packets whose headers were found to be corrupted or unsupported. */
+	STAT_INVALID_PACKET,
+	/** Packets whose checksum was wrong. */
+	STAT_BAD_CHECKSUM,
+	/** Fragments which had to wait for their siblings. */
+	STAT_FRAG_STORED,
+	/** Fragmented packets which were completed. */
+	STAT_FRAG_REASSEMBLED,
+	/** Fragmented packets which timed out before they were completed. */
+	STAT_FRAG_EXPIRED,
+
+	/* Filtering and updating. */
+	/** IPv6 packets whose source address belongs to pool6. */
+	STAT_HAIRPIN_LOOP,
+	/** IPv6 packets whose destination address doesn't belong to pool6. */
+	STAT_POOL6_MISMATCH,
+	/** IPv4 packets whose destination address doesn't belong to pool4. */
+	STAT_POOL4_MISMATCH,
+	/** IPv4 packets for which no BIB entry exists. */
+	STAT_NO_BIB,
+	/** Packets dropped due to address-dependent filtering. */
+	STAT_FILTER_ADDR,
+	/** ICMPv6 informational packets dropped due to policy. */
+	STAT_FILTER_ICMP6_INFO,
+	/** Externally initiated TCP connections dropped due to policy. */
+	STAT_FILTER_EXTERNAL_TCP,
+	/** TCP packets which belong to no connection. */
+	STAT_TCP_NO_STATE,
+	/** IPv4-initiated TCP connections dropped because they cannot be stored. */
+	STAT_TCP_V4_SYN,
+	/** Connections refused because pool4 ran out of transport addresses. */
+	STAT_POOL4_EXHAUSTED,
+	/** BIB entries created and destroyed dynamically. */
+	STAT_BIB_CREATED,
+	STAT_BIB_REMOVED,
+	/** Session entries created and destroyed. */
+	STAT_SESSION_CREATED,
+	STAT_SESSION_EXPIRED,
+	/** Keepalive probes sent to TCP nodes whose connection was idle. */
+	STAT_PROBES_SENT,
+
+	/* Routing and dispatch. */
+	/** Packets which could not be routed. */
+	STAT_ROUTE_FAILED,
+	/** Packets the kernel refused to send. */
+	STAT_SEND_FAILED,
+	/** Memory allocation failures. */
+	STAT_ALLOC_FAILED,
+
+	/* Events. */
+	/** Events which were not recorded because their type exceeded its rate limit. */
+	STAT_EVENTS_SUPPRESSED,
+	/** Events which were not recorded because userspace did not fetch the older ones in time. */
+	STAT_EVENTS_LOST,
+
+	/* Table limits. */
+	/** BIB entries which were not created because the BIB limits had been reached. */
+	STAT_BIB_LIMIT,
+	/** Sessions which were not created because the session limits had been reached. */
+	STAT_SESSION_LIMIT,
+	/** Sessions which were expired early to make room for new ones. Also counted as expired. */
+	STAT_SESSION_EVICTED,
+	/** IPv4 SYNs which were forwarded without creating a session (see pending_syn.h). */
+	STAT_SYN_PENDING,
+	/** Pending SYNs which were forgotten before their answer because the table was full. */
+	STAT_SYN_PENDING_LOST,
+	/** IPv4 SYNs stored while waiting for a simultaneous open (see pkt_queue.h). */
+	STAT_SYN_STORED,
+	/** IPv4 SYNs which were not stored, or forgotten early, because of the storage limits. */
+	STAT_SYN_STORE_DROPPED,
+
+	/* Session synchronization. */
+	/** Session changes which were not published because userspace did not fetch them in time. */
+	STAT_SYNC_LOST,
+	/** Session changes received from the peer (or restored from an image) and applied. */
+	STAT_SYNC_APPLIED,
+	/** Session changes received from the peer (or restored from an image) which were refused. */
+	STAT_SYNC_REJECTED,
+
+	/** Number of counters; not a counter itself. */
+	STAT_COUNT,
+};
+
+
+#endif /* _NF_NAT64_COMM_STATS_H */
@@ -16,6 +16,7 @@
 int str_to_bool(const char *str, bool *bool_out);
 int str_to_u8(const char *str, __u8 *u8_out, __u8 min, __u8 max);
 int str_to_u16(const char *str, __u16 *u16_out, __u16 min, __u16 max);
+int str_to_u64(const char *str, __u64 *u64_out, __u64 min, __u64 max);
 int str_to_u16_array(const char *str, __u16 **array_out, __u16 *array_len_out);
 /**
  * Converts "str" to a IPv4 address. Stores the result in "result".
@@ -34,6 +35,12 @@ int str_to_addr6(const char *str, struct in6_addr *result);
 int str_to_addr4_port(const char *str, struct ipv4_tuple_address *addr_out);
 int str_to_addr6_port(const char *str, struct ipv6_tuple_address *addr_out);
 int str_to_prefix(const char *str, struct ipv6_prefix *prefix_out);
+/** Like str_to_prefix(), except any length from 0 to 128 is accepted. */
+int str_to_network6(const char *str, struct ipv6_prefix *prefix_out);
+/** Parses "NUM" or "NUM-NUM" (both ends included). */
+int str_to_port_range(const char *str, __u16 *min_out, __u16 *max_out);
+/** Parses the name of one of the states from enum tcp_states (case insensitive). */
+int str_to_tcp_state(const char *str, __u8 *state_out);
 
 void print_code_msg(enum error_code code, char *success_msg);
 void print_time(__u64 millis);
@@ -0,0 +1,88 @@
+#ifndef _NF_NAT64_COMM_SYNC_H
+#define _NF_NAT64_COMM_SYNC_H
+
+/**
+ * @file
+ * The records two translators exchange to keep their session tables in sync (high availability).
+ *
+ * The active translator's module publishes the changes of its sessions to the sync multicast
+ * group, `jool --sync --send` forwards them to the backup translator over UDP, and `jool --sync
+ * --receive` hands them to the backup's module, which installs them. If the active translator
+ * dies, the backup already knows its connections.
+ *
+ * Unlike the rest of the structures the module and userspace exchange, these travel between
+ * machines, so they are in network byte order and have no padding.
+ *
+ * Both the kernel module and the userspace application can see this file.
+ */
+
+#include "nat64/comm/types.h"
+
+
+/** Version of the format below. Receivers reject batches from other versions. */
+#define SYNC_VERSION 1
+/**
+ * Maximum number of records per batch. A full batch (1124 bytes) fits in a UDP datagram which
+ * fits in the IPv6 minimum MTU, so it never needs to be fragmented.
+ */
+#define SYNC_BATCH_MAX 20
+/**
+ * Maximum number of records a single request can ask the module to install. Requests which do
+ * not travel over UDP (snapshot restores) use bigger batches to save messages.
+ */
+#define SYNC_REQUEST_MAX 512
+
+/** Append new ones at the end only. */
+enum sync_type {
+	/** The session was created, or its state or lifetime changed. */
+	SYNC_SESSION_UPDATE = 0,
+	/** The session died. */
+	SYNC_SESSION_REMOVE,
+};
+
+/**
+ * A session, as the peer needs to know it. Its BIB entry is implicit (ipv6.remote and
+ * ipv4.local).
+ */
+struct sync_session {
+	/** An "enum sync_type". */
+	__u8 type;
+	/** An "l4_protocol". */
+	__u8 l4_proto;
+	/** TCP state (see "enum tcp_states"). Zero for the other protocols. */
+	__u8 state;
+	__u8 reserved;
+	/** Milliseconds the session has left if it stays idle. */
+	__be32 lifetime;
+
+	struct in6_addr remote6;
+	struct in6_addr local6;
+	struct in_addr local4;
+	struct in_addr remote4;
+	__be16 remote6_port;
+	__be16 local6_port;
+	__be16 local4_port;
+	__be16 remote4_port;
+};
+
+/**
+ * The header of a group of records. It is followed by "count" sync_sessions.
+ *
+ * The module publishes one of these per message, and `jool --sync --send` sends each one as a
+ * single UDP datagram.
+ */
+struct sync_batch {
+	/** SYNC_VERSION. */
+	__u8 version;
+	__u8 flags;
+	/**
+	 * The module could not publish some records before this batch, because nobody fetched them in
+	 * time. The sender should resend the entire table. (Only meaningful between the module and
+	 * the sender.)
+	 */
+	#define SYNC_FLAG_LOST (1 << 0)
+	__be16 count;
+};
+
+
+#endif /* _NF_NAT64_COMM_SYNC_H */
@@ -27,6 +27,8 @@ struct bib_entry {
 
 	/** Should the entry never expire? */
 	bool is_static;
+	/** Generation of the tables when the entry was created (see changelog.h). */
+	u64 generation;
 
 	/** Session entries related to this BIB. */
 	struct list_head sessions;
@@ -132,9 +134,45 @@ int bib_remove(struct bib_entry *entry, l4_protocol l4_proto);
  * Asume que el candado ya se reservó.
  */
 int bib_for_each(l4_protocol l4_proto, int (*func)(struct bib_entry *, void *), void *arg);
+/**
+ * Same as bib_for_each(), except it starts at "from" (or the first entry that would follow it, if
+ * it is not in the table) instead of at the beginning. bib_for_each() visits the entries in
+ * descending IPv4 transport address order, so this can be used to resume a walk.
+ *
+ * You must lock bib_session_lock before calling this function.
+ */
+int bib_for_each_from(l4_protocol l4_proto, struct ipv4_tuple_address *from,
+		int (*func)(struct bib_entry *, void *), void *arg);
+/**
+ * Calls "func" for every entry from the "l4_proto" table which belongs to the IPv6 node "addr".
+ * Same as bib_for_each_prefix6() with a /128.
+ */
 int bib_for_each_ipv6(l4_protocol l4_proto, struct in6_addr *addr,
 		int (*func)(struct bib_entry *, void *), void *arg);
+/**
+ * Calls "func" for every entry from the "l4_proto" table whose IPv6 address belongs to "prefix".
+ * Only visits those entries, so this costs as much as the number of entries the prefix owns.
+ * "func" is allowed to remove (and free) the entry it receives.
+ *
+ * The entries are visited in descending IPv6 transport address order. If "from" is not NULL, the
+ * walk starts there instead of at the top of the prefix.
+ *
+ * You must lock bib_session_lock before calling this function.
+ */
+int bib_for_each_prefix6(l4_protocol l4_proto, struct ipv6_prefix *prefix,
+		struct ipv6_tuple_address *from, int (*func)(struct bib_entry *, void *), void *arg);
+/**
+ * Calls "func" for every entry from the "l4_proto" table whose IPv4 side is "addr" and a port
+ * between "port_min" and "port_max" (inclusive). Only visits those entries, in descending port
+ * order; if "from" is not NULL, the walk starts there instead of at "port_max". You must lock
+ * bib_session_lock before calling this function.
+ */
+int bib_for_each_range4(l4_protocol l4_proto, struct in_addr *addr, __u16 port_min,
+		__u16 port_max, struct ipv4_tuple_address *from,
+		int (*func)(struct bib_entry *, void *), void *arg);
 int bib_count(l4_protocol proto, __u64 *result);
+/** Returns the number of bytes each BIB entry occupies. */
+size_t bib_entry_size(void);
 
 /**
  * Helper function, intended to initialize a BIB entry.
@@ -0,0 +1,52 @@
+#ifndef _NF_NAT64_CHANGELOG_H
+#define _NF_NAT64_CHANGELOG_H
+
+/**
+ * @file
+ * The last few changes to the BIB and session tables, so monitors can poll for what changed since
+ * they last looked instead of reading the entire tables every time.
+ *
+ * Every change increases the tables' generation by one. The log remembers the latest
+ * CHANGELOG_SIZE changes; asking for the ones since an older generation fails, and the asker has
+ * to read the tables again. The first generation is random, so the generations of different loads
+ * of the module don't overlap.
+ *
+ * Entries are created and removed by bib.c and session.c. Sessions are also updated whenever their
+ * TCP state changes; renewing their lifetime is not considered a change (otherwise every packet
+ * would be one).
+ *
+ * Everything here is protected by bib_session_lock.
+ */
+
+#include "nat64/comm/config_proto.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+
+
+int changelog_init(void);
+void changelog_destroy(void);
+
+/**
+ * Logs the fact that "bib" was created or removed ("type"). You must lock bib_session_lock before
+ * calling this function.
+ */
+void changelog_bib(enum change_type type, struct bib_entry *bib, l4_protocol l4_proto);
+/**
+ * Logs the fact that "session" was created, changed state or was removed ("type"). You must lock
+ * bib_session_lock before calling this function.
+ */
+void changelog_session(enum change_type type, struct session_entry *session);
+
+/** Returns the generations the log can account for. */
+void changelog_range(struct changelog_range_us *range);
+
+/**
+ * Hands the changes which came after generation "*since" to "func", oldest first.
+ * "*since" is updated as they go, so if "func" fails, the walk can be resumed from where it
+ * stopped. Returns -ESTALE if the log no longer remembers some of the changes after "*since".
+ * "func" is called with bib_session_lock held.
+ */
+int changelog_for_each(u64 *since, int (*func)(struct change_us *, void *), void *arg);
+
+
+#endif /* _NF_NAT64_CHANGELOG_H */
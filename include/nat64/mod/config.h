@@ -5,6 +5,9 @@
  * @file
  * The NAT64's layer/bridge towards the user. S/he can control its behavior using this.
  *
+ * It is a Generic Netlink family (see config_proto.h). Tables are handed over as netlink dumps,
+ * and the events and session changes (see sync.h) are published to multicast groups.
+ *
  * @author Miguel Gonzalez
  * @author Alberto Leiva  <- maintenance
  */
@@ -0,0 +1,39 @@
+#ifndef _NF_NAT64_EVENTS_H
+#define _NF_NAT64_EVENTS_H
+
+/**
+ * @file
+ * Per-CPU rings of events, meant to replace the logging of things which can happen once per packet.
+ *
+ * Recording an event only touches the current CPU's ring and is rate limited per event type, so its
+ * cost is bounded no matter how many packets arrive. Userspace drains the rings whenever it wants
+ * to see them (jool --events); if it doesn't do it often enough, the newest events are lost.
+ */
+
+#include "nat64/comm/events.h"
+#include "nat64/comm/stats.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+
+
+int events_init(void);
+void events_destroy(void);
+
+/** Records the fact that "bib" was created or removed ("type"). */
+void events_bib(enum event_type type, struct bib_entry *bib, l4_protocol l4_proto);
+/** Records the fact that "session" was created or expired ("type"). */
+void events_session(enum event_type type, struct session_entry *session);
+/** Records the fact that pool4 could not provide a transport address for "tuple"'s source. */
+void events_pool4_exhausted(struct tuple *tuple);
+/** Records the fact that "tuple"'s packet was dropped, and that "reason" was the counter blamed. */
+void events_drop(enum stat_counter reason, struct tuple *tuple);
+
+/**
+ * Empties every CPU's ring, handing each event to "func" along the way.
+ * If "func" fails, the walk stops, and the event it failed on (and the ones after it) stay.
+ * Must not be called concurrently with itself.
+ */
+int events_for_each(int (*func)(struct event_us *, void *), void *arg);
+
+
+#endif /* _NF_NAT64_EVENTS_H */
@@ -12,6 +12,7 @@
 
 #include "nat64/comm/types.h"
 #include "nat64/comm/config_proto.h"
+#include "nat64/comm/sync.h"
 #include "nat64/mod/packet.h"
 
 
@@ -21,7 +22,31 @@ void filtering_destroy(void);
 int clone_filtering_config(struct filtering_config *clone);
 int set_filtering_config(__u32 operation, struct filtering_config *new_config);
 
+struct filtering_config *prepare_filtering_config(void);
+int merge_filtering_config(__u32 operation, struct filtering_config *candidate,
+		struct filtering_config *new_config);
+void commit_filtering_config(struct filtering_config *candidate);
+void abort_filtering_config(struct filtering_config *candidate);
+
 verdict filtering_and_updating(struct fragment *frag, struct tuple *tuple);
 
+/**
+ * Removes the "l4_proto" sessions of every IPv6 node from "prefix", along with their dynamic BIB
+ * entries. Static BIB entries survive (without sessions). The BIB is indexed by IPv6 address, so
+ * this costs as much as the number of entries the nodes own, not the size of the tables.
+ *
+ * Adds the number of removed entries to "count".
+ */
+int filtering_flush(l4_protocol l4_proto, struct ipv6_prefix *prefix, struct flush_count_us *count);
+
+/**
+ * Applies the HA peer's session changes (see sync.h) to the tables. The BIB entries and pool4
+ * transport addresses the sessions need are created and borrowed as well.
+ *
+ * Records which cannot be applied (for example, because pool4 differs from the peer's) are skipped
+ * and accounted for in STAT_SYNC_REJECTED.
+ */
+void filtering_sync(struct sync_session *records, unsigned int count);
+
 
 #endif /* _NF_NAT64_FILTERING_H */
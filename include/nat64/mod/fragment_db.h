@@ -41,6 +41,12 @@ int fragdb_init(void);
 int set_fragmentation_config(__u32 operation, struct fragmentation_config *new_config);
 int clone_fragmentation_config(struct fragmentation_config *clone);
 
+struct fragmentation_config *prepare_fragmentation_config(void);
+int merge_fragmentation_config(__u32 operation, struct fragmentation_config *candidate,
+		struct fragmentation_config *new_config);
+void commit_fragmentation_config(struct fragmentation_config *candidate);
+void abort_fragmentation_config(struct fragmentation_config *candidate);
+
 verdict fragment_arrives(struct sk_buff *skb, struct packet **result);
 
 void fragdb_destroy(void);
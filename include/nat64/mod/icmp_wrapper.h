@@ -21,6 +21,7 @@
 typedef enum icmp_error_code {
 	ICMPERR_ADDR_UNREACHABLE,
 	ICMPERR_PROTO_UNREACHABLE,
+	ICMPERR_PORT_UNREACHABLE,
 	ICMPERR_HOP_LIMIT,
 	ICMPERR_FRAG_NEEDED,
 	ICMPERR_HDR_FIELD,
@@ -32,6 +33,11 @@ typedef enum icmp_error_code {
  * Wrapper for the icmp_send() and the icmpv6_send() functions.
  */
 void icmp64_send(struct fragment *frag, icmp_error_code code, __be32 info);
+/**
+ * Same as icmp64_send(), except the offending packet is a raw sk_buff. "skb" still needs to be an
+ * incoming packet (with its device and route).
+ */
+void icmp64_send_skb(struct sk_buff *skb, icmp_error_code code, __be32 info);
 
 
 #endif /* _NF_NAT64_ICMP_WRAPPER_H */
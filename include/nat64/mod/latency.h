@@ -0,0 +1,76 @@
+#ifndef _NF_NAT64_LATENCY_H
+#define _NF_NAT64_LATENCY_H
+
+/**
+ * @file
+ * Optional per-CPU histograms of the time each translation stage takes.
+ *
+ * They are off by default. While off, the checks below are static keys (a no-op instruction which
+ * gets patched when the measurements are switched on), so the packet path pays nothing for them.
+ * Kernels older than 3.3 lack static keys and fall back to testing a variable.
+ */
+
+#include <linux/version.h>
+#include <linux/ktime.h>
+#include "nat64/comm/latency.h"
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+#include <linux/jump_label.h>
+
+extern struct static_key latency_key;
+
+static inline bool latency_enabled(void)
+{
+	return static_key_false(&latency_key);
+}
+
+#else
+
+extern bool latency_key;
+
+static inline bool latency_enabled(void)
+{
+	return unlikely(latency_key);
+}
+
+#endif
+
+
+int latency_init(void);
+void latency_destroy(void);
+
+/** Switches the measurements on or off. Can sleep. */
+void latency_set_enabled(bool enabled);
+/** Forgets the measurements done so far. */
+void latency_reset(void);
+/** Adds up every CPU's histograms and places the result in "result". */
+void latency_sum(struct latency_us *result);
+
+/** Accounts "duration" to "stage" in the current CPU's histogram. */
+void latency_add(enum latency_stage stage, ktime_t duration);
+
+/** Marks the beginning of the first stage. */
+static inline void latency_start(ktime_t *start)
+{
+	if (latency_enabled())
+		*start = ktime_get();
+}
+
+/**
+ * Marks the end of "stage", which started at "start". "start" becomes the beginning of the next
+ * stage.
+ */
+static inline void latency_stop(enum latency_stage stage, ktime_t *start)
+{
+	ktime_t now;
+
+	/* A zero "start" means the measurements were switched on in the middle of the packet. */
+	if (latency_enabled() && ktime_to_ns(*start) != 0) {
+		now = ktime_get();
+		latency_add(stage, ktime_sub(now, *start));
+		*start = now;
+	}
+}
+
+
+#endif /* _NF_NAT64_LATENCY_H */
@@ -0,0 +1,35 @@
+#ifndef _NF_NAT64_PENDING_SYN_H
+#define _NF_NAT64_PENDING_SYN_H
+
+/**
+ * @file
+ * Remembers IPv4-initiated TCP handshakes whose IPv6 side has not answered yet, so they don't need
+ * full sessions.
+ *
+ * An IPv4 SYN which matches a static BIB entry normally creates a V4_INIT session, which means
+ * anyone on the IPv4 Internet can fill the session table by sending SYNs. Instead, the SYN can be
+ * forwarded statelessly and recorded here in a few bytes; the session is only created once the
+ * IPv6 node answers with its own SYN.
+ *
+ * The table is a fixed array of small buckets, so it can never grow. Entries become stale
+ * TCP_INCOMING_SYN seconds after their SYN arrived (no timer needed), and when a bucket is full
+ * the oldest entry is overwritten. The worst a SYN flood can do is make some legitimate handshakes
+ * start over.
+ *
+ * The functions assume the caller holds bib_session_lock.
+ */
+
+#include <linux/types.h>
+#include "nat64/comm/types.h"
+
+
+int pending_syn_init(void);
+void pending_syn_destroy(void);
+
+/** Records that "pair"'s remote IPv4 node sent a SYN towards "pair"'s local address. */
+void pending_syn_add(struct ipv4_pair *pair);
+/** Returns whether "pair" had a (non-stale) SYN pending, and forgets it. */
+bool pending_syn_remove(struct ipv4_pair *pair);
+
+
+#endif /* _NF_NAT64_PENDING_SYN_H */
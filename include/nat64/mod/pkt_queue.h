@@ -0,0 +1,41 @@
+#ifndef _NF_NAT64_PKT_QUEUE_H
+#define _NF_NAT64_PKT_QUEUE_H
+
+/**
+ * @file
+ * Storage of IPv4 SYNs which cannot be translated yet (RFC 6146 section 3.5.2.2).
+ *
+ * When a IPv4 node attempts to open a TCP connection Jool has no mapping for (or which is being
+ * blocked by address-dependent filtering), the SYN is kept for TCP_INCOMING_SYN seconds, in case
+ * the IPv6 node is opening the same connection simultaneously (NAT traversal does that). If it
+ * isn't, the IPv4 node gets an ICMP error containing its SYN.
+ *
+ * Since anyone can send SYNs, the storage is bounded: it never holds more than PKTQUEUE_MAX_BYTES
+ * (the oldest packets are dropped first to make room), and no single IPv4 node can have more than
+ * PKTQUEUE_MAX_PER_SOURCE packets stored at once.
+ *
+ * The ICMP errors are not sent from the timer, but from a work item, outside of
+ * bib_session_lock.
+ *
+ * Except for init and destroy, the functions assume the caller holds bib_session_lock.
+ */
+
+#include "nat64/mod/packet.h"
+
+
+int pktqueue_init(void);
+void pktqueue_destroy(void);
+
+/**
+ * Stores (a clone of) "frag"'s packet, which is the IPv4 SYN "pair" describes.
+ * Returns -ENOSPC if its node already has too many packets stored.
+ */
+int pktqueue_add(struct ipv4_pair *pair, struct fragment *frag);
+/**
+ * Forgets the packet stored for "pair", if any (its connection is no longer in need of an ICMP
+ * error).
+ */
+void pktqueue_remove(struct ipv4_pair *pair);
+
+
+#endif /* _NF_NAT64_PKT_QUEUE_H */
@@ -38,6 +38,33 @@
 		result; \
 	})
 
+/**
+ * Returns the first node (in rb_first()/rb_next() order) which compare_cb considers lower or equal
+ * than "expected". Returns NULL if there is none.
+ *
+ * Bigger nodes are stored to the left, so iterating from the result using rb_next() visits
+ * "expected" (if it exists) and then everything lower. Use it to walk ranges.
+ */
+#define rbtree_find_bound(expected, root, compare_cb, type, hook_name) \
+	({ \
+		type *result = NULL; \
+		struct rb_node *node; \
+		\
+		node = (root)->rb_node; \
+		while (node) { \
+			type *entry = rb_entry(node, type, hook_name); \
+			\
+			if (compare_cb(entry, expected) <= 0) { \
+				result = entry; \
+				node = node->rb_left; \
+			} else { \
+				node = node->rb_right; \
+			} \
+		} \
+		\
+		result; \
+	})
+
 /**
  * This is just a stock add a node to a Red-Black tree.
  *
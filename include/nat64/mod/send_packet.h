@@ -29,6 +29,12 @@ struct dst_entry *route_ipv4(struct iphdr *hdr_ip, void *l4_hdr, l4_protocol l4_
  */
 struct dst_entry *route_ipv6(struct ipv6hdr *hdr_ip, void *l4_hdr, l4_protocol l4_proto, u32 mark);
 
+/**
+ * Returns the serial number "dst" (an IPv6 route) has to match for dst_check() to keep it; this is
+ * what ip6_dst_store() does for sockets. (IPv4 routes don't need one; their cookie is zero.)
+ */
+u32 route6_cookie(struct dst_entry *dst);
+
 /**
  * Puts all of "pkt"'s skbs on the network.
  *
@@ -13,6 +13,21 @@
 #include "nat64/mod/bib.h"
 
 
+/**
+ * A route one of the session's translated packets took, kept so the rest don't need to look it up
+ * again.
+ */
+struct session_route {
+	/** The route. NULL if unknown. */
+	struct dst_entry *dst;
+	/** The routing table's serial number when "dst" was looked up (see route6_cookie()). */
+	u32 cookie;
+	/** The packet's mark, which policy routing might have looked at. */
+	u32 mark;
+	/** The IPv4 TOS or IPv6 flow label, which policy routing might also have looked at. */
+	__be32 flow;
+};
+
 /**
  * A row, intended to be part of one of the session tables.
  * The mapping between the connections, as perceived by both sides (IPv4 vs IPv6).
@@ -54,6 +69,21 @@ struct session_entry {
 	 */
 	u_int8_t state;
 
+	/** Has the HA peer been told about this session? (see sync.h) */
+	bool synced;
+	/** The state the peer was last told about. Only meaningful if "synced" is true. */
+	u_int8_t synced_state;
+	/** The dying_time the peer was last told about. Only meaningful if "synced" is true. */
+	unsigned long synced_dying_time;
+
+	/** Generation of the tables when the session was created or last changed state. */
+	u64 generation;
+
+	/** Route of the last packet translated towards the IPv6 node. */
+	struct session_route route6;
+	/** Route of the last packet translated towards the IPv4 node. */
+	struct session_route route4;
+
 	struct rb_node tree6_hook;
 	struct rb_node tree4_hook;
 };
@@ -123,6 +153,24 @@ int session_get(struct tuple *tuple, struct session_entry **result);
  */
 bool session_allow(struct tuple *tuple);
 
+/**
+ * Returns the route the session the outgoing tuple "tuple" belongs to found for the last packet
+ * it translated in the same direction, provided that packet had the same mark and flow as "key"
+ * and dst_check() still approves of the route. Returns NULL otherwise.
+ *
+ * The caller owns a reference to the result.
+ * You must lock bib_session_lock before calling this function.
+ */
+struct dst_entry *session_route_get(struct tuple *tuple, struct session_route *key);
+/**
+ * Stores "key" (a route and the packet fields it was looked up for) in the session the outgoing
+ * tuple "tuple" belongs to, so session_route_get() can return it later. Takes its own reference
+ * to "key->dst". Does nothing if there's no such session.
+ *
+ * You must lock bib_session_lock before calling this function.
+ */
+void session_route_set(struct tuple *tuple, struct session_route *key);
+
 /**
  * Adds "entry" to the session table whose layer-4 protocol is "entry->l4_proto".
  * Expects all fields but the list_heads from "entry" to have been initialized.
@@ -148,7 +196,27 @@ int session_add(struct session_entry *entry);
 int session_remove(struct session_entry *entry);
 
 int session_for_each(l4_protocol l4_proto, int (*func)(struct session_entry *, void *), void *arg);
+/**
+ * Same as session_for_each(), except it starts at "from" (or the first session that would follow
+ * it, if it is not in the table) instead of at the beginning. session_for_each() visits the
+ * sessions in descending IPv4 pair order, so this can be used to resume a walk.
+ *
+ * You must lock bib_session_lock before calling this function.
+ */
+int session_for_each_from(l4_protocol l4_proto, struct ipv4_pair *from,
+		int (*func)(struct session_entry *, void *), void *arg);
+/**
+ * Calls "func" for every session from the "l4_proto" table whose local IPv4 side is "addr" and a
+ * port between "port_min" and "port_max" (inclusive). Only visits those sessions, in descending
+ * order; if "from" is not NULL, the walk starts there instead of at "port_max". You must lock
+ * bib_session_lock before calling this function.
+ */
+int session_for_each_range4(l4_protocol l4_proto, struct in_addr *addr, __u16 port_min,
+		__u16 port_max, struct ipv4_pair *from,
+		int (*func)(struct session_entry *, void *), void *arg);
 int session_count(l4_protocol proto, __u64 *result);
+/** Returns the number of bytes each session entry occupies. */
+size_t session_entry_size(void);
 
 /**
  * Helper function, intended to initialize a Session entry.
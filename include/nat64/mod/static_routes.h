@@ -20,6 +20,16 @@
  */
 int add_static_route(struct request_bib *req);
 
+/**
+ * Adds "count" static entries to the BIBs, as a single transaction: if any of them cannot be added,
+ * none of them are.
+ *
+ * @param entries the entries to be added.
+ * @param count length of "entries".
+ * @return success status as a unix error code.
+ */
+int add_static_routes(struct bib_import_us *entries, __u32 count);
+
 /**
  * Mainly deletes static entries from the BIB. It can also remove dynamic entries, though.
  *
@@ -0,0 +1,30 @@
+#ifndef _NF_NAT64_STATS_H
+#define _NF_NAT64_STATS_H
+
+/**
+ * @file
+ * Per-CPU packet counters.
+ *
+ * Incrementing is lock-free and only touches the current CPU's cache line, so it is cheap enough
+ * to be done on every packet. The counters are added up only when somebody asks for them.
+ */
+
+#include <linux/types.h>
+#include "nat64/comm/stats.h"
+
+
+int stats_init(void);
+void stats_destroy(void);
+
+/** Adds one to the "counter" counter of the current CPU. */
+void stats_inc(enum stat_counter counter);
+/** Adds "value" to the "counter" counter of the current CPU. */
+void stats_add(enum stat_counter counter, u64 value);
+/**
+ * Adds up every CPU's counters and places the result in "result".
+ * "result" must be able to hold STAT_COUNT elements.
+ */
+void stats_sum(__u64 *result);
+
+
+#endif /* _NF_NAT64_STATS_H */
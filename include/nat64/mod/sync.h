@@ -0,0 +1,52 @@
+#ifndef _NF_NAT64_SYNC_H
+#define _NF_NAT64_SYNC_H
+
+/**
+ * @file
+ * The active side of session synchronization (see nat64/comm/sync.h): a queue of the session
+ * changes the HA peer has not heard of yet.
+ *
+ * Only sessions are synchronized; the peer infers their BIB entries (dynamic BIB entries cannot
+ * outlive their sessions anyway, and static ones are configuration, not state). Not every update
+ * is worth sending either: a session is queued when it is created, when its state changes, when
+ * it dies, and when its lifetime has been renewed enough that the peer's copy would expire
+ * noticeably sooner (see sync_session_update()).
+ *
+ * Nothing is queued while the queue is disabled, which config.c does while nobody listens.
+ */
+
+#include "nat64/comm/sync.h"
+#include "nat64/mod/session.h"
+
+
+int sync_init(void);
+void sync_destroy(void);
+
+/**
+ * Starts or stops queuing session changes. Stopping also forgets the ones that were queued.
+ */
+void sync_set_enabled(bool enabled);
+
+/**
+ * Queues "session" if the peer's copy of it is missing or stale. Call after changing its state or
+ * lifetime. You must lock bib_session_lock before calling this function.
+ */
+void sync_session_update(struct session_entry *session);
+/**
+ * Queues the death of "session". You must lock bib_session_lock before calling this function.
+ */
+void sync_session_remove(struct session_entry *session);
+
+/** Writes "session" in "record", in the format the peer expects. */
+void sync_session_to_record(struct session_entry *session, enum sync_type type,
+		struct sync_session *record);
+
+/**
+ * Moves up to "max" of the oldest queued records to "records", and returns how many there were.
+ * "lost" will be true if some records were dropped because the queue overflowed since the last
+ * call.
+ */
+unsigned int sync_pop(struct sync_session *records, unsigned int max, bool *lost);
+
+
+#endif /* _NF_NAT64_SYNC_H */
@@ -0,0 +1,63 @@
+#ifndef _NF_NAT64_TABLE_QUERY_H
+#define _NF_NAT64_TABLE_QUERY_H
+
+/**
+ * @file
+ * Filtered and paginated walks through the BIB and session tables (see struct table_query).
+ *
+ * When the query restricts the addresses, only the matching section of the table is visited:
+ * - A IPv6 prefix walks the matching range of the BIB's IPv6 tree (and, for sessions, the
+ *   sessions of those BIB entries).
+ * - A IPv4 address walks the matching range of the IPv4 tree.
+ * Anything else is evaluated on the entries as they are visited. Once the limit is reached, the
+ * walk stops.
+ *
+ * If the callback fails, the walk stops and the cursor is left pointing to the last entry that
+ * was handed to it successfully, so a later call with the same query and cursor resumes right
+ * after it. The lock can be released in between; entries added or removed in the meantime might
+ * or might not be visited, but the rest are visited exactly once.
+ *
+ * You must lock bib_session_lock before calling these functions.
+ */
+
+#include "nat64/comm/config_proto.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+
+
+/**
+ * Where a walk is. Only meaningful to the query (and table) it was used with.
+ */
+struct query_cursor {
+	/** Matching entries which have been skipped because of the offset. */
+	__u64 skipped;
+	/** Matching entries which have been handed to the callback. */
+	__u64 returned;
+
+	/** False if nothing has been visited yet, in which case the keys below are garbage. */
+	bool started;
+	/** Keys of the last BIB entry visited (or the BIB entry of the last session visited). */
+	struct ipv4_tuple_address bib4;
+	struct ipv6_tuple_address bib6;
+	/** Key of the last session visited. */
+	struct ipv4_pair session4;
+};
+
+/** Points "cursor" to the beginning of any table. */
+void query_cursor_init(struct query_cursor *cursor);
+
+/**
+ * Calls "func" for every entry from the "l4_proto" BIB which matches "query", starting after
+ * "cursor".
+ */
+int query_bib(l4_protocol l4_proto, struct table_query *query, struct query_cursor *cursor,
+		int (*func)(struct bib_entry *, void *), void *arg);
+/**
+ * Calls "func" for every session from the "l4_proto" table which matches "query", starting after
+ * "cursor".
+ */
+int query_session(l4_protocol l4_proto, struct table_query *query, struct query_cursor *cursor,
+		int (*func)(struct session_entry *, void *), void *arg);
+
+
+#endif /* _NF_NAT64_TABLE_QUERY_H */
@@ -0,0 +1,26 @@
+#ifndef _NF_NAT64_TCP_PROBE_H
+#define _NF_NAT64_TCP_PROBE_H
+
+/**
+ * @file
+ * Keepalive probes for idle TCP sessions (RFC 6146 section 3.5.2.2, ESTABLISHED state expiry).
+ *
+ * The session timer runs with bib_session_lock held, so it only queues the probes here. They are
+ * built, routed and sent later, in a batch, from a work item. Routes are cached across batches,
+ * and only looked up again once the routing table changes.
+ */
+
+#include "nat64/mod/session.h"
+
+
+int tcpprobe_init(void);
+void tcpprobe_destroy(void);
+
+/**
+ * Schedules a probe towards "session"'s IPv6 node. "session" is copied, so it can die right after
+ * this returns.
+ */
+void tcpprobe_add(struct session_entry *session);
+
+
+#endif /* _NF_NAT64_TCP_PROBE_H */
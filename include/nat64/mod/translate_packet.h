@@ -65,6 +65,12 @@ void translate_packet_destroy(void);
 int clone_translate_config(struct translate_config *clone);
 int set_translate_config(__u32 operation, struct translate_config *new_config);
 
+struct translate_config *prepare_translate_config(void);
+int merge_translate_config(__u32 operation, struct translate_config *candidate,
+		struct translate_config *new_config);
+void commit_translate_config(struct translate_config *candidate);
+void abort_translate_config(struct translate_config *candidate);
+
 verdict translating_the_packet(struct tuple *tuple, struct packet *in, struct packet **out);
 
 verdict translate_inner_packet(struct tuple *tuple, struct fragment *in_inner,
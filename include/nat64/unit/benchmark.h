@@ -0,0 +1,44 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <linux/types.h>
+#include <linux/ktime.h>
+
+
+/**
+ * The durations are also sorted into a histogram, so percentiles can be estimated without storing
+ * every sample. Each power of two is split into 2^BENCH_SUB_BITS buckets, which means a
+ * percentile is off by at most 1/2^BENCH_SUB_BITS (25%) of its value.
+ */
+#define BENCH_SUB_BITS 2
+#define BENCH_BUCKETS ((64 - BENCH_SUB_BITS + 1) << BENCH_SUB_BITS)
+
+/**
+ * Timing of a repeated operation.
+ * Benchmarks are modules too, and report through the kernel log, just like the unit tests.
+ */
+struct bench_result {
+	char *name;
+	/** Number of times the operation was measured. */
+	u64 count;
+	/** Number of times the operation did not do what was expected. */
+	u64 failures;
+	/** Sum, minimum and maximum of the measured durations, in nanoseconds. */
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+	/** Number of durations which landed in each bucket. */
+	u32 histogram[BENCH_BUCKETS];
+};
+
+void bench_init(struct bench_result *result, char *name);
+/** Accounts an operation which started at "start" and ended at "end". */
+void bench_add(struct bench_result *result, ktime_t start, ktime_t end);
+/** Adds "other"'s runs to "result". */
+void bench_merge(struct bench_result *result, struct bench_result *other);
+/** Estimates the duration (in nanoseconds) "permille"/1000 of the runs did not exceed. */
+u64 bench_percentile(struct bench_result *result, unsigned int permille);
+void bench_print(struct bench_result *result);
+
+
+#endif /* BENCHMARK_H_ */
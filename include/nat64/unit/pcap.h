@@ -0,0 +1,50 @@
+#ifndef PCAP_H_
+#define PCAP_H_
+
+#include <linux/types.h>
+#include <linux/fs.h>
+#include <linux/skbuff.h>
+
+
+/**
+ * @file
+ * Minimal reader and writer of classic (libpcap) capture files, so the benchmarks can be fed real
+ * traffic.
+ *
+ * Files are read whole into memory. Ethernet, Linux cooked and raw IP link types are understood;
+ * only the layer-3 packets are kept.
+ */
+
+/** One IPv4 or IPv6 packet from a capture. */
+struct pcap_packet {
+	/** Capture time, in nanoseconds since the epoch. */
+	u64 timestamp;
+	/** The packet, starting at its layer-3 header. Points to the parent's buffer. */
+	unsigned char *data;
+	u32 len;
+};
+
+struct pcap_file {
+	/** The file's contents. */
+	unsigned char *buffer;
+	struct pcap_packet *packets;
+	unsigned int count;
+	/** Records which were truncated or did not contain IP. */
+	unsigned int skipped;
+};
+
+int pcap_load(char *path, struct pcap_file *pcap);
+void pcap_free(struct pcap_file *pcap);
+
+/** A capture being written. Packets are stored as raw IP. */
+struct pcap_output {
+	struct file *file;
+	loff_t pos;
+};
+
+int pcap_create(char *path, struct pcap_output *output);
+int pcap_write_skb(struct pcap_output *output, struct sk_buff *skb);
+void pcap_close(struct pcap_output *output);
+
+
+#endif /* PCAP_H_ */
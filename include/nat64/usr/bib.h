@@ -2,9 +2,12 @@
 #define _BIB_H
 
 #include "nat64/comm/types.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/usr/output.h"
 
 
-int bib_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname);
+int bib_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname,
+		enum output_format format, struct table_query *query);
 int bib_count(bool use_tcp, bool use_udp, bool use_icmp);
 
 int bib_add(bool use_tcp, bool use_udp, bool use_icmp, struct ipv6_tuple_address *ipv6,
@@ -13,5 +16,8 @@ int bib_add(bool use_tcp, bool use_udp, bool use_icmp, struct ipv6_tuple_address
 int bib_remove_ipv6(bool use_tcp, bool use_udp, bool use_icmp, struct ipv6_tuple_address *ipv6);
 int bib_remove_ipv4(bool use_tcp, bool use_udp, bool use_icmp, struct ipv4_tuple_address *ipv4);
 
+int bib_import(char *file_name);
+int bib_export(bool use_tcp, bool use_udp, bool use_icmp, char *file_name);
+
 
 #endif /* _BIB_H */
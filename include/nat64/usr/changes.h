@@ -0,0 +1,17 @@
+#ifndef _CHANGES_H
+#define _CHANGES_H
+
+#include <stdbool.h>
+#include "nat64/usr/output.h"
+
+
+/**
+ * If "since_set" is false, prints the tables' current generation, and the oldest one whose
+ * changes the module still remembers. Otherwise, prints the BIB and session changes which came
+ * after generation "since".
+ */
+int changes_display(bool since_set, __u64 since, enum output_format format,
+		bool numeric_hostname);
+
+
+#endif /* _CHANGES_H */
@@ -1,9 +1,37 @@
 #ifndef _DNS_H
 #define _DNS_H
 
+/**
+ * @file
+ * Reverse DNS for the display commands.
+ *
+ * Names are cached for the lifetime of the program, so every address is only looked up once.
+ * (Lookups which time out or fail temporarily are not cached; they are retried when requested
+ * again.) Callers which know their addresses in advance should dns_start(), dns_request_*() them
+ * as they arrive, print whatever dns_ready_*() says is ready, and dns_stop() once everything is
+ * printed; the lookups then happen concurrently and the printing functions give up on each of
+ * them after the timeout. Addresses nobody requested are looked up (synchronously) when printed.
+ */
 
 #include "nat64/comm/types.h"
 
+/** Default milliseconds the printing functions wait for a lookup. */
+#define DNS_DEFAULT_TIMEOUT 2000
+
+void dns_set_timeout(unsigned int millis);
+
+void dns_request_ipv6(struct in6_addr *addr);
+void dns_request_ipv4(struct in_addr *addr);
+/**
+ * Returns whether printing "addr" would not block; ie. its lookup is over, or has timed out.
+ */
+bool dns_ready_ipv6(struct in6_addr *addr);
+bool dns_ready_ipv4(struct in_addr *addr);
+/** Starts resolving the requested addresses, and any requested from now on. */
+void dns_start(void);
+/** Gives up on the addresses that are still pending. */
+void dns_stop(void);
+
 void print_ipv6_tuple(struct ipv6_tuple_address *tuple, bool numeric_hostname);
 void print_ipv4_tuple(struct ipv4_tuple_address *tuple, bool numeric_hostname);
 
@@ -0,0 +1,14 @@
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+#include <stdbool.h>
+
+
+/**
+ * Prints the events recorded since the last time anyone asked. If "follow" is true, keeps
+ * printing them as the module publishes them instead, and never returns (unless it fails).
+ */
+int events_display(bool numeric_hostname, bool follow);
+
+
+#endif /* _EVENTS_H */
@@ -8,10 +8,16 @@
 #define DROP_BY_ADDR_OPT		"dropAddr"
 #define DROP_ICMP6_INFO_OPT		"dropInfo"
 #define DROP_EXTERNAL_TCP_OPT	"dropTCP"
+#define DEFER_EXTERNAL_TCP_OPT	"deferTCP"
 #define UDP_TIMEOUT_OPT			"toUDP"
 #define ICMP_TIMEOUT_OPT		"toICMP"
 #define TCP_EST_TIMEOUT_OPT		"toTCPest"
 #define TCP_TRANS_TIMEOUT_OPT 	"toTCPtrans"
+#define BIB_MAX_OPT				"maxBIB"
+#define SESSION_MAX_OPT			"maxSessions"
+#define BIB_NODE_MAX_OPT		"maxBIBPerNode"
+#define SESSION_NODE_MAX_OPT	"maxSessionsPerNode"
+#define SESSION_EVICT_OPT		"evictSessionsAt"
 
 int filtering_request(__u32 operation, struct filtering_config *config);
 
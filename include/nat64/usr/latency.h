@@ -0,0 +1,14 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <linux/types.h>
+#include "nat64/comm/latency.h"
+
+
+#define LATENCY_ENABLED_OPT		"measureLatency"
+#define LATENCY_RESET_OPT		"resetLatency"
+
+int latency_request(__u32 operation, struct latency_config *config);
+
+
+#endif /* _LATENCY_H */
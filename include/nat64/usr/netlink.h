@@ -15,8 +15,56 @@
 	#error "Unsupported LIBNL library version number (< 3.0)."
 #endif
 
+/**
+ * Sends "request" to the kernel module over a throwaway socket, and hands the response to "cb".
+ * If the response is data (or a table, in which case "cb" might be called several times), "cb"
+ * receives the data. Otherwise it receives the ack.
+ */
 int netlink_request(void *request, __u16 request_len, int (*cb)(struct nl_msg *, void *),
 		void *cb_arg);
 
+/*
+ * Same thing, split in steps, so several requests can share a socket.
+ */
+int netlink_open(struct nl_sock **result);
+int netlink_send(struct nl_sock *sk, void *request, __u32 request_len,
+		int (*cb)(struct nl_msg *, void *), void *cb_arg);
+void netlink_close(struct nl_sock *sk);
+
+/**
+ * Returns the payload of "hdr", one of the module's responses (as handed to the callbacks above).
+ * The length is zero if "hdr" is an ack.
+ */
+void *netlink_data(struct nlmsghdr *hdr);
+int netlink_datalen(struct nlmsghdr *hdr);
+
+/**
+ * Opens a socket which will receive the messages the module publishes to its "group" multicast
+ * group (JOOL_GENL_EVENTS_GROUP or JOOL_GENL_SYNC_GROUP). Close it with netlink_close().
+ */
+int netlink_subscribe(char *group, struct nl_sock **result);
+/**
+ * Waits for messages to arrive to "sk" (see netlink_subscribe()), and hands them to "cb".
+ * Returns -ENOBUFS if some messages were lost because they were not read fast enough.
+ */
+int netlink_receive(struct nl_sock *sk, int (*cb)(struct nl_msg *, void *), void *cb_arg);
+
+/**
+ * Hands every message the module publishes to its events group to "cb". Only returns on error.
+ */
+int netlink_listen_events(int (*cb)(struct nl_msg *, void *), void *cb_arg);
+
+/*
+ * Between netlink_batch_begin() and netlink_batch_commit(), netlink_request() does not send
+ * anything; it collects the requests instead. The commit then sends them together, over a single
+ * socket and as a single message, and the module applies either all of them or none.
+ *
+ * Only updates (pool additions and removals, and filtering, translate and fragmentation changes)
+ * can be collected, since their responses are not needed.
+ */
+int netlink_batch_begin(void);
+int netlink_batch_commit(void);
+void netlink_batch_abort(void);
+
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef _OUTPUT_H
+#define _OUTPUT_H
+
+/**
+ * @file
+ * Machine-readable formats for the BIB, session and change displays.
+ *
+ * Every format prints one record per entry, straight from the netlink buffers and through a big
+ * stdout buffer, so huge tables can be piped somewhere else in a single pass. Addresses are never
+ * resolved to names.
+ */
+
+#include "nat64/comm/types.h"
+#include "nat64/comm/config_proto.h"
+
+
+enum output_format {
+	/** Human-friendly, multi-line output. The default. */
+	OUTPUT_TEXT = 0,
+	/** Comma-separated values; the first line names the columns. */
+	OUTPUT_CSV,
+	/** One JSON object per line. */
+	OUTPUT_JSON_LINES,
+	/** "struct output_record"s. */
+	OUTPUT_BINARY,
+};
+
+enum output_record_type {
+	RECORD_BIB = 1,
+	RECORD_SESSION = 2,
+	RECORD_CHANGE = 3,
+};
+
+/**
+ * Header of every record of the binary format. It is followed by "length" bytes, which are a
+ * "struct bib_entry_us", a "struct session_entry_us" or a "struct change_us" (depending on
+ * "type").
+ *
+ * Everything is in host byte order, except for the addresses (which are in network byte order).
+ */
+struct output_record {
+	__u8 type;
+	__u8 l4_proto;
+	__u16 length;
+};
+
+int str_to_output_format(const char *str, enum output_format *result);
+
+/**
+ * Prepares stdout to print records in "format". Call it before anything else is printed.
+ */
+void output_start(enum output_format format);
+/**
+ * Flushes stdout. Returns nonzero if any of the records could not be written.
+ */
+int output_end(void);
+
+void output_bib_header(enum output_format format);
+void output_bib_entry(enum output_format format, l4_protocol l4_proto, struct bib_entry_us *entry);
+void output_session_header(enum output_format format);
+void output_session_entry(enum output_format format, struct session_entry_us *entry);
+void output_change_header(enum output_format format);
+void output_change(enum output_format format, struct change_us *change);
+
+
+#endif /* _OUTPUT_H */
@@ -2,10 +2,17 @@
 #define _SESSION_H
 
 #include <stdbool.h>
+#include "nat64/comm/config_proto.h"
+#include "nat64/usr/output.h"
 
 
-int session_display(bool use_tcp, bool use_udp, bool use_icmpm, bool numeric_hostname);
+int session_display(bool use_tcp, bool use_udp, bool use_icmpm, bool numeric_hostname,
+		enum output_format format, struct table_query *query);
 int session_count(bool use_tcp, bool use_udp, bool use_icmp);
+/**
+ * Removes every session of the IPv6 nodes from "prefix", and their dynamic BIB entries.
+ */
+int session_flush(bool use_tcp, bool use_udp, bool use_icmp, struct ipv6_prefix *prefix);
 
 
 #endif /* _SESSION_H */
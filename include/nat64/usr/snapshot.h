@@ -0,0 +1,74 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+/**
+ * @file
+ * Images of the BIB and session tables, so they can survive a reload of the module.
+ *
+ * An image is a snapshot_hdr followed by blocks, until the end of the file. Each block is a
+ * snapshot_block followed by "count" records of its type. The static BIB entries come first, so
+ * the sessions which use them find them when the image is restored. (The dynamic BIB entries are
+ * implicit in the sessions, just like in session synchronization; see nat64/comm/sync.h.)
+ *
+ * Everything is in network byte order, so images can be moved between machines.
+ */
+
+#include <linux/types.h>
+#include <netinet/in.h>
+
+
+#define SNAPSHOT_MAGIC "JSNP"
+/** Version of the format. Images from other versions are refused. */
+#define SNAPSHOT_VERSION 1
+/** Maximum number of records per block; also the number of records restored per request. */
+#define SNAPSHOT_BLOCK_MAX 512
+
+struct snapshot_hdr {
+	/** SNAPSHOT_MAGIC, without the null character. */
+	char magic[4];
+	/** SNAPSHOT_VERSION. */
+	__u8 version;
+	__u8 reserved[3];
+	/** When the image was taken; milliseconds since the epoch. */
+	__be64 time;
+};
+
+enum snapshot_block_type {
+	/** The block contains snapshot_bibs. */
+	SNAPSHOT_BIB = 1,
+	/** The block contains sync_sessions (see nat64/comm/sync.h). */
+	SNAPSHOT_SESSIONS = 2,
+};
+
+struct snapshot_block {
+	/** An "enum snapshot_block_type". */
+	__u8 type;
+	__u8 reserved;
+	__be16 count;
+};
+
+/** A static BIB entry. */
+struct snapshot_bib {
+	/** An "l4_protocol". */
+	__u8 l4_proto;
+	__u8 reserved;
+	__be16 port6;
+	struct in6_addr addr6;
+	struct in_addr addr4;
+	__be16 port4;
+	__u8 reserved2[2];
+};
+
+/**
+ * Writes the BIB and session tables to "file_name" ("-" is standard output).
+ */
+int snapshot_save(char *file_name);
+/**
+ * Installs the entries from the "file_name" image ("-" is standard input). The sessions lose the
+ * time which has passed since the image was taken; the ones which would have expired meanwhile
+ * are not restored.
+ */
+int snapshot_restore(char *file_name);
+
+
+#endif /* _SNAPSHOT_H */
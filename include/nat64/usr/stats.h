@@ -0,0 +1,10 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+
+int stats_display(void);
+/** Returns the human-readable name of the "counter" counter (an enum stat_counter). */
+char *stats_name(unsigned int counter);
+
+
+#endif /* _STATS_H */
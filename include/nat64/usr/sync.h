@@ -0,0 +1,23 @@
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#include <stdbool.h>
+
+
+/**
+ * Sends the session table to the backup translator listening at "peer" (an ADDR#PORT), and then
+ * every change the module publishes, as UDP datagrams. Never returns (unless it fails).
+ */
+int sync_send(char *peer);
+
+/**
+ * Installs the sessions which arrive to the local ADDR#PORT "local" from the address "from" (where
+ * a sync_send() runs). Datagrams from other addresses are dropped, but they are not authenticated,
+ * so the link has to be trusted. Never returns (unless it fails). If "loopback" is true, prints
+ * the sessions instead; this allows testing both ends on a single machine (which can only host
+ * one instance of the module).
+ */
+int sync_receive(char *local, char *from, bool loopback);
+
+
+#endif /* _SYNC_H */
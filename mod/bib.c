@@ -2,6 +2,7 @@
 
 #include <net/ipv6.h>
 #include "nat64/mod/rbtree.h"
+#include "nat64/mod/changelog.h"
 
 
 /********************************************
@@ -88,6 +89,28 @@ static int compare_full4(struct bib_entry *bib, struct ipv4_tuple_address *addr)
 	return gap;
 }
 
+/**
+ * Returns in "result" the biggest address "prefix" contains.
+ */
+static void prefix_last_address(struct ipv6_prefix *prefix, struct in6_addr *result)
+{
+	__be32 mask;
+	int bits;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		bits = prefix->len - 32 * i;
+		if (bits <= 0)
+			mask = 0;
+		else if (bits >= 32)
+			mask = cpu_to_be32(0xFFFFFFFFU);
+		else
+			mask = cpu_to_be32(0xFFFFFFFFU << (32 - bits));
+
+		result->s6_addr32[i] = (prefix->address.s6_addr32[i] & mask) | ~mask;
+	}
+}
+
 /*******************************
  * Public functions.
  *******************************/
@@ -225,6 +248,7 @@ int bib_add(struct bib_entry *entry, l4_protocol l4_proto)
 	}
 
 	table->count++;
+	changelog_bib(CHANGE_CREATED, entry, l4_proto);
 	return 0;
 }
 
@@ -249,6 +273,7 @@ int bib_remove(struct bib_entry *entry, l4_protocol l4_proto)
 	rb_erase(&entry->tree4_hook, &table->tree4);
 
 	table->count--;
+	changelog_bib(CHANGE_REMOVED, entry, l4_proto);
 	return 0;
 }
 
@@ -262,6 +287,7 @@ struct bib_entry *bib_create(struct ipv4_tuple_address *ipv4, struct ipv6_tuple_
 	result->ipv4 = *ipv4;
 	result->ipv6 = *ipv6;
 	result->is_static = is_static;
+	result->generation = 0;
 	INIT_LIST_HEAD(&result->sessions);
 	RB_CLEAR_NODE(&result->tree6_hook);
 	RB_CLEAR_NODE(&result->tree4_hook);
@@ -269,6 +295,11 @@ struct bib_entry *bib_create(struct ipv4_tuple_address *ipv4, struct ipv6_tuple_
 	return result;
 }
 
+size_t bib_entry_size(void)
+{
+	return kmem_cache_size(entry_cache);
+}
+
 void bib_kfree(struct bib_entry *bib)
 {
 	kmem_cache_free(entry_cache, bib);
@@ -293,58 +324,107 @@ int bib_for_each(l4_protocol l4_proto, int (*func)(struct bib_entry *, void *),
 	return 0;
 }
 
-int bib_for_each_ipv6(l4_protocol l4_proto, struct in6_addr *addr,
+int bib_for_each_from(l4_protocol l4_proto, struct ipv4_tuple_address *from,
 		int (*func)(struct bib_entry *, void *), void *arg)
 {
 	struct bib_table *table;
 	struct bib_entry *bib;
 	struct rb_node *node;
 	int error;
-	bool found;
 
-	/* Sanitize */
+	error = get_bib_table(l4_proto, &table);
+	if (error)
+		return error;
+
+	bib = rbtree_find_bound(from, &table->tree4, compare_full4, struct bib_entry, tree4_hook);
+	while (bib) {
+		error = func(bib, arg);
+		if (error)
+			return error;
+
+		node = rb_next(&bib->tree4_hook);
+		bib = node ? rb_entry(node, struct bib_entry, tree4_hook) : NULL;
+	}
+
+	return 0;
+}
+
+int bib_for_each_ipv6(l4_protocol l4_proto, struct in6_addr *addr,
+		int (*func)(struct bib_entry *, void *), void *arg)
+{
+	struct ipv6_prefix prefix;
+
 	if (!addr)
 		return -EINVAL;
+
+	prefix.address = *addr;
+	prefix.len = 128;
+	return bib_for_each_prefix6(l4_proto, &prefix, NULL, func, arg);
+}
+
+int bib_for_each_prefix6(l4_protocol l4_proto, struct ipv6_prefix *prefix,
+		struct ipv6_tuple_address *from, int (*func)(struct bib_entry *, void *), void *arg)
+{
+	struct bib_table *table;
+	struct ipv6_tuple_address last;
+	struct bib_entry *bib;
+	struct rb_node *node;
+	int error;
+
 	error = get_bib_table(l4_proto, &table);
 	if (error)
 		return error;
 
-	/* Find the top-most node in the tree whose IPv6 address is addr. */
-	bib = rbtree_find(addr, &table->tree6, compare_addr6, struct bib_entry, tree6_hook);
-	if (!bib)
-		return 0; /* _Successfully_ iterated through no entries. */
-
-	/* Keep moving left until we find the first node whose IPv6 address is addr. */
-	found = false;
-	do {
-		node = rb_prev(&bib->tree6_hook);
-
-		if (node) {
-			struct bib_entry *tmp = rb_entry(node, struct bib_entry, tree6_hook);
-			if (compare_addr6(tmp, addr))
-				found = true;
-			else
-				bib = tmp;
-		} else {
-			found = true;
-		}
-	} while (!found);
+	prefix_last_address(prefix, &last.address);
+	last.l4_id = 0xFFFF;
 
 	/*
-	 * Keep moving right until the address changes.
-	 * (The nodes are sorted by address first.)
+	 * Start from the biggest entry inside the prefix (or "from") and move down until we leave it.
+	 * The next node is found before "func" runs, so it can remove the entry it is handed.
 	 */
-	do {
+	bib = rbtree_find_bound(from ? from : &last, &table->tree6, compare_full6, struct bib_entry,
+			tree6_hook);
+	while (bib && ipv6_prefix_equal(&bib->ipv6.address, &prefix->address, prefix->len)) {
+		node = rb_next(&bib->tree6_hook);
+
 		error = func(bib, arg);
 		if (error)
 			return error;
 
-		node = rb_next(&bib->tree6_hook);
-		if (!node)
-			break;
+		bib = node ? rb_entry(node, struct bib_entry, tree6_hook) : NULL;
+	}
+
+	return 0;
+}
+
+int bib_for_each_range4(l4_protocol l4_proto, struct in_addr *addr, __u16 port_min,
+		__u16 port_max, struct ipv4_tuple_address *from,
+		int (*func)(struct bib_entry *, void *), void *arg)
+{
+	struct bib_table *table;
+	struct ipv4_tuple_address last;
+	struct bib_entry *bib;
+	struct rb_node *node;
+	int error;
+
+	error = get_bib_table(l4_proto, &table);
+	if (error)
+		return error;
+
+	last.address = *addr;
+	last.l4_id = port_max;
+
+	/* Start from the biggest port in range (or "from") and move down until we leave the range. */
+	bib = rbtree_find_bound(from ? from : &last, &table->tree4, compare_full4, struct bib_entry,
+			tree4_hook);
+	while (bib && ipv4_addr_equals(&bib->ipv4.address, addr) && bib->ipv4.l4_id >= port_min) {
+		error = func(bib, arg);
+		if (error)
+			return error;
 
-		bib = rb_entry(node, struct bib_entry, tree6_hook);
-	} while (ipv6_addr_equals(addr, &bib->ipv6.address));
+		node = rb_next(&bib->tree4_hook);
+		bib = node ? rb_entry(node, struct bib_entry, tree4_hook) : NULL;
+	}
 
 	return 0;
 }
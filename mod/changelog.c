@@ -0,0 +1,127 @@
+#include "nat64/mod/changelog.h"
+#include "nat64/comm/constants.h"
+#include "nat64/mod/random.h"
+
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+
+#if (CHANGELOG_SIZE & (CHANGELOG_SIZE - 1)) != 0
+#error "CHANGELOG_SIZE must be a power of two."
+#endif
+
+/*
+ * The log. Everything here is protected by bib_session_lock, which the code that changes the
+ * tables already holds anyway.
+ */
+
+/** The latest changes. The one which created generation "g" is at slot (g - 1). */
+static struct change_us *ring;
+/** The generation the tables started at when the module was loaded. */
+static u64 epoch;
+/** The tables' current generation; that is, "epoch" plus the number of changes ever logged. */
+static u64 generation;
+
+
+int changelog_init(void)
+{
+	ring = vmalloc(CHANGELOG_SIZE * sizeof(*ring));
+	if (!ring) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the change log.");
+		return -ENOMEM;
+	}
+
+	/*
+	 * Every load starts counting from a random point, so a monitor which still remembers a
+	 * generation from a previous load is told it's stale instead of being handed unrelated
+	 * changes once the new generations catch up. The low 32 bits start at zero so each load can
+	 * log four billion changes before it could reach another load's; the top bit stays clear so
+	 * the counter never wraps.
+	 */
+	epoch = ((u64) (get_random_u32() >> 1)) << 32;
+	generation = epoch;
+	return 0;
+}
+
+void changelog_destroy(void)
+{
+	vfree(ring);
+	ring = NULL;
+}
+
+/**
+ * Returns the oldest generation the changes after which are all still in the log.
+ */
+static u64 oldest(void)
+{
+	return (generation - epoch > CHANGELOG_SIZE) ? (generation - CHANGELOG_SIZE) : epoch;
+}
+
+/**
+ * Claims the slot of the next change, and returns it (with its header already filled in).
+ */
+static struct change_us *next(enum change_table table, enum change_type type,
+		l4_protocol l4_proto)
+{
+	struct change_us *change = &ring[generation & (CHANGELOG_SIZE - 1)];
+
+	generation++;
+
+	memset(change, 0, sizeof(*change));
+	change->generation = generation;
+	change->table = table;
+	change->type = type;
+	change->l4_proto = l4_proto;
+	return change;
+}
+
+void changelog_bib(enum change_type type, struct bib_entry *bib, l4_protocol l4_proto)
+{
+	struct change_us *change = next(CHANGE_BIB, type, l4_proto);
+
+	change->is_static = bib->is_static;
+	change->ipv6.remote = bib->ipv6;
+	change->ipv4.local = bib->ipv4;
+	bib->generation = change->generation;
+}
+
+void changelog_session(enum change_type type, struct session_entry *session)
+{
+	struct change_us *change = next(CHANGE_SESSION, type, session->l4_proto);
+
+	change->ipv6 = session->ipv6;
+	change->ipv4 = session->ipv4;
+	session->generation = change->generation;
+}
+
+void changelog_range(struct changelog_range_us *range)
+{
+	spin_lock_bh(&bib_session_lock);
+	range->oldest = oldest();
+	range->latest = generation;
+	spin_unlock_bh(&bib_session_lock);
+}
+
+int changelog_for_each(u64 *since, int (*func)(struct change_us *, void *), void *arg)
+{
+	int error = 0;
+
+	spin_lock_bh(&bib_session_lock);
+
+	/* (A "since" from another load of the module is almost certainly out of range; see init.) */
+	if (*since < oldest() || *since > generation) {
+		error = -ESTALE;
+		goto end;
+	}
+
+	for (; *since < generation; (*since)++) {
+		error = func(&ring[*since & (CHANGELOG_SIZE - 1)], arg);
+		if (error)
+			break;
+	}
+	/* Fall through. */
+
+end:
+	spin_unlock_bh(&bib_session_lock);
+	return error;
+}
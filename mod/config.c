@@ -2,87 +2,111 @@
 #include "nat64/comm/constants.h"
 #include "nat64/comm/types.h"
 #include "nat64/comm/config_proto.h"
-#include "nat64/mod/out_stream.h"
 #include "nat64/mod/fragment_db.h"
 #include "nat64/mod/pool6.h"
 #include "nat64/mod/pool4.h"
 #include "nat64/mod/bib.h"
 #include "nat64/mod/session.h"
 #include "nat64/mod/static_routes.h"
+#include "nat64/mod/table_query.h"
 #include "nat64/mod/filtering_and_updating.h"
 #include "nat64/mod/translate_packet.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/sync.h"
+#include "nat64/mod/changelog.h"
+#include "nat64/mod/latency.h"
 
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <net/genetlink.h>
 
 
+/*
+ * Linux 3.7 renamed the netlink "pid"s to "portid"s.
+ * (That's commit 15e473046cb6e5d18a4d0057e61d76315230382b; v3.7-rc1~145^2~213.)
+ */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 7, 0)
+#define info_portid(info) ((info)->snd_pid)
+#define cb_portid(cb) (NETLINK_CB((cb)->skb).pid)
+#else
+#define info_portid(info) ((info)->snd_portid)
+#define cb_portid(cb) (NETLINK_CB((cb)->skb).portid)
+#endif
+
+/** How often the events are published to the events multicast group. */
+#define EVENTS_PUBLISH_PERIOD msecs_to_jiffies(1000)
+/** How often the session changes are published to the sync multicast group. */
+#define SYNC_PUBLISH_PERIOD msecs_to_jiffies(100)
+
 /**
- * Socket the userspace application will speak to.
+ * The Generic Netlink family the userspace application speaks to. Defined (along with its
+ * operations) at the end of the file.
  */
-static struct sock *nl_socket;
+static struct genl_family jool_family;
 
 /**
  * A lock, used to avoid sync issues when receiving messages from userspace.
  */
 static DEFINE_MUTEX(my_mutex);
 
+static void publish_events(struct work_struct *work);
+static DECLARE_DELAYED_WORK(events_work, publish_events);
+static void publish_sync(struct work_struct *work);
+static DECLARE_DELAYED_WORK(sync_work, publish_sync);
+
 
 /**
- * Use this when data_len is known to be smaller than BUFFER_SIZE. When this might not be the case,
- * use the output stream instead (out_stream.h).
+ * Sends "payload" to the process that sent the request "info" describes.
+ *
+ * Errors (and acks) don't need this; Generic Netlink builds them out of the handlers' results.
  */
-static int respond_single_msg(struct nlmsghdr *nl_hdr_in, int type, void *payload, int payload_len)
+static int respond_setcfg(struct genl_info *info, void *payload, int payload_len)
 {
-	struct sk_buff *skb_out;
-	struct nlmsghdr *nl_hdr_out;
-	int res;
+	struct sk_buff *skb;
+	void *msg;
+	int error;
 
-	skb_out = nlmsg_new(NLMSG_ALIGN(payload_len), GFP_ATOMIC);
-	if (!skb_out) {
+	skb = genlmsg_new(payload_len, GFP_KERNEL);
+	if (!skb) {
 		log_err(ERR_ALLOC_FAILED, "Failed to allocate a response skb to the user.");
 		return -ENOMEM;
 	}
 
-	nl_hdr_out = nlmsg_put(skb_out,
-			0, /* src_pid (0 = kernel) */
-			nl_hdr_in->nlmsg_seq, /* seq */
-			type, /* type */
-			payload_len, /* payload len */
-			0); /* flags */
-	memcpy(nlmsg_data(nl_hdr_out), payload, payload_len);
-	/* NETLINK_CB(skb_out).dst_group = 0; */
+	msg = genlmsg_put(skb, info_portid(info), info->snd_seq, &jool_family, 0, JOOL_CMD_REQUEST);
+	if (!msg) {
+		log_err(ERR_ALLOC_FAILED, "The response skb is too small for its own headers.");
+		nlmsg_free(skb);
+		return -ENOMEM;
+	}
+
+	memcpy(skb_put(skb, payload_len), payload, payload_len);
+	genlmsg_end(skb, msg);
 
-	res = nlmsg_unicast(nl_socket, skb_out, nl_hdr_in->nlmsg_pid);
-	if (res < 0) {
-		log_err(ERR_NETLINK, "Error code %d while returning response to the user.", res);
-		return res;
+	error = genlmsg_reply(skb, info);
+	if (error) {
+		log_err(ERR_NETLINK, "Error code %d while returning response to the user.", error);
+		return error;
 	}
 
 	return 0;
 }
 
-static int respond_setcfg(struct nlmsghdr *nl_hdr_in, void *payload, int payload_len)
-{
-	return respond_single_msg(nl_hdr_in, MSG_SETCFG, payload, payload_len);
-}
-
 /**
- * @note "ACK messages also use the message type NLMSG_ERROR and payload format but the error code
- * is set to 0." (http://www.infradead.org/~tgr/libnl/doc/core.html#core_msg_ack).
+ * Appends "payload" to the message being built at the end of "skb". Fails with -EMSGSIZE if it
+ * doesn't fit; the walk that produces the entries is expected to stop then, and resume with the
+ * same entry in the next message.
  */
-static int respond_error(struct nlmsghdr *nl_hdr_in, int error)
+static int dump_write(struct sk_buff *skb, void *payload, size_t payload_len)
 {
-	struct nlmsgerr payload = { abs(error), *nl_hdr_in };
-	return respond_single_msg(nl_hdr_in, NLMSG_ERROR, &payload, sizeof(payload));
-}
+	if (skb_tailroom(skb) < payload_len)
+		return -EMSGSIZE;
 
-/*
-static int respond_ack(struct nlmsghdr *nl_hdr_in)
-{
-	return respond_error(nl_hdr_in, 0);
+	memcpy(skb_put(skb, payload_len), payload, payload_len);
+	return 0;
 }
-*/
 
 static int verify_superpriv(struct request_hdr *nat64_hdr)
 {
@@ -94,243 +118,204 @@ static int verify_superpriv(struct request_hdr *nat64_hdr)
 	return 0;
 }
 
-static int pool6_entry_to_userspace(struct ipv6_prefix *prefix, void *arg)
-{
-	struct out_stream *stream = (struct out_stream *) arg;
-	return stream_write(stream, prefix, sizeof(*prefix));
-}
-
-static int handle_pool6_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static int handle_pool6_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		union request_pool6 *request)
 {
-	struct out_stream *stream;
 	__u64 count;
 	int error;
 
 	switch (nat64_hdr->operation) {
-	case OP_DISPLAY:
-		log_debug("Sending IPv6 pool to userspace.");
-
-		stream = kmalloc(sizeof(*stream), GFP_ATOMIC);
-		if (!stream) {
-			log_err(ERR_ALLOC_FAILED, "Could not allocate an output stream to userspace.");
-			return respond_error(nl_hdr, -ENOMEM);
-		}
-
-		stream_init(stream, nl_socket, nl_hdr);
-		error = pool6_for_each(pool6_entry_to_userspace, stream);
-		stream_close(stream);
-
-		kfree(stream);
-		return error;
-
 	case OP_COUNT:
 		log_debug("Returning IPv6 prefix count.");
 		error = pool6_count(&count);
 		if (error)
-			return respond_error(nl_hdr, error);
-		return respond_setcfg(nl_hdr, &count, sizeof(count));
+			return error;
+		return respond_setcfg(info, &count, sizeof(count));
 
 	case OP_ADD:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Adding a prefix to the IPv6 pool.");
-		return respond_error(nl_hdr, pool6_add(&request->update.prefix));
+		return pool6_add(&request->update.prefix);
 
 	case OP_REMOVE:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Removing a prefix from the IPv6 pool.");
-		return respond_error(nl_hdr, pool6_remove(&request->update.prefix));
+		return pool6_remove(&request->update.prefix);
 
 	default:
 		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
-		return respond_error(nl_hdr, -EINVAL);
+		return -EINVAL;
 	}
 }
 
-static int pool4_entry_to_userspace(struct pool4_node *node, void *arg)
-{
-	return stream_write(arg, &node->addr, sizeof(node->addr));
-}
-
-static int handle_pool4_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static int handle_pool4_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		union request_pool4 *request)
 {
-	struct out_stream *stream;
 	__u64 count;
 	int error;
 
 	switch (nat64_hdr->operation) {
-	case OP_DISPLAY:
-		log_debug("Sending IPv4 pool to userspace.");
-
-		stream = kmalloc(sizeof(*stream), GFP_ATOMIC);
-		if (!stream) {
-			log_err(ERR_ALLOC_FAILED, "Could not allocate an output stream to userspace.");
-			return respond_error(nl_hdr, -ENOMEM);
-		}
-
-		stream_init(stream, nl_socket, nl_hdr);
-		error = pool4_for_each(pool4_entry_to_userspace, stream);
-		stream_close(stream);
-
-		kfree(stream);
-		return error;
-
 	case OP_COUNT:
 		log_debug("Returning IPv4 address count.");
 		error = pool4_count(&count);
 		if (error)
-			return respond_error(nl_hdr, error);
-		return respond_setcfg(nl_hdr, &count, sizeof(count));
+			return error;
+		return respond_setcfg(info, &count, sizeof(count));
 
 	case OP_ADD:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Adding an address to the IPv4 pool.");
-		return respond_error(nl_hdr, pool4_register(&request->update.addr));
+		return pool4_register(&request->update.addr);
 
 	case OP_REMOVE:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Removing an address from the IPv4 pool.");
-		return respond_error(nl_hdr, pool4_remove(&request->update.addr));
+		return pool4_remove(&request->update.addr);
 
 	default:
 		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
-		return respond_error(nl_hdr, -EINVAL);
+		return -EINVAL;
 	}
 }
 
-static int bib_entry_to_userspace(struct bib_entry *entry, void *arg)
+/**
+ * Returns the query userspace attached to its display request, or an empty one if it didn't.
+ * (Older clients send requests which end before the query.)
+ */
+static int get_query(struct request_hdr *nat64_hdr, struct table_query *query, size_t query_end,
+		struct table_query *result)
 {
-	struct out_stream *stream = (struct out_stream *) arg;
-	struct bib_entry_us entry_us;
+	if (nat64_hdr->length < sizeof(*nat64_hdr) + query_end) {
+		memset(result, 0, sizeof(*result));
+		return 0;
+	}
 
-	entry_us.ipv4 = entry->ipv4;
-	entry_us.ipv6 = entry->ipv6;
-	entry_us.is_static = entry->is_static;
+	if ((query->flags & QUERY_IPV6_MASK) && query->ipv6.len > 128) {
+		log_err(ERR_PREF_LEN_RANGE, "The query's prefix length is larger than 128.");
+		return -EINVAL;
+	}
 
-	return stream_write(stream, &entry_us, sizeof(entry_us));
+	*result = *query;
+	return 0;
 }
 
-static int handle_bib_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static int handle_bib_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		struct request_bib *request)
 {
-	struct out_stream *stream;
-	__u64 count;
+	struct table_count_us count;
 	int error;
 
 	switch (nat64_hdr->operation) {
-	case OP_DISPLAY:
-		log_debug("Sending BIB to userspace.");
-
-		stream = kmalloc(sizeof(*stream), GFP_ATOMIC);
-		if (!stream) {
-			log_err(ERR_ALLOC_FAILED, "Could not allocate an output stream to userspace.");
-			return respond_error(nl_hdr, -ENOMEM);
-		}
-
-		stream_init(stream, nl_socket, nl_hdr);
-		spin_lock_bh(&bib_session_lock);
-		error = bib_for_each(request->l4_proto, bib_entry_to_userspace, stream);
-		spin_unlock_bh(&bib_session_lock);
-		stream_close(stream);
-
-		kfree(stream);
-		return error;
-
 	case OP_COUNT:
 		log_debug("Returning BIB count.");
-		error = bib_count(request->l4_proto, &count);
+		error = bib_count(request->l4_proto, &count.count);
 		if (error)
-			return respond_error(nl_hdr, error);
-		return respond_setcfg(nl_hdr, &count, sizeof(count));
+			return error;
+		count.bytes = count.count * bib_entry_size();
+		return respond_setcfg(info, &count, sizeof(count));
 
 	case OP_ADD:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Adding BIB entry.");
-		return respond_error(nl_hdr, add_static_route(request));
+		return add_static_route(request);
 
 	case OP_REMOVE:
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Removing BIB entry.");
-		return respond_error(nl_hdr, delete_static_route(request));
+		return delete_static_route(request);
 
-	default:
-		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
-		return respond_error(nl_hdr, -EINVAL);
-	}
-}
+	case OP_IMPORT:
+		if (verify_superpriv(nat64_hdr)) {
+			return -EPERM;
+		}
 
-static int session_entry_to_userspace(struct session_entry *entry, void *arg)
-{
-	struct out_stream *stream = (struct out_stream *) arg;
-	struct session_entry_us entry_us;
+		if (nat64_hdr->length < sizeof(*nat64_hdr) + sizeof(*request)
+				|| request->import.count > (nat64_hdr->length - sizeof(*nat64_hdr)
+						- sizeof(*request)) / sizeof(struct bib_import_us)) {
+			log_err(ERR_UNKNOWN_ERROR, "The request claims to contain %u BIB entries, "
+					"but it is too short.", request->import.count);
+			return -EINVAL;
+		}
 
-	entry_us.ipv6 = entry->ipv6;
-	entry_us.ipv4 = entry->ipv4;
-	entry_us.dying_time = jiffies_to_msecs(entry->dying_time - jiffies);
-	entry_us.l4_proto = entry->l4_proto;
+		log_debug("Adding %u BIB entries.", request->import.count);
+		return add_static_routes((struct bib_import_us *) (request + 1), request->import.count);
 
-	return stream_write(stream, &entry_us, sizeof(entry_us));
+	default:
+		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
+		return -EINVAL;
+	}
 }
 
-static int handle_session_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static int handle_session_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		struct request_session *request)
 {
-	struct out_stream *stream;
-	__u64 count;
+	struct table_count_us count;
+	struct flush_count_us flush_count;
 	int error;
 
 	switch (nat64_hdr->operation) {
-	case OP_DISPLAY:
-		log_debug("Sending session table to userspace.");
+	case OP_COUNT:
+		log_debug("Returning session count.");
+		error = session_count(request->l4_proto, &count.count);
+		if (error)
+			return error;
+		count.bytes = count.count * session_entry_size();
+		return respond_setcfg(info, &count, sizeof(count));
 
-		stream = kmalloc(sizeof(*stream), GFP_ATOMIC);
-		if (!stream) {
-			log_err(ERR_ALLOC_FAILED, "Could not allocate an output stream to userspace.");
-			return respond_error(nl_hdr, -ENOMEM);
+	case OP_FLUSH:
+		if (verify_superpriv(nat64_hdr)) {
+			return -EPERM;
 		}
 
-		stream_init(stream, nl_socket, nl_hdr);
-		spin_lock_bh(&bib_session_lock);
-		error = session_for_each(request->l4_proto, session_entry_to_userspace, stream);
-		spin_unlock_bh(&bib_session_lock);
-		stream_close(stream);
-
-		kfree(stream);
-		return error;
+		if (request->flush.prefix.len > 128) {
+			log_err(ERR_PREF_LEN_RANGE, "The prefix length is larger than 128.");
+			return -EINVAL;
+		}
 
-	case OP_COUNT:
-		log_debug("Returning session count.");
-		error = session_count(request->l4_proto, &count);
+		log_debug("Flushing the state of %pI6c/%u.", &request->flush.prefix.address,
+				request->flush.prefix.len);
+		memset(&flush_count, 0, sizeof(flush_count));
+		error = filtering_flush(request->l4_proto, &request->flush.prefix, &flush_count);
 		if (error)
-			return respond_error(nl_hdr, error);
-		return respond_setcfg(nl_hdr, &count, sizeof(count));
+			return error;
+		return respond_setcfg(info, &flush_count, sizeof(flush_count));
 
 	default:
 		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
-		return respond_error(nl_hdr, -EINVAL);
+		return -EINVAL;
 	}
 }
 
-static int handle_filtering_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+/**
+ * Userspace speaks milliseconds; the module's timeouts are jiffies.
+ */
+static void filtering_to_jiffies(struct filtering_config *request)
+{
+	request->to.udp = msecs_to_jiffies(request->to.udp);
+	request->to.tcp_est = msecs_to_jiffies(request->to.tcp_est);
+	request->to.tcp_trans = msecs_to_jiffies(request->to.tcp_trans);
+	request->to.icmp = msecs_to_jiffies(request->to.icmp);
+}
+
+static int handle_filtering_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		struct filtering_config *request)
 {
 	struct filtering_config clone;
@@ -341,31 +326,32 @@ static int handle_filtering_config(struct nlmsghdr *nl_hdr, struct request_hdr *
 
 		error = clone_filtering_config(&clone);
 		if (error)
-			return respond_error(nl_hdr, error);
+			return error;
 
 		clone.to.udp = jiffies_to_msecs(clone.to.udp);
 		clone.to.tcp_est = jiffies_to_msecs(clone.to.tcp_est);
 		clone.to.tcp_trans = jiffies_to_msecs(clone.to.tcp_trans);
 		clone.to.icmp = jiffies_to_msecs(clone.to.icmp);
 
-		return respond_setcfg(nl_hdr, &clone, sizeof(clone));
+		return respond_setcfg(info, &clone, sizeof(clone));
 	} else {
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Updating 'Filtering and Updating' options.");
 
-		request->to.udp = msecs_to_jiffies(request->to.udp);
-		request->to.tcp_est = msecs_to_jiffies(request->to.tcp_est);
-		request->to.tcp_trans = msecs_to_jiffies(request->to.tcp_trans);
-		request->to.icmp = msecs_to_jiffies(request->to.icmp);
-
-		return respond_error(nl_hdr, set_filtering_config(nat64_hdr->operation, request));
+		filtering_to_jiffies(request);
+		return set_filtering_config(nat64_hdr->operation, request);
 	}
 }
 
-static int handle_fragmentation_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static void fragmentation_to_jiffies(struct fragmentation_config *request)
+{
+	request->fragment_timeout = msecs_to_jiffies(request->fragment_timeout);
+}
+
+static int handle_fragmentation_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		struct fragmentation_config *request)
 {
 	struct fragmentation_config clone;
@@ -376,25 +362,24 @@ static int handle_fragmentation_config(struct nlmsghdr *nl_hdr, struct request_h
 
 		error = clone_fragmentation_config(&clone);
 		if (error)
-			return respond_error(nl_hdr, error);
+			return error;
 
 		clone.fragment_timeout = jiffies_to_msecs(clone.fragment_timeout);
 
-		return respond_setcfg(nl_hdr, &clone, sizeof(clone));
+		return respond_setcfg(info, &clone, sizeof(clone));
 	} else {
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Updating 'Fragmentation' options.");
 
-		request->fragment_timeout = msecs_to_jiffies(request->fragment_timeout);
-
-		return respond_error(nl_hdr, set_fragmentation_config(nat64_hdr->operation, request));
+		fragmentation_to_jiffies(request);
+		return set_fragmentation_config(nat64_hdr->operation, request);
 	}
 }
 
-static int handle_translate_config(struct nlmsghdr *nl_hdr, struct request_hdr *nat64_hdr,
+static int handle_translate_config(struct genl_info *info, struct request_hdr *nat64_hdr,
 		struct translate_config *request)
 {
 	int error;
@@ -408,13 +393,13 @@ static int handle_translate_config(struct nlmsghdr *nl_hdr, struct request_hdr *
 
 		error = clone_translate_config(&clone);
 		if (error)
-			return respond_error(nl_hdr, error);
+			return error;
 
 		error = serialize_translate_config(&clone, &config, &config_len);
 		if (error)
-			return respond_error(nl_hdr, error);
+			return error;
 
-		error = respond_setcfg(nl_hdr, config, config_len);
+		error = respond_setcfg(info, config, config_len);
 		kfree(config);
 		kfree(clone.mtu_plateaus);
 		return error;
@@ -422,7 +407,7 @@ static int handle_translate_config(struct nlmsghdr *nl_hdr, struct request_hdr *
 		struct translate_config new_config;
 
 		if (verify_superpriv(nat64_hdr)) {
-			return respond_error(nl_hdr, -EPERM);
+			return -EPERM;
 		}
 
 		log_debug("Updating 'Translate the Packet' options.");
@@ -430,108 +415,1010 @@ static int handle_translate_config(struct nlmsghdr *nl_hdr, struct request_hdr *
 		error = deserialize_translate_config(request, nat64_hdr->length - sizeof(*nat64_hdr),
 				&new_config);
 		if (error)
-			return respond_error(nl_hdr, error);
+			return error;
 
-		error = respond_error(nl_hdr, set_translate_config(nat64_hdr->operation, &new_config));
+		error = set_translate_config(nat64_hdr->operation, &new_config);
 		kfree(new_config.mtu_plateaus);
 		return error;
 	}
 }
 
+static int handle_sync_config(struct genl_info *info, struct request_hdr *nat64_hdr,
+		struct sync_batch *batch)
+{
+	__u16 count;
+
+	switch (nat64_hdr->operation) {
+	case OP_ADD:
+		if (verify_superpriv(nat64_hdr))
+			return -EPERM;
+
+		if (nat64_hdr->length < sizeof(*nat64_hdr) + sizeof(*batch)) {
+			log_err(ERR_UNKNOWN_ERROR, "The request is too short to contain a session batch.");
+			return -EINVAL;
+		}
+		if (batch->version != SYNC_VERSION) {
+			log_err(ERR_UNKNOWN_ERROR, "The session batch's version is %u; I only speak %u.",
+					batch->version, SYNC_VERSION);
+			return -EINVAL;
+		}
+		count = be16_to_cpu(batch->count);
+		if (count > SYNC_REQUEST_MAX || count > (nat64_hdr->length - sizeof(*nat64_hdr)
+				- sizeof(*batch)) / sizeof(struct sync_session)) {
+			log_err(ERR_UNKNOWN_ERROR, "The session batch claims to contain %u records, but "
+					"it is too short, or the count exceeds %u.", count, SYNC_REQUEST_MAX);
+			return -EINVAL;
+		}
+
+		log_debug("Applying %u session records.", count);
+		filtering_sync((struct sync_session *) (batch + 1), count);
+		return 0;
+
+	default:
+		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
+		return -EINVAL;
+	}
+}
+
+static int handle_changes_config(struct genl_info *info, struct request_hdr *nat64_hdr)
+{
+	struct changelog_range_us range;
+
+	switch (nat64_hdr->operation) {
+	case OP_COUNT:
+		log_debug("Returning the generations the change log covers.");
+		changelog_range(&range);
+		return respond_setcfg(info, &range, sizeof(range));
+
+	default:
+		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
+		return -EINVAL;
+	}
+}
+
+static int handle_stats_config(struct genl_info *info, struct request_hdr *nat64_hdr)
+{
+	__u64 counters[STAT_COUNT];
+
+	switch (nat64_hdr->operation) {
+	case OP_DISPLAY:
+		log_debug("Returning the counters.");
+		stats_sum(counters);
+		return respond_setcfg(info, counters, sizeof(counters));
+
+	default:
+		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
+		return -EINVAL;
+	}
+}
+
+static int handle_latency_config(struct genl_info *info, struct request_hdr *nat64_hdr,
+		struct latency_config *request)
+{
+	struct latency_us *result;
+	int error;
+
+	if (nat64_hdr->operation == 0) {
+		log_debug("Returning the latency histograms.");
+
+		result = kmalloc(sizeof(*result), GFP_KERNEL);
+		if (!result) {
+			log_err(ERR_ALLOC_FAILED, "Could not allocate the latency histograms' copy.");
+			return -ENOMEM;
+		}
+
+		latency_sum(result);
+		error = respond_setcfg(info, result, sizeof(*result));
+		kfree(result);
+		return error;
+	}
+
+	if (verify_superpriv(nat64_hdr))
+		return -EPERM;
+
+	log_debug("Updating the latency options.");
+
+	if (nat64_hdr->operation & LATENCY_ENABLED_MASK)
+		latency_set_enabled(request->enabled);
+	if (nat64_hdr->operation & LATENCY_RESET_MASK)
+		latency_reset();
+
+	return 0;
+}
+
+/**
+ * The new configurations of the modules a batch updates. NULL means the batch doesn't touch the
+ * module.
+ */
+struct batch_candidates {
+	struct filtering_config *filtering;
+	struct translate_config *translate;
+	struct fragmentation_config *fragmentation;
+};
+
+/**
+ * Returns whether "request" is a well-formed update that can be part of a batch.
+ */
+static bool is_batchable(struct request_hdr *request)
+{
+	size_t payload_len = request->length - sizeof(*request);
+
+	switch (request->mode) {
+	case MODE_POOL6:
+		return (request->operation == OP_ADD || request->operation == OP_REMOVE)
+				&& payload_len >= sizeof(union request_pool6);
+	case MODE_POOL4:
+		return (request->operation == OP_ADD || request->operation == OP_REMOVE)
+				&& payload_len >= sizeof(union request_pool4);
+	case MODE_FILTERING:
+		return request->operation != 0 && payload_len >= sizeof(struct filtering_config);
+	case MODE_FRAGMENTATION:
+		return request->operation != 0 && payload_len >= sizeof(struct fragmentation_config);
+	case MODE_TRANSLATE:
+		return request->operation != 0;
+	}
+
+	return false;
+}
+
+/**
+ * Returns (in "result") the list of requests "batch" contains. Fails if any of them is
+ * truncated or cannot be part of a batch.
+ */
+static int batch_split(struct request_hdr *nat64_hdr, struct request_batch *batch,
+		struct request_hdr ***result)
+{
+	struct request_hdr **requests;
+	struct request_hdr *request;
+	size_t offset = BATCH_ALIGN(sizeof(*nat64_hdr) + sizeof(*batch));
+	size_t total = nat64_hdr->length;
+	__u32 i;
+
+	if (total < offset || batch->count == 0
+			|| batch->count > (total - offset) / sizeof(struct request_hdr)) {
+		log_err(ERR_UNKNOWN_OP, "The batch's request count doesn't match its length.");
+		return -EINVAL;
+	}
+
+	requests = kmalloc(batch->count * sizeof(*requests), GFP_KERNEL);
+	if (!requests) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the batch's request list.");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		request = (struct request_hdr *) (((unsigned char *) nat64_hdr) + offset);
+		if (offset + sizeof(*request) > total || request->length < sizeof(*request)
+				|| request->length > total - offset) {
+			log_err(ERR_UNKNOWN_OP, "Request #%u of the batch is truncated.", i + 1);
+			goto fail;
+		}
+		if (!is_batchable(request)) {
+			log_err(ERR_UNKNOWN_OP, "Request #%u (mode %u, operation %u) cannot be part of a "
+					"batch.", i + 1, request->mode, request->operation);
+			goto fail;
+		}
+
+		requests[i] = request;
+		offset += BATCH_ALIGN(request->length);
+	}
+
+	*result = requests;
+	return 0;
+
+fail:
+	kfree(requests);
+	return -EINVAL;
+}
+
+/**
+ * Applies "request" (if it is a configuration update) to the candidates.
+ */
+static int batch_merge(struct request_hdr *request, struct batch_candidates *candidates)
+{
+	void *payload = request + 1;
+	struct translate_config translate;
+	int error;
+
+	switch (request->mode) {
+	case MODE_FILTERING:
+		if (!candidates->filtering) {
+			candidates->filtering = prepare_filtering_config();
+			if (!candidates->filtering)
+				return -ENOMEM;
+		}
+		filtering_to_jiffies(payload);
+		return merge_filtering_config(request->operation, candidates->filtering, payload);
+
+	case MODE_FRAGMENTATION:
+		if (!candidates->fragmentation) {
+			candidates->fragmentation = prepare_fragmentation_config();
+			if (!candidates->fragmentation)
+				return -ENOMEM;
+		}
+		fragmentation_to_jiffies(payload);
+		return merge_fragmentation_config(request->operation, candidates->fragmentation,
+				payload);
+
+	case MODE_TRANSLATE:
+		if (!candidates->translate) {
+			candidates->translate = prepare_translate_config();
+			if (!candidates->translate)
+				return -ENOMEM;
+		}
+		error = deserialize_translate_config(payload, request->length - sizeof(*request),
+				&translate);
+		if (error)
+			return error;
+		error = merge_translate_config(request->operation, candidates->translate, &translate);
+		kfree(translate.mtu_plateaus);
+		return error;
+	}
+
+	return 0;
+}
+
+static bool is_pool_request(struct request_hdr *request)
+{
+	return request->mode == MODE_POOL6 || request->mode == MODE_POOL4;
+}
+
 /**
- * Gets called by "netlink_rcv_skb" when the userspace application wants to interact with us.
+ * Returns whether pool requests "a" and "b" update the same address or prefix.
+ */
+static bool batch_same_target(struct request_hdr *a, struct request_hdr *b)
+{
+	union request_pool6 *pool6_a = (union request_pool6 *) (a + 1);
+	union request_pool6 *pool6_b = (union request_pool6 *) (b + 1);
+	union request_pool4 *pool4_a = (union request_pool4 *) (a + 1);
+	union request_pool4 *pool4_b = (union request_pool4 *) (b + 1);
+
+	if (a->mode != b->mode)
+		return false;
+
+	switch (a->mode) {
+	case MODE_POOL6:
+		return ipv6_prefix_equals(&pool6_a->update.prefix, &pool6_b->update.prefix);
+	case MODE_POOL4:
+		return ipv4_addr_equals(&pool4_a->update.addr, &pool4_b->update.addr);
+	}
+
+	return false;
+}
+
+static int pool6_prefix_equals(struct ipv6_prefix *prefix, void *arg)
+{
+	return ipv6_prefix_equals(prefix, arg);
+}
+
+/**
+ * Returns whether pool request "request" can be applied to the pools as they are now; ie. whether
+ * its address or prefix is (if it's a removal) or is not (if it's an addition) part of the pool.
+ */
+static bool batch_check_pool(struct request_hdr *request)
+{
+	union request_pool6 *pool6 = (union request_pool6 *) (request + 1);
+	union request_pool4 *pool4 = (union request_pool4 *) (request + 1);
+	bool exists;
+
+	if (request->mode == MODE_POOL6)
+		exists = pool6_for_each(pool6_prefix_equals, &pool6->update.prefix) > 0;
+	else
+		exists = pool4_contains(&pool4->update.addr);
+
+	if (request->operation == OP_ADD && exists) {
+		log_err(ERR_UNKNOWN_OP, "The address or prefix already belongs to the pool.");
+		return false;
+	}
+	if (request->operation == OP_REMOVE && !exists) {
+		log_err(ERR_UNKNOWN_OP, "The address or prefix is not part of the pool.");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Validates pool request "requests[index]", which must be the only one in the batch that touches
+ * its address or prefix.
+ */
+static int batch_validate_pool(struct request_hdr **requests, __u32 index)
+{
+	__u32 i;
+
+	for (i = 0; i < index; i++) {
+		if (is_pool_request(requests[i]) && batch_same_target(requests[i], requests[index])) {
+			log_err(ERR_UNKNOWN_OP, "Requests #%u and #%u of the batch update the same "
+					"address or prefix.", i + 1, index + 1);
+			return -EINVAL;
+		}
+	}
+
+	return batch_check_pool(requests[index]) ? 0 : -EINVAL;
+}
+
+/**
+ * Applies pool request "request" to its pool, or reverts it if "undo" is true.
+ */
+static int batch_apply_pool(struct request_hdr *request, bool undo)
+{
+	bool add = (request->operation == OP_ADD) != undo;
+	union request_pool6 *pool6 = (union request_pool6 *) (request + 1);
+	union request_pool4 *pool4 = (union request_pool4 *) (request + 1);
+
+	if (request->mode == MODE_POOL6)
+		return add ? pool6_add(&pool6->update.prefix) : pool6_remove(&pool6->update.prefix);
+	return add ? pool4_register(&pool4->update.addr) : pool4_remove(&pool4->update.addr);
+}
+
+static void batch_abort(struct batch_candidates *candidates)
+{
+	if (candidates->filtering)
+		abort_filtering_config(candidates->filtering);
+	if (candidates->translate)
+		abort_translate_config(candidates->translate);
+	if (candidates->fragmentation)
+		abort_fragmentation_config(candidates->fragmentation);
+}
+
+/**
+ * Applies all of the requests from "batch", or none of them.
+ *
+ * The configuration updates are validated and merged into private copies first, and the pool
+ * updates are checked against the current pools, so nothing changes if any of them is wrong.
+ * Then the pool additions are applied; if one of these fails (eg. out of memory), the ones that
+ * succeeded are removed again (they have been in the pool for a moment at most, so there is
+ * little chance anything got reserved from them). The removals go last, once nothing else can
+ * fail, because removing an IPv4 address discards its port reservations, and those cannot be
+ * restored by adding it back. Finally, each module's configuration is replaced once.
  *
- * @param skb packet received from userspace.
- * @param nlh message's metadata.
- * @return result status.
+ * Pools only change through configuration requests, which the Generic Netlink mutex serializes,
+ * so the checks stay valid until the batch is applied.
  */
-static int handle_netlink_message(struct sk_buff *skb_in, struct nlmsghdr *nl_hdr)
+static int handle_batch(struct genl_info *info, struct request_hdr *nat64_hdr,
+		struct request_batch *batch)
+{
+	struct request_hdr **requests;
+	struct batch_candidates candidates = { NULL, NULL, NULL };
+	__u32 i, j;
+	int error;
+
+	if (verify_superpriv(nat64_hdr))
+		return -EPERM;
+
+	error = batch_split(nat64_hdr, batch, &requests);
+	if (error)
+		return error;
+
+	log_debug("Applying a batch of %u requests.", batch->count);
+
+	for (i = 0; i < batch->count; i++) {
+		if (is_pool_request(requests[i]))
+			error = batch_validate_pool(requests, i);
+		else
+			error = batch_merge(requests[i], &candidates);
+		if (error) {
+			log_err(ERR_UNKNOWN_OP, "Request #%u of the batch is invalid; nothing was applied.",
+					i + 1);
+			goto abort;
+		}
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		if (!is_pool_request(requests[i]) || requests[i]->operation != OP_ADD)
+			continue;
+
+		error = batch_apply_pool(requests[i], false);
+		if (error) {
+			log_err(ERR_UNKNOWN_OP, "Request #%u of the batch failed; nothing was applied.",
+					i + 1);
+			for (j = i; j > 0; j--) {
+				if (!is_pool_request(requests[j - 1]) || requests[j - 1]->operation != OP_ADD)
+					continue;
+				if (batch_apply_pool(requests[j - 1], true))
+					log_err(ERR_UNKNOWN_OP, "Could not revert request #%u of the batch.", j);
+			}
+			goto abort;
+		}
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		if (!is_pool_request(requests[i]) || requests[i]->operation != OP_REMOVE)
+			continue;
+
+		/* Cannot fail; the entry was found during validation and nobody could remove it since. */
+		if (batch_apply_pool(requests[i], false))
+			log_err(ERR_UNKNOWN_OP, "Request #%u of the batch could not be applied.", i + 1);
+	}
+
+	if (candidates.filtering)
+		commit_filtering_config(candidates.filtering);
+	if (candidates.translate)
+		commit_translate_config(candidates.translate);
+	if (candidates.fragmentation)
+		commit_fragmentation_config(candidates.fragmentation);
+
+	kfree(requests);
+	return 0;
+
+abort:
+	batch_abort(&candidates);
+	kfree(requests);
+	return error;
+}
+
+
+/**
+ * Returns the request "nl_hdr" carries (and validates its length), or NULL if it's malformed.
+ */
+static struct request_hdr *get_request(struct nlmsghdr *nl_hdr)
+{
+	struct request_hdr *nat64_hdr;
+	size_t len;
+
+	if (nlmsg_len(nl_hdr) < (int) (GENL_HDRLEN + sizeof(*nat64_hdr))) {
+		log_err(ERR_UNKNOWN_OP, "The request is too short to contain a header.");
+		return NULL;
+	}
+	len = nlmsg_len(nl_hdr) - GENL_HDRLEN;
+
+	nat64_hdr = (struct request_hdr *) (((unsigned char *) nlmsg_data(nl_hdr)) + GENL_HDRLEN);
+	if (nat64_hdr->length < sizeof(*nat64_hdr) || nat64_hdr->length > len) {
+		log_err(ERR_UNKNOWN_OP, "The request's length (%u) doesn't match its message's (%zu).",
+				nat64_hdr->length, len);
+		return NULL;
+	}
+
+	return nat64_hdr;
+}
+
+/**
+ * Gets called by Generic Netlink when the userspace application wants to interact with us, except
+ * when it wants a table (see handle_dump()).
+ *
+ * The result is sent back as an ack (if it is zero and userspace asked for one) or as an error.
+ */
+static int handle_request(struct sk_buff *skb, struct genl_info *info)
 {
 	struct request_hdr *nat64_hdr;
 	void *request;
 	int error;
 
-	if (nl_hdr->nlmsg_type != MSG_TYPE_NAT64) {
-		log_debug("Expecting %#x but got %#x.", MSG_TYPE_NAT64, nl_hdr->nlmsg_type);
+	nat64_hdr = get_request(info->nlhdr);
+	if (!nat64_hdr)
+		return -EINVAL;
+	request = nat64_hdr + 1;
+
+	if (is_dump_request(nat64_hdr)) {
+		log_err(ERR_UNKNOWN_OP, "Tables can only be requested as dumps (NLM_F_DUMP).");
 		return -EINVAL;
 	}
 
-	nat64_hdr = NLMSG_DATA(nl_hdr);
-	request = nat64_hdr + 1;
+	mutex_lock(&my_mutex);
 
 	switch (nat64_hdr->mode) {
 	case MODE_POOL6:
-		error = handle_pool6_config(nl_hdr, nat64_hdr, request);
+		error = handle_pool6_config(info, nat64_hdr, request);
 		break;
 	case MODE_POOL4:
-		error = handle_pool4_config(nl_hdr, nat64_hdr, request);
+		error = handle_pool4_config(info, nat64_hdr, request);
 		break;
 	case MODE_BIB:
-		error = handle_bib_config(nl_hdr, nat64_hdr, request);
+		error = handle_bib_config(info, nat64_hdr, request);
 		break;
 	case MODE_SESSION:
-		error = handle_session_config(nl_hdr, nat64_hdr, request);
+		error = handle_session_config(info, nat64_hdr, request);
 		break;
 	case MODE_FILTERING:
-		error = handle_filtering_config(nl_hdr, nat64_hdr, request);
+		error = handle_filtering_config(info, nat64_hdr, request);
 		break;
 	case MODE_TRANSLATE:
-		error = handle_translate_config(nl_hdr, nat64_hdr, request);
+		error = handle_translate_config(info, nat64_hdr, request);
 		break;
 	case MODE_FRAGMENTATION:
-		error = handle_fragmentation_config(nl_hdr, nat64_hdr, request);
+		error = handle_fragmentation_config(info, nat64_hdr, request);
+		break;
+	case MODE_STATS:
+		error = handle_stats_config(info, nat64_hdr);
+		break;
+	case MODE_LATENCY:
+		error = handle_latency_config(info, nat64_hdr, request);
+		break;
+	case MODE_BATCH:
+		error = handle_batch(info, nat64_hdr, request);
+		break;
+	case MODE_SYNC:
+		error = handle_sync_config(info, nat64_hdr, request);
+		break;
+	case MODE_CHANGES:
+		error = handle_changes_config(info, nat64_hdr);
+		break;
+	case MODE_EVENTS:
+		log_err(ERR_UNKNOWN_OP, "Unknown operation: %d", nat64_hdr->operation);
+		error = -EINVAL;
 		break;
 	default:
 		log_err(ERR_UNKNOWN_OP, "Unknown configuration mode: %d", nat64_hdr->mode);
-		error = respond_error(nl_hdr, -EINVAL);
+		error = -EINVAL;
 	}
 
+	mutex_unlock(&my_mutex);
+	return error;
+}
+
+/**
+ * What a dump remembers between calls to handle_dump().
+ */
+struct dump_state {
+	/** The request's query (BIB and session dumps only). */
+	struct table_query query;
+	/** Where the BIB or session walk stopped. */
+	struct query_cursor cursor;
+	/** Index of the session table the walk is in (sync dumps only; see dump_sync()). */
+	unsigned int table;
+	/** Generation of the last change sent (change dumps only). */
+	__u64 since;
+	/**
+	 * Number of entries sent so far (pool dumps only). The pools are small, so they are resumed by
+	 * skipping this many entries.
+	 */
+	__u64 sent;
+	/** Every entry has been sent; the next call only needs to end the dump. */
+	bool done;
+};
+
+struct pool_dump {
+	struct sk_buff *skb;
+	struct dump_state *state;
+	/** Number of entries the current walk has visited. */
+	__u64 visited;
+};
+
+static int pool_entry_to_userspace(struct pool_dump *dump, void *payload, size_t payload_len)
+{
+	int error;
+
+	if (dump->visited++ < dump->state->sent)
+		return 0;
+
+	error = dump_write(dump->skb, payload, payload_len);
+	if (!error)
+		dump->state->sent++;
 	return error;
 }
 
+static int pool6_entry_to_userspace(struct ipv6_prefix *prefix, void *arg)
+{
+	return pool_entry_to_userspace(arg, prefix, sizeof(*prefix));
+}
+
+static int pool4_entry_to_userspace(struct pool4_node *node, void *arg)
+{
+	return pool_entry_to_userspace(arg, &node->addr, sizeof(node->addr));
+}
+
+static int bib_entry_to_userspace(struct bib_entry *entry, void *arg)
+{
+	struct bib_entry_us entry_us;
+
+	entry_us.ipv4 = entry->ipv4;
+	entry_us.ipv6 = entry->ipv6;
+	entry_us.is_static = entry->is_static;
+	entry_us.generation = entry->generation;
+
+	return dump_write(arg, &entry_us, sizeof(entry_us));
+}
+
+static int session_entry_to_userspace(struct session_entry *entry, void *arg)
+{
+	struct session_entry_us entry_us;
+
+	entry_us.ipv6 = entry->ipv6;
+	entry_us.ipv4 = entry->ipv4;
+	entry_us.dying_time = jiffies_to_msecs(entry->dying_time - jiffies);
+	entry_us.l4_proto = entry->l4_proto;
+	entry_us.generation = entry->generation;
+
+	return dump_write(arg, &entry_us, sizeof(entry_us));
+}
+
+static int event_to_userspace(struct event_us *event, void *arg)
+{
+	return dump_write(arg, event, sizeof(*event));
+}
+
+static int change_to_userspace(struct change_us *change, void *arg)
+{
+	return dump_write(arg, change, sizeof(*change));
+}
+
+static int sync_record_to_userspace(struct session_entry *entry, void *arg)
+{
+	struct sync_session record;
+
+	sync_session_to_record(entry, SYNC_SESSION_UPDATE, &record);
+	return dump_write(arg, &record, sizeof(record));
+}
+
 /**
- * Gets called by Netlink when the userspace application wants to interact with us.
+ * Sync dumps are the entire state the HA peer needs: every session from every table.
+ */
+static int dump_sync(struct sk_buff *skb, struct dump_state *state)
+{
+	l4_protocol tables[] = { L4PROTO_UDP, L4PROTO_TCP, L4PROTO_ICMP };
+	int error;
+
+	/*
+	 * The sender subscribes to the sync group before it dumps, but publish_sync() might not have
+	 * noticed yet. Changes which happen from now on must not be missed.
+	 */
+	sync_set_enabled(true);
+
+	for (; state->table < ARRAY_SIZE(tables); state->table++) {
+		spin_lock_bh(&bib_session_lock);
+		error = query_session(tables[state->table], &state->query, &state->cursor,
+				sync_record_to_userspace, skb);
+		spin_unlock_bh(&bib_session_lock);
+		if (error)
+			return error;
+
+		query_cursor_init(&state->cursor);
+	}
+
+	return 0;
+}
+
+static int dump_state_create(struct request_hdr *nat64_hdr, struct dump_state **result)
+{
+	struct dump_state *state;
+	struct request_bib *bib = (struct request_bib *) (nat64_hdr + 1);
+	struct request_session *session = (struct request_session *) (nat64_hdr + 1);
+	struct request_changes *changes = (struct request_changes *) (nat64_hdr + 1);
+	int error;
+
+	state = kmalloc(sizeof(*state), GFP_KERNEL);
+	if (!state) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the dump's state.");
+		return -ENOMEM;
+	}
+
+	switch (nat64_hdr->mode) {
+	case MODE_BIB:
+		error = get_query(nat64_hdr, &bib->display.query,
+				offsetof(struct request_bib, display.query) + sizeof(state->query),
+				&state->query);
+		break;
+	case MODE_SESSION:
+		error = get_query(nat64_hdr, &session->display.query,
+				offsetof(struct request_session, display.query) + sizeof(state->query),
+				&state->query);
+		break;
+	default:
+		memset(&state->query, 0, sizeof(state->query));
+		error = 0;
+	}
+
+	if (error) {
+		kfree(state);
+		return error;
+	}
+
+	if (nat64_hdr->mode == MODE_CHANGES) {
+		if (nat64_hdr->length < sizeof(*nat64_hdr) + sizeof(*changes)) {
+			log_err(ERR_UNKNOWN_ERROR, "The request does not say since which generation.");
+			kfree(state);
+			return -EINVAL;
+		}
+		state->since = changes->since;
+	} else {
+		state->since = 0;
+	}
+
+	query_cursor_init(&state->cursor);
+	state->table = 0;
+	state->sent = 0;
+	state->done = false;
+
+	*result = state;
+	return 0;
+}
+
+/**
+ * Appends to "skb" as many of the entries "nat64_hdr" wants as fit, starting where "state" says.
+ * Returns -EMSGSIZE if some entries were left out.
+ */
+static int dump_entries(struct sk_buff *skb, struct request_hdr *nat64_hdr,
+		struct dump_state *state)
+{
+	struct pool_dump pool_dump = { skb, state, 0 };
+	struct request_bib *bib = (struct request_bib *) (nat64_hdr + 1);
+	struct request_session *session = (struct request_session *) (nat64_hdr + 1);
+	int error;
+
+	switch (nat64_hdr->mode) {
+	case MODE_POOL6:
+		return pool6_for_each(pool6_entry_to_userspace, &pool_dump);
+	case MODE_POOL4:
+		return pool4_for_each(pool4_entry_to_userspace, &pool_dump);
+	case MODE_BIB:
+		spin_lock_bh(&bib_session_lock);
+		error = query_bib(bib->l4_proto, &state->query, &state->cursor, bib_entry_to_userspace,
+				skb);
+		spin_unlock_bh(&bib_session_lock);
+		return error;
+	case MODE_SESSION:
+		spin_lock_bh(&bib_session_lock);
+		error = query_session(session->l4_proto, &state->query, &state->cursor,
+				session_entry_to_userspace, skb);
+		spin_unlock_bh(&bib_session_lock);
+		return error;
+	case MODE_EVENTS:
+		/* my_mutex guarantees there is only one consumer at a time. */
+		return events_for_each(event_to_userspace, skb);
+	case MODE_SYNC:
+		return dump_sync(skb, state);
+	case MODE_CHANGES:
+		error = changelog_for_each(&state->since, change_to_userspace, skb);
+		if (error == -ESTALE)
+			log_err(ERR_UNKNOWN_ERROR, "The changes since generation %llu are no longer "
+					"available; the tables have to be read again.", state->since);
+		return error;
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * Gets called by Generic Netlink when the userspace application wants a table (see
+ * is_dump_request()), and then again every time userspace has read the previous message.
  *
- * @param skb packet received from userspace.
+ * Each call fills a single message (as many entries as fit) and returns, so no lock is held while
+ * userspace catches up, and a slow reader holds back the dump instead of losing the rest of it.
  */
-static void receive_from_userspace(struct sk_buff *skb)
+static int handle_dump(struct sk_buff *skb, struct netlink_callback *cb)
 {
-	log_debug("Message arrived.");
+	struct request_hdr *nat64_hdr;
+	struct dump_state *state;
+	void *msg;
+	unsigned int empty_len;
+	int error;
+
+	nat64_hdr = get_request(cb->nlh);
+	if (!nat64_hdr)
+		return -EINVAL;
+
+	if (!is_dump_request(nat64_hdr)) {
+		log_err(ERR_UNKNOWN_OP, "Mode %u, operation %u is not a table; it cannot be dumped.",
+				nat64_hdr->mode, nat64_hdr->operation);
+		return -EINVAL;
+	}
+
+	state = (struct dump_state *) cb->args[0];
+	if (!state) {
+		log_debug("Sending a table (mode %u) to userspace.", nat64_hdr->mode);
+		error = dump_state_create(nat64_hdr, &state);
+		if (error)
+			return error;
+		cb->args[0] = (long) state;
+	}
+
+	if (state->done)
+		return 0;
+
+	msg = genlmsg_put(skb, cb_portid(cb), cb->nlh->nlmsg_seq, &jool_family, NLM_F_MULTI,
+			JOOL_CMD_REQUEST);
+	if (!msg)
+		return -EMSGSIZE;
+	empty_len = skb->len;
+
 	mutex_lock(&my_mutex);
-	netlink_rcv_skb(skb, &handle_netlink_message);
+	error = dump_entries(skb, nat64_hdr, state);
 	mutex_unlock(&my_mutex);
+
+	if (error && error != -EMSGSIZE) {
+		genlmsg_cancel(skb, msg);
+		return error;
+	}
+	if (!error)
+		state->done = true;
+
+	if (skb->len == empty_len) {
+		/* Either there was nothing to send, or the next entry doesn't fit in a message. */
+		genlmsg_cancel(skb, msg);
+		return error;
+	}
+
+	genlmsg_end(skb, msg);
+	return skb->len;
+}
+
+static int handle_dump_done(struct netlink_callback *cb)
+{
+	kfree((struct dump_state *) cb->args[0]);
+	return 0;
+}
+
+static struct genl_ops ops[] = {
+	{
+		.cmd = JOOL_CMD_REQUEST,
+		.doit = handle_request,
+		.dumpit = handle_dump,
+		.done = handle_dump_done,
+	},
+};
+
+/*
+ * Linux 3.13 moved the multicast groups into the family.
+ * (That's commit 2a94fe48f32ccf7321450a2cc07f2b724a444e5b, v3.13-rc1~105^2~176.)
+ */
+enum jool_genl_group {
+	GROUP_EVENTS,
+	GROUP_SYNC,
+};
+
+static struct genl_multicast_group groups[] = {
+	[GROUP_EVENTS] = { .name = JOOL_GENL_EVENTS_GROUP },
+	[GROUP_SYNC] = { .name = JOOL_GENL_SYNC_GROUP },
+};
+
+static struct genl_family jool_family = {
+	.id = GENL_ID_GENERATE,
+	.hdrsize = 0,
+	.name = JOOL_GENL_FAMILY,
+	.version = JOOL_GENL_VERSION,
+	.maxattr = 0,
+};
+
+static bool has_listeners(enum jool_genl_group group)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 13, 0)
+	return netlink_has_listeners(init_net.genl_sock, groups[group].id);
+#else
+	return netlink_has_listeners(init_net.genl_sock, jool_family.mcgrp_offset + group);
+#endif
+}
+
+static void multicast(struct sk_buff *skb, enum jool_genl_group group)
+{
+	int error;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 13, 0)
+	error = genlmsg_multicast(skb, 0, groups[group].id, GFP_KERNEL);
+#else
+	error = genlmsg_multicast(&jool_family, skb, 0, group, GFP_KERNEL);
+#endif
+	/* -ESRCH means the listeners left; that's fine. */
+	if (error && error != -ESRCH)
+		log_debug("Error code %d while publishing to group %s.", error, groups[group].name);
+}
+
+/**
+ * Sends the events recorded since the last time to the events multicast group, then schedules
+ * itself again.
+ *
+ * While nobody listens, the events are left in the rings, so jool --events can still fetch them.
+ */
+static void publish_events(struct work_struct *work)
+{
+	struct sk_buff *skb;
+	void *msg;
+	unsigned int empty_len;
+	int error;
+
+	mutex_lock(&my_mutex);
+
+	while (has_listeners(GROUP_EVENTS)) {
+		skb = nlmsg_new(NLMSG_DEFAULT_SIZE, GFP_KERNEL);
+		if (!skb)
+			break;
+
+		msg = genlmsg_put(skb, 0, 0, &jool_family, 0, JOOL_CMD_EVENTS);
+		if (!msg) {
+			nlmsg_free(skb);
+			break;
+		}
+		empty_len = skb->len;
+
+		error = events_for_each(event_to_userspace, skb);
+		if (skb->len == empty_len) {
+			nlmsg_free(skb);
+			break;
+		}
+
+		genlmsg_end(skb, msg);
+		multicast(skb, GROUP_EVENTS);
+
+		if (error != -EMSGSIZE)
+			break;
+	}
+
+	mutex_unlock(&my_mutex);
+
+	schedule_delayed_work(&events_work, EVENTS_PUBLISH_PERIOD);
+}
+
+/**
+ * Sends the session changes queued since the last time to the sync multicast group, one batch per
+ * message, then schedules itself again.
+ *
+ * Nothing is queued while nobody listens, so the packet path doesn't pay for an unused feature.
+ */
+static void publish_sync(struct work_struct *work)
+{
+	struct sk_buff *skb;
+	struct sync_batch *batch;
+	void *msg;
+	unsigned int count;
+	bool lost;
+
+	if (!has_listeners(GROUP_SYNC)) {
+		sync_set_enabled(false);
+		goto end;
+	}
+	sync_set_enabled(true);
+
+	do {
+		skb = genlmsg_new(sizeof(*batch) + SYNC_BATCH_MAX * sizeof(struct sync_session),
+				GFP_KERNEL);
+		if (!skb)
+			break;
+
+		msg = genlmsg_put(skb, 0, 0, &jool_family, 0, JOOL_CMD_SYNC);
+		if (!msg) {
+			nlmsg_free(skb);
+			break;
+		}
+
+		batch = (struct sync_batch *) skb_put(skb, sizeof(*batch));
+		count = sync_pop((struct sync_session *) skb_tail_pointer(skb), SYNC_BATCH_MAX, &lost);
+		if (!count && !lost) {
+			nlmsg_free(skb);
+			break;
+		}
+		skb_put(skb, count * sizeof(struct sync_session));
+
+		batch->version = SYNC_VERSION;
+		batch->flags = lost ? SYNC_FLAG_LOST : 0;
+		batch->count = cpu_to_be16(count);
+
+		genlmsg_end(skb, msg);
+		multicast(skb, GROUP_SYNC);
+	} while (count == SYNC_BATCH_MAX);
+
+end:
+	schedule_delayed_work(&sync_work, SYNC_PUBLISH_PERIOD);
 }
 
 int config_init(void)
 {
-	/*
-	 * The function changed between Linux 3.5.7 and 3.6, and then again from 3.6.11 to 3.7.
-	 *
-	 * If you're reading Git's history, that appears to be commit
-	 * a31f2d17b331db970259e875b7223d3aba7e3821 (v3.6-rc1~125^2~337) and then again in
-	 * 9f00d9776bc5beb92e8bfc884a7e96ddc5589e2e (v3.7-rc1~145^2~194).
-	 */
-#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 6, 0)
-	nl_socket = netlink_kernel_create(&init_net, NETLINK_USERSOCK, 0, receive_from_userspace,
-			NULL, THIS_MODULE);
-#elif LINUX_VERSION_CODE < KERNEL_VERSION(3, 7, 0)
-	struct netlink_kernel_cfg nl_cfg = { .input  = receive_from_userspace };
-	nl_socket = netlink_kernel_create(&init_net, NETLINK_USERSOCK, THIS_MODULE, &nl_cfg);
+	int error;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 13, 0)
+	int i;
+
+	error = genl_register_family_with_ops(&jool_family, ops, ARRAY_SIZE(ops));
+	for (i = 0; !error && i < ARRAY_SIZE(groups); i++) {
+		error = genl_register_mc_group(&jool_family, &groups[i]);
+		if (error)
+			genl_unregister_family(&jool_family);
+	}
 #else
-	struct netlink_kernel_cfg nl_cfg = { .input  = receive_from_userspace };
-	nl_socket = netlink_kernel_create(&init_net, NETLINK_USERSOCK, &nl_cfg);
+	error = genl_register_family_with_ops_groups(&jool_family, ops, groups);
 #endif
-	
-	if (!nl_socket) {
-		log_err(ERR_NETLINK, "Creation of netlink socket failed.");
-		return -EINVAL;
+	if (error) {
+		log_err(ERR_NETLINK, "Could not register the Generic Netlink family (error %d).", error);
+		return error;
 	}
-	log_debug("Netlink socket created.");
+	log_debug("Generic Netlink family registered.");
 
+	schedule_delayed_work(&events_work, EVENTS_PUBLISH_PERIOD);
+	schedule_delayed_work(&sync_work, SYNC_PUBLISH_PERIOD);
 	return 0;
 }
 
 void config_destroy(void)
 {
-	netlink_kernel_release(nl_socket);
+	cancel_delayed_work_sync(&sync_work);
+	cancel_delayed_work_sync(&events_work);
+	genl_unregister_family(&jool_family);
 }
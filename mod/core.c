@@ -9,6 +9,8 @@
 #include "nat64/mod/translate_packet.h"
 #include "nat64/mod/handling_hairpinning.h"
 #include "nat64/mod/send_packet.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/latency.h"
 
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -16,34 +18,89 @@
 #include <net/ipv6.h>
 
 
+/**
+ * Updates the translated packet/byte counters using "pkt", which is about to leave.
+ */
+static void count_translated(struct packet *pkt)
+{
+	struct fragment *frag;
+	u64 bytes = 0;
+
+	list_for_each_entry(frag, &pkt->fragments, list_hook)
+		bytes += frag->skb->len;
+
+	switch (pkt_get_l3proto(pkt)) {
+	case L3PROTO_IPV4:
+		stats_inc(STAT_PKTS_6TO4);
+		stats_add(STAT_BYTES_6TO4, bytes);
+		break;
+	case L3PROTO_IPV6:
+		stats_inc(STAT_PKTS_4TO6);
+		stats_add(STAT_BYTES_4TO6, bytes);
+		break;
+	}
+}
+
 static unsigned int core_common(struct sk_buff *skb_in)
 {
 	struct packet *pkt_in = NULL;
 	struct packet *pkt_out = NULL;
 	struct tuple tuple_in;
 	struct tuple tuple_out;
+	ktime_t start = ktime_set(0, 0);
 	verdict result;
 
+	latency_start(&start);
 	result = fragment_arrives(skb_in, &pkt_in);
-	if (result != VER_CONTINUE)
+	latency_stop(LATENCY_FRAGMENT, &start);
+	if (result != VER_CONTINUE) {
+		switch (result) {
+		case VER_ACCEPT:
+			stats_inc(STAT_ACCEPTED);
+			break;
+		case VER_DROP:
+			stats_inc(STAT_DROPPED);
+			break;
+		default:
+			stats_inc(STAT_STOLEN);
+			break;
+		}
 		return (unsigned int) result;
+	}
 
-	if (determine_in_tuple(pkt_in->first_fragment, &tuple_in) != VER_CONTINUE)
+	result = determine_in_tuple(pkt_in->first_fragment, &tuple_in);
+	latency_stop(LATENCY_INCOMING_TUPLE, &start);
+	if (result != VER_CONTINUE)
 		goto end;
-	if (filtering_and_updating(pkt_in->first_fragment, &tuple_in) != VER_CONTINUE)
+
+	result = filtering_and_updating(pkt_in->first_fragment, &tuple_in);
+	latency_stop(LATENCY_FILTERING, &start);
+	if (result != VER_CONTINUE)
 		goto end;
-	if (compute_out_tuple(&tuple_in, &tuple_out) != VER_CONTINUE)
+
+	result = compute_out_tuple(&tuple_in, &tuple_out);
+	latency_stop(LATENCY_OUTGOING_TUPLE, &start);
+	if (result != VER_CONTINUE)
 		goto end;
-	if (translating_the_packet(&tuple_out, pkt_in, &pkt_out) != VER_CONTINUE)
+
+	result = translating_the_packet(&tuple_out, pkt_in, &pkt_out);
+	latency_stop(LATENCY_TRANSLATE, &start);
+	if (result != VER_CONTINUE) {
+		stats_inc(STAT_TRANSLATE_FAILED);
 		goto end;
+	}
+
+	count_translated(pkt_out);
 
 	if (is_hairpin(pkt_out)) {
-		if (handling_hairpinning(pkt_out, &tuple_out) != VER_CONTINUE)
-			goto end;
+		stats_inc(STAT_HAIRPINNED);
+		result = handling_hairpinning(pkt_out, &tuple_out);
 	} else {
-		if (send_pkt(pkt_out) != VER_CONTINUE)
-			goto end;
+		result = send_pkt(pkt_out);
 	}
+	latency_stop(LATENCY_SEND, &start);
+	if (result != VER_CONTINUE)
+		goto end;
 
 	log_debug("Success.");
 	/* Fall through. */
@@ -51,6 +108,7 @@ static unsigned int core_common(struct sk_buff *skb_in)
 end:
 	pkt_kfree(pkt_in);
 	pkt_kfree(pkt_out);
+	stats_inc(STAT_STOLEN);
 	return (unsigned int) VER_STOLEN;
 }
 
@@ -62,13 +120,25 @@ unsigned int core_4to6(struct sk_buff *skb)
 	struct iphdr *ip4_header;
 	struct in_addr daddr;
 
-	skb_linearize(skb);
-
+	/*
+	 * The IPv4 header is always in the linear area by the time the hooks see the packet, so the
+	 * packet can be classified before we touch it. This keeps traffic which is not meant for us
+	 * (eg. native IPv4 being routed by this same box) nearly free.
+	 */
 	ip4_header = ip_hdr(skb);
 
 	daddr.s_addr = ip4_header->daddr;
-	if (!pool4_contains(&daddr))
+	if (!pool4_contains(&daddr)) {
+		stats_inc(STAT_ACCEPTED);
 		return NF_ACCEPT;
+	}
+
+	if (skb_linearize(skb)) {
+		log_err(ERR_ALLOC_FAILED, "Could not linearize the IPv4 packet.");
+		stats_inc(STAT_DROPPED);
+		return NF_DROP;
+	}
+	ip4_header = ip_hdr(skb);
 
 	log_debug("===============================================");
 	log_debug("Catching IPv4 packet: %pI4->%pI4", &ip4_header->saddr, &ip4_header->daddr);
@@ -83,12 +153,20 @@ unsigned int core_6to4(struct sk_buff *skb)
 {
 	struct ipv6hdr *ip6_header;
 
-	skb_linearize(skb);
-
+	/* Same as core_4to6(); the fixed IPv6 header is always in the linear area. */
 	ip6_header = ipv6_hdr(skb);
 
-	if (!pool6_contains(&ip6_header->daddr))
+	if (!pool6_contains(&ip6_header->daddr)) {
+		stats_inc(STAT_ACCEPTED);
 		return NF_ACCEPT;
+	}
+
+	if (skb_linearize(skb)) {
+		log_err(ERR_ALLOC_FAILED, "Could not linearize the IPv6 packet.");
+		stats_inc(STAT_DROPPED);
+		return NF_DROP;
+	}
+	ip6_header = ipv6_hdr(skb);
 
 	log_debug("===============================================");
 	log_debug("Catching IPv6 packet: %pI6c->%pI6c", &ip6_header->saddr, &ip6_header->daddr);
@@ -0,0 +1,200 @@
+#include "nat64/mod/events.h"
+#include "nat64/comm/constants.h"
+#include "nat64/mod/stats.h"
+
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/jiffies.h>
+#include <linux/string.h>
+
+
+#if (EVENTS_RING_SIZE & (EVENTS_RING_SIZE - 1)) != 0
+#error "EVENTS_RING_SIZE must be a power of two."
+#endif
+
+/**
+ * One CPU's events.
+ *
+ * The ring is a single-producer, single-consumer queue. The producer is the CPU the ring belongs to
+ * (with bottom halves disabled, so it cannot race against itself), and the consumer is whoever is
+ * handling the userspace request (config.c serializes those). Neither needs a lock.
+ */
+struct events_cpu {
+	struct event_us ring[EVENTS_RING_SIZE];
+	/** Number of events ever written. Only the producer writes this. */
+	unsigned int head;
+	/** Number of events ever read. Only the consumer writes this. */
+	unsigned int tail;
+
+	/** Jiffy the current rate limiting window of each event type started in. */
+	unsigned long window_start[EVENT_TYPE_COUNT];
+	/** Events of each type recorded since window_start. */
+	unsigned int window_count[EVENT_TYPE_COUNT];
+};
+
+/** The rings, one per CPU. */
+static struct events_cpu __percpu *events;
+
+
+int events_init(void)
+{
+	struct events_cpu *cpu_events;
+	int cpu;
+	int i;
+
+	events = alloc_percpu(struct events_cpu);
+	if (!events) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the per-CPU event rings.");
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		cpu_events = per_cpu_ptr(events, cpu);
+		for (i = 0; i < EVENT_TYPE_COUNT; i++)
+			cpu_events->window_start[i] = jiffies;
+	}
+
+	return 0;
+}
+
+void events_destroy(void)
+{
+	free_percpu(events);
+	events = NULL;
+}
+
+/**
+ * Returns the slot the current CPU's next event of type "type" should be written in, or NULL if the
+ * event should be skipped. Bottom halves are expected to be disabled.
+ */
+static struct event_us *reserve(struct events_cpu *cpu_events, enum event_type type)
+{
+	struct event_us *event;
+
+	if (time_after(jiffies, cpu_events->window_start[type] + HZ)) {
+		cpu_events->window_start[type] = jiffies;
+		cpu_events->window_count[type] = 0;
+	}
+	if (cpu_events->window_count[type] >= EVENTS_PER_SECOND) {
+		stats_inc(STAT_EVENTS_SUPPRESSED);
+		return NULL;
+	}
+	cpu_events->window_count[type]++;
+
+	if (cpu_events->head - ACCESS_ONCE(cpu_events->tail) >= EVENTS_RING_SIZE) {
+		stats_inc(STAT_EVENTS_LOST);
+		return NULL;
+	}
+
+	event = &cpu_events->ring[cpu_events->head & (EVENTS_RING_SIZE - 1)];
+	memset(event, 0, sizeof(*event));
+	event->age = jiffies;
+	event->type = type;
+	return event;
+}
+
+/** Makes the event reserve() returned visible to the consumer. */
+static void commit(struct events_cpu *cpu_events)
+{
+	/* The consumer must not see the new head before the event's contents. */
+	smp_wmb();
+	ACCESS_ONCE(cpu_events->head) = cpu_events->head + 1;
+}
+
+/**
+ * Records an event. Either address can be NULL, in which case it is left zeroed.
+ */
+static void record(enum event_type type, enum stat_counter reason, l4_protocol l4_proto,
+		struct ipv6_tuple_address *addr6, struct ipv4_tuple_address *addr4)
+{
+	struct events_cpu *cpu_events;
+	struct event_us *event;
+
+	local_bh_disable();
+	cpu_events = this_cpu_ptr(events);
+
+	event = reserve(cpu_events, type);
+	if (event) {
+		event->reason = reason;
+		event->l4_proto = l4_proto;
+		if (addr6)
+			event->ipv6 = *addr6;
+		if (addr4)
+			event->ipv4 = *addr4;
+		commit(cpu_events);
+	}
+
+	local_bh_enable();
+}
+
+void events_bib(enum event_type type, struct bib_entry *bib, l4_protocol l4_proto)
+{
+	record(type, 0, l4_proto, &bib->ipv6, &bib->ipv4);
+}
+
+void events_session(enum event_type type, struct session_entry *session)
+{
+	record(type, 0, session->l4_proto, &session->ipv6.remote, &session->ipv4.remote);
+}
+
+void events_pool4_exhausted(struct tuple *tuple)
+{
+	struct ipv6_tuple_address addr6;
+
+	addr6.address = tuple->src.addr.ipv6;
+	addr6.l4_id = tuple->src.l4_id;
+	record(EVENT_POOL4_EXHAUSTED, 0, tuple->l4_proto, &addr6, NULL);
+}
+
+void events_drop(enum stat_counter reason, struct tuple *tuple)
+{
+	struct ipv6_tuple_address addr6;
+	struct ipv4_tuple_address addr4;
+
+	switch (tuple->l3_proto) {
+	case L3PROTO_IPV6:
+		addr6.address = tuple->src.addr.ipv6;
+		addr6.l4_id = tuple->src.l4_id;
+		record(EVENT_DROP, reason, tuple->l4_proto, &addr6, NULL);
+		break;
+	case L3PROTO_IPV4:
+		addr4.address = tuple->src.addr.ipv4;
+		addr4.l4_id = tuple->src.l4_id;
+		record(EVENT_DROP, reason, tuple->l4_proto, NULL, &addr4);
+		break;
+	}
+}
+
+int events_for_each(int (*func)(struct event_us *, void *), void *arg)
+{
+	struct events_cpu *cpu_events;
+	struct event_us event;
+	unsigned int head, tail;
+	int cpu;
+	int error = 0;
+
+	for_each_possible_cpu(cpu) {
+		cpu_events = per_cpu_ptr(events, cpu);
+
+		head = ACCESS_ONCE(cpu_events->head);
+		/* Do not read the events before the head that announced them. */
+		smp_rmb();
+
+		for (tail = cpu_events->tail; tail != head; tail++) {
+			event = cpu_events->ring[tail & (EVENTS_RING_SIZE - 1)];
+			event.age = jiffies_to_msecs(jiffies - (unsigned long) event.age);
+			error = func(&event, arg);
+			if (error)
+				break; /* The event stays, so the next call starts with it. */
+		}
+
+		/* The producer must not overwrite the slots before we're done reading them. */
+		smp_mb();
+		ACCESS_ONCE(cpu_events->tail) = tail;
+
+		if (error)
+			break;
+	}
+
+	return error;
+}
@@ -7,8 +7,16 @@
 #include "nat64/mod/pool6.h"
 #include "nat64/mod/bib.h"
 #include "nat64/mod/session.h"
-#include "nat64/mod/send_packet.h"
-
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/sync.h"
+#include "nat64/mod/changelog.h"
+#include "nat64/mod/pending_syn.h"
+#include "nat64/mod/pkt_queue.h"
+#include "nat64/mod/tcp_probe.h"
+
+#include <linux/version.h>
+#include <linux/mm.h>
 #include <linux/skbuff.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
@@ -36,44 +44,11 @@ static LIST_HEAD(sessions_syn);
 static struct timer_list expire_timer;
 
 
-/** The states from the TCP state machine; RFC 6146 section 3.5.2. */
-enum tcp_states {
-	/** No traffic has been seen; state is fictional. */
-	CLOSED = 0,
-	/** A SYN packet arrived from the IPv6 side; some IPv4 node is trying to start a connection. */
-	V6_INIT,
-	/** A SYN packet arrived from the IPv4 side; some IPv4 node is trying to start a connection. */
-	V4_INIT,
-	/** The handshake is complete and the sides are exchanging upper-layer data. */
-	ESTABLISHED,
-	/**
-	 * The IPv4 node wants to terminate the connection. Data can still flow.
-	 * Awaiting a IPv6 FIN...
-	 */
-	V4_FIN_RCV,
-	/**
-	 * The IPv6 node wants to terminate the connection. Data can still flow.
-	 * Awaiting a IPv4 FIN...
-	 */
-	V6_FIN_RCV,
-	/** Both sides issued a FIN. Packets can still flow for a short time. */
-	V4_FIN_V6_FIN_RCV,
-	/** The session might die in a short while. */
-	TRANS,
-};
-
-
 /**
- * Helper of the set_*_timer functions. Safely updates "session"->dying_time and moves it from its
- * original location to the end of "list".
+ * Makes sure the cleaner wakes up in time to expire "session".
  */
-static void update_timer(struct session_entry *session, struct list_head *list, __u64 ttl)
+static void schedule_timer(struct session_entry *session)
 {
-	session->dying_time = jiffies + ttl;
-
-	list_del(&session->expire_list_hook);
-	list_add(&session->expire_list_hook, list->prev);
-
 	/*
 	 * TODO (performance) is the second comparison really neccesary?
 	 * The new session should always expire last. (This also applies to the fragment DB timer)
@@ -90,6 +65,43 @@ static void update_timer(struct session_entry *session, struct list_head *list,
 	}
 }
 
+/**
+ * Helper of the set_*_timer functions. Safely updates "session"->dying_time and moves it from its
+ * original location to the end of "list".
+ */
+static void update_timer(struct session_entry *session, struct list_head *list, __u64 ttl)
+{
+	session->dying_time = jiffies + ttl;
+
+	list_del(&session->expire_list_hook);
+	list_add(&session->expire_list_hook, list->prev);
+
+	schedule_timer(session);
+}
+
+/**
+ * Same as update_timer(), except "session" will die at "dying_time", which might come before the
+ * dying_time of sessions already in "list". "session" is inserted so the list stays sorted.
+ */
+static void update_timer_sorted(struct session_entry *session, struct list_head *list,
+		unsigned long dying_time)
+{
+	struct list_head *prev;
+
+	session->dying_time = dying_time;
+	list_del(&session->expire_list_hook);
+
+	/* The lifetime is usually close to the list's timeout, so look from the end. */
+	for (prev = list->prev; prev != list; prev = prev->prev) {
+		if (!time_before(dying_time,
+				list_entry(prev, struct session_entry, expire_list_hook)->dying_time))
+			break;
+	}
+	list_add(&session->expire_list_hook, prev);
+
+	schedule_timer(session);
+}
+
 /**
  * Marks "session" to be destroyed after the UDP session lifetime has lapsed.
  */
@@ -198,91 +210,6 @@ static unsigned long get_next_dying_time(void)
 	return current_min;
 }
 
-/**
- * Sends a probe packet to "session"'s IPv6 endpoint.
- *
- * From RFC 6146 page 30.
- *
- * @param[in] session the established session that has been inactive for too long.
- */
-static void send_probe_packet(struct session_entry *session)
-{
-	struct sk_buff* skb;
-	struct dst_entry *dst;
-	struct ipv6hdr *iph;
-	struct tcphdr *th;
-	int error;
-
-	unsigned int l3_hdr_len = sizeof(*iph);
-	unsigned int l4_hdr_len = sizeof(*th);
-
-	skb = alloc_skb(LL_MAX_HEADER + l3_hdr_len + l4_hdr_len, GFP_ATOMIC);
-	if (!skb) {
-		log_warning("Could now allocate a probe packet.");
-		goto fail;
-	}
-
-	skb_reserve(skb, LL_MAX_HEADER);
-	skb_put(skb, l3_hdr_len + l4_hdr_len);
-	skb_reset_mac_header(skb);
-	skb_reset_network_header(skb);
-	skb_set_transport_header(skb, l3_hdr_len);
-
-	iph = ipv6_hdr(skb);
-	iph->version = 6;
-	iph->priority = 0;
-	iph->flow_lbl[0] = 0;
-	iph->flow_lbl[1] = 0;
-	iph->flow_lbl[2] = 0;
-	iph->payload_len = l4_hdr_len;
-	iph->nexthdr = NEXTHDR_TCP;
-	iph->hop_limit = 255;
-	iph->saddr = session->ipv6.local.address;
-	iph->daddr = session->ipv6.remote.address;
-
-	th = tcp_hdr(skb);
-	th->source = cpu_to_be16(session->ipv6.local.l4_id);
-	th->dest = cpu_to_be16(session->ipv6.remote.l4_id);
-	th->seq = htonl(0);
-	th->ack_seq = htonl(0);
-	th->res1 = 0;
-	th->doff = l4_hdr_len / 4;
-	th->fin = 0;
-	th->syn = 0;
-	th->rst = 0;
-	th->psh = 0;
-	th->ack = 1;
-	th->urg = 0;
-	th->ece = 0;
-	th->cwr = 0;
-	th->window = htons(8192);
-	th->check = 0;
-	th->urg_ptr = 0;
-
-	th->check = csum_ipv6_magic(&iph->saddr, &iph->daddr, l4_hdr_len, IPPROTO_TCP,
-			csum_partial(th, l4_hdr_len, 0));
-	skb->ip_summed = CHECKSUM_UNNECESSARY;
-
-	dst = route_ipv6(iph, th, L4PROTO_TCP, 0);
-	if (!dst) {
-		log_warning("Could now route the probe packet.");
-		goto fail;
-	}
-	skb->dev = dst->dev;
-	skb_dst_set(skb, dst);
-
-	error = ip6_local_out(skb);
-	if (error) {
-		log_warning("The kernel's packet dispatch function returned errcode %d.", error);
-		goto fail;
-	}
-
-	return;
-
-fail:
-	log_warning("Looks like a TCP connection will break or remain idle forever somewhere...");
-}
-
 /**
  * Decides whether "session"'s expiration should cause its destruction or not. It should be called
  * when "session" expires.
@@ -304,13 +231,12 @@ static bool session_expire(struct session_entry *session)
 	case L4PROTO_TCP:
 		switch (session->state) {
 		case V4_INIT:
-			/* TODO (Issue #58) send the stored packet. */
-			/* send_icmp_error_message(skb, DESTINATION_UNREACHABLE, ADDRESS_UNREACHABLE); */
+			/* Stored SYNs are answered by pkt_queue; V4_INIT sessions never hold one. */
 			session->state = CLOSED;
 			return true;
 
 		case ESTABLISHED:
-			send_probe_packet(session);
+			tcpprobe_add(session);
 			session->state = TRANS;
 			set_tcp_trans_timer(session);
 			return false;
@@ -342,6 +268,48 @@ static bool session_expire(struct session_entry *session)
 	return true;
 }
 
+/**
+ * Removes "session" from the database and frees it. Its BIB entry dies along with it if no other
+ * sessions need it, unless it is "keep".
+ *
+ * @return 1 if the BIB entry was also removed, 0 if it wasn't, negative if "session" couldn't be
+ *		removed.
+ */
+static int remove_session(struct session_entry *session, struct bib_entry *keep)
+{
+	struct bib_entry *bib;
+	l4_protocol l4_proto;
+	int error;
+
+	error = session_remove(session);
+	if (error)
+		return error; /* Error msg already printed. */
+
+	bib = session->bib;
+	l4_proto = session->l4_proto;
+
+	list_del(&session->bib_list_hook);
+	list_del(&session->expire_list_hook);
+	events_session(EVENT_SESSION_EXPIRED, session);
+	sync_session_remove(session);
+	session_kfree(session);
+
+	if (!bib) {
+		log_crit(ERR_NULL, "The session entry I just removed had no BIB entry."); /* ?? */
+		return 0;
+	}
+
+	if (!list_empty(&bib->sessions) || bib->is_static || bib == keep)
+		return 0; /* The BIB entry needn't die; no error to report. */
+	if (is_error(bib_remove(bib, l4_proto)))
+		return 0; /* Error msg already printed. */
+
+	pool4_return(l4_proto, &bib->ipv4);
+	events_bib(EVENT_BIB_REMOVED, bib, l4_proto);
+	bib_kfree(bib);
+	return 1;
+}
+
 /**
  * Iterates through "list", deleting expired sessions.
  * "list" is assumed to be sorted by expiration date, so it will stop on the first unexpired
@@ -353,47 +321,35 @@ static bool clean_expired_sessions(struct list_head *list)
 {
 	struct list_head *current_hook, *next_hook;
 	struct session_entry *session;
-	struct bib_entry *bib;
 	unsigned int s = 0;
 	unsigned int b = 0;
-	l4_protocol l4_proto;
+	int removed;
 
 	list_for_each_safe(current_hook, next_hook, list) {
 		session = list_entry(current_hook, struct session_entry, expire_list_hook);
 
 		if (time_before(jiffies, session->dying_time)) {
+			stats_add(STAT_SESSION_EXPIRED, s);
+			stats_add(STAT_BIB_REMOVED, b);
 			log_debug("Deleted %u sessions and %u BIB entries.", s, b);
 			return false;
 		}
-		if (!session_expire(session))
-			continue; /* The entry's TTL changed, which doesn't mean the next one isn't expired. */
-
-		if (is_error(session_remove(session)))
-			continue; /* Error msg already printed. */
-
-		bib = session->bib;
-		l4_proto = session->l4_proto;
-
-		list_del(&session->bib_list_hook);
-		list_del(&session->expire_list_hook);
-		session_kfree(session);
-		s++;
-
-		if (!bib) {
-			log_crit(ERR_NULL, "The session entry I just removed had no BIB entry."); /* ?? */
+		if (!session_expire(session)) {
+			/* The entry's TTL changed, which doesn't mean the next one isn't expired. */
+			changelog_session(CHANGE_UPDATED, session);
+			sync_session_update(session);
 			continue;
 		}
 
-		if (!list_empty(&bib->sessions) || bib->is_static)
-			continue; /* The BIB entry needn't die; no error to report. */
-		if (is_error(bib_remove(bib, l4_proto)))
-			continue; /* Error msg already printed. */
-
-		pool4_return(l4_proto, &bib->ipv4);
-		bib_kfree(bib);
-		b++;
+		removed = remove_session(session, NULL);
+		if (removed < 0)
+			continue;
+		s++;
+		b += removed;
 	}
 
+	stats_add(STAT_SESSION_EXPIRED, s);
+	stats_add(STAT_BIB_REMOVED, b);
 	log_debug("Deleted %u sessions and %u BIB entries.", s, b);
 
 	return true;
@@ -460,6 +416,21 @@ static bool address_dependent_filtering(void)
 	return result;
 }
 
+/**
+ * Use this function to safely obtain the configuration value which dictates whether IPv4 nodes'
+ * handshakes should be kept out of the session table until the IPv6 node answers.
+ */
+static bool defer_external_connections(void)
+{
+	bool result;
+
+	rcu_read_lock_bh();
+	result = rcu_dereference_bh(config)->defer_external_tcp;
+	rcu_read_unlock_bh();
+
+	return result;
+}
+
 /**
  * Use this function to safely obtain the configuration value which dictates whether IPv4 nodes
  * should be allowed to initiate conversations with IPv6 nodes.
@@ -565,11 +536,189 @@ static int allocate_ipv4_transport_address(struct tuple *base, struct ipv4_tuple
 }
 
 /**
- * Decides whether the packet should be filtered or not. Not yet implemented.
+ * Use this function to safely obtain the maximum sizes of the tables.
+ */
+static void get_limits(struct limits *result)
+{
+	rcu_read_lock_bh();
+	*result = rcu_dereference_bh(config)->max;
+	rcu_read_unlock_bh();
+}
+
+/**
+ * Returns the number of entries "count_fn" reports, adding up every protocol.
+ */
+static __u64 count_entries(int (*count_fn)(l4_protocol, __u64 *))
+{
+	l4_protocol protos[] = { L4PROTO_UDP, L4PROTO_TCP, L4PROTO_ICMP };
+	__u64 total = 0;
+	__u64 count;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(protos); i++)
+		if (!count_fn(protos[i], &count))
+			total += count;
+
+	return total;
+}
+
+struct node_usage {
+	/** Entries counted so far. */
+	__u64 count;
+	/** Number of entries after which the iteration can stop. */
+	__u64 limit;
+	/** Count sessions (true) or BIB entries (false)? */
+	bool sessions;
+};
+
+/**
+ * Adds "bib" (or its sessions) to "void_usage"'s count.
+ *
+ * See node_limit_reached().
+ */
+static int count_node_entries(struct bib_entry *bib, void *void_usage)
+{
+	struct node_usage *usage = void_usage;
+	struct list_head *node;
+
+	/* Stop as soon as the answer is known; a node might own lots of entries. */
+	if (usage->sessions) {
+		list_for_each(node, &bib->sessions) {
+			usage->count++;
+			if (usage->count >= usage->limit)
+				return 1;
+		}
+		return 0;
+	}
+
+	usage->count++;
+	return usage->count >= usage->limit;
+}
+
+/**
+ * Returns whether the IPv6 node "addr" already owns "limit" BIB entries ("sessions" false) or
+ * sessions ("sessions" true) in the tables, adding up every protocol. Zero means unlimited.
+ */
+static bool node_limit_reached(struct in6_addr *addr, __u64 limit, bool sessions)
+{
+	l4_protocol protos[] = { L4PROTO_UDP, L4PROTO_TCP, L4PROTO_ICMP };
+	struct node_usage usage = { .count = 0, .limit = limit, .sessions = sessions };
+	int i;
+
+	if (!limit)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(protos); i++)
+		if (bib_for_each_ipv6(protos[i], addr, count_node_entries, &usage) > 0)
+			return true;
+
+	return false;
+}
+
+/**
+ * Returns whether the BIB cannot hold another entry owned by "node".
+ */
+static bool bib_limit_reached(struct in6_addr *node)
+{
+	struct limits max;
+
+	get_limits(&max);
+	if (max.bib && count_entries(bib_count) >= max.bib)
+		return true;
+	return node_limit_reached(node, max.bib_per_node, false);
+}
+
+/**
+ * Returns whether the session table cannot hold another entry owned by "node".
+ */
+static bool session_limit_reached(struct in6_addr *node)
+{
+	struct limits max;
+
+	get_limits(&max);
+	if (max.session && count_entries(session_count) >= max.session)
+		return true;
+	return node_limit_reached(node, max.session_per_node, true);
+}
+
+/**
+ * Expires up to "count" sessions early, least valuable first: TCP sessions in transitory states,
+ * then the idlest UDP sessions, then ICMP. Established TCP sessions are never evicted.
+ * "keep" survives even if it loses all of its sessions.
+ *
+ * Assumes the caller holds bib_session_lock.
+ *
+ * @return number of sessions evicted.
+ */
+static unsigned int evict_sessions(unsigned int count, struct bib_entry *keep)
+{
+	struct list_head *lists[] = {
+			&sessions_tcp_trans, &sessions_syn, &sessions_udp, &sessions_icmp
+	};
+	struct list_head *current_hook, *next_hook;
+	struct session_entry *session;
+	unsigned int s = 0;
+	unsigned int b = 0;
+	int removed;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lists) && s < count; i++) {
+		/* The lists are sorted by expiration date, so the idlest sessions come first. */
+		list_for_each_safe(current_hook, next_hook, lists[i]) {
+			if (s >= count)
+				break;
+
+			session = list_entry(current_hook, struct session_entry, expire_list_hook);
+			removed = remove_session(session, keep);
+			if (removed < 0)
+				continue;
+			s++;
+			b += removed;
+		}
+	}
+
+	stats_add(STAT_SESSION_EXPIRED, s);
+	stats_add(STAT_SESSION_EVICTED, s);
+	stats_add(STAT_BIB_REMOVED, b);
+	log_debug("Evicted %u sessions and %u BIB entries.", s, b);
+
+	return s;
+}
+
+/**
+ * If the session table has reached its high-water mark, evicts sessions so the one about to be
+ * created (which will belong to "bib") fits. Evicts in batches so the next few packets don't have
+ * to.
+ */
+static void evict_if_needed(struct bib_entry *bib)
+{
+	struct limits max;
+	__u64 mark;
+	__u64 total;
+
+	get_limits(&max);
+	mark = max.session_evict;
+	if (!mark)
+		return;
+	/* We'd rather shed sessions than refuse new ones. */
+	if (max.session && max.session < mark)
+		mark = max.session;
+
+	total = count_entries(session_count);
+	if (total < mark)
+		return;
+
+	evict_sessions(min(total - mark + 1, (__u64) EVICT_BATCH), bib);
+}
+
+/**
+ * Accounts "tuple"'s packet as dropped because of "reason".
+ * Use this instead of logging; it can happen once per packet.
  */
-static inline void apply_policies(void)
+static void count_drop(enum stat_counter reason, struct tuple *tuple)
 {
-	/* TODO (Issue #41) decide whether resources and policy allow filtering to continue. */
+	stats_inc(reason);
+	events_drop(reason, tuple);
 }
 
 /**
@@ -592,10 +741,20 @@ static int get_or_create_bib_ipv6(struct fragment *frag, struct tuple *tuple,
 
 	/* The entry does not exist; try to create it. */
 
+	if (bib_limit_reached(&tuple->src.addr.ipv6)) {
+		log_debug("The BIB is full; dropping packet.");
+		count_drop(STAT_BIB_LIMIT, tuple);
+		if (tuple->l4_proto != L4PROTO_ICMP)
+			icmp64_send(frag, ICMPERR_ADDR_UNREACHABLE, 0);
+		return -ENOSPC;
+	}
+
 	/* Look in the BIB tables for a previous packet from the same origin. */
 	error = allocate_ipv4_transport_address(tuple, &addr4);
 	if (error) {
-		log_warning("Error code %d while 'allocating' an address for a BIB entry.", error);
+		log_debug("Error code %d while 'allocating' an address for a BIB entry.", error);
+		stats_inc(STAT_POOL4_EXHAUSTED);
+		events_pool4_exhausted(tuple);
 		if (tuple->l4_proto != L4PROTO_ICMP) {
 			/* I don't know why this is not supposed to happen with ICMP, but the RFC says so... */
 			icmp64_send(frag, ICMPERR_ADDR_UNREACHABLE, 0);
@@ -609,11 +768,11 @@ static int get_or_create_bib_ipv6(struct fragment *frag, struct tuple *tuple,
 	*bib = bib_create(&addr4, &addr6, false);
 	if (!(*bib)) {
 		log_err(ERR_ALLOC_FAILED, "Failed to allocate a BIB entry.");
+		stats_inc(STAT_ALLOC_FAILED);
 		return -ENOMEM;
 	}
 
 	/* Add */
-	apply_policies();
 	error = bib_add(*bib, tuple->l4_proto);
 	if (error) {
 		bib_kfree(*bib);
@@ -621,6 +780,8 @@ static int get_or_create_bib_ipv6(struct fragment *frag, struct tuple *tuple,
 		return error;
 	}
 
+	stats_inc(STAT_BIB_CREATED);
+	events_bib(EVENT_BIB_CREATED, *bib, tuple->l4_proto);
 	return 0;
 }
 
@@ -635,7 +796,8 @@ static int get_or_create_bib_ipv4(struct fragment *frag, struct tuple *tuple,
 
 	error = bib_get(tuple, bib);
 	if (error == -ENOENT) {
-		log_info("There is no BIB entry for the incoming IPv4 packet.");
+		log_debug("There is no BIB entry for the incoming IPv4 packet.");
+		count_drop(STAT_NO_BIB, tuple);
 		icmp64_send(frag, ICMPERR_ADDR_UNREACHABLE, 0);
 		return error;
 	} else if (error) {
@@ -645,7 +807,8 @@ static int get_or_create_bib_ipv4(struct fragment *frag, struct tuple *tuple,
 	}
 
 	if (address_dependent_filtering() && !session_allow(tuple)) {
-		log_info("Packet was blocked by address-dependent filtering.");
+		log_debug("Packet was blocked by address-dependent filtering.");
+		count_drop(STAT_FILTER_ADDR, tuple);
 		icmp64_send(frag, ICMPERR_FILTER, 0);
 		return -EPERM;
 	}
@@ -667,6 +830,13 @@ static int create_session_ipv6(struct tuple *tuple, struct bib_entry *bib,
 	struct ipv6_pair pair6;
 	int error;
 
+	evict_if_needed(bib);
+	if (session_limit_reached(&bib->ipv6.address)) {
+		log_debug("The session table is full; dropping packet.");
+		count_drop(STAT_SESSION_LIMIT, tuple);
+		return -ENOSPC;
+	}
+
 	/* Translate address from IPv6 to IPv4 */
 	error = pool6_get(&tuple->dst.addr.ipv6, &prefix);
 	if (error) {
@@ -697,11 +867,10 @@ static int create_session_ipv6(struct tuple *tuple, struct bib_entry *bib,
 	*session = session_create(&pair4, &pair6, tuple->l4_proto);
 	if (!(*session)) {
 		log_err(ERR_ALLOC_FAILED, "Failed to allocate a session entry.");
+		stats_inc(STAT_ALLOC_FAILED);
 		return -ENOMEM;
 	}
 
-	apply_policies();
-
 	/* Add it to the table. */
 	error = session_add(*session);
 	if (error) {
@@ -714,6 +883,8 @@ static int create_session_ipv6(struct tuple *tuple, struct bib_entry *bib,
 	(*session)->bib = bib;
 	list_add(&(*session)->bib_list_hook, &bib->sessions);
 
+	stats_inc(STAT_SESSION_CREATED);
+	events_session(EVENT_SESSION_CREATED, *session);
 	return 0;
 }
 
@@ -750,6 +921,13 @@ static int create_session_ipv4(struct tuple *tuple, struct bib_entry *bib,
 	struct ipv6_pair pair6;
 	int error;
 
+	evict_if_needed(bib);
+	if (session_limit_reached(&bib->ipv6.address)) {
+		log_debug("The session table is full; dropping packet.");
+		count_drop(STAT_SESSION_LIMIT, tuple);
+		return -ENOSPC;
+	}
+
 	/* Translate address from IPv4 to IPv6 */
 	error = pool6_peek(&prefix);
 	if (error)
@@ -778,11 +956,10 @@ static int create_session_ipv4(struct tuple *tuple, struct bib_entry *bib,
 	*session = session_create(&pair4, &pair6, tuple->l4_proto);
 	if (!(*session)) {
 		log_err(ERR_ALLOC_FAILED, "Failed to allocate a session entry.");
+		stats_inc(STAT_ALLOC_FAILED);
 		return -ENOMEM;
 	}
 
-	apply_policies();
-
 	/* Add it to the table. */
 	error = session_add(*session);
 	if (error) {
@@ -795,6 +972,8 @@ static int create_session_ipv4(struct tuple *tuple, struct bib_entry *bib,
 	(*session)->bib = bib;
 	list_add(&(*session)->bib_list_hook, &bib->sessions);
 
+	stats_inc(STAT_SESSION_CREATED);
+	events_session(EVENT_SESSION_CREATED, *session);
 	return 0;
 }
 
@@ -840,11 +1019,14 @@ static verdict ipv6_udp(struct fragment *frag, struct tuple *tuple)
 	if (error) {
 		bib_remove(bib, tuple->l4_proto);
 		pool4_return(tuple->l4_proto, &bib->ipv4);
+		events_bib(EVENT_BIB_REMOVED, bib, tuple->l4_proto);
 		bib_kfree(bib);
+		stats_inc(STAT_BIB_REMOVED);
 		return VER_DROP;
 	}
 
 	set_udp_timer(session);
+	sync_session_update(session);
 
 	return VER_CONTINUE;
 }
@@ -869,6 +1051,7 @@ static verdict ipv4_udp(struct fragment* frag, struct tuple *tuple)
 		return VER_DROP;
 
 	set_udp_timer(session);
+	sync_session_update(session);
 
 	return VER_CONTINUE;
 }
@@ -889,7 +1072,8 @@ static verdict ipv6_icmp6(struct fragment *frag, struct tuple *tuple)
 	int error;
 
 	if (filter_icmpv6_info()) {
-		log_info("Packet is ICMPv6 info (ping); dropping due to policy.");
+		log_debug("Packet is ICMPv6 info (ping); dropping due to policy.");
+		count_drop(STAT_FILTER_ICMP6_INFO, tuple);
 		return VER_DROP;
 	}
 
@@ -901,11 +1085,14 @@ static verdict ipv6_icmp6(struct fragment *frag, struct tuple *tuple)
 	if (error) {
 		bib_remove(bib, tuple->l4_proto);
 		pool4_return(tuple->l4_proto, &bib->ipv4);
+		events_bib(EVENT_BIB_REMOVED, bib, tuple->l4_proto);
 		bib_kfree(bib);
+		stats_inc(STAT_BIB_REMOVED);
 		return VER_DROP;
 	}
 
 	set_icmp_timer(session);
+	sync_session_update(session);
 
 	return VER_CONTINUE;
 }
@@ -930,6 +1117,7 @@ static verdict ipv4_icmp4(struct fragment* frag, struct tuple *tuple)
 		return VER_DROP;
 
 	set_icmp_timer(session);
+	sync_session_update(session);
 
 	return VER_CONTINUE;
 }
@@ -953,21 +1141,49 @@ static int tcp_closed_v6_syn(struct fragment* frag, struct tuple *tuple)
 	if (error) {
 		bib_remove(bib, tuple->l4_proto);
 		pool4_return(tuple->l4_proto, &bib->ipv4);
+		events_bib(EVENT_BIB_REMOVED, bib, tuple->l4_proto);
 		bib_kfree(bib);
+		stats_inc(STAT_BIB_REMOVED);
 		return error;
 	}
 
+	/* If the IPv4 node's SYN was stored, it will retransmit it and find the session this time. */
+	pktqueue_remove(&session->ipv4);
+
+	if (pending_syn_remove(&session->ipv4)) {
+		/* This answers a deferred IPv4 SYN; same as V4_INIT + V6 SYN. */
+		set_tcp_est_timer(session);
+		session->state = ESTABLISHED;
+		sync_session_update(session);
+		return 0;
+	}
+
 	set_tcp_trans_timer(session);
 	session->state = V6_INIT;
+	sync_session_update(session);
 
 	return 0;
 }
 
-static inline void store_packet(void)
+/**
+ * Keeps "frag" (an IPv4 SYN) around for a while, in case the IPv6 node is opening the same
+ * connection. Returns -EINVAL so the original is dropped either way.
+ */
+static int store_packet(struct fragment *frag, struct tuple *tuple)
 {
-	/* TODO (Issue #58) store the packet. */
-	log_warning("Unknown TCP connections started from the IPv4 side are still unsupported. "
-			"Dropping packet...");
+	struct ipv4_pair pair4;
+
+	pair4.local.address = tuple->dst.addr.ipv4;
+	pair4.local.l4_id = tuple->dst.l4_id;
+	pair4.remote.address = tuple->src.addr.ipv4;
+	pair4.remote.l4_id = tuple->src.l4_id;
+
+	if (pktqueue_add(&pair4, frag) != 0) {
+		log_debug("Could not store the IPv4 SYN. Dropping packet...");
+		count_drop(STAT_TCP_V4_SYN, tuple);
+	}
+
+	return -EINVAL;
 }
 
 /**
@@ -979,24 +1195,31 @@ static int tcp_closed_v4_syn(struct fragment* frag, struct tuple *tuple)
 {
 	struct bib_entry *bib;
 	struct session_entry *session;
+	struct ipv4_pair pair4;
 	int error;
 
 	if (drop_external_connections()) {
-		log_info("Applying policy: Dropping externally initiated TCP connections.");
+		log_debug("Applying policy: Dropping externally initiated TCP connections.");
+		count_drop(STAT_FILTER_EXTERNAL_TCP, tuple);
 		return -EPERM;
 	}
 
-	if (address_dependent_filtering()) {
-		/* TODO (issue #58) set_syn_timer(session); */
-		log_warning("Storage of TCP packets is not yet supported.");
-		return -EINVAL;
-	}
+	if (address_dependent_filtering())
+		return store_packet(frag, tuple);
 
 	error = bib_get(tuple, &bib);
-	if (error) {
-		if (error == -ENOENT)
-			store_packet();
-		return error;
+	if (error)
+		return (error == -ENOENT) ? store_packet(frag, tuple) : error;
+
+	if (defer_external_connections()) {
+		/* The IPv6 node's SYN will create the session. */
+		pair4.local.address = tuple->dst.addr.ipv4;
+		pair4.local.l4_id = tuple->dst.l4_id;
+		pair4.remote.address = tuple->src.addr.ipv4;
+		pair4.remote.l4_id = tuple->src.l4_id;
+		pending_syn_add(&pair4);
+		stats_inc(STAT_SYN_PENDING);
+		return 0;
 	}
 
 	error = create_session_ipv4(tuple, bib, &session);
@@ -1005,6 +1228,7 @@ static int tcp_closed_v4_syn(struct fragment* frag, struct tuple *tuple)
 
 	session->state = V4_INIT;
 	set_tcp_trans_timer(session);
+	sync_session_update(session);
 
 	return 0;
 }
@@ -1032,8 +1256,9 @@ static int tcp_closed_state_handle(struct fragment* frag, struct tuple *tuple)
 
 	error = bib_get(tuple, &bib);
 	if (error) {
-		log_info("Closed state: Packet is not SYN and there is no BIB, so discarding. ERRcode %d",
+		log_debug("Closed state: Packet is not SYN and there is no BIB, so discarding. ERRcode %d",
 				error);
+		count_drop(STAT_TCP_NO_STATE, tuple);
 	}
 
 	return error;
@@ -1163,6 +1388,7 @@ static int tcp_trans_state_handle(struct fragment *frag, struct session_entry *s
 static verdict tcp(struct fragment* frag, struct tuple *tuple)
 {
 	struct session_entry *session;
+	u_int8_t old_state;
 	int error;
 
 	error = session_get(tuple, &session);
@@ -1178,6 +1404,7 @@ static verdict tcp(struct fragment* frag, struct tuple *tuple)
 	}
 
 	/* Act according the current state. */
+	old_state = session->state;
 	switch (session->state) {
 	case V4_INIT:
 		error = tcp_v4_init_state_handle(frag, session);
@@ -1208,12 +1435,84 @@ static verdict tcp(struct fragment* frag, struct tuple *tuple)
 		log_err(ERR_INVALID_STATE, "Invalid state found: %u.", session->state);
 		error = -EINVAL;
 	}
+
+	if (!error) {
+		if (session->state != old_state)
+			changelog_session(CHANGE_UPDATED, session);
+		sync_session_update(session);
+	}
 	/* Fall through. */
 
 end:
 	return error ? VER_DROP : VER_CONTINUE;
 }
 
+/**
+ * Returns the number of sessions the shrinker might be able to evict. (It's an upper bound, since
+ * established TCP sessions are never evicted.)
+ */
+static unsigned long evictable_sessions(void)
+{
+	struct limits max;
+
+	get_limits(&max);
+	if (!max.session_evict)
+		return 0;
+	return count_entries(session_count);
+}
+
+/**
+ * Evicts up to "count" sessions on behalf of the kernel's memory reclaim.
+ */
+static unsigned long shrink_sessions(unsigned long count)
+{
+	unsigned long evicted;
+
+	if (!evictable_sessions())
+		return 0;
+
+	spin_lock_bh(&bib_session_lock);
+	evicted = evict_sessions(count, NULL);
+	spin_unlock_bh(&bib_session_lock);
+
+	return evicted;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 12, 0)
+
+static unsigned long session_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	return evictable_sessions();
+}
+
+static unsigned long session_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	unsigned long evicted = shrink_sessions(sc->nr_to_scan);
+	return evicted ? evicted : SHRINK_STOP;
+}
+
+static struct shrinker session_shrinker = {
+	.count_objects = session_shrinker_count,
+	.scan_objects = session_shrinker_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+#else
+
+static int session_shrinker_shrink(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	if (sc->nr_to_scan)
+		shrink_sessions(sc->nr_to_scan);
+	return evictable_sessions();
+}
+
+static struct shrinker session_shrinker = {
+	.shrink = session_shrinker_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+#endif
+
 /**
  * Prepares this module for future use. Avoid calling the rest of the functions unless this has
  * already been executed once.
@@ -1222,12 +1521,24 @@ end:
  */
 int filtering_init(void)
 {
+	int error;
+
 	config = kmalloc(sizeof(*config), GFP_ATOMIC);
 	if (!config) {
 		log_err(ERR_ALLOC_FAILED, "Could not allocate memory to store the filtering config.");
 		return -ENOMEM;
 	}
 
+	error = pending_syn_init();
+	if (error)
+		goto pending_syn_failure;
+	error = pktqueue_init();
+	if (error)
+		goto pktqueue_failure;
+	error = tcpprobe_init();
+	if (error)
+		goto tcpprobe_failure;
+
 	config->to.udp = msecs_to_jiffies(1000 * UDP_DEFAULT);
 	config->to.icmp = msecs_to_jiffies(1000 * ICMP_DEFAULT);
 	config->to.tcp_trans = msecs_to_jiffies(1000 * TCP_TRANS);
@@ -1235,6 +1546,12 @@ int filtering_init(void)
 	config->drop_by_addr = FILT_DEF_ADDR_DEPENDENT_FILTERING;
 	config->drop_external_tcp = FILT_DEF_DROP_EXTERNAL_CONNECTIONS;
 	config->drop_icmp6_info = FILT_DEF_FILTER_ICMPV6_INFO;
+	config->defer_external_tcp = FILT_DEF_DEFER_EXTERNAL_CONNECTIONS;
+	config->max.bib = FILT_DEF_MAX_BIB;
+	config->max.session = FILT_DEF_MAX_SESSIONS;
+	config->max.bib_per_node = FILT_DEF_MAX_BIB_PER_NODE;
+	config->max.session_per_node = FILT_DEF_MAX_SESSIONS_PER_NODE;
+	config->max.session_evict = FILT_DEF_SESSION_EVICT;
 
 	INIT_LIST_HEAD(&sessions_udp);
 	INIT_LIST_HEAD(&sessions_tcp_est);
@@ -1247,7 +1564,29 @@ int filtering_init(void)
 	expire_timer.expires = 0;
 	expire_timer.data = 0;
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 12, 0)
+	error = register_shrinker(&session_shrinker);
+	if (error) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not register the session shrinker.");
+		goto shrinker_failure;
+	}
+#else
+	register_shrinker(&session_shrinker);
+#endif
+
 	return 0;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 12, 0)
+shrinker_failure:
+	tcpprobe_destroy();
+#endif
+tcpprobe_failure:
+	pktqueue_destroy();
+pktqueue_failure:
+	pending_syn_destroy();
+pending_syn_failure:
+	kfree(config);
+	return error;
 }
 
 /**
@@ -1255,7 +1594,11 @@ int filtering_init(void)
  */
 void filtering_destroy(void)
 {
+	unregister_shrinker(&session_shrinker);
 	del_timer_sync(&expire_timer);
+	tcpprobe_destroy();
+	pktqueue_destroy();
+	pending_syn_destroy();
 	kfree(config);
 }
 
@@ -1273,6 +1616,99 @@ int clone_filtering_config(struct filtering_config *clone)
 	return 0;
 }
 
+/**
+ * Returns a copy of the current configuration, which can be modified using
+ * merge_filtering_config() and then either commit_filtering_config()ed or
+ * abort_filtering_config()ed. Returns NULL on allocation failure.
+ *
+ * Writers are serialized by config.c, so there can be only one candidate at a time.
+ */
+struct filtering_config *prepare_filtering_config(void)
+{
+	struct filtering_config *candidate;
+
+	candidate = kmalloc(sizeof(*candidate), GFP_KERNEL);
+	if (!candidate)
+		return NULL;
+
+	*candidate = *config;
+	return candidate;
+}
+
+/**
+ * Validates the fields from "new_config" that "operation" selects, and copies them to "candidate".
+ * "candidate" is left untouched on failure.
+ */
+int merge_filtering_config(__u32 operation, struct filtering_config *candidate,
+		struct filtering_config *new_config)
+{
+	int udp_min = msecs_to_jiffies(1000 * UDP_MIN);
+	int tcp_est = msecs_to_jiffies(1000 * TCP_EST);
+	int tcp_trans = msecs_to_jiffies(1000 * TCP_TRANS);
+
+	if ((operation & UDP_TIMEOUT_MASK) && new_config->to.udp < udp_min) {
+		log_err(ERR_UDP_TO_RANGE, "The UDP timeout must be at least %u seconds.", UDP_MIN);
+		return -EINVAL;
+	}
+	if ((operation & TCP_EST_TIMEOUT_MASK) && new_config->to.tcp_est < tcp_est) {
+		log_err(ERR_TCPEST_TO_RANGE, "The TCP est timeout must be at least %u seconds.", TCP_EST);
+		return -EINVAL;
+	}
+	if ((operation & TCP_TRANS_TIMEOUT_MASK) && new_config->to.tcp_trans < tcp_trans) {
+		log_err(ERR_TCPTRANS_TO_RANGE, "The TCP trans timeout must be at least %u seconds.",
+				TCP_TRANS);
+		return -EINVAL;
+	}
+
+	if (operation & DROP_BY_ADDR_MASK)
+		candidate->drop_by_addr = new_config->drop_by_addr;
+	if (operation & DROP_ICMP6_INFO_MASK)
+		candidate->drop_icmp6_info = new_config->drop_icmp6_info;
+	if (operation & DROP_EXTERNAL_TCP_MASK)
+		candidate->drop_external_tcp = new_config->drop_external_tcp;
+	if (operation & DEFER_EXTERNAL_TCP_MASK)
+		candidate->defer_external_tcp = new_config->defer_external_tcp;
+
+	if (operation & UDP_TIMEOUT_MASK)
+		candidate->to.udp = new_config->to.udp;
+	if (operation & ICMP_TIMEOUT_MASK)
+		candidate->to.icmp = new_config->to.icmp;
+	if (operation & TCP_EST_TIMEOUT_MASK)
+		candidate->to.tcp_est = new_config->to.tcp_est;
+	if (operation & TCP_TRANS_TIMEOUT_MASK)
+		candidate->to.tcp_trans = new_config->to.tcp_trans;
+
+	if (operation & BIB_MAX_MASK)
+		candidate->max.bib = new_config->max.bib;
+	if (operation & SESSION_MAX_MASK)
+		candidate->max.session = new_config->max.session;
+	if (operation & BIB_NODE_MAX_MASK)
+		candidate->max.bib_per_node = new_config->max.bib_per_node;
+	if (operation & SESSION_NODE_MAX_MASK)
+		candidate->max.session_per_node = new_config->max.session_per_node;
+	if (operation & SESSION_EVICT_MASK)
+		candidate->max.session_evict = new_config->max.session_evict;
+
+	return 0;
+}
+
+/**
+ * Makes "candidate" the current configuration. Cannot fail.
+ */
+void commit_filtering_config(struct filtering_config *candidate)
+{
+	struct filtering_config *old_config = config;
+
+	rcu_assign_pointer(config, candidate);
+	synchronize_rcu_bh();
+	kfree(old_config);
+}
+
+void abort_filtering_config(struct filtering_config *candidate)
+{
+	kfree(candidate);
+}
+
 /**
  * Updates the configuration of this module.
  *
@@ -1282,64 +1718,338 @@ int clone_filtering_config(struct filtering_config *clone)
  */
 int set_filtering_config(__u32 operation, struct filtering_config *new_config)
 {
-	struct filtering_config *tmp_config;
-	struct filtering_config *old_config;
-	int udp_min = msecs_to_jiffies(1000 * UDP_MIN);
-	int tcp_est = msecs_to_jiffies(1000 * TCP_EST);
-	int tcp_trans = msecs_to_jiffies(1000 * TCP_TRANS);
+	struct filtering_config *candidate;
+	int error;
 
-	tmp_config = kmalloc(sizeof(*tmp_config), GFP_KERNEL);
-	if (!tmp_config)
+	candidate = prepare_filtering_config();
+	if (!candidate)
 		return -ENOMEM;
 
-	old_config = config;
-	*tmp_config = *old_config;
+	error = merge_filtering_config(operation, candidate, new_config);
+	if (error) {
+		abort_filtering_config(candidate);
+		return error;
+	}
 
-	if (operation & DROP_BY_ADDR_MASK)
-		tmp_config->drop_by_addr = new_config->drop_by_addr;
-	if (operation & DROP_ICMP6_INFO_MASK)
-		tmp_config->drop_icmp6_info = new_config->drop_icmp6_info;
-	if (operation & DROP_EXTERNAL_TCP_MASK)
-		tmp_config->drop_external_tcp = new_config->drop_external_tcp;
+	commit_filtering_config(candidate);
+	return 0;
+}
 
-	if (operation & UDP_TIMEOUT_MASK) {
-		if (new_config->to.udp < udp_min) {
-			log_err(ERR_UDP_TO_RANGE, "The UDP timeout must be at least %u seconds.", UDP_MIN);
-			goto fail;
-		}
-		tmp_config->to.udp = new_config->to.udp;
+struct flush_args {
+	l4_protocol l4_proto;
+	struct flush_count_us *count;
+};
+
+/**
+ * Removes "bib"'s sessions, and also "bib" unless it is static.
+ */
+static int flush_bib(struct bib_entry *bib, void *void_args)
+{
+	struct flush_args *args = void_args;
+	struct session_entry *session, *tmp;
+	int error;
+
+	/* "bib" holds the list, so it cannot die along with its last session. */
+	list_for_each_entry_safe(session, tmp, &bib->sessions, bib_list_hook) {
+		error = remove_session(session, bib);
+		if (error < 0)
+			return error; /* Error msg already printed. */
+		args->count->session++;
 	}
 
-	if (operation & ICMP_TIMEOUT_MASK)
-		tmp_config->to.icmp = new_config->to.icmp;
+	if (bib->is_static)
+		return 0;
+
+	error = bib_remove(bib, args->l4_proto);
+	if (error)
+		return error; /* Error msg already printed. */
+
+	pool4_return(args->l4_proto, &bib->ipv4);
+	events_bib(EVENT_BIB_REMOVED, bib, args->l4_proto);
+	bib_kfree(bib);
+	args->count->bib++;
+	return 0;
+}
+
+int filtering_flush(l4_protocol l4_proto, struct ipv6_prefix *prefix, struct flush_count_us *count)
+{
+	struct flush_args args = { .l4_proto = l4_proto, .count = count };
+	int error;
+
+	spin_lock_bh(&bib_session_lock);
+	error = bib_for_each_prefix6(l4_proto, prefix, NULL, flush_bib, &args);
+	spin_unlock_bh(&bib_session_lock);
+
+	return error;
+}
+
+/**
+ * Returns the list "session"'s lifetime would belong to had it been set by this translator.
+ */
+static struct list_head *get_expire_list(struct session_entry *session)
+{
+	switch (session->l4_proto) {
+	case L4PROTO_UDP:
+		return &sessions_udp;
+	case L4PROTO_ICMP:
+		return &sessions_icmp;
+	case L4PROTO_TCP:
+	case L4PROTO_NONE:
+		break;
+	}
+
+	return (session->state == ESTABLISHED) ? &sessions_tcp_est : &sessions_tcp_trans;
+}
 
-	if (operation & TCP_EST_TIMEOUT_MASK) {
-		if (new_config->to.tcp_est < tcp_est) {
-			log_err(ERR_TCPEST_TO_RANGE, "The TCP est timeout must be at least %u seconds.",
-					TCP_EST);
-			goto fail;
+/**
+ * Returns the lifetime (in jiffies) this translator would give "session"; that is, the timeout of
+ * the list get_expire_list() picks.
+ */
+static __u64 get_expire_timeout(struct session_entry *session)
+{
+	struct list_head *list = get_expire_list(session);
+	__u64 timeout;
+
+	rcu_read_lock_bh();
+	if (list == &sessions_udp)
+		timeout = rcu_dereference_bh(config)->to.udp;
+	else if (list == &sessions_icmp)
+		timeout = rcu_dereference_bh(config)->to.icmp;
+	else if (list == &sessions_tcp_est)
+		timeout = rcu_dereference_bh(config)->to.tcp_est;
+	else
+		timeout = rcu_dereference_bh(config)->to.tcp_trans;
+	rcu_read_unlock_bh();
+
+	return timeout;
+}
+
+static bool is_valid_record(struct sync_session *record)
+{
+	switch (record->l4_proto) {
+	case L4PROTO_UDP:
+	case L4PROTO_ICMP:
+		return true;
+	case L4PROTO_TCP:
+		/* Closed sessions are not supposed to be stored. */
+		return record->state > CLOSED && record->state <= TRANS;
+	}
+
+	return false;
+}
+
+static void record_to_pairs(struct sync_session *record, struct ipv6_pair *pair6,
+		struct ipv4_pair *pair4)
+{
+	pair6->remote.address = record->remote6;
+	pair6->remote.l4_id = be16_to_cpu(record->remote6_port);
+	pair6->local.address = record->local6;
+	pair6->local.l4_id = be16_to_cpu(record->local6_port);
+	pair4->local.address = record->local4;
+	pair4->local.l4_id = be16_to_cpu(record->local4_port);
+	pair4->remote.address = record->remote4;
+	pair4->remote.l4_id = be16_to_cpu(record->remote4_port);
+}
+
+/**
+ * Returns (in "result") the BIB entry the peer's session "pair6"-"pair4" belongs to, creating it
+ * if it doesn't exist.
+ */
+static int get_or_create_bib_sync(l4_protocol l4_proto, struct ipv6_pair *pair6,
+		struct ipv4_pair *pair4, struct bib_entry **result)
+{
+	struct bib_entry *bib;
+	int error;
+
+	error = bib_get_by_ipv6(&pair6->remote, l4_proto, &bib);
+	if (!error) {
+		if (!ipv4_tuple_addr_equals(&bib->ipv4, &pair4->local)) {
+			log_debug("%pI6c#%u is mapped to a different IPv4 transport address here.",
+					&bib->ipv6.address, bib->ipv6.l4_id);
+			return -EEXIST;
 		}
-		tmp_config->to.tcp_est = new_config->to.tcp_est;
+		*result = bib;
+		return 0;
 	}
+	if (error != -ENOENT)
+		return error;
+
+	/* The peer might have different limits; ours apply to what it tells us too. */
+	if (bib_limit_reached(&pair6->remote.address)) {
+		log_debug("The BIB is full; refusing the peer's session.");
+		stats_inc(STAT_BIB_LIMIT);
+		return -ENOSPC;
+	}
+
+	/* The peer borrowed the transport address from its pool4, so nobody else can have it here. */
+	error = pool4_get(l4_proto, &pair4->local);
+	if (error)
+		return error;
+
+	bib = bib_create(&pair4->local, &pair6->remote, false);
+	if (!bib) {
+		log_err(ERR_ALLOC_FAILED, "Failed to allocate a BIB entry.");
+		stats_inc(STAT_ALLOC_FAILED);
+		pool4_return(l4_proto, &pair4->local);
+		return -ENOMEM;
+	}
+
+	error = bib_add(bib, l4_proto);
+	if (error) {
+		bib_kfree(bib);
+		pool4_return(l4_proto, &pair4->local);
+		return error;
+	}
+
+	stats_inc(STAT_BIB_CREATED);
+	events_bib(EVENT_BIB_CREATED, bib, l4_proto);
+	*result = bib;
+	return 0;
+}
+
+/**
+ * Creates the session "record" describes, or updates it if it already exists.
+ */
+static int sync_update(struct sync_session *record)
+{
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct bib_entry *bib;
+	struct session_entry *session;
+	l4_protocol l4_proto = record->l4_proto;
+	__u64 lifetime;
+	int error;
+
+	record_to_pairs(record, &pair6, &pair4);
 
-	if (operation & TCP_TRANS_TIMEOUT_MASK) {
-		if (new_config->to.tcp_trans < tcp_trans) {
-			log_err(ERR_TCPTRANS_TO_RANGE, "The TCP trans timeout must be at least %u seconds.",
-					TCP_TRANS);
-			goto fail;
+	error = session_get_by_ipv6(&pair6, l4_proto, &session);
+	if (!error) {
+		if (!ipv4_tuple_addr_equals(&session->ipv4.local, &pair4.local)
+				|| !ipv4_tuple_addr_equals(&session->ipv4.remote, &pair4.remote)) {
+			log_debug("The session of %pI6c#%u has a different IPv4 side here.",
+					&pair6.remote.address, pair6.remote.l4_id);
+			return -EEXIST;
 		}
-		tmp_config->to.tcp_trans = new_config->to.tcp_trans;
+		if (session->state != record->state) {
+			session->state = record->state;
+			changelog_session(CHANGE_UPDATED, session);
+		}
+		goto update;
 	}
+	if (error != -ENOENT)
+		return error;
 
-	rcu_assign_pointer(config, tmp_config);
-	synchronize_rcu_bh();
-	kfree(old_config);
+	if (session_limit_reached(&pair6.remote.address)) {
+		log_debug("The session table is full; refusing the peer's session.");
+		stats_inc(STAT_SESSION_LIMIT);
+		return -ENOSPC;
+	}
 
+	error = get_or_create_bib_sync(l4_proto, &pair6, &pair4, &bib);
+	if (error)
+		return error;
+
+	session = session_create(&pair4, &pair6, l4_proto);
+	if (!session) {
+		log_err(ERR_ALLOC_FAILED, "Failed to allocate a session entry.");
+		stats_inc(STAT_ALLOC_FAILED);
+		error = -ENOMEM;
+		goto bib_failure;
+	}
+
+	error = session_add(session);
+	if (error) {
+		session_kfree(session);
+		goto bib_failure;
+	}
+
+	session->bib = bib;
+	list_add(&session->bib_list_hook, &bib->sessions);
+
+	stats_inc(STAT_SESSION_CREATED);
+	events_session(EVENT_SESSION_CREATED, session);
+	/* Fall through. */
+
+update:
+	session->state = record->state;
+	/* The peer's word is not enough to keep a session longer than we would have. */
+	lifetime = min_t(__u64, msecs_to_jiffies(be32_to_cpu(record->lifetime)),
+			get_expire_timeout(session));
+	update_timer_sorted(session, get_expire_list(session), jiffies + lifetime);
 	return 0;
 
-fail:
-	kfree(tmp_config);
-	return -EINVAL;
+bib_failure:
+	if (list_empty(&bib->sessions) && !bib->is_static && !is_error(bib_remove(bib, l4_proto))) {
+		pool4_return(l4_proto, &bib->ipv4);
+		events_bib(EVENT_BIB_REMOVED, bib, l4_proto);
+		bib_kfree(bib);
+		stats_inc(STAT_BIB_REMOVED);
+	}
+	return error;
+}
+
+/**
+ * Removes the session "record" describes, if it exists.
+ */
+static int sync_remove(struct sync_session *record)
+{
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+	int removed;
+	int error;
+
+	record_to_pairs(record, &pair6, &pair4);
+
+	error = session_get_by_ipv6(&pair6, record->l4_proto, &session);
+	if (error)
+		return (error == -ENOENT) ? 0 : error; /* We expired it first; that's fine. */
+
+	removed = remove_session(session, NULL);
+	if (removed < 0)
+		return removed;
+
+	stats_inc(STAT_SESSION_EXPIRED);
+	stats_add(STAT_BIB_REMOVED, removed);
+	return 0;
+}
+
+void filtering_sync(struct sync_session *records, unsigned int count)
+{
+	unsigned int applied = 0;
+	unsigned int i;
+	int error;
+
+	spin_lock_bh(&bib_session_lock);
+
+	for (i = 0; i < count; i++) {
+		if (!is_valid_record(&records[i])) {
+			log_debug("Ignoring a malformed session record.");
+			continue;
+		}
+
+		switch (records[i].type) {
+		case SYNC_SESSION_UPDATE:
+			error = sync_update(&records[i]);
+			break;
+		case SYNC_SESSION_REMOVE:
+			error = sync_remove(&records[i]);
+			break;
+		default:
+			log_debug("Ignoring a session record of unknown type %u.", records[i].type);
+			error = -EINVAL;
+		}
+
+		if (!error)
+			applied++;
+		else
+			log_debug("Error code %d while applying a session record.", error);
+	}
+
+	spin_unlock_bh(&bib_session_lock);
+
+	stats_add(STAT_SYNC_APPLIED, applied);
+	stats_add(STAT_SYNC_REJECTED, count - applied);
 }
 
 /**
@@ -1372,11 +2082,13 @@ verdict filtering_and_updating(struct fragment* frag, struct tuple *tuple)
 		/* Get rid of hairpinning loops and unwanted packets. */
 		hdr_ip6 = frag_get_ipv6_hdr(frag);
 		if (pool6_contains(&hdr_ip6->saddr)) {
-			log_info("Hairpinning loop. Dropping...");
+			log_debug("Hairpinning loop. Dropping...");
+			count_drop(STAT_HAIRPIN_LOOP, tuple);
 			return VER_DROP;
 		}
 		if (!pool6_contains(&hdr_ip6->daddr)) {
-			log_info("Packet was rejected by pool6, dropping...");
+			log_debug("Packet was rejected by pool6, dropping...");
+			count_drop(STAT_POOL6_MISMATCH, tuple);
 			return VER_DROP;
 		}
 		break;
@@ -1390,7 +2102,8 @@ verdict filtering_and_updating(struct fragment* frag, struct tuple *tuple)
 		/* Get rid of unexpected packets */
 		addr4.s_addr = frag_get_ipv4_hdr(frag)->daddr;
 		if (!pool4_contains(&addr4)) {
-			log_info("Packet was rejected by pool4, dropping...");
+			log_debug("Packet was rejected by pool4, dropping...");
+			count_drop(STAT_POOL4_MISMATCH, tuple);
 			return VER_DROP;
 		}
 		break;
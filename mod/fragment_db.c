@@ -1,6 +1,7 @@
 #include "nat64/mod/fragment_db.h"
 #include "nat64/comm/constants.h"
 #include "nat64/mod/random.h"
+#include "nat64/mod/stats.h"
 
 #include <linux/version.h>
 
@@ -393,6 +394,7 @@ static void clean_expired_buffers(void)
 
 		if (time_after(buffer->dying_time, jiffies)) {
 			spin_unlock_bh(&table_lock);
+			stats_add(STAT_FRAG_EXPIRED, b);
 			log_debug("Deleted %u reassembly buffers.", b);
 			return;
 		}
@@ -404,6 +406,7 @@ static void clean_expired_buffers(void)
 	}
 
 	spin_unlock_bh(&table_lock);
+	stats_add(STAT_FRAG_EXPIRED, b);
 	log_debug("Deleted %u reassembly buffers. The database is now empty.", b);
 }
 
@@ -521,6 +524,7 @@ static int validate_csum_icmp6(struct packet *pkt)
 
 	if (tmp != computed_csum) {
 		log_warning("Checksum doesn't match. Expected: %x, actual: %x.", computed_csum, tmp);
+		stats_inc(STAT_BAD_CHECKSUM);
 		return -EINVAL;
 	}
 
@@ -560,6 +564,7 @@ static int validate_csum_icmp4(struct packet *pkt)
 
 	if (tmp != computed_csum) {
 		log_warning("Checksum doesn't match. Expected: %x, actual: %x.", computed_csum, tmp);
+		stats_inc(STAT_BAD_CHECKSUM);
 		return -EINVAL;
 	}
 
@@ -683,40 +688,75 @@ int clone_fragmentation_config(struct fragmentation_config *clone)
 }
 
 /**
- * Updates the configuration of this module.
- *
- * @param[in] operation indicator of which fields from "new_config" should be taken into account.
- * @param[in] new configuration values.
- * @return zero on success, nonzero on failure.
+ * Returns a modifiable copy of the current configuration. See prepare_filtering_config().
  */
-int set_fragmentation_config(__u32 operation, struct fragmentation_config *new_config)
+struct fragmentation_config *prepare_fragmentation_config(void)
 {
-	struct fragmentation_config *tmp_config;
-	struct fragmentation_config *old_config;
-	unsigned long fragment_min = msecs_to_jiffies(1000 * FRAGMENT_MIN);
+	struct fragmentation_config *candidate;
 
-	tmp_config = kmalloc(sizeof(*tmp_config), GFP_KERNEL);
-	if (!tmp_config)
-		return -ENOMEM;
+	candidate = kmalloc(sizeof(*candidate), GFP_KERNEL);
+	if (!candidate)
+		return NULL;
+
+	*candidate = *config;
+	return candidate;
+}
 
-	old_config = config;
-	*tmp_config = *old_config;
+int merge_fragmentation_config(__u32 operation, struct fragmentation_config *candidate,
+		struct fragmentation_config *new_config)
+{
+	unsigned long fragment_min = msecs_to_jiffies(1000 * FRAGMENT_MIN);
 
 	if (operation & FRAGMENT_TIMEOUT_MASK) {
 		if (new_config->fragment_timeout < fragment_min) {
 			log_err(ERR_FRAGMENTATION_TO_RANGE, "The fragment timeout must be at least %u seconds.",
 					FRAGMENT_MIN);
-			kfree(tmp_config);
 			return -EINVAL;
 		}
 
-		tmp_config->fragment_timeout = new_config->fragment_timeout;
+		candidate->fragment_timeout = new_config->fragment_timeout;
 	}
 
-	rcu_assign_pointer(config, tmp_config);
+	return 0;
+}
+
+void commit_fragmentation_config(struct fragmentation_config *candidate)
+{
+	struct fragmentation_config *old_config = config;
+
+	rcu_assign_pointer(config, candidate);
 	synchronize_rcu_bh();
 	kfree(old_config);
+}
+
+void abort_fragmentation_config(struct fragmentation_config *candidate)
+{
+	kfree(candidate);
+}
+
+/**
+ * Updates the configuration of this module.
+ *
+ * @param[in] operation indicator of which fields from "new_config" should be taken into account.
+ * @param[in] new configuration values.
+ * @return zero on success, nonzero on failure.
+ */
+int set_fragmentation_config(__u32 operation, struct fragmentation_config *new_config)
+{
+	struct fragmentation_config *candidate;
+	int error;
+
+	candidate = prepare_fragmentation_config();
+	if (!candidate)
+		return -ENOMEM;
 
+	error = merge_fragmentation_config(operation, candidate, new_config);
+	if (error) {
+		abort_fragmentation_config(candidate);
+		return error;
+	}
+
+	commit_fragmentation_config(candidate);
 	return 0;
 }
 
@@ -748,8 +788,10 @@ verdict fragment_arrives(struct sk_buff *skb, struct packet **result)
 	 * Encapsulating and validating the packet is not part of the RFC, we just do it because we
 	 * need it. Just saying.
 	 */
-	if (is_error(frag_create_from_skb(skb, &frag)))
+	if (is_error(frag_create_from_skb(skb, &frag))) {
+		stats_inc(STAT_INVALID_PACKET);
 		return VER_DROP;
+	}
 
 	/*
 	 * This short circuit is not part of the RFC.
@@ -759,6 +801,7 @@ verdict fragment_arrives(struct sk_buff *skb, struct packet **result)
 	if (!frag_is_fragmented(frag)) {
 		/* No need to interact with the database. Encapsulate the packet and let it fly. */
 		if (is_error(pkt_create(frag, result))) {
+			stats_inc(STAT_ALLOC_FAILED);
 			frag_kfree(frag);
 			return VER_STOLEN;
 		}
@@ -774,6 +817,7 @@ verdict fragment_arrives(struct sk_buff *skb, struct packet **result)
 	 * Also implementation specific, not part of the RFC.
 	 */
 	if (is_error(frag_to_key(frag, &key))) {
+		stats_inc(STAT_INVALID_PACKET);
 		frag_kfree(frag);
 		return VER_DROP;
 	}
@@ -859,6 +903,7 @@ verdict fragment_arrives(struct sk_buff *skb, struct packet **result)
 		buffer->pkt = NULL;
 		buffer_destroy(&key, buffer);
 		spin_unlock_bh(&table_lock);
+		stats_inc(STAT_FRAG_REASSEMBLED);
 
 		if (is_error(l4_post(*result))) { /* omg fml =_= */
 			pkt_kfree(*result);
@@ -871,10 +916,12 @@ verdict fragment_arrives(struct sk_buff *skb, struct packet **result)
 	/* RFC 815 ends here. */
 
 	spin_unlock_bh(&table_lock);
+	stats_inc(STAT_FRAG_STORED);
 	return VER_STOLEN;
 
 fail:
 	spin_unlock_bh(&table_lock);
+	stats_inc(STAT_ALLOC_FAILED);
 	return VER_DROP;
 }
 
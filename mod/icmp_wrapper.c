@@ -4,7 +4,7 @@
 #include <net/icmp.h>
 #include <linux/icmpv6.h>
 
-static void icmp4_send(struct fragment *frag, icmp_error_code error, __be32 info)
+static void icmp4_send(struct sk_buff *skb, icmp_error_code error, __be32 info)
 {
 	int type, code;
 
@@ -17,6 +17,10 @@ static void icmp4_send(struct fragment *frag, icmp_error_code error, __be32 info
 		type = ICMP_DEST_UNREACH;
 		code = ICMP_PROT_UNREACH;
 		break;
+	case ICMPERR_PORT_UNREACHABLE:
+		type = ICMP_DEST_UNREACH;
+		code = ICMP_PORT_UNREACH;
+		break;
 	case ICMPERR_HOP_LIMIT:
 		type = ICMP_TIME_EXCEEDED;
 		code = ICMP_EXC_TTL;
@@ -37,10 +41,10 @@ static void icmp4_send(struct fragment *frag, icmp_error_code error, __be32 info
 		return; /* Not supported or needed. */
 	}
 
-	icmp_send(frag->original_skb, type, code, info);
+	icmp_send(skb, type, code, info);
 }
 
-static void icmp6_send(struct fragment *frag, icmp_error_code error, __be32 info)
+static void icmp6_send(struct sk_buff *skb, icmp_error_code error, __be32 info)
 {
 	int type, code;
 
@@ -53,6 +57,10 @@ static void icmp6_send(struct fragment *frag, icmp_error_code error, __be32 info
 		type = ICMPV6_PARAMPROB;
 		code = ICMPV6_UNK_NEXTHDR;
 		break;
+	case ICMPERR_PORT_UNREACHABLE:
+		type = ICMPV6_DEST_UNREACH;
+		code = ICMPV6_PORT_UNREACH;
+		break;
 	case ICMPERR_HOP_LIMIT:
 		type = ICMPV6_TIME_EXCEED;
 		code = ICMPV6_EXC_HOPLIMIT;
@@ -70,7 +78,7 @@ static void icmp6_send(struct fragment *frag, icmp_error_code error, __be32 info
 	}
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3, 12, 0) || KERNEL_VERSION(3, 13, 0) <= LINUX_VERSION_CODE
-	icmpv6_send(frag->original_skb, type, code, info);
+	icmpv6_send(skb, type, code, info);
 #else
 #warning "You're compiling in kernel 3.12. See https://github.com/NICMx/NAT64/issues/90"
 #endif
@@ -78,15 +86,20 @@ static void icmp6_send(struct fragment *frag, icmp_error_code error, __be32 info
 
 void icmp64_send(struct fragment *frag, icmp_error_code error, __be32 info)
 {
-	if (!frag->original_skb || !frag->original_skb->dev)
+	icmp64_send_skb(frag->original_skb, error, info);
+}
+
+void icmp64_send_skb(struct sk_buff *skb, icmp_error_code error, __be32 info)
+{
+	if (!skb || !skb->dev)
 		return;
 
-	switch (be16_to_cpu(frag->original_skb->protocol)) {
+	switch (be16_to_cpu(skb->protocol)) {
 	case ETH_P_IP:
-		icmp4_send(frag, error, info);
+		icmp4_send(skb, error, info);
 		break;
 	case ETH_P_IPV6:
-		icmp6_send(frag, error, info);
+		icmp6_send(skb, error, info);
 		break;
 	}
 }
@@ -0,0 +1,108 @@
+#include "nat64/mod/latency.h"
+#include "nat64/comm/types.h"
+
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/bitops.h>
+#include <linux/string.h>
+
+
+/** One CPU's histograms. */
+struct latency_cpu {
+	u64 total_ns[LATENCY_STAGE_COUNT];
+	u64 histogram[LATENCY_STAGE_COUNT][LATENCY_BUCKETS];
+};
+
+/** The histograms, one copy per CPU. */
+static struct latency_cpu __percpu *latencies;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+struct static_key latency_key = STATIC_KEY_INIT_FALSE;
+#else
+bool latency_key = false;
+#endif
+
+/**
+ * Whether the key is currently on. Static keys are reference counters, so this prevents them from
+ * being incremented twice. Only touched by latency_set_enabled(), whose callers are serialized by
+ * config.c.
+ */
+static bool enabled;
+
+
+int latency_init(void)
+{
+	latencies = alloc_percpu(struct latency_cpu);
+	if (!latencies) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the per-CPU latency histograms.");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void latency_destroy(void)
+{
+	latency_set_enabled(false);
+	free_percpu(latencies);
+	latencies = NULL;
+}
+
+void latency_set_enabled(bool enable)
+{
+	if (enable == enabled)
+		return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	if (enable)
+		static_key_slow_inc(&latency_key);
+	else
+		static_key_slow_dec(&latency_key);
+#else
+	latency_key = enable;
+#endif
+
+	enabled = enable;
+}
+
+void latency_reset(void)
+{
+	int cpu;
+
+	/* Packets being measured at the same time might survive the reset; that's fine. */
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(latencies, cpu), 0, sizeof(struct latency_cpu));
+}
+
+void latency_sum(struct latency_us *result)
+{
+	struct latency_cpu *cpu_latencies;
+	int cpu;
+	int stage;
+	int i;
+
+	memset(result, 0, sizeof(*result));
+	result->enabled = enabled;
+
+	for_each_possible_cpu(cpu) {
+		cpu_latencies = per_cpu_ptr(latencies, cpu);
+		for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+			result->total_ns[stage] += cpu_latencies->total_ns[stage];
+			for (i = 0; i < LATENCY_BUCKETS; i++)
+				result->histogram[stage][i] += cpu_latencies->histogram[stage][i];
+		}
+	}
+}
+
+void latency_add(enum latency_stage stage, ktime_t duration)
+{
+	u64 ns = ktime_to_ns(duration);
+	unsigned int bucket;
+
+	bucket = (ns > 1) ? (fls64(ns) - 1) : 0;
+	if (bucket >= LATENCY_BUCKETS)
+		bucket = LATENCY_BUCKETS - 1;
+
+	this_cpu_add(latencies->total_ns[stage], ns);
+	this_cpu_inc(latencies->histogram[stage][bucket]);
+}
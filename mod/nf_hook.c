@@ -10,6 +10,11 @@
 #include "nat64/mod/filtering_and_updating.h"
 #include "nat64/mod/translate_packet.h"
 #include "nat64/mod/core.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/sync.h"
+#include "nat64/mod/changelog.h"
+#include "nat64/mod/latency.h"
 
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -105,6 +110,21 @@ int __init nat64_init(void)
 	log_debug("Inserting the module...");
 
 	/* Init Jool's submodules. */
+	error = stats_init();
+	if (error)
+		goto stats_failure;
+	error = events_init();
+	if (error)
+		goto events_failure;
+	error = sync_init();
+	if (error)
+		goto sync_failure;
+	error = changelog_init();
+	if (error)
+		goto changelog_failure;
+	error = latency_init();
+	if (error)
+		goto latency_failure;
 	error = pktmod_init();
 	if (error)
 		goto pktmod_failure;
@@ -170,6 +190,21 @@ config_failure:
 	pktmod_destroy();
 
 pktmod_failure:
+	latency_destroy();
+
+latency_failure:
+	changelog_destroy();
+
+changelog_failure:
+	sync_destroy();
+
+sync_failure:
+	events_destroy();
+
+events_failure:
+	stats_destroy();
+
+stats_failure:
 	return error;
 }
 
@@ -188,6 +223,11 @@ void __exit nat64_exit(void)
 	fragdb_destroy();
 	config_destroy();
 	pktmod_destroy();
+	latency_destroy();
+	changelog_destroy();
+	sync_destroy();
+	events_destroy();
+	stats_destroy();
 
 	log_info(MODULE_NAME " module removed.");
 }
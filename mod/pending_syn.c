@@ -0,0 +1,124 @@
+#include "nat64/mod/pending_syn.h"
+#include "nat64/comm/constants.h"
+#include "nat64/mod/stats.h"
+
+#include <linux/jiffies.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+
+
+/** A IPv4 SYN whose IPv6 answer is being waited for. 16 bytes, as opposed to a whole session. */
+struct pending_syn {
+	__be32 local_addr;
+	__be32 remote_addr;
+	__u16 local_port;
+	__u16 remote_port;
+	/** Jiffy (truncated) at which the SYN arrived. Only meaningful if the entry is in use. */
+	__u32 stamp;
+};
+
+/** The table; PENDING_SYN_BUCKETS groups of PENDING_SYN_WAYS entries each. */
+static struct pending_syn *table;
+/** Hashing seed, so remote nodes cannot choose which bucket they land in. */
+static u32 rnd;
+
+
+/**
+ * Returns whether "entry" is unused or has been waiting for too long.
+ */
+static bool is_stale(struct pending_syn *entry, __u32 now)
+{
+	if (!entry->local_addr && !entry->remote_addr && !entry->local_port && !entry->remote_port)
+		return true;
+	return now - entry->stamp > msecs_to_jiffies(1000 * TCP_INCOMING_SYN);
+}
+
+static bool matches(struct pending_syn *entry, struct ipv4_pair *pair)
+{
+	return entry->local_addr == pair->local.address.s_addr
+			&& entry->remote_addr == pair->remote.address.s_addr
+			&& entry->local_port == pair->local.l4_id
+			&& entry->remote_port == pair->remote.l4_id;
+}
+
+/**
+ * Returns the first entry of "pair"'s bucket.
+ */
+static struct pending_syn *get_bucket(struct ipv4_pair *pair)
+{
+	u32 hash = jhash_3words((__force u32) pair->local.address.s_addr,
+			(__force u32) pair->remote.address.s_addr,
+			(pair->local.l4_id << 16) | pair->remote.l4_id, rnd);
+	return &table[(hash % PENDING_SYN_BUCKETS) * PENDING_SYN_WAYS];
+}
+
+int pending_syn_init(void)
+{
+	table = vmalloc(PENDING_SYN_BUCKETS * PENDING_SYN_WAYS * sizeof(*table));
+	if (!table) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the pending SYN table.");
+		return -ENOMEM;
+	}
+
+	memset(table, 0, PENDING_SYN_BUCKETS * PENDING_SYN_WAYS * sizeof(*table));
+	get_random_bytes(&rnd, sizeof(rnd));
+	return 0;
+}
+
+void pending_syn_destroy(void)
+{
+	vfree(table);
+	table = NULL;
+}
+
+void pending_syn_add(struct ipv4_pair *pair)
+{
+	struct pending_syn *bucket = get_bucket(pair);
+	struct pending_syn *victim = NULL;
+	__u32 now = jiffies;
+	int i;
+
+	for (i = 0; i < PENDING_SYN_WAYS; i++) {
+		if (matches(&bucket[i], pair)) {
+			/* Retransmission; the handshake gets another chance. */
+			victim = &bucket[i];
+			goto store;
+		}
+		if (is_stale(&bucket[i], now)) {
+			if (!victim || !is_stale(victim, now))
+				victim = &bucket[i];
+		} else if (!victim || (!is_stale(victim, now)
+				&& (__s32) (bucket[i].stamp - victim->stamp) < 0)) {
+			victim = &bucket[i];
+		}
+	}
+
+	if (!is_stale(victim, now))
+		stats_inc(STAT_SYN_PENDING_LOST);
+
+store:
+	victim->local_addr = pair->local.address.s_addr;
+	victim->remote_addr = pair->remote.address.s_addr;
+	victim->local_port = pair->local.l4_id;
+	victim->remote_port = pair->remote.l4_id;
+	victim->stamp = now;
+}
+
+bool pending_syn_remove(struct ipv4_pair *pair)
+{
+	struct pending_syn *bucket = get_bucket(pair);
+	__u32 now = jiffies;
+	bool result;
+	int i;
+
+	for (i = 0; i < PENDING_SYN_WAYS; i++) {
+		if (matches(&bucket[i], pair)) {
+			result = !is_stale(&bucket[i], now);
+			memset(&bucket[i], 0, sizeof(bucket[i]));
+			return result;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,254 @@
+#include "nat64/mod/pkt_queue.h"
+#include "nat64/comm/constants.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/icmp_wrapper.h"
+#include "nat64/mod/stats.h"
+
+#include <linux/list.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+#include <linux/netdevice.h>
+
+
+/** Number of slots of the source address index. */
+#define PKTQUEUE_HASH_SIZE 256
+
+struct stored_pkt {
+	/** The connection "skb" attempted to open. */
+	struct ipv4_pair pair;
+	/** The SYN. Holds a reference to its device, so the ICMP error can be sent through it. */
+	struct sk_buff *skb;
+	/** Jiffy at which the IPv4 node should be told its connection failed. */
+	unsigned long dying_time;
+	/** Links this packet to "fifo" (or "expired"). */
+	struct list_head list_hook;
+	/** Links this packet to its source's slot in "sources". */
+	struct hlist_node hash_hook;
+};
+
+/** The stored packets, oldest first. They all live equally long, so this is also expiry order. */
+static LIST_HEAD(fifo);
+/** Packets which outlived their timeout and whose ICMP errors haven't been sent yet. */
+static LIST_HEAD(expired);
+/** The packets from "fifo" again, indexed by source address. */
+static struct hlist_head sources[PKTQUEUE_HASH_SIZE];
+/** Hashing seed, so remote nodes cannot choose which slot they land in. */
+static u32 rnd;
+/** Memory currently being used by the packets from "fifo". */
+static unsigned int bytes;
+
+/** Moves expired packets to "expired". */
+static struct timer_list expire_timer;
+/** Sends the ICMP errors of the packets from "expired". */
+static struct work_struct reply_work;
+
+
+static struct hlist_head *get_slot(struct in_addr *src)
+{
+	return &sources[jhash_1word((__force u32) src->s_addr, rnd) % PKTQUEUE_HASH_SIZE];
+}
+
+static bool pair_equals(struct ipv4_pair *a, struct ipv4_pair *b)
+{
+	return ipv4_tuple_addr_equals(&a->remote, &b->remote)
+			&& ipv4_tuple_addr_equals(&a->local, &b->local);
+}
+
+/** Memory "pkt" is accounted for. */
+static unsigned int pkt_size(struct stored_pkt *pkt)
+{
+	return sizeof(*pkt) + pkt->skb->truesize;
+}
+
+/**
+ * Takes "pkt" out of "fifo" and "sources". Does not free it.
+ */
+static void unlink_pkt(struct stored_pkt *pkt)
+{
+	list_del(&pkt->list_hook);
+	hlist_del(&pkt->hash_hook);
+	bytes -= pkt_size(pkt);
+}
+
+static void free_pkt(struct stored_pkt *pkt)
+{
+	if (pkt->skb->dev)
+		dev_put(pkt->skb->dev);
+	kfree_skb(pkt->skb);
+	kfree(pkt);
+}
+
+static void free_list(struct list_head *list)
+{
+	struct stored_pkt *pkt, *tmp;
+
+	list_for_each_entry_safe(pkt, tmp, list, list_hook) {
+		list_del(&pkt->list_hook);
+		free_pkt(pkt);
+	}
+}
+
+/**
+ * Work function; answers the expired packets with ICMP errors. Runs in process context, so the
+ * packet path is not held up by this.
+ */
+static void send_replies(struct work_struct *work)
+{
+	LIST_HEAD(replies);
+	struct stored_pkt *pkt, *tmp;
+
+	spin_lock_bh(&bib_session_lock);
+	list_splice_init(&expired, &replies);
+	spin_unlock_bh(&bib_session_lock);
+
+	list_for_each_entry_safe(pkt, tmp, &replies, list_hook) {
+		/* The ICMP functions expect to be running in softirq context. */
+		local_bh_disable();
+		icmp64_send_skb(pkt->skb, ICMPERR_PORT_UNREACHABLE, 0);
+		local_bh_enable();
+
+		list_del(&pkt->list_hook);
+		free_pkt(pkt);
+	}
+}
+
+/**
+ * Timer function; hands the expired packets over to send_replies().
+ */
+static void expire_timer_fn(unsigned long param)
+{
+	struct stored_pkt *pkt, *tmp;
+	bool reply = false;
+
+	spin_lock_bh(&bib_session_lock);
+
+	list_for_each_entry_safe(pkt, tmp, &fifo, list_hook) {
+		if (time_before(jiffies, pkt->dying_time)) {
+			mod_timer(&expire_timer, max(pkt->dying_time, jiffies + MIN_TIMER_SLEEP));
+			break;
+		}
+
+		unlink_pkt(pkt);
+		list_add_tail(&pkt->list_hook, &expired);
+		reply = true;
+	}
+
+	spin_unlock_bh(&bib_session_lock);
+
+	if (reply)
+		schedule_work(&reply_work);
+}
+
+int pktqueue_init(void)
+{
+	int i;
+
+	INIT_LIST_HEAD(&fifo);
+	INIT_LIST_HEAD(&expired);
+	for (i = 0; i < PKTQUEUE_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&sources[i]);
+	get_random_bytes(&rnd, sizeof(rnd));
+	bytes = 0;
+
+	init_timer(&expire_timer);
+	expire_timer.function = expire_timer_fn;
+	expire_timer.expires = 0;
+	expire_timer.data = 0;
+	INIT_WORK(&reply_work, send_replies);
+
+	return 0;
+}
+
+void pktqueue_destroy(void)
+{
+	del_timer_sync(&expire_timer);
+	cancel_work_sync(&reply_work);
+
+	/* Nobody is going to be told their connection failed; oh well. */
+	free_list(&fifo);
+	free_list(&expired);
+}
+
+int pktqueue_add(struct ipv4_pair *pair, struct fragment *frag)
+{
+	struct hlist_head *slot = get_slot(&pair->remote.address);
+	struct hlist_node *node;
+	struct stored_pkt *pkt, *oldest;
+	unsigned int source_count = 0;
+
+	hlist_for_each(node, slot) {
+		pkt = hlist_entry(node, struct stored_pkt, hash_hook);
+		if (!ipv4_addr_equals(&pkt->pair.remote.address, &pair->remote.address))
+			continue;
+		if (pair_equals(&pkt->pair, pair))
+			return 0; /* Retransmission; the original is good enough. */
+		source_count++;
+	}
+
+	if (source_count >= PKTQUEUE_MAX_PER_SOURCE) {
+		log_debug("%pI4 already has %u packets stored.", &pair->remote.address, source_count);
+		stats_inc(STAT_SYN_STORE_DROPPED);
+		return -ENOSPC;
+	}
+
+	pkt = kmalloc(sizeof(*pkt), GFP_ATOMIC);
+	if (!pkt) {
+		stats_inc(STAT_ALLOC_FAILED);
+		return -ENOMEM;
+	}
+	pkt->skb = skb_clone(frag->original_skb, GFP_ATOMIC);
+	if (!pkt->skb) {
+		stats_inc(STAT_ALLOC_FAILED);
+		kfree(pkt);
+		return -ENOMEM;
+	}
+	/* The packet is going to outlive the RCU section which might be protecting its route. */
+	skb_dst_force(pkt->skb);
+	if (pkt->skb->dev)
+		dev_hold(pkt->skb->dev);
+
+	pkt->pair = *pair;
+	pkt->dying_time = jiffies + msecs_to_jiffies(1000 * TCP_INCOMING_SYN);
+
+	if (pkt_size(pkt) > PKTQUEUE_MAX_BYTES) {
+		free_pkt(pkt);
+		stats_inc(STAT_SYN_STORE_DROPPED);
+		return -ENOSPC;
+	}
+
+	/* Make room, oldest first. */
+	while (bytes + pkt_size(pkt) > PKTQUEUE_MAX_BYTES) {
+		oldest = list_first_entry(&fifo, struct stored_pkt, list_hook);
+		unlink_pkt(oldest);
+		free_pkt(oldest);
+		stats_inc(STAT_SYN_STORE_DROPPED);
+	}
+
+	list_add_tail(&pkt->list_hook, &fifo);
+	hlist_add_head(&pkt->hash_hook, slot);
+	bytes += pkt_size(pkt);
+	stats_inc(STAT_SYN_STORED);
+
+	if (!timer_pending(&expire_timer))
+		mod_timer(&expire_timer, pkt->dying_time);
+
+	return 0;
+}
+
+void pktqueue_remove(struct ipv4_pair *pair)
+{
+	struct hlist_node *node;
+	struct stored_pkt *pkt;
+
+	hlist_for_each(node, get_slot(&pair->remote.address)) {
+		pkt = hlist_entry(node, struct stored_pkt, hash_hook);
+		if (pair_equals(&pkt->pair, pair)) {
+			unlink_pkt(pkt);
+			free_pkt(pkt);
+			return;
+		}
+	}
+}
@@ -420,7 +420,7 @@ int pool4_get_any_addr(l4_protocol proto, __u16 l4_id, struct ipv4_tuple_address
 			goto success;
 	} while (original_addr != last_used_addr);
 
-	log_warning("I completely ran out of IPv4 addresses and ports.");
+	log_debug("I completely ran out of IPv4 addresses and ports.");
 	error = -ESRCH;
 
 failure:
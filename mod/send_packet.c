@@ -1,9 +1,11 @@
 #include "nat64/mod/send_packet.h"
 #include "nat64/comm/types.h"
+#include "nat64/mod/stats.h"
 
 #include <linux/version.h>
 #include <linux/list.h>
 #include <net/ip.h>
+#include <net/ip6_fib.h>
 #include <net/ip6_route.h>
 #include <net/route.h>
 
@@ -57,10 +59,12 @@ struct dst_entry *route_ipv4(struct iphdr *hdr_ip4, void *l4_hdr, l4_protocol l4
 	if (error) {
 		log_err(ERR_ROUTE_FAILED, "ip_route_output_key() failed. Code: %d. Cannot route packet.",
 				-error);
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 	if (!table) {
 		log_err(ERR_ROUTE_FAILED, "The routing table is NULL. Cannot route packet.");
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 
@@ -111,11 +115,13 @@ struct dst_entry *route_ipv6(struct ipv6hdr *hdr_ip6, void *l4_hdr, l4_protocol
 	dst = ip6_route_output(&init_net, NULL, &flow);
 	if (!dst) {
 		log_err(ERR_ROUTE_FAILED, "ip6_route_output() returned NULL. Cannot route packet.");
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 	if (dst->error) {
 		log_err(ERR_ROUTE_FAILED, "ip6_route_output() returned error %d. Cannot route packet.",
 				-dst->error);
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 
@@ -185,6 +191,7 @@ struct dst_entry *route_ipv4(struct iphdr *hdr_ip, void *l4_hdr, l4_protocol l4_
 	if (!table || IS_ERR(table)) {
 		log_err(ERR_ROUTE_FAILED, "__ip_route_output_key() returned %ld. Cannot route packet.",
 				(long) table);
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 
@@ -241,11 +248,13 @@ struct dst_entry *route_ipv6(struct ipv6hdr *hdr_ip, void *l4_hdr, l4_protocol l
 	dst = ip6_route_output(&init_net, NULL, &flow);
 	if (!dst) {
 		log_err(ERR_ROUTE_FAILED, "ip6_route_output() returned NULL. Cannot route packet.");
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 	if (dst->error) {
 		log_err(ERR_ROUTE_FAILED, "ip6_route_output() returned error %d. Cannot route packet.",
 				-dst->error);
+		stats_inc(STAT_ROUTE_FAILED);
 		return NULL;
 	}
 
@@ -254,6 +263,12 @@ struct dst_entry *route_ipv6(struct ipv6hdr *hdr_ip, void *l4_hdr, l4_protocol l
 
 #endif
 
+u32 route6_cookie(struct dst_entry *dst)
+{
+	struct rt6_info *rt = (struct rt6_info *) dst;
+
+	return rt->rt6i_node ? rt->rt6i_node->fn_sernum : 0;
+}
 
 verdict send_pkt(struct packet *pkt)
 {
@@ -277,6 +292,7 @@ verdict send_pkt(struct packet *pkt)
 		if (error) {
 			log_err(ERR_SEND_FAILED, "The kernel's packet dispatch function returned errcode %d. "
 					"Cannot send packet.", error);
+			stats_inc(STAT_SEND_FAILED);
 			return VER_DROP; /* The rest will also probably fail methinks, so meh. */
 		}
 	}
@@ -1,7 +1,9 @@
 #include "nat64/mod/session.h"
 
+#include <net/dst.h>
 #include <net/ipv6.h>
 #include "nat64/mod/rbtree.h"
+#include "nat64/mod/changelog.h"
 
 
 /********************************************
@@ -93,6 +95,18 @@ static int compare_full6(struct session_entry *session, struct ipv6_pair *pair)
 	return gap;
 }
 
+static int compare_local4(struct session_entry *session, struct ipv4_tuple_address *addr)
+{
+	int gap;
+
+	gap = ipv4_addr_cmp(&session->ipv4.local.address, &addr->address);
+	if (gap != 0)
+		return gap;
+
+	gap = session->ipv4.local.l4_id - addr->l4_id;
+	return gap;
+}
+
 static int compare_addrs4(struct session_entry *session, struct ipv4_pair *pair)
 {
 	int gap;
@@ -249,6 +263,72 @@ bool session_allow(struct tuple *tuple)
 			tree4_hook);
 }
 
+/**
+ * Returns the route slot of the session the outgoing packet "tuple" describes belongs to, or NULL
+ * if there's no such session.
+ */
+static struct session_route *get_route(struct tuple *tuple)
+{
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+
+	/* Outgoing tuples are reversed; their destination is the session's remote node. */
+	switch (tuple->l3_proto) {
+	case L3PROTO_IPV6:
+		pair6.remote.address = tuple->dst.addr.ipv6;
+		pair6.remote.l4_id = tuple->dst.l4_id;
+		pair6.local.address = tuple->src.addr.ipv6;
+		pair6.local.l4_id = tuple->src.l4_id;
+		if (session_get_by_ipv6(&pair6, tuple->l4_proto, &session))
+			return NULL;
+		return &session->route6;
+	case L3PROTO_IPV4:
+		pair4.remote.address = tuple->dst.addr.ipv4;
+		pair4.remote.l4_id = tuple->dst.l4_id;
+		pair4.local.address = tuple->src.addr.ipv4;
+		pair4.local.l4_id = tuple->src.l4_id;
+		if (session_get_by_ipv4(&pair4, tuple->l4_proto, &session))
+			return NULL;
+		return &session->route4;
+	}
+
+	return NULL;
+}
+
+struct dst_entry *session_route_get(struct tuple *tuple, struct session_route *key)
+{
+	struct session_route *route;
+
+	route = get_route(tuple);
+	if (!route || !route->dst)
+		return NULL;
+	if (route->mark != key->mark || route->flow != key->flow)
+		return NULL;
+
+	if (!dst_check(route->dst, route->cookie)) {
+		/* The routing table changed since. */
+		dst_release(route->dst);
+		route->dst = NULL;
+		return NULL;
+	}
+
+	return dst_clone(route->dst);
+}
+
+void session_route_set(struct tuple *tuple, struct session_route *key)
+{
+	struct session_route *route;
+
+	route = get_route(tuple);
+	if (!route)
+		return;
+
+	dst_release(route->dst);
+	*route = *key;
+	dst_clone(route->dst);
+}
+
 int session_add(struct session_entry *entry)
 {
 	struct session_table *table;
@@ -275,6 +355,7 @@ int session_add(struct session_entry *entry)
 	}
 
 	table->count++;
+	changelog_session(CHANGE_CREATED, entry);
 	return 0;
 }
 
@@ -297,6 +378,7 @@ int session_remove(struct session_entry *entry)
 	rb_erase(&entry->tree4_hook, &table->tree4);
 
 	table->count--;
+	changelog_session(CHANGE_REMOVED, entry);
 	return 0;
 }
 
@@ -315,14 +397,27 @@ struct session_entry *session_create(struct ipv4_pair *ipv4, struct ipv6_pair *i
 	INIT_LIST_HEAD(&result->expire_list_hook);
 	result->l4_proto = l4_proto;
 	result->state = 0;
+	result->synced = false;
+	result->synced_state = 0;
+	result->synced_dying_time = 0;
+	result->generation = 0;
+	result->route6.dst = NULL;
+	result->route4.dst = NULL;
 	RB_CLEAR_NODE(&result->tree6_hook);
 	RB_CLEAR_NODE(&result->tree4_hook);
 
 	return result;
 }
 
+size_t session_entry_size(void)
+{
+	return kmem_cache_size(entry_cache);
+}
+
 void session_kfree(struct session_entry *session)
 {
+	dst_release(session->route6.dst);
+	dst_release(session->route4.dst);
 	kmem_cache_free(entry_cache, session);
 }
 
@@ -345,6 +440,72 @@ int session_for_each(l4_protocol l4_proto, int (*func)(struct session_entry *, v
 	return 0;
 }
 
+int session_for_each_from(l4_protocol l4_proto, struct ipv4_pair *from,
+		int (*func)(struct session_entry *, void *), void *arg)
+{
+	struct session_table *table;
+	struct session_entry *session;
+	struct rb_node *node;
+	int error;
+
+	error = get_session_table(l4_proto, &table);
+	if (error)
+		return error;
+
+	session = rbtree_find_bound(from, &table->tree4, compare_full4, struct session_entry,
+			tree4_hook);
+	while (session) {
+		error = func(session, arg);
+		if (error)
+			return error;
+
+		node = rb_next(&session->tree4_hook);
+		session = node ? rb_entry(node, struct session_entry, tree4_hook) : NULL;
+	}
+
+	return 0;
+}
+
+int session_for_each_range4(l4_protocol l4_proto, struct in_addr *addr, __u16 port_min,
+		__u16 port_max, struct ipv4_pair *from,
+		int (*func)(struct session_entry *, void *), void *arg)
+{
+	struct session_table *table;
+	struct ipv4_tuple_address last;
+	struct session_entry *session;
+	struct rb_node *node;
+	int error;
+
+	error = get_session_table(l4_proto, &table);
+	if (error)
+		return error;
+
+	last.address = *addr;
+	last.l4_id = port_max;
+
+	/*
+	 * The tree is sorted by local address and port first, so the sessions we want are contiguous.
+	 * Start from the biggest port in range (or "from") and move down until we leave the range.
+	 */
+	if (from)
+		session = rbtree_find_bound(from, &table->tree4, compare_full4, struct session_entry,
+				tree4_hook);
+	else
+		session = rbtree_find_bound(&last, &table->tree4, compare_local4, struct session_entry,
+				tree4_hook);
+	while (session && ipv4_addr_equals(&session->ipv4.local.address, addr)
+			&& session->ipv4.local.l4_id >= port_min) {
+		error = func(session, arg);
+		if (error)
+			return error;
+
+		node = rb_next(&session->tree4_hook);
+		session = node ? rb_entry(node, struct session_entry, tree4_hook) : NULL;
+	}
+
+	return 0;
+}
+
 int session_count(l4_protocol proto, __u64 *result)
 {
 	struct session_table *table;
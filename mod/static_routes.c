@@ -14,22 +14,19 @@
 #include <linux/slab.h>
 
 
-int add_static_route(struct request_bib *req)
+/**
+ * Adds the static "ipv6"-"ipv4" mapping to the "l4_proto" BIB.
+ * Assumes the caller holds bib_session_lock and has already validated "ipv4"'s address.
+ */
+static int add_entry(struct ipv6_tuple_address *ipv6, struct ipv4_tuple_address *ipv4,
+		l4_protocol l4_proto)
 {
 	struct bib_entry *bib_by_ipv6, *bib_by_ipv4;
 	struct bib_entry *bib = NULL;
 	int error;
 
-	if (!pool4_contains(&req->add.ipv4.address)) {
-		log_err(ERR_POOL6_NOT_FOUND, "The address '%pI4' does not belong to the IPv4 pool.",
-				&req->add.ipv4.address);
-		return -EINVAL;
-	}
-
-	spin_lock_bh(&bib_session_lock);
-
 	/* Check if the BIB entry exists. */
-	error = bib_get_by_ipv6(&req->add.ipv6, req->l4_proto, &bib_by_ipv6);
+	error = bib_get_by_ipv6(ipv6, l4_proto, &bib_by_ipv6);
 	if (!error) {
 		bib = bib_by_ipv6;
 		goto already_mapped;
@@ -37,7 +34,7 @@ int add_static_route(struct request_bib *req)
 	if (error != -ENOENT)
 		goto generic_error;
 
-	error = bib_get_by_ipv4(&req->add.ipv4, req->l4_proto, &bib_by_ipv4);
+	error = bib_get_by_ipv4(ipv4, l4_proto, &bib_by_ipv4);
 	if (!error) {
 		bib = bib_by_ipv4;
 		goto already_mapped;
@@ -46,7 +43,7 @@ int add_static_route(struct request_bib *req)
 		goto generic_error;
 
 	/* Borrow the address and port from the IPv4 pool. */
-	if (is_error(pool4_get(req->l4_proto, &req->add.ipv4))) {
+	if (is_error(pool4_get(l4_proto, ipv4))) {
 		/*
 		 * This might happen if Filtering just reserved the address#port, but hasn't yet inserted
 		 * the BIB entry to the table. This is because bib_session_lock doesn't cover the IPv4
@@ -56,44 +53,114 @@ int add_static_route(struct request_bib *req)
 		 */
 		log_err(ERR_BIB_REINSERT, "Port number %u from address %pI4 is taken from the IPv4 pool, "
 				"but it wasn't found in the BIB. Please try again; if the problem persists, "
-				"please report.", req->add.ipv4.l4_id, &req->add.ipv4.address);
-		error = -EEXIST;
-		goto failure;
+				"please report.", ipv4->l4_id, &ipv4->address);
+		return -EEXIST;
 	}
 
 	/* Create and insert the entry. */
-	bib = bib_create(&req->add.ipv4, &req->add.ipv6, true);
+	bib = bib_create(ipv4, ipv6, true);
 	if (!bib) {
 		log_err(ERR_ALLOC_FAILED, "Could NOT allocate a BIB entry.");
 		error = -ENOMEM;
 		goto failure;
 	}
 
-	error = bib_add(bib, req->l4_proto);
+	error = bib_add(bib, l4_proto);
 	if (error) {
 		log_err(ERR_UNKNOWN_ERROR, "Could NOT add the BIB entry to the table.");
 		goto failure;
 	}
 
-	spin_unlock_bh(&bib_session_lock);
 	return 0;
 
 already_mapped:
 	log_err(ERR_BIB_REINSERT, "%pI6c#%u is already mapped to %pI4#%u.",
 			&bib->ipv6.address, bib->ipv6.l4_id,
 			&bib->ipv4.address, bib->ipv4.l4_id);
-	error = -EEXIST;
-	bib = NULL;
-	goto failure;
+	return -EEXIST;
 
 generic_error:
 	log_err(ERR_UNKNOWN_ERROR, "Error code %u while trying to interact with the BIB.",
 			error);
-	/* Fall through. */
+	return error;
 
 failure:
 	if (bib)
 		bib_kfree(bib);
+	pool4_return(l4_proto, ipv4);
+	return error;
+}
+
+/**
+ * Reverts add_entry(). Assumes the caller holds bib_session_lock, and that nothing has had a chance
+ * to attach sessions to the entry.
+ */
+static void remove_entry(struct bib_import_us *entry)
+{
+	struct bib_entry *bib;
+
+	if (bib_get_by_ipv6(&entry->ipv6, entry->l4_proto, &bib))
+		return;
+	if (bib_remove(bib, entry->l4_proto))
+		return;
+	pool4_return(entry->l4_proto, &bib->ipv4);
+	bib_kfree(bib);
+}
+
+int add_static_route(struct request_bib *req)
+{
+	int error;
+
+	if (!pool4_contains(&req->add.ipv4.address)) {
+		log_err(ERR_POOL6_NOT_FOUND, "The address '%pI4' does not belong to the IPv4 pool.",
+				&req->add.ipv4.address);
+		return -EINVAL;
+	}
+
+	spin_lock_bh(&bib_session_lock);
+	error = add_entry(&req->add.ipv6, &req->add.ipv4, req->l4_proto);
+	spin_unlock_bh(&bib_session_lock);
+
+	return error;
+}
+
+int add_static_routes(struct bib_import_us *entries, __u32 count)
+{
+	__u32 i, j;
+	int error = 0;
+
+	/* Validate everything first, so bib_session_lock is not held longer than necessary. */
+	for (i = 0; i < count; i++) {
+		switch (entries[i].l4_proto) {
+		case L4PROTO_TCP:
+		case L4PROTO_UDP:
+		case L4PROTO_ICMP:
+			break;
+		default:
+			log_err(ERR_L4PROTO, "Entry %u: Unsupported transport protocol: %u.", i,
+					entries[i].l4_proto);
+			return -EINVAL;
+		}
+
+		if (!pool4_contains(&entries[i].ipv4.address)) {
+			log_err(ERR_POOL4_NOT_FOUND, "Entry %u: The address '%pI4' does not belong to the "
+					"IPv4 pool.", i, &entries[i].ipv4.address);
+			return -EINVAL;
+		}
+	}
+
+	spin_lock_bh(&bib_session_lock);
+
+	for (i = 0; i < count; i++) {
+		error = add_entry(&entries[i].ipv6, &entries[i].ipv4, entries[i].l4_proto);
+		if (error) {
+			log_warning("Entry %u could not be added; reverting the batch.", i);
+			for (j = 0; j < i; j++)
+				remove_entry(&entries[j]);
+			break;
+		}
+	}
+
 	spin_unlock_bh(&bib_session_lock);
 	return error;
 }
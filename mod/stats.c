@@ -0,0 +1,62 @@
+#include "nat64/mod/stats.h"
+#include "nat64/comm/types.h"
+
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/string.h>
+
+
+/** One CPU's counters. */
+struct stats_cpu {
+	u64 counters[STAT_COUNT];
+};
+
+/** The counters, one copy per CPU. */
+static struct stats_cpu __percpu *stats;
+
+
+int stats_init(void)
+{
+	stats = alloc_percpu(struct stats_cpu);
+	if (!stats) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the per-CPU counters.");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void stats_destroy(void)
+{
+	free_percpu(stats);
+	stats = NULL;
+}
+
+void stats_inc(enum stat_counter counter)
+{
+	this_cpu_inc(stats->counters[counter]);
+}
+
+void stats_add(enum stat_counter counter, u64 value)
+{
+	this_cpu_add(stats->counters[counter], value);
+}
+
+void stats_sum(__u64 *result)
+{
+	struct stats_cpu *cpu_stats;
+	int cpu;
+	int i;
+
+	memset(result, 0, STAT_COUNT * sizeof(*result));
+
+	/*
+	 * The counters are not read atomically in relation to each other, so the snapshot might be
+	 * slightly inconsistent. This is fine for statistics purposes.
+	 */
+	for_each_possible_cpu(cpu) {
+		cpu_stats = per_cpu_ptr(stats, cpu);
+		for (i = 0; i < STAT_COUNT; i++)
+			result[i] += cpu_stats->counters[i];
+	}
+}
@@ -0,0 +1,146 @@
+#include "nat64/mod/sync.h"
+#include "nat64/comm/constants.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/stats.h"
+
+#include <linux/jiffies.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+
+#if (SYNC_RING_SIZE & (SYNC_RING_SIZE - 1)) != 0
+#error "SYNC_RING_SIZE must be a power of two."
+#endif
+
+/*
+ * The queue. Everything here is protected by bib_session_lock, which the producers (the code that
+ * changes the sessions) already hold anyway.
+ */
+
+/** The records nobody has popped yet. */
+static struct sync_session *ring;
+/** Number of records ever queued. */
+static unsigned int head;
+/** Number of records ever popped. */
+static unsigned int tail;
+/** Should the session changes be queued? */
+static bool enabled;
+/** Some records have been dropped since the last sync_pop(). */
+static bool lost;
+
+
+int sync_init(void)
+{
+	ring = vmalloc(SYNC_RING_SIZE * sizeof(*ring));
+	if (!ring) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the session synchronization queue.");
+		return -ENOMEM;
+	}
+
+	head = 0;
+	tail = 0;
+	enabled = false;
+	lost = false;
+	return 0;
+}
+
+void sync_destroy(void)
+{
+	vfree(ring);
+	ring = NULL;
+}
+
+void sync_set_enabled(bool enable)
+{
+	spin_lock_bh(&bib_session_lock);
+
+	if (enabled != enable)
+		log_debug("%s the session synchronization queue.", enable ? "Enabling" : "Disabling");
+	enabled = enable;
+	if (!enable) {
+		tail = head;
+		lost = false;
+	}
+
+	spin_unlock_bh(&bib_session_lock);
+}
+
+void sync_session_to_record(struct session_entry *session, enum sync_type type,
+		struct sync_session *record)
+{
+	long lifetime = (long) (session->dying_time - jiffies);
+
+	memset(record, 0, sizeof(*record));
+	record->type = type;
+	record->l4_proto = session->l4_proto;
+	record->state = session->state;
+	record->lifetime = cpu_to_be32((lifetime > 0) ? jiffies_to_msecs(lifetime) : 0);
+
+	record->remote6 = session->ipv6.remote.address;
+	record->local6 = session->ipv6.local.address;
+	record->local4 = session->ipv4.local.address;
+	record->remote4 = session->ipv4.remote.address;
+	record->remote6_port = cpu_to_be16(session->ipv6.remote.l4_id);
+	record->local6_port = cpu_to_be16(session->ipv6.local.l4_id);
+	record->local4_port = cpu_to_be16(session->ipv4.local.l4_id);
+	record->remote4_port = cpu_to_be16(session->ipv4.remote.l4_id);
+}
+
+static void queue(struct session_entry *session, enum sync_type type)
+{
+	if (head - tail >= SYNC_RING_SIZE) {
+		stats_inc(STAT_SYNC_LOST);
+		lost = true;
+		return;
+	}
+
+	sync_session_to_record(session, type, &ring[head & (SYNC_RING_SIZE - 1)]);
+	head++;
+}
+
+/**
+ * Returns true if the peer would expire "session" noticeably sooner than we would; that is, if the
+ * lifetime it was told about is shorter than three quarters of ours.
+ * (The lifetime is renewed by every packet, so sending every renewal would flood the peer.)
+ */
+static bool is_stale(struct session_entry *session)
+{
+	long ours = (long) (session->dying_time - jiffies);
+	long theirs = (long) (session->synced_dying_time - jiffies);
+
+	return theirs < ours - ours / 4;
+}
+
+void sync_session_update(struct session_entry *session)
+{
+	if (!enabled)
+		return;
+	if (session->synced && session->synced_state == session->state && !is_stale(session))
+		return;
+
+	queue(session, SYNC_SESSION_UPDATE);
+	session->synced = true;
+	session->synced_state = session->state;
+	session->synced_dying_time = session->dying_time;
+}
+
+void sync_session_remove(struct session_entry *session)
+{
+	if (enabled)
+		queue(session, SYNC_SESSION_REMOVE);
+}
+
+unsigned int sync_pop(struct sync_session *records, unsigned int max, bool *result)
+{
+	unsigned int count = 0;
+
+	spin_lock_bh(&bib_session_lock);
+
+	for (; count < max && tail != head; tail++)
+		records[count++] = ring[tail & (SYNC_RING_SIZE - 1)];
+	*result = lost;
+	lost = false;
+
+	spin_unlock_bh(&bib_session_lock);
+	return count;
+}
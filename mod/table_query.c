@@ -0,0 +1,328 @@
+#include "nat64/mod/table_query.h"
+
+#include <linux/jiffies.h>
+#include <net/ipv6.h>
+
+
+/**
+ * Positive, so it cannot be mistaken for an error. Stops the walk once the limit has been reached.
+ */
+#define QUERY_DONE 1
+
+struct query_walk {
+	struct table_query *query;
+	/** Where the walk is; it survives the walk. */
+	struct query_cursor *cursor;
+	/** Is the walk going through the BIB's IPv6 tree (as opposed to the IPv4 one)? */
+	bool by_ipv6;
+
+	int (*bib_func)(struct bib_entry *, void *);
+	int (*session_func)(struct session_entry *, void *);
+	void *arg;
+};
+
+
+static void walk_init(struct query_walk *walk, struct table_query *query,
+		struct query_cursor *cursor, void *arg)
+{
+	walk->query = query;
+	walk->cursor = cursor;
+	walk->by_ipv6 = (query->flags & QUERY_IPV6_MASK) ? true : false;
+	walk->bib_func = NULL;
+	walk->session_func = NULL;
+	walk->arg = arg;
+}
+
+/**
+ * Returns whether "walk" has already returned as many entries as it was allowed to.
+ */
+static bool walk_finished(struct query_walk *walk)
+{
+	return walk->query->limit && walk->cursor->returned >= walk->query->limit;
+}
+
+/**
+ * Returns whether "walk" should skip the next matching entry, and accounts for it.
+ */
+static bool walk_skip(struct query_walk *walk)
+{
+	if (walk->cursor->skipped < walk->query->offset) {
+		walk->cursor->skipped++;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Accounts for a successful call to the callback. Returns QUERY_DONE if the walk should stop.
+ */
+static int walk_count(struct query_walk *walk)
+{
+	walk->cursor->returned++;
+	return walk_finished(walk) ? QUERY_DONE : 0;
+}
+
+static int walk_result(int error)
+{
+	return (error == QUERY_DONE) ? 0 : error;
+}
+
+static bool port_matches(struct table_query *query, __u16 port)
+{
+	if (!(query->flags & QUERY_PORTS_MASK))
+		return true;
+	return query->port_min <= port && port <= query->port_max;
+}
+
+static bool bib_matches(struct bib_entry *bib, struct table_query *query)
+{
+	if ((query->flags & QUERY_IPV6_MASK)
+			&& !ipv6_prefix_equal(&bib->ipv6.address, &query->ipv6.address, query->ipv6.len))
+		return false;
+	if ((query->flags & QUERY_IPV4_MASK)
+			&& !ipv4_addr_equals(&bib->ipv4.address, &query->ipv4))
+		return false;
+	return port_matches(query, bib->ipv4.l4_id);
+}
+
+static bool session_matches(struct session_entry *session, struct table_query *query)
+{
+	__u64 lifetime;
+
+	if ((query->flags & QUERY_IPV6_MASK) && !ipv6_prefix_equal(&session->ipv6.remote.address,
+			&query->ipv6.address, query->ipv6.len))
+		return false;
+	if ((query->flags & QUERY_IPV4_MASK)
+			&& !ipv4_addr_equals(&session->ipv4.local.address, &query->ipv4))
+		return false;
+	if (!port_matches(query, session->ipv4.local.l4_id))
+		return false;
+
+	if ((query->flags & QUERY_STATE_MASK)
+			&& (session->l4_proto != L4PROTO_TCP || session->state != query->state))
+		return false;
+
+	if (query->flags & QUERY_LIFETIME_MASK) {
+		lifetime = time_after(session->dying_time, jiffies)
+				? jiffies_to_msecs(session->dying_time - jiffies)
+				: 0;
+		if (lifetime < query->lifetime_min || query->lifetime_max < lifetime)
+			return false;
+	}
+
+	return true;
+}
+
+static bool session_pair_equals(struct session_entry *session, struct ipv4_pair *pair)
+{
+	return ipv4_tuple_addr_equals(&session->ipv4.local, &pair->local)
+			&& ipv4_tuple_addr_equals(&session->ipv4.remote, &pair->remote);
+}
+
+/**
+ * Returns whether "bib" is the entry "walk"'s cursor points to (ie. it was visited already).
+ */
+static bool is_cursor_bib(struct query_walk *walk, struct bib_entry *bib)
+{
+	if (!walk->cursor->started)
+		return false;
+	return walk->by_ipv6
+			? ipv6_tuple_addr_equals(&bib->ipv6, &walk->cursor->bib6)
+			: ipv4_tuple_addr_equals(&bib->ipv4, &walk->cursor->bib4);
+}
+
+static int visit_bib(struct bib_entry *bib, void *arg)
+{
+	struct query_walk *walk = arg;
+	int error;
+
+	if (is_cursor_bib(walk, bib))
+		return 0;
+
+	if (bib_matches(bib, walk->query) && !walk_skip(walk)) {
+		error = walk->bib_func(bib, walk->arg);
+		if (error)
+			return error;
+		error = walk_count(walk);
+	} else {
+		error = 0;
+	}
+
+	walk->cursor->started = true;
+	walk->cursor->bib4 = bib->ipv4;
+	walk->cursor->bib6 = bib->ipv6;
+	return error;
+}
+
+static int visit_session(struct session_entry *session, void *arg)
+{
+	struct query_walk *walk = arg;
+	int error;
+
+	if (walk->cursor->started && session_pair_equals(session, &walk->cursor->session4))
+		return 0;
+
+	if (session_matches(session, walk->query) && !walk_skip(walk)) {
+		error = walk->session_func(session, walk->arg);
+		if (error)
+			return error;
+		error = walk_count(walk);
+	} else {
+		error = 0;
+	}
+
+	walk->cursor->started = true;
+	walk->cursor->session4 = session->ipv4;
+	return error;
+}
+
+/**
+ * Sorts sessions by IPv4 pair, the same way the session tables do.
+ */
+static int compare_session4(struct session_entry *session, struct ipv4_pair *pair)
+{
+	int gap;
+
+	gap = ipv4_addr_cmp(&session->ipv4.local.address, &pair->local.address);
+	if (gap != 0)
+		return gap;
+
+	gap = session->ipv4.local.l4_id - pair->local.l4_id;
+	if (gap != 0)
+		return gap;
+
+	gap = ipv4_addr_cmp(&session->ipv4.remote.address, &pair->remote.address);
+	if (gap != 0)
+		return gap;
+
+	gap = session->ipv4.remote.l4_id - pair->remote.l4_id;
+	return gap;
+}
+
+/**
+ * Returns the session of "bib" which sorts right after "last", or the smallest one if "last" is
+ * NULL. Returns NULL if there is none.
+ */
+static struct session_entry *next_bib_session(struct bib_entry *bib, struct ipv4_pair *last)
+{
+	struct session_entry *session;
+	struct session_entry *result = NULL;
+
+	list_for_each_entry(session, &bib->sessions, bib_list_hook) {
+		if (last && compare_session4(session, last) <= 0)
+			continue;
+		if (!result || compare_session4(session, &result->ipv4) < 0)
+			result = session;
+	}
+
+	return result;
+}
+
+/**
+ * Visits the sessions of "bib"; used to reach every session whose IPv6 node belongs to a prefix.
+ *
+ * The walk is resumed by BIB entry, and then by session. The entry's session list is not sorted,
+ * so its sessions are visited in IPv4 pair order instead, which is what the cursor remembers; this
+ * way the walk resumes at the right place even if the cursor's session died in the meantime.
+ * Finding each next session is linear, but a node only has so many sessions per BIB entry.
+ */
+static int visit_bib_sessions(struct bib_entry *bib, void *arg)
+{
+	struct query_walk *walk = arg;
+	struct session_entry *session;
+	int error;
+
+	session = next_bib_session(bib, is_cursor_bib(walk, bib) ? &walk->cursor->session4 : NULL);
+	while (session) {
+		error = visit_session(session, arg);
+		if (error < 0)
+			return error;
+		/* The session was visited, so the cursor now points to it. */
+		walk->cursor->bib6 = bib->ipv6;
+		if (error)
+			return error;
+
+		session = next_bib_session(bib, &session->ipv4);
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the IPv4 port range "query" is interested in.
+ */
+static void get_port_range(struct table_query *query, __u16 *min, __u16 *max)
+{
+	if (query->flags & QUERY_PORTS_MASK) {
+		*min = query->port_min;
+		*max = query->port_max;
+	} else {
+		*min = 0;
+		*max = 0xFFFF;
+	}
+}
+
+void query_cursor_init(struct query_cursor *cursor)
+{
+	memset(cursor, 0, sizeof(*cursor));
+}
+
+int query_bib(l4_protocol l4_proto, struct table_query *query, struct query_cursor *cursor,
+		int (*func)(struct bib_entry *, void *), void *arg)
+{
+	struct query_walk walk;
+	__u16 min, max;
+	int error;
+
+	walk_init(&walk, query, cursor, arg);
+	walk.bib_func = func;
+
+	if (walk_finished(&walk))
+		return 0;
+
+	if (query->flags & QUERY_IPV6_MASK) {
+		error = bib_for_each_prefix6(l4_proto, &query->ipv6,
+				cursor->started ? &cursor->bib6 : NULL, visit_bib, &walk);
+	} else if (query->flags & QUERY_IPV4_MASK) {
+		get_port_range(query, &min, &max);
+		error = bib_for_each_range4(l4_proto, &query->ipv4, min, max,
+				cursor->started ? &cursor->bib4 : NULL, visit_bib, &walk);
+	} else if (cursor->started) {
+		error = bib_for_each_from(l4_proto, &cursor->bib4, visit_bib, &walk);
+	} else {
+		error = bib_for_each(l4_proto, visit_bib, &walk);
+	}
+
+	return walk_result(error);
+}
+
+int query_session(l4_protocol l4_proto, struct table_query *query, struct query_cursor *cursor,
+		int (*func)(struct session_entry *, void *), void *arg)
+{
+	struct query_walk walk;
+	__u16 min, max;
+	int error;
+
+	walk_init(&walk, query, cursor, arg);
+	walk.session_func = func;
+
+	if (walk_finished(&walk))
+		return 0;
+
+	if (query->flags & QUERY_IPV6_MASK) {
+		/* The session tables are not indexed by IPv6 node, but the BIBs are. */
+		error = bib_for_each_prefix6(l4_proto, &query->ipv6,
+				cursor->started ? &cursor->bib6 : NULL, visit_bib_sessions, &walk);
+	} else if (query->flags & QUERY_IPV4_MASK) {
+		get_port_range(query, &min, &max);
+		error = session_for_each_range4(l4_proto, &query->ipv4, min, max,
+				cursor->started ? &cursor->session4 : NULL, visit_session, &walk);
+	} else if (cursor->started) {
+		error = session_for_each_from(l4_proto, &cursor->session4, visit_session, &walk);
+	} else {
+		error = session_for_each(l4_proto, visit_session, &walk);
+	}
+
+	return walk_result(error);
+}
@@ -0,0 +1,269 @@
+#include "nat64/mod/tcp_probe.h"
+#include "nat64/mod/send_packet.h"
+#include "nat64/mod/pool6.h"
+#include "nat64/mod/stats.h"
+
+#include <linux/jhash.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/skbuff.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <net/ip6_checksum.h>
+#include <net/ip6_route.h>
+#include <net/ipv6.h>
+
+
+/** Number of routes the probes remember. Must be a power of two. */
+#define ROUTE_CACHE_SIZE 256
+
+struct probe {
+	/** Addresses and ports of the session which needs to be probed. */
+	struct ipv6_pair pair;
+	/** Links this probe to "probes". */
+	struct list_head list_hook;
+};
+
+struct cached_route {
+	/** Destination the route leads to. */
+	struct in6_addr daddr;
+	/** Source address the route was computed for; only its first "prefix_len" bits matter. */
+	struct in6_addr saddr;
+	/** Length of the pool6 prefix "saddr" belongs to (128 if it wasn't found). */
+	__u8 prefix_len;
+	/** The route. NULL if this slot is unused. */
+	struct dst_entry *dst;
+	/** The routing table's serial number when "dst" was looked up (see route6_cookie()). */
+	u32 cookie;
+};
+
+/** Probes waiting to be sent. */
+static LIST_HEAD(probes);
+/** Protects "probes". */
+static DEFINE_SPINLOCK(probes_lock);
+/** Sends the probes from "probes". */
+static struct work_struct probe_work;
+/**
+ * Routes from previous probes, indexed by a hash of their destinations. They outlive the batches,
+ * since the sessions which need probes tend to need them again two hours later, and a lot of them
+ * time out together. Stale ones are detected by dst_check().
+ */
+static struct cached_route cache[ROUTE_CACHE_SIZE];
+/** Protects "cache". (Older kernels can run the work item on two CPUs at once.) */
+static DEFINE_MUTEX(cache_lock);
+
+
+static void cache_release(struct cached_route *entry)
+{
+	if (entry->dst) {
+		dst_release(entry->dst);
+		entry->dst = NULL;
+	}
+}
+
+/**
+ * Returns the route the probe whose header is "iph" should take, and a reference to it.
+ *
+ * Routes are looked up once per IPv6 node and pool6 prefix (probes whose sources only differ in
+ * the embedded IPv4 address share them), and reused until the routing table changes.
+ * "cache_lock" must be held.
+ */
+static struct dst_entry *get_route(struct ipv6hdr *iph, struct tcphdr *th)
+{
+	struct cached_route *entry;
+	struct ipv6_prefix prefix;
+	struct dst_entry *dst;
+
+	/* pool6 prefixes can be anything from /32 to /96. */
+	if (pool6_get(&iph->saddr, &prefix))
+		prefix.len = 128;
+
+	entry = &cache[jhash2(iph->daddr.s6_addr32, 4, 0) & (ROUTE_CACHE_SIZE - 1)];
+	if (entry->dst && entry->prefix_len == prefix.len
+			&& ipv6_addr_equal(&entry->daddr, &iph->daddr)
+			&& ipv6_prefix_equal(&entry->saddr, &iph->saddr, prefix.len)) {
+		if (dst_check(entry->dst, entry->cookie)) {
+			dst_clone(entry->dst);
+			return entry->dst;
+		}
+		/* The routing table changed since. */
+		cache_release(entry);
+	}
+
+	dst = route_ipv6(iph, th, L4PROTO_TCP, 0);
+	if (!dst)
+		return NULL;
+
+	cache_release(entry);
+	entry->daddr = iph->daddr;
+	entry->saddr = iph->saddr;
+	entry->prefix_len = prefix.len;
+	entry->dst = dst;
+	entry->cookie = route6_cookie(dst);
+
+	dst_clone(dst);
+	return dst;
+}
+
+/**
+ * Creates a probe packet for the session "pair" describes. Returns NULL on allocation failure.
+ *
+ * From RFC 6146 page 30.
+ */
+static struct sk_buff *build_probe(struct ipv6_pair *pair)
+{
+	struct sk_buff* skb;
+	struct ipv6hdr *iph;
+	struct tcphdr *th;
+
+	unsigned int l3_hdr_len = sizeof(*iph);
+	unsigned int l4_hdr_len = sizeof(*th);
+
+	skb = alloc_skb(LL_MAX_HEADER + l3_hdr_len + l4_hdr_len, GFP_KERNEL);
+	if (!skb) {
+		log_warning("Could now allocate a probe packet.");
+		stats_inc(STAT_ALLOC_FAILED);
+		return NULL;
+	}
+
+	skb_reserve(skb, LL_MAX_HEADER);
+	skb_put(skb, l3_hdr_len + l4_hdr_len);
+	skb_reset_mac_header(skb);
+	skb_reset_network_header(skb);
+	skb_set_transport_header(skb, l3_hdr_len);
+
+	iph = ipv6_hdr(skb);
+	iph->version = 6;
+	iph->priority = 0;
+	iph->flow_lbl[0] = 0;
+	iph->flow_lbl[1] = 0;
+	iph->flow_lbl[2] = 0;
+	iph->payload_len = cpu_to_be16(l4_hdr_len);
+	iph->nexthdr = NEXTHDR_TCP;
+	iph->hop_limit = 255;
+	iph->saddr = pair->local.address;
+	iph->daddr = pair->remote.address;
+
+	th = tcp_hdr(skb);
+	th->source = cpu_to_be16(pair->local.l4_id);
+	th->dest = cpu_to_be16(pair->remote.l4_id);
+	th->seq = htonl(0);
+	th->ack_seq = htonl(0);
+	th->res1 = 0;
+	th->doff = l4_hdr_len / 4;
+	th->fin = 0;
+	th->syn = 0;
+	th->rst = 0;
+	th->psh = 0;
+	th->ack = 1;
+	th->urg = 0;
+	th->ece = 0;
+	th->cwr = 0;
+	th->window = htons(8192);
+	th->check = 0;
+	th->urg_ptr = 0;
+
+	th->check = csum_ipv6_magic(&iph->saddr, &iph->daddr, l4_hdr_len, IPPROTO_TCP,
+			csum_partial(th, l4_hdr_len, 0));
+	skb->ip_summed = CHECKSUM_UNNECESSARY;
+
+	return skb;
+}
+
+static void send_probe(struct ipv6_pair *pair)
+{
+	struct sk_buff *skb;
+	struct dst_entry *dst;
+	int error;
+
+	skb = build_probe(pair);
+	if (!skb)
+		goto fail;
+
+	mutex_lock(&cache_lock);
+	dst = get_route(ipv6_hdr(skb), tcp_hdr(skb));
+	mutex_unlock(&cache_lock);
+	if (!dst) {
+		log_warning("Could now route the probe packet.");
+		kfree_skb(skb);
+		goto fail;
+	}
+	skb->dev = dst->dev;
+	skb_dst_set(skb, dst);
+
+	error = ip6_local_out(skb);
+	if (error) {
+		log_warning("The kernel's packet dispatch function returned errcode %d.", error);
+		stats_inc(STAT_SEND_FAILED);
+		goto fail;
+	}
+
+	stats_inc(STAT_PROBES_SENT);
+	return;
+
+fail:
+	log_warning("Looks like a TCP connection will break or remain idle forever somewhere...");
+}
+
+/**
+ * Work function; sends every queued probe.
+ */
+static void send_probes(struct work_struct *work)
+{
+	LIST_HEAD(batch);
+	struct probe *probe, *tmp;
+
+	spin_lock_bh(&probes_lock);
+	list_splice_init(&probes, &batch);
+	spin_unlock_bh(&probes_lock);
+
+	list_for_each_entry_safe(probe, tmp, &batch, list_hook) {
+		send_probe(&probe->pair);
+		list_del(&probe->list_hook);
+		kfree(probe);
+	}
+}
+
+int tcpprobe_init(void)
+{
+	INIT_WORK(&probe_work, send_probes);
+	return 0;
+}
+
+void tcpprobe_destroy(void)
+{
+	struct probe *probe, *tmp;
+	unsigned int i;
+
+	cancel_work_sync(&probe_work);
+
+	list_for_each_entry_safe(probe, tmp, &probes, list_hook) {
+		list_del(&probe->list_hook);
+		kfree(probe);
+	}
+
+	for (i = 0; i < ROUTE_CACHE_SIZE; i++)
+		cache_release(&cache[i]);
+}
+
+void tcpprobe_add(struct session_entry *session)
+{
+	struct probe *probe;
+
+	probe = kmalloc(sizeof(*probe), GFP_ATOMIC);
+	if (!probe) {
+		stats_inc(STAT_ALLOC_FAILED);
+		log_warning("Looks like a TCP connection will break or remain idle forever somewhere...");
+		return;
+	}
+	probe->pair = session->ipv6;
+
+	spin_lock_bh(&probes_lock);
+	list_add_tail(&probe->list_hook, &probes);
+	spin_unlock_bh(&probes_lock);
+
+	schedule_work(&probe_work);
+}
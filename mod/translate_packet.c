@@ -5,6 +5,7 @@
 #include "nat64/mod/config.h"
 #include "nat64/mod/ipv6_hdr_iterator.h"
 #include "nat64/mod/send_packet.h"
+#include "nat64/mod/session.h"
 #include "nat64/mod/icmp_wrapper.h"
 
 #include <linux/kernel.h>
@@ -15,7 +16,9 @@
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/icmp.h>
+#include <net/route.h>
 #include <net/tcp.h>
+#include <net/dst.h>
 
 
 static struct translate_config *config;
@@ -61,10 +64,29 @@ static void be16_swap(void *a, void *b, int size)
 	*(__u16 *)b = t;
 }
 
-int set_translate_config(__u32 operation, struct translate_config *new_config)
+/**
+ * Returns a modifiable copy of the current configuration. See prepare_filtering_config().
+ *
+ * The candidate shares the MTU plateaus list with the current configuration until
+ * merge_translate_config() replaces it.
+ */
+struct translate_config *prepare_translate_config(void)
 {
-	struct translate_config *tmp_config;
-	struct translate_config *old_config;
+	struct translate_config *candidate;
+
+	candidate = kmalloc(sizeof(*candidate), GFP_KERNEL);
+	if (!candidate)
+		return NULL;
+
+	*candidate = *config;
+	return candidate;
+}
+
+int merge_translate_config(__u32 operation, struct translate_config *candidate,
+		struct translate_config *new_config)
+{
+	__u16 *plateaus = NULL;
+	__u16 plateaus_len;
 
 	/* Validate. */
 	if (operation & MTU_PLATEAUS_MASK) {
@@ -95,53 +117,79 @@ int set_translate_config(__u32 operation, struct translate_config *new_config)
 		}
 
 		new_config->mtu_plateau_count = i + 1;
+
+		plateaus_len = new_config->mtu_plateau_count * sizeof(*new_config->mtu_plateaus);
+		plateaus = kmalloc(plateaus_len, GFP_ATOMIC);
+		if (!plateaus) {
+			log_err(ERR_ALLOC_FAILED, "Could not allocate the kernel's MTU plateaus list.");
+			return -ENOMEM;
+		}
+		memcpy(plateaus, new_config->mtu_plateaus, plateaus_len);
 	}
 
 	/* Update. */
-	tmp_config = kmalloc(sizeof(*tmp_config), GFP_KERNEL);
-	if (!tmp_config)
-		return -ENOMEM;
-
-	old_config = config;
-	*tmp_config = *old_config;
-
 	if (operation & RESET_TCLASS_MASK)
-		tmp_config->reset_traffic_class = new_config->reset_traffic_class;
+		candidate->reset_traffic_class = new_config->reset_traffic_class;
 	if (operation & RESET_TOS_MASK)
-		tmp_config->reset_tos = new_config->reset_tos;
+		candidate->reset_tos = new_config->reset_tos;
 	if (operation & NEW_TOS_MASK)
-		tmp_config->new_tos = new_config->new_tos;
+		candidate->new_tos = new_config->new_tos;
 	if (operation & DF_ALWAYS_ON_MASK)
-		tmp_config->df_always_on = new_config->df_always_on;
+		candidate->df_always_on = new_config->df_always_on;
 	if (operation & BUILD_IPV4_ID_MASK)
-		tmp_config->build_ipv4_id = new_config->build_ipv4_id;
+		candidate->build_ipv4_id = new_config->build_ipv4_id;
 	if (operation & LOWER_MTU_FAIL_MASK)
-		tmp_config->lower_mtu_fail = new_config->lower_mtu_fail;
-
-	if (operation & MTU_PLATEAUS_MASK) {
-		__u16 new_mtus_len = new_config->mtu_plateau_count * sizeof(*new_config->mtu_plateaus);
-
-		tmp_config->mtu_plateaus = kmalloc(new_mtus_len, GFP_ATOMIC);
-		if (!tmp_config->mtu_plateaus) {
-			log_err(ERR_ALLOC_FAILED, "Could not allocate the kernel's MTU plateaus list.");
-			kfree(tmp_config);
-			return -ENOMEM;
-		}
-
-		tmp_config->mtu_plateau_count = new_config->mtu_plateau_count;
-		memcpy(tmp_config->mtu_plateaus, new_config->mtu_plateaus, new_mtus_len);
+		candidate->lower_mtu_fail = new_config->lower_mtu_fail;
+
+	if (plateaus) {
+		/* A previous merge might have already given the candidate a list of its own. */
+		if (candidate->mtu_plateaus != config->mtu_plateaus)
+			kfree(candidate->mtu_plateaus);
+		candidate->mtu_plateaus = plateaus;
+		candidate->mtu_plateau_count = new_config->mtu_plateau_count;
 	}
 
 	if (operation & MIN_IPV6_MTU_MASK)
-		tmp_config->min_ipv6_mtu = new_config->min_ipv6_mtu;
+		candidate->min_ipv6_mtu = new_config->min_ipv6_mtu;
+
+	return 0;
+}
 
-	rcu_assign_pointer(config, tmp_config);
+void commit_translate_config(struct translate_config *candidate)
+{
+	struct translate_config *old_config = config;
+
+	rcu_assign_pointer(config, candidate);
 	synchronize_rcu_bh();
 
-	if (old_config->mtu_plateaus != tmp_config->mtu_plateaus)
+	if (old_config->mtu_plateaus != candidate->mtu_plateaus)
 		kfree(old_config->mtu_plateaus);
 	kfree(old_config);
+}
+
+void abort_translate_config(struct translate_config *candidate)
+{
+	if (candidate->mtu_plateaus != config->mtu_plateaus)
+		kfree(candidate->mtu_plateaus);
+	kfree(candidate);
+}
 
+int set_translate_config(__u32 operation, struct translate_config *new_config)
+{
+	struct translate_config *candidate;
+	int error;
+
+	candidate = prepare_translate_config();
+	if (!candidate)
+		return -ENOMEM;
+
+	error = merge_translate_config(operation, candidate, new_config);
+	if (error) {
+		abort_translate_config(candidate);
+		return error;
+	}
+
+	commit_translate_config(candidate);
 	return 0;
 }
 
@@ -525,6 +573,78 @@ end:
 	return result;
 }
 
+#ifndef UNIT_TESTING
+static struct dst_entry *route_fragment(struct fragment *frag)
+{
+	switch (frag->l3_hdr.proto) {
+	case L3PROTO_IPV6:
+		return route_ipv6(frag->l3_hdr.ptr, frag->l4_hdr.ptr, frag->l4_hdr.proto, frag->skb->mark);
+	case L3PROTO_IPV4:
+		return route_ipv4(frag->l3_hdr.ptr, frag->l4_hdr.ptr, frag->l4_hdr.proto, frag->skb->mark);
+	}
+
+	return NULL;
+}
+
+static bool is_icmp_error(struct fragment *frag)
+{
+	if (frag->l4_hdr.proto != L4PROTO_ICMP)
+		return false;
+
+	switch (frag->l3_hdr.proto) {
+	case L3PROTO_IPV6:
+		return is_icmp6_error(frag_get_icmp6_hdr(frag)->icmp6_type);
+	case L3PROTO_IPV4:
+		return is_icmp4_error(frag_get_icmp4_hdr(frag)->type);
+	}
+
+	return false;
+}
+
+/**
+ * Returns the route "frag" (the fragment of the packet "tuple" describes which contains the
+ * layer-4 header) should take.
+ *
+ * The packets of a session share addresses and ports, so they tend to share routes too. Each
+ * session remembers the route of the last packet it translated in either direction, and the
+ * rest reuse it until dst_check() says the routing table changed. ICMP errors are not cached;
+ * "tuple" describes their inner packets, not the error.
+ */
+static struct dst_entry *route_first_fragment(struct tuple *tuple, struct fragment *frag)
+{
+	struct session_route key;
+	struct dst_entry *dst;
+
+	if (is_icmp_error(frag))
+		return route_fragment(frag);
+
+	key.mark = frag->skb->mark;
+	if (frag->l3_hdr.proto == L3PROTO_IPV6)
+		key.flow = get_flow_label(frag_get_ipv6_hdr(frag));
+	else
+		key.flow = cpu_to_be32(RT_TOS(frag_get_ipv4_hdr(frag)->tos));
+
+	spin_lock_bh(&bib_session_lock);
+	dst = session_route_get(tuple, &key);
+	spin_unlock_bh(&bib_session_lock);
+	if (dst)
+		return dst;
+
+	dst = route_fragment(frag);
+	if (!dst)
+		return NULL;
+
+	key.dst = dst;
+	key.cookie = (frag->l3_hdr.proto == L3PROTO_IPV6) ? route6_cookie(dst) : 0;
+
+	spin_lock_bh(&bib_session_lock);
+	session_route_set(tuple, &key);
+	spin_unlock_bh(&bib_session_lock);
+
+	return dst;
+}
+#endif
+
 /**
  * By the time this function is called, "out"'s fields (including its fragments) are properly
  * initialized, but each fragments' skb are not.
@@ -541,7 +661,10 @@ end:
  */
 static verdict post_process(struct tuple *tuple, struct packet *in, struct packet *out)
 {
+#ifndef UNIT_TESTING
+	struct fragment *first;
 	struct fragment *frag;
+#endif
 	verdict result;
 	struct translation_steps *step = &steps[pkt_get_l3proto(in)][pkt_get_l4proto(in)];
 
@@ -550,32 +673,31 @@ static verdict post_process(struct tuple *tuple, struct packet *in, struct packe
 		return result;
 
 #ifndef UNIT_TESTING
-	list_for_each_entry(frag, &out->fragments, list_hook) {
-		struct sk_buff *skb = frag->skb;
-		/* Moved skb->protocol to frag_create_skb() and divide(). */
-		/* Moved skb->mark to translate() and divide(). */
-
-		/*
-		 * I'm not sure if I should only route the first fragment or all of them separately.
-		 * Well, there's the routing cache, so this shouldn't be too slow.
-		 */
-		if (!skb_dst(skb)) {
-			struct dst_entry *dst = NULL;
-
-			switch (frag->l3_hdr.proto) {
-			case L3PROTO_IPV6:
-				dst = route_ipv6(frag->l3_hdr.ptr, frag->l4_hdr.ptr, frag->l4_hdr.proto, skb->mark);
-				break;
-			case L3PROTO_IPV4:
-				dst = route_ipv4(frag->l3_hdr.ptr, frag->l4_hdr.ptr, frag->l4_hdr.proto, skb->mark);
-				break;
-			}
+	/* Moved skb->protocol to frag_create_skb() and divide(). */
+	/* Moved skb->mark to translate() and divide(). */
+
+	/*
+	 * All of the fragments share addresses and should follow the same path anyway, so only the
+	 * one which contains the layer-4 header is routed; the rest borrow its dst_entry. This spares
+	 * us a routing lookup per additional fragment. (The first one is usually spared too; see
+	 * route_first_fragment().)
+	 */
+	first = out->first_fragment;
+	if (!first) {
+		log_crit(ERR_UNKNOWN_ERROR, "The outgoing packet has no layer-4 fragment.");
+		return VER_DROP;
+	}
 
-			if (!dst)
-				return VER_DROP;
+	if (!skb_dst(first->skb)) {
+		struct dst_entry *dst = route_first_fragment(tuple, first);
+		if (!dst)
+			return VER_DROP;
+		skb_dst_set(first->skb, dst);
+	}
 
-			skb_dst_set(skb, dst);
-		}
+	list_for_each_entry(frag, &out->fragments, list_hook) {
+		if (frag != first && !skb_dst(frag->skb))
+			skb_dst_set(frag->skb, dst_clone(skb_dst(first->skb)));
 	}
 #endif
 
@@ -0,0 +1,338 @@
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/printk.h>
+#include <linux/slab.h>
+#include <linux/netfilter.h>
+
+#include "nat64/unit/benchmark.h"
+#include "nat64/unit/skb_generator.h"
+#include "nat64/unit/types.h"
+#include "nat64/unit/send_packet_impersonator.h"
+
+#include "nat64/comm/str_utils.h"
+#include "nat64/mod/pool6.h"
+#include "nat64/mod/pool4.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+#include "nat64/mod/fragment_db.h"
+#include "nat64/mod/filtering_and_updating.h"
+#include "nat64/mod/translate_packet.h"
+#include "nat64/mod/core.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/changelog.h"
+
+
+/*
+ * Measures how long core_6to4() and core_4to6() take to process a packet.
+ *
+ * Everything from the fragment database to the translation is real; only routing and sending
+ * are replaced by the impersonator, which just hands the translated packet back to us.
+ * Usage:
+ *
+ *	sudo insmod benchmark.ko iterations=1000000 flows=4096 payload_len=512 && sudo rmmod benchmark
+ *	dmesg | grep Benchmark
+ *
+ * ../usr/Makefile also builds this file as a userspace program, which takes the same arguments.
+ */
+
+static unsigned int iterations = 100000;
+module_param(iterations, uint, 0);
+MODULE_PARM_DESC(iterations, "Number of packets to translate per scenario.");
+
+static unsigned int flows = 256;
+module_param(flows, uint, 0);
+MODULE_PARM_DESC(flows, "Number of distinct IPv6 nodes the packets come from.");
+
+static unsigned short payload_len = 100;
+module_param(payload_len, ushort, 0);
+MODULE_PARM_DESC(payload_len, "Length of the packets' layer-4 payload.");
+
+
+#define NAT64_IPV6_POOL "64:ff9b::/96"
+#define NAT64_IPV4_ADDR "192.0.2.1"
+#define SERVER_IPV4_ADDR "198.51.100.1"
+#define OTHER_SERVER_IPV4_ADDR "198.51.100.2"
+#define SERVER_IPV6_ADDR "64:ff9b::198.51.100.1"
+#define SERVER_PORT 80
+#define CLIENT_PREFIX "2001:db8::"
+#define CLIENT_PORT 5000
+
+/** Builds a packet from a ipv6_pair or a ipv4_pair (see skb_generator.h). */
+typedef int (*skb_creator)(void *, struct sk_buff **, u16);
+
+/** The IPv6 view of each flow. */
+static struct ipv6_pair *pairs6;
+/** The IPv4 view of each flow, as defined by the BIB entries the 6-to-4 traffic created. */
+static struct ipv4_pair *pairs4;
+
+
+static int init_flows(void)
+{
+	struct in6_addr client_prefix;
+	struct in6_addr server6;
+	int i;
+
+	pairs6 = kmalloc(flows * sizeof(*pairs6), GFP_KERNEL);
+	pairs4 = kmalloc(flows * sizeof(*pairs4), GFP_KERNEL);
+	if (!pairs6 || !pairs4) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate %u flows.", flows);
+		return -ENOMEM;
+	}
+
+	if (str_to_addr6(CLIENT_PREFIX, &client_prefix) || str_to_addr6(SERVER_IPV6_ADDR, &server6))
+		return -EINVAL;
+
+	for (i = 0; i < flows; i++) {
+		pairs6[i].remote.address = client_prefix;
+		pairs6[i].remote.address.s6_addr32[3] = cpu_to_be32(i + 1);
+		pairs6[i].remote.l4_id = CLIENT_PORT;
+		pairs6[i].local.address = server6;
+		pairs6[i].local.l4_id = SERVER_PORT;
+	}
+
+	return 0;
+}
+
+/**
+ * Computes the IPv4 side of every flow, as seen from IPv4 node "server". Can only be done after
+ * the flows' BIB entries exist.
+ */
+static int learn_flows_ipv4(l4_protocol l4_proto, char *server)
+{
+	struct bib_entry *bib;
+	struct in_addr server4;
+	int i, error = 0;
+
+	if (str_to_addr4(server, &server4))
+		return -EINVAL;
+
+	spin_lock_bh(&bib_session_lock);
+	for (i = 0; i < flows; i++) {
+		error = bib_get_by_ipv6(&pairs6[i].remote, l4_proto, &bib);
+		if (error) {
+			log_warning("Flow #%d does not have a BIB entry.", i);
+			break;
+		}
+		pairs4[i].remote.address = server4;
+		/* The generator takes the ICMP identifier from the remote side. */
+		pairs4[i].remote.l4_id = (l4_proto == L4PROTO_ICMP) ? bib->ipv4.l4_id : SERVER_PORT;
+		pairs4[i].local = bib->ipv4;
+	}
+	spin_unlock_bh(&bib_session_lock);
+
+	return error;
+}
+
+/**
+ * Feeds "count" packets to "core", cycling through the flows, and measures each call.
+ * "pairs" is an array of "pair_size"-sized ipv6_pairs or ipv4_pairs, depending on "create_skb".
+ * If "expected" is NF_STOLEN, the packets are expected to be translated and sent.
+ */
+static bool run(struct bench_result *result, unsigned int count, unsigned int expected,
+		unsigned int (*core)(struct sk_buff *), skb_creator create_skb,
+		void *pairs, size_t pair_size)
+{
+	struct sk_buff *skb, *sent;
+	ktime_t start, end;
+	unsigned int verdict;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (create_skb(pairs + (i % flows) * pair_size, &skb, payload_len) != 0)
+			return false;
+
+		start = ktime_get();
+		verdict = core(skb);
+		end = ktime_get();
+		bench_add(result, start, end);
+
+		if (verdict != NF_STOLEN)
+			kfree_skb(skb); /* The kernel would have done this. */
+
+		sent = get_sent_skb();
+		if (sent) {
+			kfree_skb(sent);
+			set_sent_skb(NULL);
+		}
+
+		if (verdict != expected || (expected == NF_STOLEN && !sent))
+			result->failures++;
+	}
+
+	bench_print(result);
+	return true;
+}
+
+static bool bench_udp(void)
+{
+	struct bench_result result;
+
+	bench_init(&result, "UDP 6->4, new flows");
+	if (!run(&result, flows, NF_STOLEN, core_6to4, (skb_creator) create_skb_ipv6_udp,
+			pairs6, sizeof(*pairs6)))
+		return false;
+	if (learn_flows_ipv4(L4PROTO_UDP, SERVER_IPV4_ADDR))
+		return false;
+
+	bench_init(&result, "UDP 6->4, existing flows");
+	if (!run(&result, iterations, NF_STOLEN, core_6to4, (skb_creator) create_skb_ipv6_udp,
+			pairs6, sizeof(*pairs6)))
+		return false;
+
+	bench_init(&result, "UDP 4->6, existing flows");
+	if (!run(&result, iterations, NF_STOLEN, core_4to6, (skb_creator) create_skb_ipv4_udp,
+			pairs4, sizeof(*pairs4)))
+		return false;
+
+	/*
+	 * A second server writes to the same BIB entries. There is no address-dependent filtering
+	 * by default, so each of its packets opens a new session.
+	 */
+	if (learn_flows_ipv4(L4PROTO_UDP, OTHER_SERVER_IPV4_ADDR))
+		return false;
+
+	bench_init(&result, "UDP 4->6, new flows");
+	return run(&result, flows, NF_STOLEN, core_4to6, (skb_creator) create_skb_ipv4_udp,
+			pairs4, sizeof(*pairs4));
+}
+
+static bool bench_icmp(void)
+{
+	struct bench_result result;
+
+	bench_init(&result, "ICMP 6->4, new flows");
+	if (!run(&result, flows, NF_STOLEN, core_6to4,
+			(skb_creator) create_skb_ipv6_icmp_info, pairs6, sizeof(*pairs6)))
+		return false;
+
+	if (learn_flows_ipv4(L4PROTO_ICMP, SERVER_IPV4_ADDR))
+		return false;
+
+	bench_init(&result, "ICMP 6->4, existing flows");
+	if (!run(&result, iterations, NF_STOLEN, core_6to4,
+			(skb_creator) create_skb_ipv6_icmp_info, pairs6, sizeof(*pairs6)))
+		return false;
+
+	bench_init(&result, "ICMP 4->6, existing flows");
+	return run(&result, iterations, NF_STOLEN, core_4to6,
+			(skb_creator) create_skb_ipv4_icmp_info, pairs4, sizeof(*pairs4));
+}
+
+static bool bench_untranslatable(void)
+{
+	struct bench_result result;
+	struct ipv6_pair pair6;
+
+	/* Native IPv6 traffic which happens to traverse the translator. */
+	if (init_pair6(&pair6, "2001:db8::1", CLIENT_PORT, "2001:db8:1::1", SERVER_PORT))
+		return false;
+
+	bench_init(&result, "IPv6 not meant for translation");
+	return run(&result, iterations, NF_ACCEPT, core_6to4, (skb_creator) create_skb_ipv6_udp,
+			&pair6, 0);
+}
+
+static void deinit(void)
+{
+	translate_packet_destroy();
+	filtering_destroy();
+	session_destroy();
+	bib_destroy();
+	changelog_destroy();
+	pool4_destroy();
+	pool6_destroy();
+	fragdb_destroy();
+	pktmod_destroy();
+	events_destroy();
+	stats_destroy();
+
+	kfree(pairs4);
+	kfree(pairs6);
+}
+
+static int init(void)
+{
+	char *pool6[] = { NAT64_IPV6_POOL };
+	char *pool4[] = { NAT64_IPV4_ADDR };
+	int error;
+
+	error = init_flows();
+	if (error)
+		goto failure;
+	error = stats_init();
+	if (error)
+		goto failure;
+	error = events_init();
+	if (error)
+		goto failure;
+	error = pktmod_init();
+	if (error)
+		goto failure;
+	error = fragdb_init();
+	if (error)
+		goto failure;
+	error = pool6_init(pool6, ARRAY_SIZE(pool6));
+	if (error)
+		goto failure;
+	error = pool4_init(pool4, ARRAY_SIZE(pool4));
+	if (error)
+		goto failure;
+	error = changelog_init();
+	if (error)
+		goto failure;
+	error = bib_init();
+	if (error)
+		goto failure;
+	error = session_init();
+	if (error)
+		goto failure;
+	error = filtering_init();
+	if (error)
+		goto failure;
+	error = translate_packet_init();
+	if (error)
+		goto failure;
+
+	return 0;
+
+failure:
+	deinit();
+	return error;
+}
+
+static int init_benchmark_module(void)
+{
+	int error;
+
+	/* Every flow needs its own transport address from the single pool4 address. */
+	if (flows == 0 || flows > 30000) {
+		log_err(ERR_UNKNOWN_ERROR, "flows must be within [1, 30000].");
+		return -EINVAL;
+	}
+
+	error = init();
+	if (error)
+		return error;
+
+	log_info("Benchmark: %u iterations, %u flows, %u bytes of payload.", iterations, flows,
+			payload_len);
+
+	if (!bench_udp() || !bench_icmp() || !bench_untranslatable())
+		error = -EINVAL;
+
+	deinit();
+	log_info("Benchmark finished.");
+	return error;
+}
+
+static void cleanup_benchmark_module(void)
+{
+	/* No code. */
+}
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("NIC-ITESM");
+MODULE_DESCRIPTION("Translation core benchmark.");
+module_init(init_benchmark_module);
+module_exit(cleanup_benchmark_module);
@@ -0,0 +1,467 @@
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/printk.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/delay.h>
+#include <linux/cpumask.h>
+#include <linux/math64.h>
+
+#include "nat64/unit/benchmark.h"
+#include "nat64/unit/skb_generator.h"
+#include "nat64/unit/types.h"
+#include "nat64/comm/str_utils.h"
+#include "filtering_and_updating.c"
+
+
+/*
+ * Replays tuples through filtering_and_updating() from several threads at once, to quantify how
+ * much bib_session_lock serializes them.
+ *
+ * The benchmark runs once per thread count (1, 2, 4, ... up to "threads"), starting from empty
+ * tables every time. Each operation is one of these, chosen at random according to the
+ * percentages:
+ * - A UDP packet from a flow nobody has seen before (creates a BIB entry and a session).
+ * - A TCP handshake from a new flow: IPv6 SYN, IPv4 SYN and IPv6 RST (CLOSED -> V6 INIT ->
+ *   ESTABLISHED -> TRANS).
+ * - A UDP packet from one of "flows" well-known flows (only refreshes a session).
+ * Meanwhile, another thread can run the session cleaner every "expire_interval_ms".
+ *
+ * "lock wait" is sampled by having the workers take bib_session_lock themselves every once in a
+ * while; it estimates how long the datapath waits for the lock. For exact hold and wait times,
+ * run this on a kernel with CONFIG_LOCK_STAT and look for bib_session_lock in /proc/lock_stat.
+ *
+ *	sudo insmod filtering_stress.ko threads=8 tcp_pct=20 && sudo rmmod filtering_stress
+ *	dmesg | grep Benchmark
+ */
+
+static unsigned int threads;
+module_param(threads, uint, 0);
+MODULE_PARM_DESC(threads, "Maximum number of worker threads. Default: number of online CPUs.");
+
+static unsigned int ops_per_thread = 100000;
+module_param(ops_per_thread, uint, 0);
+MODULE_PARM_DESC(ops_per_thread, "Operations each worker performs per round.");
+
+static unsigned int flows = 1024;
+module_param(flows, uint, 0);
+MODULE_PARM_DESC(flows, "Number of well-known UDP flows.");
+
+static unsigned int new_pct = 10;
+module_param(new_pct, uint, 0);
+MODULE_PARM_DESC(new_pct, "Percentage of operations which are UDP packets from new flows.");
+
+static unsigned int tcp_pct = 10;
+module_param(tcp_pct, uint, 0);
+MODULE_PARM_DESC(tcp_pct, "Percentage of operations which are TCP handshakes from new flows.");
+
+static unsigned int expire_interval_ms;
+module_param(expire_interval_ms, uint, 0);
+MODULE_PARM_DESC(expire_interval_ms, "Run the session cleaner this often. Zero disables it.");
+
+static unsigned int session_lifetime_ms;
+module_param(session_lifetime_ms, uint, 0);
+MODULE_PARM_DESC(session_lifetime_ms, "Override the UDP and TCP timeouts. Zero keeps them.");
+
+
+#define NAT64_IPV6_POOL "64:ff9b::/96"
+#define SERVER_IPV4_ADDR "198.51.100.1"
+#define SERVER_IPV6_ADDR "64:ff9b::198.51.100.1"
+#define SERVER_PORT 80
+#define CLIENT_PREFIX "2001:db8::"
+#define CLIENT_PORT 5000
+
+/** Workers sample the lock wait once every this number of operations. */
+#define LOCK_PROBE_INTERVAL 64
+
+struct worker {
+	unsigned int id;
+	/** State of the worker's pseudorandom number generator. */
+	u32 seed;
+	/** Counter used to make up new flows. */
+	u32 next_flow;
+
+	struct bench_result latency;
+	struct bench_result lock_wait;
+	struct completion done;
+};
+
+static struct in6_addr client_prefix;
+static struct ipv6_tuple_address server6;
+static struct ipv4_tuple_address server4;
+
+/** Workers wait for this before starting, so they all start at roughly the same time. */
+static struct completion start_signal;
+
+
+static u32 next_random(struct worker *worker)
+{
+	/* xorshift32. Good enough, and doesn't take any locks. */
+	worker->seed ^= worker->seed << 13;
+	worker->seed ^= worker->seed >> 17;
+	worker->seed ^= worker->seed << 5;
+	return worker->seed;
+}
+
+/**
+ * Flows are told apart by their IPv6 source address. Worker zero is reserved for the well-known
+ * flows.
+ */
+static void init_flow6(struct ipv6_pair *pair6, unsigned int worker_id, u32 flow)
+{
+	pair6->remote.address = client_prefix;
+	pair6->remote.address.s6_addr32[2] = cpu_to_be32(worker_id);
+	pair6->remote.address.s6_addr32[3] = cpu_to_be32(flow);
+	pair6->remote.l4_id = CLIENT_PORT;
+	pair6->local = server6;
+}
+
+/**
+ * Sends one packet through filtering_and_updating() and measures it.
+ * The packet is built from "pair", which is a ipv6_pair or a ipv4_pair depending on "l3_proto".
+ * If "syn" or "rst", the packet is assumed to be TCP, and the flag is set.
+ */
+static verdict filter_packet(struct worker *worker, l3_protocol l3_proto, l4_protocol l4_proto,
+		void *pair, bool syn, bool rst)
+{
+	struct sk_buff *skb;
+	struct fragment *frag;
+	struct tuple tuple;
+	ktime_t start, end;
+	verdict result;
+	int error;
+
+	if (l3_proto == L3PROTO_IPV6) {
+		init_ipv6_tuple_from_pair(&tuple, pair, l4_proto);
+		error = (l4_proto == L4PROTO_TCP)
+				? create_skb_ipv6_tcp(pair, &skb, 16)
+				: create_skb_ipv6_udp(pair, &skb, 16);
+	} else {
+		init_ipv4_tuple_from_pair(&tuple, pair, l4_proto);
+		error = create_skb_ipv4_tcp(pair, &skb, 16);
+	}
+	if (error)
+		return VER_DROP;
+
+	if (l4_proto == L4PROTO_TCP) {
+		tcp_hdr(skb)->syn = syn;
+		tcp_hdr(skb)->rst = rst;
+	}
+
+	if (frag_create_from_skb(skb, &frag)) {
+		kfree_skb(skb);
+		return VER_DROP;
+	}
+
+	start = ktime_get();
+	result = filtering_and_updating(frag, &tuple);
+	end = ktime_get();
+	bench_add(&worker->latency, start, end);
+
+	frag_kfree(frag);
+	return result;
+}
+
+static bool tcp_handshake(struct worker *worker)
+{
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct bib_entry *bib;
+	int error;
+
+	init_flow6(&pair6, worker->id, worker->next_flow++);
+	if (filter_packet(worker, L3PROTO_IPV6, L4PROTO_TCP, &pair6, true, false)
+			!= VER_CONTINUE)
+		return false;
+
+	spin_lock_bh(&bib_session_lock);
+	error = bib_get_by_ipv6(&pair6.remote, L4PROTO_TCP, &bib);
+	if (!error)
+		pair4.local = bib->ipv4;
+	spin_unlock_bh(&bib_session_lock);
+	if (error)
+		return false; /* Expired already? */
+	pair4.remote = server4;
+
+	if (filter_packet(worker, L3PROTO_IPV4, L4PROTO_TCP, &pair4, true, false)
+			!= VER_CONTINUE)
+		return false;
+	return filter_packet(worker, L3PROTO_IPV6, L4PROTO_TCP, &pair6, false, true)
+			== VER_CONTINUE;
+}
+
+static void probe_lock(struct worker *worker)
+{
+	ktime_t start, end;
+
+	start = ktime_get();
+	spin_lock_bh(&bib_session_lock);
+	end = ktime_get();
+	spin_unlock_bh(&bib_session_lock);
+
+	bench_add(&worker->lock_wait, start, end);
+}
+
+static int worker_thread(void *arg)
+{
+	struct worker *worker = arg;
+	struct ipv6_pair pair6;
+	unsigned int i, dice;
+	bool success;
+
+	wait_for_completion(&start_signal);
+
+	for (i = 0; i < ops_per_thread; i++) {
+		dice = next_random(worker) % 100;
+
+		if (dice < new_pct) {
+			init_flow6(&pair6, worker->id, worker->next_flow++);
+			success = filter_packet(worker, L3PROTO_IPV6, L4PROTO_UDP, &pair6, false,
+					false) == VER_CONTINUE;
+		} else if (dice < new_pct + tcp_pct) {
+			success = tcp_handshake(worker);
+		} else {
+			init_flow6(&pair6, 0, next_random(worker) % flows);
+			success = filter_packet(worker, L3PROTO_IPV6, L4PROTO_UDP, &pair6, false,
+					false) == VER_CONTINUE;
+		}
+
+		if (!success)
+			worker->latency.failures++;
+		if (i % LOCK_PROBE_INTERVAL == 0)
+			probe_lock(worker);
+		if (i % 1024 == 0)
+			cond_resched();
+	}
+
+	complete_and_exit(&worker->done, 0);
+}
+
+static int cleaner_thread(void *arg)
+{
+	struct bench_result *result = arg;
+	ktime_t start, end;
+
+	while (!kthread_should_stop()) {
+		start = ktime_get();
+		cleaner_timer(0);
+		end = ktime_get();
+		bench_add(result, start, end);
+
+		msleep_interruptible(expire_interval_ms);
+	}
+
+	return 0;
+}
+
+static int init_tables(void)
+{
+	char *pool6[] = { NAT64_IPV6_POOL };
+	int error;
+
+	error = pool6_init(pool6, ARRAY_SIZE(pool6));
+	if (error)
+		return error;
+	error = pool4_init(NULL, 0);
+	if (error)
+		return error;
+	error = changelog_init();
+	if (error)
+		return error;
+	error = bib_init();
+	if (error)
+		return error;
+	error = session_init();
+	if (error)
+		return error;
+	error = filtering_init();
+	if (error)
+		return error;
+
+	if (session_lifetime_ms) {
+		config->to.udp = msecs_to_jiffies(session_lifetime_ms);
+		config->to.tcp_est = msecs_to_jiffies(session_lifetime_ms);
+		config->to.tcp_trans = msecs_to_jiffies(session_lifetime_ms);
+	}
+
+	return 0;
+}
+
+static void destroy_tables(void)
+{
+	filtering_destroy();
+	session_destroy();
+	bib_destroy();
+	changelog_destroy();
+	pool4_destroy();
+	pool6_destroy();
+}
+
+/** Creates the well-known flows. */
+static bool warm_up(struct worker *worker)
+{
+	struct ipv6_pair pair6;
+	unsigned int i;
+
+	for (i = 0; i < flows; i++) {
+		init_flow6(&pair6, 0, i);
+		if (filter_packet(worker, L3PROTO_IPV6, L4PROTO_UDP, &pair6, false, false)
+				!= VER_CONTINUE)
+			return false;
+	}
+
+	return true;
+}
+
+static int run_round(unsigned int thread_count)
+{
+	struct worker *workers;
+	struct task_struct *task;
+	struct task_struct *cleaner = NULL;
+	struct bench_result total_latency, total_lock_wait, cleaner_result;
+	ktime_t start, end;
+	u64 ops, wall_ns;
+	unsigned int i;
+	int error;
+
+	workers = kcalloc(thread_count, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return -ENOMEM;
+
+	error = init_tables();
+	if (error)
+		goto end;
+
+	for (i = 0; i < thread_count; i++) {
+		workers[i].id = i + 1;
+		workers[i].seed = 2463534242U + i;
+		bench_init(&workers[i].latency, "latency");
+		bench_init(&workers[i].lock_wait, "lock wait");
+		init_completion(&workers[i].done);
+	}
+	if (!warm_up(&workers[0])) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not create the well-known flows.");
+		error = -EINVAL;
+		goto end;
+	}
+	bench_init(&workers[0].latency, "latency");
+
+	init_completion(&start_signal);
+	for (i = 0; i < thread_count; i++) {
+		task = kthread_run(worker_thread, &workers[i], "jool_bench/%u", i);
+		if (IS_ERR(task)) {
+			log_err(ERR_UNKNOWN_ERROR, "Could not start worker thread #%u.", i);
+			/* The threads that did start still need to be released. */
+			thread_count = i;
+			error = PTR_ERR(task);
+			break;
+		}
+	}
+
+	bench_init(&cleaner_result, "cleaner");
+	if (expire_interval_ms) {
+		cleaner = kthread_run(cleaner_thread, &cleaner_result, "jool_bench_clean");
+		if (IS_ERR(cleaner)) {
+			log_warning("Could not start the cleaner thread; running without it.");
+			cleaner = NULL;
+		}
+	}
+
+	start = ktime_get();
+	complete_all(&start_signal);
+	for (i = 0; i < thread_count; i++)
+		wait_for_completion(&workers[i].done);
+	end = ktime_get();
+
+	if (cleaner)
+		kthread_stop(cleaner);
+	if (error)
+		goto end;
+
+	/* Merge and report. */
+	bench_init(&total_latency, "filtering_and_updating");
+	bench_init(&total_lock_wait, "lock wait");
+	for (i = 0; i < thread_count; i++) {
+		bench_merge(&total_latency, &workers[i].latency);
+		bench_merge(&total_lock_wait, &workers[i].lock_wait);
+	}
+
+	ops = (u64) thread_count * ops_per_thread;
+	wall_ns = ktime_to_ns(ktime_sub(end, start));
+	log_info("Benchmark: %u threads: %llu operations in %llu ms; %llu operations/sec.",
+			thread_count, ops, div64_u64(wall_ns, NSEC_PER_MSEC),
+			wall_ns ? div64_u64(ops * NSEC_PER_SEC, wall_ns) : 0);
+	bench_print(&total_latency);
+	bench_print(&total_lock_wait);
+	if (cleaner)
+		bench_print(&cleaner_result);
+	/* Fall through. */
+
+end:
+	destroy_tables();
+	kfree(workers);
+	return error;
+}
+
+static int init_benchmark_module(void)
+{
+	unsigned int count;
+	int error;
+
+	if (!threads)
+		threads = num_online_cpus();
+	if (flows == 0 || new_pct + tcp_pct > 100) {
+		log_err(ERR_UNKNOWN_ERROR, "flows must be positive and new_pct + tcp_pct <= 100.");
+		return -EINVAL;
+	}
+
+	if (str_to_addr6(CLIENT_PREFIX, &client_prefix)
+			|| str_to_addr6(SERVER_IPV6_ADDR, &server6.address)
+			|| str_to_addr4(SERVER_IPV4_ADDR, &server4.address))
+		return -EINVAL;
+	server6.l4_id = SERVER_PORT;
+	server4.l4_id = SERVER_PORT;
+
+	error = pktmod_init();
+	if (error)
+		return error;
+	error = stats_init();
+	if (error)
+		goto pktmod_failure;
+	error = events_init();
+	if (error)
+		goto stats_failure;
+
+	log_info("Benchmark: %u ops per thread, %u well-known flows, %u%% new UDP flows, "
+			"%u%% TCP handshakes, cleaner every %u ms.", ops_per_thread, flows, new_pct,
+			tcp_pct, expire_interval_ms);
+
+	/* 1, 2, 4, ..., and then exactly "threads". */
+	for (count = 1; ; count = min(count * 2, threads)) {
+		error = run_round(count);
+		if (error || count == threads)
+			break;
+	}
+
+	log_info("Benchmark finished.");
+
+	events_destroy();
+stats_failure:
+	stats_destroy();
+pktmod_failure:
+	pktmod_destroy();
+	return error;
+}
+
+static void cleanup_benchmark_module(void)
+{
+	/* No code. */
+}
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("NIC-ITESM");
+MODULE_DESCRIPTION("Filtering and updating multithreaded benchmark.");
+module_init(init_benchmark_module);
+module_exit(cleanup_benchmark_module);
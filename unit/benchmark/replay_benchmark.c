@@ -0,0 +1,501 @@
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/printk.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/netfilter.h>
+#include <linux/if_ether.h>
+#include <linux/math64.h>
+
+#include "nat64/unit/benchmark.h"
+#include "nat64/unit/pcap.h"
+#include "nat64/unit/send_packet_impersonator.h"
+
+#include "nat64/mod/pool6.h"
+#include "nat64/mod/pool4.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+#include "nat64/mod/fragment_db.h"
+#include "nat64/mod/filtering_and_updating.h"
+#include "nat64/mod/translate_packet.h"
+#include "nat64/mod/core.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/changelog.h"
+#include "nat64/mod/latency.h"
+
+
+/*
+ * Replays captured traffic through core_6to4() and core_4to6(), as fast as possible.
+ *
+ * The IPv6-side and IPv4-side captures are merged by timestamp and fed to the translator in that
+ * order, so the IPv4 packets find the state the IPv6 ones created. For the IPv4 half to translate,
+ * pool4 should be the address the capturing NAT64 used (Jool tries to keep the source ports, so
+ * single-address pools usually line up). Routing and sending are impersonated; translated packets
+ * can be written to a capture for diffing. Usage:
+ *
+ *	sudo insmod replay.ko pcap6=/tmp/v6.pcap pcap4=/tmp/v4.pcap pool4=203.0.113.1 \
+ *			output=/tmp/out.pcap loops=10 && sudo rmmod replay
+ *	dmesg | grep Benchmark
+ *
+ * After the timed loops, the capture is replayed once more with the latency histograms (see
+ * latency.h) switched on, to tell where the time goes.
+ */
+
+static char *pcap6;
+module_param(pcap6, charp, 0);
+MODULE_PARM_DESC(pcap6, "Capture of the traffic seen on the IPv6 side.");
+
+static char *pcap4;
+module_param(pcap4, charp, 0);
+MODULE_PARM_DESC(pcap4, "Capture of the traffic seen on the IPv4 side.");
+
+static char *output;
+module_param(output, charp, 0);
+MODULE_PARM_DESC(output, "If set, the packets translated during the first loop are written here.");
+
+static unsigned int loops = 1;
+module_param(loops, uint, 0);
+MODULE_PARM_DESC(loops, "Number of times the captures are replayed.");
+
+static char *pool6 = "64:ff9b::/96";
+module_param(pool6, charp, 0);
+MODULE_PARM_DESC(pool6, "The translator's IPv6 prefix.");
+
+static char *pool4 = "192.0.2.1";
+module_param(pool4, charp, 0);
+MODULE_PARM_DESC(pool4, "The translator's IPv4 address.");
+
+
+/** Relax the CPU every this number of packets; replays can take a while. */
+#define RESCHED_INTERVAL 1024
+
+/** What happened to the packets of a replay. */
+struct replay_counters {
+	u64 packets_in;
+	u64 bytes_in;
+	/** Packets which came out of the translator. */
+	u64 packets_out;
+	u64 bytes_out;
+	/** Packets core returned to the kernel untouched. */
+	u64 accepted;
+	/** Packets which were dropped, filtered or stored. */
+	u64 other;
+};
+
+static struct pcap_file capture6;
+static struct pcap_file capture4;
+/** Every packet of both captures, in the order they will be replayed. */
+static struct pcap_packet **schedule;
+static unsigned int schedule_len;
+
+static struct pcap_output out;
+
+/** Names of the stages the latency histograms measure, indexed by enum latency_stage. */
+static char *stage_names[] = {
+	"stage 1, fragment_arrives",
+	"stage 2, determine_in_tuple",
+	"stage 3, filtering_and_updating",
+	"stage 4, compute_out_tuple",
+	"stage 5, translating_the_packet",
+	"stage 6, send_pkt/hairpinning",
+};
+
+/** Counters before and after a replay, to compute what it allocated. */
+static __u64 stats_before[STAT_COUNT];
+static __u64 stats_after[STAT_COUNT];
+
+
+/**
+ * Merges the captures into "schedule". Both are assumed to be sorted by time, which is how
+ * capture tools write them.
+ */
+static int build_schedule(void)
+{
+	unsigned int i6 = 0, i4 = 0;
+	struct pcap_packet *next;
+
+	schedule_len = capture6.count + capture4.count;
+	schedule = vmalloc(schedule_len * sizeof(*schedule));
+	if (!schedule) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the replay order of %u packets.",
+				schedule_len);
+		return -ENOMEM;
+	}
+
+	while (i6 + i4 < schedule_len) {
+		if (i4 >= capture4.count)
+			next = &capture6.packets[i6++];
+		else if (i6 >= capture6.count)
+			next = &capture4.packets[i4++];
+		else if (capture6.packets[i6].timestamp <= capture4.packets[i4].timestamp)
+			next = &capture6.packets[i6++];
+		else
+			next = &capture4.packets[i4++];
+		schedule[i6 + i4 - 1] = next;
+	}
+
+	return 0;
+}
+
+/** Returns true if "packet" is IPv6; IPv4 otherwise. */
+static bool is_ipv6(struct pcap_packet *packet)
+{
+	return (packet->data[0] >> 4) == 6;
+}
+
+/** Creates a sk_buff which contains "packet", as the kernel would hand it to the hooks. */
+static struct sk_buff *build_skb(struct pcap_packet *packet)
+{
+	struct sk_buff *skb;
+
+	skb = alloc_skb(LL_MAX_HEADER + packet->len, GFP_KERNEL);
+	if (!skb) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate a skb.");
+		return NULL;
+	}
+
+	skb_reserve(skb, LL_MAX_HEADER);
+	memcpy(skb_put(skb, packet->len), packet->data, packet->len);
+	skb->protocol = htons(is_ipv6(packet) ? ETH_P_IPV6 : ETH_P_IP);
+	skb_reset_mac_header(skb);
+	skb_reset_network_header(skb);
+
+	return skb;
+}
+
+/**
+ * Takes the packet the impersonator "sent" (if any), accounts it and possibly writes it down.
+ * Returns true if there was one.
+ */
+static bool collect_sent(struct replay_counters *counters, bool write)
+{
+	struct sk_buff *sent = get_sent_skb();
+
+	if (!sent)
+		return false;
+
+	counters->packets_out++;
+	counters->bytes_out += sent->len;
+	if (write && pcap_write_skb(&out, sent))
+		log_warning("Could not write a translated packet to '%s'.", output);
+
+	kfree_skb(sent);
+	set_sent_skb(NULL);
+	return true;
+}
+
+/**
+ * Feeds the whole schedule to core_6to4() and core_4to6(), measuring every call.
+ */
+static bool replay(struct bench_result *result6, struct bench_result *result4,
+		struct replay_counters *counters, bool write)
+{
+	struct pcap_packet *packet;
+	struct sk_buff *skb;
+	struct bench_result *result;
+	ktime_t start, end;
+	unsigned int verdict;
+	unsigned int i;
+
+	for (i = 0; i < schedule_len; i++) {
+		packet = schedule[i];
+		skb = build_skb(packet);
+		if (!skb)
+			return false;
+
+		if (is_ipv6(packet)) {
+			result = result6;
+			start = ktime_get();
+			verdict = core_6to4(skb);
+			end = ktime_get();
+		} else {
+			result = result4;
+			start = ktime_get();
+			verdict = core_4to6(skb);
+			end = ktime_get();
+		}
+		bench_add(result, start, end);
+
+		counters->packets_in++;
+		counters->bytes_in += packet->len;
+		if (verdict != NF_STOLEN)
+			kfree_skb(skb); /* The kernel would have done this. */
+
+		if (!collect_sent(counters, write)) {
+			if (verdict == NF_ACCEPT)
+				counters->accepted++;
+			else
+				counters->other++;
+		}
+
+		if (i % RESCHED_INTERVAL == 0)
+			cond_resched();
+	}
+
+	return true;
+}
+
+static void print_counters(char *name, struct replay_counters *counters,
+		struct bench_result *result6, struct bench_result *result4, u64 wall_ns)
+{
+	u64 core_ns = result6->total_ns + result4->total_ns;
+
+	log_info("Benchmark '%s': %llu packets (%llu bytes) in, %llu packets (%llu bytes) out, "
+			"%llu returned to the kernel, %llu dropped/filtered/stored.", name,
+			counters->packets_in, counters->bytes_in, counters->packets_out,
+			counters->bytes_out, counters->accepted, counters->other);
+
+	if (core_ns == 0 || wall_ns == 0)
+		return;
+	log_info("Benchmark '%s': within core, %llu pps and %llu bytes/sec; overall (counting the "
+			"skb copies), %llu pps.", name,
+			div64_u64(counters->packets_in * NSEC_PER_SEC, core_ns),
+			div64_u64(counters->bytes_in * NSEC_PER_SEC, core_ns),
+			div64_u64(counters->packets_in * NSEC_PER_SEC, wall_ns));
+}
+
+/** Prints how many objects the translator allocated between the two stats_sum()s. */
+static void print_allocations(char *name, struct replay_counters *counters)
+{
+#define DELTA(counter) (stats_after[counter] - stats_before[counter])
+	log_info("Benchmark '%s': allocated %llu input skbs, %llu output packets, %llu BIB entries, "
+			"%llu sessions and %llu stored fragments (%llu allocations failed).", name,
+			counters->packets_in, counters->packets_out, DELTA(STAT_BIB_CREATED),
+			DELTA(STAT_SESSION_CREATED), DELTA(STAT_FRAG_STORED),
+			DELTA(STAT_ALLOC_FAILED));
+#undef DELTA
+}
+
+static bool bench_replay(void)
+{
+	struct bench_result result6, result4;
+	struct replay_counters counters;
+	ktime_t start;
+	u64 wall_ns;
+	unsigned int i;
+
+	bench_init(&result6, "replay, core_6to4");
+	bench_init(&result4, "replay, core_4to6");
+	memset(&counters, 0, sizeof(counters));
+
+	stats_sum(stats_before);
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		if (!replay(&result6, &result4, &counters, output && i == 0))
+			return false;
+		if (i == 0 && output)
+			pcap_close(&out);
+	}
+	wall_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	stats_sum(stats_after);
+
+	bench_print(&result6);
+	bench_print(&result4);
+	print_counters("replay", &counters, &result6, &result4, wall_ns);
+	print_allocations("replay", &counters);
+	return true;
+}
+
+/**
+ * Returns the upper bound of the histogram bucket "permille"/1000 of "stage"'s samples did not
+ * exceed.
+ */
+static u64 latency_percentile(struct latency_us *latency, int stage, u64 count,
+		unsigned int permille)
+{
+	u64 threshold = div64_u64(count * permille + 999, 1000);
+	u64 seen = 0;
+	int i;
+
+	for (i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		seen += latency->histogram[stage][i];
+		if (seen >= threshold)
+			return 1ULL << (i + 1);
+	}
+
+	return 1ULL << LATENCY_BUCKETS;
+}
+
+static bool bench_stages(void)
+{
+	struct bench_result result6, result4;
+	struct replay_counters counters;
+	struct latency_us *latency;
+	u64 count;
+	int stage, i;
+	bool success;
+
+	latency = kmalloc(sizeof(*latency), GFP_KERNEL);
+	if (!latency) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the latency histograms' copy.");
+		return false;
+	}
+
+	bench_init(&result6, "replay (measuring stages), core_6to4");
+	bench_init(&result4, "replay (measuring stages), core_4to6");
+	memset(&counters, 0, sizeof(counters));
+
+	latency_reset();
+	latency_set_enabled(true);
+	success = replay(&result6, &result4, &counters, false);
+	latency_set_enabled(false);
+	latency_sum(latency);
+
+	if (success) {
+		/* This replay finds the state the previous ones left behind. */
+		bench_print(&result6);
+		bench_print(&result4);
+
+		for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+			count = 0;
+			for (i = 0; i < LATENCY_BUCKETS; i++)
+				count += latency->histogram[stage][i];
+			if (count == 0) {
+				log_info("Benchmark '%s': Nothing was measured.", stage_names[stage]);
+				continue;
+			}
+
+			log_info("Benchmark '%s': %llu runs, %llu ns/run, p50 < %llu ns, p99 < %llu ns.",
+					stage_names[stage], count,
+					div64_u64(latency->total_ns[stage], count),
+					latency_percentile(latency, stage, count, 500),
+					latency_percentile(latency, stage, count, 990));
+		}
+	}
+
+	kfree(latency);
+	return success;
+}
+
+static void deinit(void)
+{
+	translate_packet_destroy();
+	filtering_destroy();
+	session_destroy();
+	bib_destroy();
+	changelog_destroy();
+	pool4_destroy();
+	pool6_destroy();
+	fragdb_destroy();
+	pktmod_destroy();
+	latency_destroy();
+	events_destroy();
+	stats_destroy();
+
+	if (out.file)
+		pcap_close(&out);
+	vfree(schedule);
+	pcap_free(&capture4);
+	pcap_free(&capture6);
+}
+
+static int init(void)
+{
+	char *pool6_arr[] = { pool6 };
+	char *pool4_arr[] = { pool4 };
+	int error;
+
+	if (pcap6) {
+		error = pcap_load(pcap6, &capture6);
+		if (error)
+			goto failure;
+	}
+	if (pcap4) {
+		error = pcap_load(pcap4, &capture4);
+		if (error)
+			goto failure;
+	}
+	error = build_schedule();
+	if (error)
+		goto failure;
+	if (output) {
+		error = pcap_create(output, &out);
+		if (error)
+			goto failure;
+	}
+
+	error = stats_init();
+	if (error)
+		goto failure;
+	error = events_init();
+	if (error)
+		goto failure;
+	error = latency_init();
+	if (error)
+		goto failure;
+	error = pktmod_init();
+	if (error)
+		goto failure;
+	error = fragdb_init();
+	if (error)
+		goto failure;
+	error = pool6_init(pool6_arr, ARRAY_SIZE(pool6_arr));
+	if (error)
+		goto failure;
+	error = pool4_init(pool4_arr, ARRAY_SIZE(pool4_arr));
+	if (error)
+		goto failure;
+	error = changelog_init();
+	if (error)
+		goto failure;
+	error = bib_init();
+	if (error)
+		goto failure;
+	error = session_init();
+	if (error)
+		goto failure;
+	error = filtering_init();
+	if (error)
+		goto failure;
+	error = translate_packet_init();
+	if (error)
+		goto failure;
+
+	return 0;
+
+failure:
+	deinit();
+	return error;
+}
+
+static int init_benchmark_module(void)
+{
+	int error;
+
+	if (!pcap6 && !pcap4) {
+		log_err(ERR_UNKNOWN_ERROR, "Please provide at least one capture (pcap6 and/or pcap4).");
+		return -EINVAL;
+	}
+	if (loops == 0) {
+		log_err(ERR_UNKNOWN_ERROR, "loops cannot be zero.");
+		return -EINVAL;
+	}
+
+	error = init();
+	if (error)
+		return error;
+
+	log_info("Benchmark: Replaying %u IPv6-side and %u IPv4-side packets (%u records skipped) "
+			"%u times.", capture6.count, capture4.count,
+			capture6.skipped + capture4.skipped, loops);
+
+	if (!bench_replay() || !bench_stages())
+		error = -EINVAL;
+
+	deinit();
+	log_info("Benchmark finished.");
+	return error;
+}
+
+static void cleanup_benchmark_module(void)
+{
+	/* No code. */
+}
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("NIC-ITESM");
+MODULE_DESCRIPTION("Captured traffic replay benchmark.");
+module_init(init_benchmark_module);
+module_exit(cleanup_benchmark_module);
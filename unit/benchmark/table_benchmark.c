@@ -0,0 +1,395 @@
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/printk.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+
+#include "nat64/unit/benchmark.h"
+#include "nat64/comm/str_utils.h"
+#include "nat64/mod/bib.h"
+#include "nat64/mod/session.h"
+#include "nat64/mod/changelog.h"
+
+
+/*
+ * Measures the BIB and session tables' insertions, lookups and removals while they hold lots of
+ * entries.
+ *
+ * The address distribution mimics a NAT64 serving a large IPv6 network: lots of IPv6 nodes (each
+ * using a few ports), sharing a handful of pool4 addresses, talking to a limited number of IPv4
+ * servers. Usage:
+ *
+ *	sudo insmod tables.ko entries=1000000 pool4_size=64 && sudo rmmod tables
+ *	dmesg | grep Benchmark
+ *
+ * The module links whatever bib.o and session.o are built, so other table implementations can be
+ * compared by building the module against them.
+ */
+
+static unsigned int entries = 100000;
+module_param(entries, uint, 0);
+MODULE_PARM_DESC(entries, "Number of BIB entries (and sessions) to populate the tables with.");
+
+static unsigned int ports_per_node = 8;
+module_param(ports_per_node, uint, 0);
+MODULE_PARM_DESC(ports_per_node, "Number of BIB entries each IPv6 node owns.");
+
+static unsigned int pool4_size = 16;
+module_param(pool4_size, uint, 0);
+MODULE_PARM_DESC(pool4_size, "Number of IPv4 addresses the BIB entries are spread across.");
+
+static unsigned int servers = 1000;
+module_param(servers, uint, 0);
+MODULE_PARM_DESC(servers, "Number of IPv4 nodes the sessions point to.");
+
+
+#define CLIENT_PREFIX "2001:db8::"
+#define POOL4_FIRST_ADDR "192.0.2.0"
+#define SERVER_FIRST_ADDR "198.51.100.0"
+#define NAT64_PREFIX "64:ff9b::"
+#define FIRST_PORT 1024
+#define SERVER_PORT 80
+
+/** Number of ports each pool4 address can lend. */
+#define PORTS_PER_ADDR (65536 - FIRST_PORT)
+/** Relax the CPU every this number of operations; the populations can take a while. */
+#define RESCHED_INTERVAL 1024
+
+static struct in6_addr client_prefix;
+static struct in6_addr nat64_prefix;
+static struct in_addr pool4_first;
+static struct in_addr server_first;
+
+
+/** Computes the addresses of the "index"th BIB entry. */
+static void get_bib_addrs(unsigned int index, struct ipv6_tuple_address *addr6,
+		struct ipv4_tuple_address *addr4)
+{
+	addr6->address = client_prefix;
+	addr6->address.s6_addr32[3] = cpu_to_be32(index / ports_per_node + 1);
+	addr6->l4_id = FIRST_PORT + index % ports_per_node;
+
+	addr4->address.s_addr = htonl(ntohl(pool4_first.s_addr) + index % pool4_size + 1);
+	addr4->l4_id = FIRST_PORT + index / pool4_size;
+}
+
+/** Computes the addresses of the "index"th session, which belongs to the "index"th BIB entry. */
+static void get_session_pairs(unsigned int index, struct ipv6_pair *pair6, struct ipv4_pair *pair4)
+{
+	struct in_addr server;
+
+	server.s_addr = htonl(ntohl(server_first.s_addr) + index % servers + 1);
+
+	get_bib_addrs(index, &pair6->remote, &pair4->local);
+	pair4->remote.address = server;
+	pair4->remote.l4_id = SERVER_PORT;
+	pair6->local.address = nat64_prefix;
+	pair6->local.address.s6_addr32[3] = server.s_addr;
+	pair6->local.l4_id = SERVER_PORT;
+}
+
+/**
+ * Returns a pseudorandom index within [0, entries), so lookups don't walk the trees in order.
+ */
+static unsigned int scramble(unsigned int i)
+{
+	return (unsigned int) (((u64) i * 2654435761U) % entries);
+}
+
+static void relax(unsigned int i)
+{
+	if (i % RESCHED_INTERVAL == 0)
+		cond_resched();
+}
+
+static bool bench_bib_add(void)
+{
+	struct bench_result result;
+	struct ipv6_tuple_address addr6;
+	struct ipv4_tuple_address addr4;
+	struct bib_entry *bib;
+	size_t entry_size = 0;
+	ktime_t start, end;
+	unsigned int i;
+	int error;
+
+	bench_init(&result, "bib_add");
+	for (i = 0; i < entries; i++) {
+		get_bib_addrs(i, &addr6, &addr4);
+		bib = bib_create(&addr4, &addr6, false);
+		if (!bib) {
+			log_err(ERR_ALLOC_FAILED, "Could only allocate %u BIB entries.", i);
+			return false;
+		}
+		if (i == 0)
+			entry_size = ksize(bib);
+
+		spin_lock_bh(&bib_session_lock);
+		start = ktime_get();
+		error = bib_add(bib, L4PROTO_UDP);
+		end = ktime_get();
+		spin_unlock_bh(&bib_session_lock);
+
+		bench_add(&result, start, end);
+		if (error) {
+			result.failures++;
+			bib_kfree(bib);
+		}
+		relax(i);
+	}
+
+	bench_print(&result);
+	log_info("Benchmark 'bib_add': %zu bytes per entry (struct is %zu bytes).", entry_size,
+			sizeof(*bib));
+	return true;
+}
+
+static bool bench_bib_get(bool hit)
+{
+	struct bench_result result6, result4;
+	struct ipv6_tuple_address addr6;
+	struct ipv4_tuple_address addr4;
+	struct bib_entry *bib;
+	ktime_t start, end;
+	unsigned int i;
+	int error;
+
+	bench_init(&result6, hit ? "bib_get_by_ipv6 (hit)" : "bib_get_by_ipv6 (miss)");
+	bench_init(&result4, hit ? "bib_get_by_ipv4 (hit)" : "bib_get_by_ipv4 (miss)");
+
+	for (i = 0; i < entries; i++) {
+		get_bib_addrs(scramble(i), &addr6, &addr4);
+		if (!hit) {
+			addr6.l4_id += ports_per_node; /* This node doesn't use this port. */
+			addr4.address.s_addr = htonl(ntohl(pool4_first.s_addr) + pool4_size + 1);
+		}
+
+		spin_lock_bh(&bib_session_lock);
+		start = ktime_get();
+		error = bib_get_by_ipv6(&addr6, L4PROTO_UDP, &bib);
+		end = ktime_get();
+		bench_add(&result6, start, end);
+		if (hit ? error : (error != -ENOENT))
+			result6.failures++;
+
+		start = ktime_get();
+		error = bib_get_by_ipv4(&addr4, L4PROTO_UDP, &bib);
+		end = ktime_get();
+		bench_add(&result4, start, end);
+		if (hit ? error : (error != -ENOENT))
+			result4.failures++;
+		spin_unlock_bh(&bib_session_lock);
+
+		relax(i);
+	}
+
+	bench_print(&result6);
+	bench_print(&result4);
+	return true;
+}
+
+static bool bench_session_add(void)
+{
+	struct bench_result result;
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+	size_t entry_size = 0;
+	ktime_t start, end;
+	unsigned int i;
+	int error;
+
+	bench_init(&result, "session_add");
+	for (i = 0; i < entries; i++) {
+		get_session_pairs(i, &pair6, &pair4);
+		session = session_create(&pair4, &pair6, L4PROTO_UDP);
+		if (!session) {
+			log_err(ERR_ALLOC_FAILED, "Could only allocate %u sessions.", i);
+			return false;
+		}
+		if (i == 0)
+			entry_size = ksize(session);
+
+		spin_lock_bh(&bib_session_lock);
+		start = ktime_get();
+		error = session_add(session);
+		end = ktime_get();
+		spin_unlock_bh(&bib_session_lock);
+
+		bench_add(&result, start, end);
+		if (error) {
+			result.failures++;
+			session_kfree(session);
+		}
+		relax(i);
+	}
+
+	bench_print(&result);
+	log_info("Benchmark 'session_add': %zu bytes per entry (struct is %zu bytes).",
+			entry_size, sizeof(*session));
+	return true;
+}
+
+static bool bench_session_get(void)
+{
+	struct bench_result result6, result4;
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+	ktime_t start, end;
+	unsigned int i;
+
+	bench_init(&result6, "session_get_by_ipv6");
+	bench_init(&result4, "session_get_by_ipv4");
+
+	for (i = 0; i < entries; i++) {
+		get_session_pairs(scramble(i), &pair6, &pair4);
+
+		spin_lock_bh(&bib_session_lock);
+		start = ktime_get();
+		if (session_get_by_ipv6(&pair6, L4PROTO_UDP, &session))
+			result6.failures++;
+		end = ktime_get();
+		bench_add(&result6, start, end);
+
+		start = ktime_get();
+		if (session_get_by_ipv4(&pair4, L4PROTO_UDP, &session))
+			result4.failures++;
+		end = ktime_get();
+		bench_add(&result4, start, end);
+		spin_unlock_bh(&bib_session_lock);
+
+		relax(i);
+	}
+
+	bench_print(&result6);
+	bench_print(&result4);
+	return true;
+}
+
+static bool bench_remove(void)
+{
+	struct bench_result result_session, result_bib;
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+	struct bib_entry *bib;
+	ktime_t start, end;
+	unsigned int i;
+	int error;
+
+	bench_init(&result_session, "session_remove");
+	bench_init(&result_bib, "bib_remove");
+
+	for (i = 0; i < entries; i++) {
+		get_session_pairs(i, &pair6, &pair4);
+
+		spin_lock_bh(&bib_session_lock);
+
+		if (session_get_by_ipv6(&pair6, L4PROTO_UDP, &session) == 0) {
+			start = ktime_get();
+			error = session_remove(session);
+			end = ktime_get();
+			bench_add(&result_session, start, end);
+			if (error)
+				result_session.failures++;
+			else
+				session_kfree(session);
+		}
+
+		if (bib_get_by_ipv6(&pair6.remote, L4PROTO_UDP, &bib) == 0) {
+			start = ktime_get();
+			error = bib_remove(bib, L4PROTO_UDP);
+			end = ktime_get();
+			bench_add(&result_bib, start, end);
+			if (error)
+				result_bib.failures++;
+			else
+				bib_kfree(bib);
+		}
+
+		spin_unlock_bh(&bib_session_lock);
+		relax(i);
+	}
+
+	bench_print(&result_session);
+	bench_print(&result_bib);
+	return true;
+}
+
+static int init(void)
+{
+	int error;
+
+	if (str_to_addr6(CLIENT_PREFIX, &client_prefix)
+			|| str_to_addr6(NAT64_PREFIX, &nat64_prefix)
+			|| str_to_addr4(POOL4_FIRST_ADDR, &pool4_first)
+			|| str_to_addr4(SERVER_FIRST_ADDR, &server_first))
+		return -EINVAL;
+
+	error = changelog_init();
+	if (error)
+		return error;
+	error = bib_init();
+	if (error) {
+		changelog_destroy();
+		return error;
+	}
+	error = session_init();
+	if (error) {
+		bib_destroy();
+		changelog_destroy();
+		return error;
+	}
+
+	return 0;
+}
+
+static void deinit(void)
+{
+	session_destroy();
+	bib_destroy();
+	changelog_destroy();
+}
+
+static int init_benchmark_module(void)
+{
+	int error;
+
+	if (entries == 0 || ports_per_node == 0 || pool4_size == 0 || servers == 0) {
+		log_err(ERR_UNKNOWN_ERROR, "The parameters cannot be zero.");
+		return -EINVAL;
+	}
+	/* Just like in the real thing, each BIB entry needs its own IPv4 transport address. */
+	if (entries / pool4_size >= PORTS_PER_ADDR) {
+		log_err(ERR_UNKNOWN_ERROR, "%u pool4 addresses cannot hold %u BIB entries; use at least %u.",
+				pool4_size, entries, entries / PORTS_PER_ADDR + 1);
+		return -EINVAL;
+	}
+
+	error = init();
+	if (error)
+		return error;
+
+	log_info("Benchmark: %u entries, %u ports per IPv6 node, %u pool4 addresses, %u servers.",
+			entries, ports_per_node, pool4_size, servers);
+
+	if (!bench_bib_add() || !bench_bib_get(true) || !bench_bib_get(false)
+			|| !bench_session_add() || !bench_session_get() || !bench_remove())
+		error = -EINVAL;
+
+	deinit();
+	log_info("Benchmark finished.");
+	return error;
+}
+
+static void cleanup_benchmark_module(void)
+{
+	/* No code. */
+}
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("NIC-ITESM");
+MODULE_DESCRIPTION("BIB and session tables benchmark.");
+module_init(init_benchmark_module);
+module_exit(cleanup_benchmark_module);
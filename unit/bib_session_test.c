@@ -5,8 +5,11 @@
 #include <linux/slab.h>
 
 #include "nat64/unit/unit_test.h"
+#include "nat64/comm/constants.h"
 #include "nat64/comm/str_utils.h"
 #include "nat64/mod/bib.h"
+#include "nat64/mod/table_query.h"
+#include "nat64/mod/changelog.h"
 #include "session.c"
 
 
@@ -466,6 +469,414 @@ static bool test_for_each_ipv6(void)
 	return success;
 }
 
+static int count_func(struct bib_entry *entry, void *arg)
+{
+	unsigned int *count = arg;
+	(*count)++;
+	return 0;
+}
+
+/**
+ * Counts entries like count_func(), but only accepts two per walk.
+ */
+static int count_two_func(struct bib_entry *entry, void *arg)
+{
+	unsigned int *count = arg;
+
+	if (count[1] == 2)
+		return -ENOSPC;
+
+	count[0]++;
+	count[1]++;
+	return 0;
+}
+
+static bool assert_query(struct table_query *query, unsigned int expected, char *test_name)
+{
+	struct query_cursor cursor;
+	unsigned int count[2] = { 0, 0 };
+	unsigned int walks;
+	int error;
+	bool success = true;
+
+	query_cursor_init(&cursor);
+	success &= assert_equals_int(0, query_bib(L4PROTO_UDP, query, &cursor, count_func, count),
+			test_name);
+	success &= assert_equals_u32(expected, count[0], test_name);
+
+	/* Same thing, except the walk is interrupted and resumed every two entries. */
+	query_cursor_init(&cursor);
+	count[0] = 0;
+	walks = 0;
+	do {
+		count[1] = 0;
+		error = query_bib(L4PROTO_UDP, query, &cursor, count_two_func, count);
+		walks++;
+	} while (error == -ENOSPC && walks <= expected);
+	success &= assert_equals_int(0, error, test_name);
+	success &= assert_equals_u32(expected, count[0], test_name);
+
+	return success;
+}
+
+static bool test_query(void)
+{
+	struct table_query query;
+	bool success = true;
+	int i;
+
+	/* 1.1.1.1#10-19 are ::1#10-14 and ::2#15-19, 2.2.2.2#10-14 are ::3#10-14. */
+	{
+		struct bib_entry *bib;
+		struct ipv4_tuple_address a4;
+		struct ipv6_tuple_address a6;
+
+		for (i = 0; i < 10; i++) {
+			a4.address = addr4[1].address;
+			a4.l4_id = 10 + i;
+			a6.address = addr6[(i < 5) ? 0 : 1].address;
+			a6.l4_id = 10 + i;
+
+			bib = create_and_insert_bib(&a4, &a6, L4PROTO_UDP);
+			if (!bib)
+				return false;
+		}
+
+		for (i = 0; i < 5; i++) {
+			a4.address = addr4[2].address;
+			a4.l4_id = 10 + i;
+			a6.address = addr6[2].address;
+			a6.l4_id = 10 + i;
+
+			bib = create_and_insert_bib(&a4, &a6, L4PROTO_UDP);
+			if (!bib)
+				return false;
+		}
+	}
+
+	memset(&query, 0, sizeof(query));
+	success &= assert_query(&query, 15, "No filters");
+
+	query.flags = QUERY_IPV4_MASK;
+	query.ipv4 = addr4[1].address;
+	success &= assert_query(&query, 10, "IPv4 address");
+
+	query.flags |= QUERY_PORTS_MASK;
+	query.port_min = 12;
+	query.port_max = 15;
+	success &= assert_query(&query, 4, "IPv4 range");
+
+	query.flags = QUERY_PORTS_MASK;
+	query.port_min = 10;
+	query.port_max = 10;
+	success &= assert_query(&query, 2, "Port only");
+
+	query.flags = QUERY_IPV6_MASK;
+	query.ipv6.address = addr6[1].address;
+	query.ipv6.len = 128;
+	success &= assert_query(&query, 5, "IPv6 address");
+
+	query.ipv6.len = 126;
+	success &= assert_query(&query, 15, "IPv6 prefix");
+
+	query.flags |= QUERY_IPV4_MASK;
+	query.ipv4 = addr4[2].address;
+	success &= assert_query(&query, 5, "IPv6 prefix and IPv4 address");
+
+	query.flags = QUERY_IPV4_MASK;
+	query.ipv4 = addr4[1].address;
+	query.offset = 8;
+	success &= assert_query(&query, 2, "Offset");
+
+	query.offset = 0;
+	query.limit = 3;
+	success &= assert_query(&query, 3, "Limit");
+
+	query.offset = 8;
+	success &= assert_query(&query, 2, "Offset and limit");
+
+	return success;
+}
+
+/**
+ * Counts the sessions a walk is handed. If "max" is nonzero, only accepts that many per walk.
+ */
+struct session_count {
+	unsigned int total;
+	unsigned int walk;
+	unsigned int max;
+	/** The last session handed to the callback. */
+	struct session_entry *last;
+};
+
+static int session_count_func(struct session_entry *session, void *arg)
+{
+	struct session_count *count = arg;
+
+	if (count->max && count->walk == count->max)
+		return -ENOSPC;
+
+	count->total++;
+	count->walk++;
+	count->last = session;
+	return 0;
+}
+
+/**
+ * Walks the sessions "query" matches, resuming every "max" sessions (unless "max" is zero).
+ * If "remove" is true, the session the cursor points to is removed before each resume.
+ * Returns the number of sessions visited, or -1 if the walk failed.
+ */
+static int walk_sessions(struct table_query *query, unsigned int max, bool remove)
+{
+	struct query_cursor cursor;
+	struct session_count count = { .total = 0, .max = max, .last = NULL };
+	unsigned int walks = 0;
+	int error;
+
+	query_cursor_init(&cursor);
+	do {
+		if (remove && count.last) {
+			list_del(&count.last->bib_list_hook);
+			if (session_remove(count.last))
+				return -1;
+			session_kfree(count.last);
+			count.last = NULL;
+		}
+
+		count.walk = 0;
+		error = query_session(L4PROTO_UDP, query, &cursor, session_count_func, &count);
+		walks++;
+	} while (error == -ENOSPC && walks <= 100);
+
+	return error ? -1 : count.total;
+}
+
+static bool assert_session_query(struct table_query *query, int expected, char *test_name)
+{
+	bool success = true;
+
+	success &= assert_equals_int(expected, walk_sessions(query, 0, false), test_name);
+	/* Same thing, except the walk is interrupted and resumed every two sessions. */
+	success &= assert_equals_int(expected, walk_sessions(query, 2, false), test_name);
+
+	return success;
+}
+
+/**
+ * Adds a session to "bib", towards "remote4"#"port".
+ */
+static bool add_query_session(struct bib_entry *bib, struct in_addr *remote4, __u16 port)
+{
+	struct ipv4_pair pair4;
+	struct ipv6_pair pair6;
+	struct session_entry *session;
+
+	pair4.local = bib->ipv4;
+	pair4.remote.address = *remote4;
+	pair4.remote.l4_id = port;
+	pair6.remote = bib->ipv6;
+	pair6.local.address = addr6[0].address;
+	pair6.local.l4_id = port;
+
+	session = session_create(&pair4, &pair6, L4PROTO_UDP);
+	if (!session)
+		return false;
+	session->dying_time = jiffies + msecs_to_jiffies(60000);
+	session->bib = bib;
+	list_add(&session->bib_list_hook, &bib->sessions);
+
+	if (session_add(session)) {
+		list_del(&session->bib_list_hook);
+		session_kfree(session);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_query_session(void)
+{
+	struct table_query query;
+	struct bib_entry *bib;
+	struct ipv4_tuple_address a4;
+	struct ipv6_tuple_address a6;
+	/* How many sessions each BIB entry gets. */
+	const unsigned int sessions[] = { 5, 3, 2 };
+	int total;
+	unsigned int i, j;
+	bool success = true;
+
+	/*
+	 * 1.1.1.1#10 is ::1#10 and 1.1.1.1#11 is ::2#11; their sessions go to 2.2.2.2#20-24 and
+	 * 2.2.2.2#20-22. 2.2.2.2#12 is ::3#12, and its sessions go to 1.1.1.1#20-21.
+	 */
+	for (i = 0; i < ARRAY_SIZE(sessions); i++) {
+		a4.address = addr4[(i < 2) ? 1 : 2].address;
+		a4.l4_id = 10 + i;
+		a6.address = addr6[i].address;
+		a6.l4_id = 10 + i;
+
+		bib = create_and_insert_bib(&a4, &a6, L4PROTO_UDP);
+		if (!bib)
+			return false;
+
+		for (j = 0; j < sessions[i]; j++) {
+			if (!add_query_session(bib, &addr4[(i < 2) ? 2 : 1].address, 20 + j))
+				return false;
+		}
+	}
+
+	memset(&query, 0, sizeof(query));
+	success &= assert_session_query(&query, 10, "No filters");
+
+	query.flags = QUERY_IPV4_MASK;
+	query.ipv4 = addr4[1].address;
+	success &= assert_session_query(&query, 8, "IPv4 address");
+
+	query.flags |= QUERY_PORTS_MASK;
+	query.port_min = 11;
+	query.port_max = 11;
+	success &= assert_session_query(&query, 3, "IPv4 range");
+
+	query.flags = QUERY_IPV6_MASK;
+	query.ipv6.address = addr6[0].address;
+	query.ipv6.len = 128;
+	success &= assert_session_query(&query, 5, "IPv6 address");
+
+	query.ipv6.len = 126;
+	success &= assert_session_query(&query, 10, "IPv6 prefix");
+
+	query.flags |= QUERY_IPV4_MASK;
+	query.ipv4 = addr4[2].address;
+	success &= assert_session_query(&query, 2, "IPv6 prefix and IPv4 address");
+
+	query.flags = QUERY_IPV6_MASK;
+	query.offset = 4;
+	query.limit = 3;
+	success &= assert_session_query(&query, 3, "Offset and limit");
+
+	/*
+	 * Resume after the session the cursor points to has died; the rest of the sessions (of its
+	 * BIB entry, too) still have to be visited exactly once.
+	 */
+	query.offset = 0;
+	query.limit = 0;
+	success &= assert_equals_int(10, walk_sessions(&query, 2, true), "Removed cursor (IPv6)");
+
+	query.flags = QUERY_IPV4_MASK;
+	query.ipv4 = addr4[1].address;
+	total = walk_sessions(&query, 0, false);
+	success &= assert_equals_int(total, walk_sessions(&query, 2, true), "Removed cursor (IPv4)");
+
+	return success;
+}
+
+struct change_list {
+	struct change_us changes[4];
+	unsigned int count;
+};
+
+/** The generation the log started at (it's random), so the tests can count from it. */
+static u64 first;
+
+static int collect_func(struct change_us *change, void *arg)
+{
+	struct change_list *list = arg;
+
+	if (list->count >= ARRAY_SIZE(list->changes))
+		return -ENOSPC;
+
+	list->changes[list->count++] = *change;
+	return 0;
+}
+
+static bool assert_change(struct change_us *change, __u32 generation, enum change_table table,
+		enum change_type type, char *test_name)
+{
+	bool success = true;
+
+	success &= assert_equals_u32(generation, change->generation - first, test_name);
+	success &= assert_equals_u8(table, change->table, test_name);
+	success &= assert_equals_u8(type, change->type, test_name);
+	success &= assert_equals_u8(L4PROTO_UDP, change->l4_proto, test_name);
+
+	return success;
+}
+
+static bool test_changelog(void)
+{
+	struct changelog_range_us range;
+	struct change_list list = { .count = 0 };
+	struct bib_entry *bib;
+	struct session_entry *session;
+	u64 since;
+	int i;
+	bool success = true;
+
+	changelog_range(&range);
+	first = range.latest;
+	success &= assert_true(range.oldest == first, "Initial oldest");
+
+	bib = create_and_insert_bib(&addr4[1], &addr6[1], L4PROTO_UDP);
+	if (!bib)
+		return false;
+	session = create_and_insert_session(2, 1, 2, 1, NULL, L4PROTO_UDP, 12345);
+	if (!session)
+		return false;
+	success &= assert_equals_int(0, session_remove(session), "Session removal");
+	session_kfree(session);
+
+	success &= assert_equals_u32(1, bib->generation - first, "BIB's generation");
+
+	since = first + 1;
+	success &= assert_equals_int(0, changelog_for_each(&since, collect_func, &list), "Walk");
+	success &= assert_equals_u32(3, since - first, "Walk's end");
+	success &= assert_equals_u32(2, list.count, "Walk's change count");
+	if (!success)
+		return false;
+	success &= assert_change(&list.changes[0], 2, CHANGE_SESSION, CHANGE_CREATED, "Creation");
+	success &= assert_change(&list.changes[1], 3, CHANGE_SESSION, CHANGE_REMOVED, "Removal");
+	success &= assert_equals_ipv4(&addr4[2].address, &list.changes[1].ipv4.remote.address,
+			"Removal's address");
+
+	list.count = 0;
+	success &= assert_equals_int(0, changelog_for_each(&since, collect_func, &list), "No news");
+	success &= assert_equals_u32(0, list.count, "No news' change count");
+
+	since = first + 4;
+	success &= assert_equals_int(-ESTALE, changelog_for_each(&since, collect_func, &list),
+			"Future generation");
+	since = 1;
+	success &= assert_equals_int(-ESTALE, changelog_for_each(&since, collect_func, &list),
+			"Previous load's generation");
+
+	/* Push the first changes out of the log. */
+	for (i = 0; i < CHANGELOG_SIZE / 2; i++) {
+		success &= assert_equals_int(0, bib_remove(bib, L4PROTO_UDP), "Churn removal");
+		success &= assert_equals_int(0, bib_add(bib, L4PROTO_UDP), "Churn addition");
+		if (!success)
+			return false;
+	}
+
+	changelog_range(&range);
+	success &= assert_equals_u32(3, range.oldest - first, "Oldest after churn");
+	success &= assert_equals_u32(CHANGELOG_SIZE + 3, range.latest - first, "Latest after churn");
+
+	since = first + 2;
+	success &= assert_equals_int(-ESTALE, changelog_for_each(&since, collect_func, &list),
+			"Forgotten generation");
+	since = first + 3;
+	list.count = 0;
+	success &= assert_equals_int(-ENOSPC, changelog_for_each(&since, collect_func, &list),
+			"Interrupted walk");
+	success &= assert_equals_u32(3 + ARRAY_SIZE(list.changes), since - first,
+			"Interrupted walk's end");
+	success &= assert_change(&list.changes[0], 4, CHANGE_BIB, CHANGE_REMOVED, "Churn");
+
+	return success;
+}
+
 /********************************************
  * Main.
  ********************************************/
@@ -486,11 +897,17 @@ static bool init(void)
 		addr6[i].l4_id = IPV6_PORTS[i];
 	}
 
-	if (is_error(bib_init()))
+	if (is_error(changelog_init()))
 		return false;
 
+	if (is_error(bib_init())) {
+		changelog_destroy();
+		return false;
+	}
+
 	if (is_error(session_init())) {
 		bib_destroy();
+		changelog_destroy();
 		return false;
 	}
 
@@ -501,6 +918,7 @@ static void end(void)
 {
 	session_destroy();
 	bib_destroy();
+	changelog_destroy();
 }
 
 int init_module(void)
@@ -511,6 +929,9 @@ int init_module(void)
 	INIT_CALL_END(init(), simple_session(), end(), "Single Session");
 	INIT_CALL_END(init(), test_address_filtering(), end(), "Address-dependent filtering.");
 	INIT_CALL_END(init(), test_for_each_ipv6(), end(), "for-each-IPv6 function.");
+	INIT_CALL_END(init(), test_query(), end(), "Table queries.");
+	INIT_CALL_END(init(), test_query_session(), end(), "Session queries.");
+	INIT_CALL_END(init(), test_changelog(), end(), "Change log.");
 
 	END_TESTS;
 }
@@ -3,6 +3,7 @@
 
 #include "nat64/unit/unit_test.h"
 #include "nat64/comm/str_utils.h"
+#include "nat64/mod/changelog.h"
 #include "compute_outgoing_tuple.c"
 
 
@@ -96,6 +97,8 @@ static bool init(void)
 	prefix.len = 96;
 
 	/* Init the BIB module */
+	if (is_error(changelog_init()))
+		return false;
 	if (is_error(bib_init()))
 		return false;
 
@@ -112,6 +115,7 @@ static bool init(void)
 static void cleanup(void)
 {
 	bib_destroy();
+	changelog_destroy();
 	pool6_destroy();
 }
 
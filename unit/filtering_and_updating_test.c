@@ -395,6 +395,127 @@ static noinline bool test_udp(void)
 	return success;
 }
 
+/**
+ * Translates a IPv6-UDP packet from "src6"#"src_port" to "dst6"#3434, and asserts the verdict.
+ */
+static noinline bool translate_udp6(char *src6, u16 src_port, char *dst6, verdict expected,
+		char *test_name)
+{
+	struct fragment *frag;
+	struct sk_buff *skb;
+	struct tuple tuple;
+	struct ipv6_pair pair6;
+	bool success;
+
+	if (is_error(init_pair6(&pair6, src6, src_port, dst6, 3434)))
+		return false;
+	if (is_error(init_ipv6_tuple_from_pair(&tuple, &pair6, L4PROTO_UDP)))
+		return false;
+	if (is_error(create_skb_ipv6_udp(&pair6, &skb, 16)))
+		return false;
+	if (is_error(frag_create_from_skb(skb, &frag)))
+		return false;
+
+	success = assert_equals_int(expected, ipv6_udp(frag, &tuple), test_name);
+
+	frag_kfree(frag);
+	return success;
+}
+
+static noinline bool assert_stat(u32 expected, enum stat_counter counter, char *test_name)
+{
+	__u64 counters[STAT_COUNT];
+
+	stats_sum(counters);
+	return assert_equals_u32(expected, counters[counter], test_name);
+}
+
+static noinline bool test_limits(void)
+{
+	bool success = true;
+
+	config->max.bib_per_node = 1;
+
+	success &= translate_udp6("1::2", 1212, "3::4", VER_CONTINUE, "first BIB of the node");
+	success &= translate_udp6("1::2", 1213, "3::4", VER_DROP, "second BIB of the node");
+	success &= translate_udp6("1::3", 1212, "3::4", VER_CONTINUE, "first BIB of another node");
+	success &= assert_bib_count(2, L4PROTO_UDP);
+	success &= assert_session_count(2, L4PROTO_UDP);
+	success &= assert_stat(1, STAT_BIB_LIMIT, "BIB limit counter");
+
+	config->max.bib_per_node = 0;
+	config->max.session = 2;
+
+	/* Existing BIB, new session. */
+	success &= translate_udp6("1::2", 1212, "3::5", VER_DROP, "third session");
+	/* Existing session. */
+	success &= translate_udp6("1::2", 1212, "3::4", VER_CONTINUE, "existing session");
+	success &= assert_bib_count(2, L4PROTO_UDP);
+	success &= assert_session_count(2, L4PROTO_UDP);
+	success &= assert_stat(1, STAT_SESSION_LIMIT, "session limit counter");
+
+	return success;
+}
+
+static noinline bool test_eviction(void)
+{
+	bool success = true;
+
+	config->max.session_evict = 2;
+
+	success &= translate_udp6("1::2", 1212, "3::4", VER_CONTINUE, "first session");
+	success &= translate_udp6("1::3", 1212, "3::4", VER_CONTINUE, "second session");
+	success &= assert_session_count(2, L4PROTO_UDP);
+
+	/* The idlest session (and its BIB entry) makes room for the new one. */
+	success &= translate_udp6("1::4", 1212, "3::4", VER_CONTINUE, "third session");
+	success &= assert_bib_count(2, L4PROTO_UDP);
+	success &= assert_session_count(2, L4PROTO_UDP);
+	success &= assert_stat(1, STAT_SESSION_EVICTED, "eviction counter");
+
+	/* A session can evict its BIB's only other session without losing the BIB entry. */
+	success &= translate_udp6("1::3", 1212, "3::5", VER_CONTINUE, "second session's sibling");
+	success &= assert_bib_count(2, L4PROTO_UDP);
+	success &= assert_session_count(2, L4PROTO_UDP);
+	success &= assert_stat(2, STAT_SESSION_EVICTED, "eviction counter 2");
+
+	return success;
+}
+
+static noinline bool test_flush(void)
+{
+	struct ipv6_prefix prefix;
+	struct ipv6_tuple_address addr6;
+	struct bib_entry *bib;
+	struct flush_count_us count = { .bib = 0, .session = 0 };
+	bool success = true;
+
+	success &= translate_udp6("1::2", 1212, "3::4", VER_CONTINUE, "node 1, first session");
+	success &= translate_udp6("1::2", 1212, "3::5", VER_CONTINUE, "node 1, second session");
+	success &= translate_udp6("1::2", 1213, "3::4", VER_CONTINUE, "node 1, second BIB");
+	success &= translate_udp6("1::3", 1212, "3::4", VER_CONTINUE, "node 2");
+	success &= assert_bib_count(3, L4PROTO_UDP);
+	success &= assert_session_count(4, L4PROTO_UDP);
+
+	if (!str_to_addr6_verbose("1::2", &prefix.address))
+		return false;
+	prefix.len = 128;
+
+	success &= assert_equals_int(0, filtering_flush(L4PROTO_UDP, &prefix, &count), "result");
+	success &= assert_equals_u32(2, count.bib, "removed BIBs");
+	success &= assert_equals_u32(3, count.session, "removed sessions");
+	success &= assert_bib_count(1, L4PROTO_UDP);
+	success &= assert_session_count(1, L4PROTO_UDP);
+
+	/* The other node is untouched. */
+	if (!str_to_addr6_verbose("1::3", &addr6.address))
+		return false;
+	addr6.l4_id = 1212;
+	success &= assert_equals_int(0, bib_get_by_ipv6(&addr6, L4PROTO_UDP, &bib), "survivor");
+
+	return success;
+}
+
 static noinline bool test_icmp(void)
 {
 	struct fragment *frag6, *frag4;
@@ -1124,11 +1245,211 @@ static noinline bool test_tcp(void)
 	return success;
 }
 
+static noinline bool test_tcp_deferred(void)
+{
+	bool success = true;
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct tuple tuple6;
+	struct tuple tuple4;
+	struct fragment *frag;
+	struct bib_entry *bib;
+
+	if (is_error(init_pair6(&pair6, "1::2", 1212, "3::4", 3434)))
+		return false;
+	if (is_error(init_ipv6_tuple_from_pair(&tuple6, &pair6, L4PROTO_TCP)))
+		return false;
+	if (is_error(init_pair4(&pair4, "0.0.0.4", 3434, "192.168.2.1", 1024)))
+		return false;
+	if (is_error(init_ipv4_tuple_from_pair(&tuple4, &pair4, L4PROTO_TCP)))
+		return false;
+
+	/* Static BIB entry the IPv4 node will connect to. */
+	bib = bib_create(&pair4.local, &pair6.remote, true);
+	if (!bib)
+		return false;
+	if (is_error(bib_add(bib, L4PROTO_TCP))) {
+		bib_kfree(bib);
+		return false;
+	}
+
+	config->defer_external_tcp = true;
+
+	/* V4 SYN; it goes through, but no session is created. */
+	if (!create_tcp_packet(&frag, L3PROTO_IPV4, true, false, false))
+		return false;
+	success &= assert_equals_int(VER_CONTINUE, tcp(frag, &tuple4), "V4 syn-result");
+	success &= assert_session_count(0, L4PROTO_TCP);
+	success &= assert_stat(1, STAT_SYN_PENDING, "pending counter");
+	frag_kfree(frag);
+
+	/* V6 SYN; the answer creates the session, and the handshake is already complete. */
+	if (!create_tcp_packet(&frag, L3PROTO_IPV6, true, false, false))
+		return false;
+	success &= assert_equals_int(VER_CONTINUE, tcp(frag, &tuple6), "V6 syn-result");
+	success &= assert_bib_count(1, L4PROTO_TCP);
+	success &= assert_session_count(1, L4PROTO_TCP);
+	success &= assert_session_exists("1::2", 1212, "3::4", 3434,
+			"192.168.2.1", 1024, "0.0.0.4", 3434,
+			L4PROTO_TCP, ESTABLISHED);
+	frag_kfree(frag);
+
+	return success;
+}
+
+/**
+ * A V4 SYN arrives before the V6 node opens the connection; it is stored, not translated.
+ * Once the V6 SYN creates the session, the retransmitted V4 SYN completes the handshake.
+ */
+static noinline bool test_tcp_stored(void)
+{
+	bool success = true;
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct tuple tuple6;
+	struct tuple tuple4;
+	struct fragment *frag;
+
+	if (is_error(init_pair6(&pair6, "1::2", 1212, "3::4", 3434)))
+		return false;
+	if (is_error(init_ipv6_tuple_from_pair(&tuple6, &pair6, L4PROTO_TCP)))
+		return false;
+	if (is_error(init_pair4(&pair4, "0.0.0.4", 3434, "192.168.2.1", 1024)))
+		return false;
+	if (is_error(init_ipv4_tuple_from_pair(&tuple4, &pair4, L4PROTO_TCP)))
+		return false;
+
+	/* V4 SYN, and then its retransmission; only one of them is kept. */
+	if (!create_tcp_packet(&frag, L3PROTO_IPV4, true, false, false))
+		return false;
+	success &= assert_equals_int(VER_DROP, tcp(frag, &tuple4), "V4 syn-result");
+	success &= assert_equals_int(VER_DROP, tcp(frag, &tuple4), "V4 syn-retransmission");
+	success &= assert_session_count(0, L4PROTO_TCP);
+	success &= assert_stat(1, STAT_SYN_STORED, "stored counter");
+	success &= assert_stat(0, STAT_TCP_V4_SYN, "drop counter");
+	frag_kfree(frag);
+
+	/* V6 SYN */
+	if (!create_tcp_packet(&frag, L3PROTO_IPV6, true, false, false))
+		return false;
+	success &= assert_equals_int(VER_CONTINUE, tcp(frag, &tuple6), "V6 syn-result");
+	frag_kfree(frag);
+
+	/* V4 SYN again. */
+	if (!create_tcp_packet(&frag, L3PROTO_IPV4, true, false, false))
+		return false;
+	success &= assert_equals_int(VER_CONTINUE, tcp(frag, &tuple4), "V4 syn-result 2");
+	success &= assert_session_exists("1::2", 1212, "3::4", 3434,
+			"192.168.2.1", 1024, "0.0.0.4", 3434,
+			L4PROTO_TCP, ESTABLISHED);
+	frag_kfree(frag);
+
+	return success;
+}
+
+/**
+ * Installs, updates and removes a session the way an HA peer would tell us to.
+ */
+static noinline bool test_sync(void)
+{
+	struct sync_session records[2];
+	struct ipv6_pair pair6;
+	struct ipv4_pair pair4;
+	struct session_entry *session;
+	bool success = true;
+
+	memset(records, 0, sizeof(records));
+	records[0].type = SYNC_SESSION_UPDATE;
+	records[0].l4_proto = L4PROTO_TCP;
+	records[0].state = V6_INIT;
+	records[0].lifetime = cpu_to_be32(60000);
+	if (!str_to_addr6_verbose("1::2", &records[0].remote6))
+		return false;
+	if (!str_to_addr6_verbose("3::4", &records[0].local6))
+		return false;
+	if (!str_to_addr4_verbose("192.168.2.1", &records[0].local4))
+		return false;
+	if (!str_to_addr4_verbose("0.0.0.4", &records[0].remote4))
+		return false;
+	records[0].remote6_port = cpu_to_be16(1212);
+	records[0].local6_port = cpu_to_be16(3434);
+	records[0].local4_port = cpu_to_be16(1024);
+	records[0].remote4_port = cpu_to_be16(3434);
+
+	/* Same IPv6 node, different IPv4 transport address; it cannot have two. */
+	records[1] = records[0];
+	records[1].local4_port = cpu_to_be16(1025);
+
+	filtering_sync(records, 2);
+	success &= assert_bib_exists("1::2", 1212, "192.168.2.1", 1024, L4PROTO_TCP, 1);
+	success &= assert_session_exists("1::2", 1212, "3::4", 3434,
+			"192.168.2.1", 1024, "0.0.0.4", 3434,
+			L4PROTO_TCP, V6_INIT);
+	success &= assert_stat(1, STAT_SYNC_APPLIED, "applied counter");
+	success &= assert_stat(1, STAT_SYNC_REJECTED, "rejected counter");
+
+	/* The handshake finished on the peer. */
+	records[0].state = ESTABLISHED;
+	filtering_sync(records, 1);
+	success &= assert_session_count(1, L4PROTO_TCP);
+	success &= assert_session_exists("1::2", 1212, "3::4", 3434,
+			"192.168.2.1", 1024, "0.0.0.4", 3434,
+			L4PROTO_TCP, ESTABLISHED);
+
+	/* The peer cannot keep the session alive for longer than we would. */
+	records[0].lifetime = cpu_to_be32(0xFFFFFFFFU);
+	filtering_sync(records, 1);
+	record_to_pairs(&records[0], &pair6, &pair4);
+	if (!assert_equals_int(0, session_get_by_ipv6(&pair6, L4PROTO_TCP, &session), "Synced session"))
+		return false;
+	success &= assert_true(!time_after(session->dying_time, jiffies + config->to.tcp_est),
+			"Synced lifetime is capped");
+	records[0].lifetime = cpu_to_be32(60000);
+
+	/* Nonsense is refused. */
+	records[1] = records[0];
+	records[1].state = 200;
+	filtering_sync(&records[1], 1);
+	success &= assert_stat(2, STAT_SYNC_REJECTED, "rejected counter 2");
+
+	/* The connection ended; the dynamic BIB entry goes with it. */
+	records[0].type = SYNC_SESSION_REMOVE;
+	filtering_sync(records, 1);
+	success &= assert_session_count(0, L4PROTO_TCP);
+	success &= assert_bib_count(0, L4PROTO_TCP);
+	success &= assert_stat(3, STAT_SYNC_APPLIED, "applied counter 2");
+
+	/* The peer's sessions count towards our limits too. */
+	config->max.session_per_node = 1;
+	records[0].type = SYNC_SESSION_UPDATE;
+	records[1] = records[0];
+	if (!str_to_addr6_verbose("3::5", &records[1].local6))
+		return false;
+	if (!str_to_addr4_verbose("0.0.0.5", &records[1].remote4))
+		return false;
+	filtering_sync(records, 2);
+	config->max.session_per_node = 0;
+	success &= assert_session_count(1, L4PROTO_TCP);
+	success &= assert_stat(1, STAT_SESSION_LIMIT, "session limit counter");
+	success &= assert_stat(3, STAT_SYNC_REJECTED, "rejected counter 3");
+
+	return success;
+}
+
 static noinline bool init_full(void)
 {
 	char *prefixes[] = { "3::/96" };
 	int error;
 
+	error = stats_init();
+	if (error)
+		goto fail;
+	error = events_init();
+	if (error)
+		goto fail;
+	error = changelog_init();
+	if (error)
+		goto fail;
 	error = pktmod_init();
 	if (error)
 		goto fail;
@@ -1156,6 +1477,12 @@ fail:
 
 static noinline bool init_filtering_only(void)
 {
+	if (is_error(stats_init()))
+		return false;
+	if (is_error(events_init()))
+		return false;
+	if (is_error(changelog_init()))
+		return false;
 	if (is_error(pktmod_init()))
 		return false;
 	if (is_error(filtering_init()))
@@ -1172,12 +1499,18 @@ static void end_full(void)
 	pool4_destroy();
 	pool6_destroy();
 	pktmod_destroy();
+	changelog_destroy();
+	events_destroy();
+	stats_destroy();
 }
 
 static void end_filtering_only(void)
 {
 	filtering_destroy();
 	pktmod_destroy();
+	changelog_destroy();
+	events_destroy();
+	stats_destroy();
 }
 
 #define TEST_FILTERING_ONLY(fn, name) \
@@ -1196,6 +1529,11 @@ static int __init filtering_test_init(void)
 	/* ICMP */
 	INIT_CALL_END(init_full(), test_icmp(), end_full(), "ICMP");
 
+	/* Limits */
+	INIT_CALL_END(init_full(), test_limits(), end_full(), "limits");
+	INIT_CALL_END(init_full(), test_eviction(), end_full(), "eviction");
+	INIT_CALL_END(init_full(), test_flush(), end_full(), "flush");
+
 	/* TCP */
 	/* CALL_TEST(test_send_probe_packet(), "test_send_probe_packet"); */
 	INIT_CALL_END(init_full(), test_tcp_closed_state_handle_6(), end_full(), "TCP-CLOSED-6");
@@ -1219,6 +1557,11 @@ static int __init filtering_test_init(void)
 	TEST_FILTERING_ONLY(test_tcp_trans_state_handle_v4rst(), "TCP-TRANS-V4 rst");
 	TEST_FILTERING_ONLY(test_tcp_trans_state_handle_else(), "TCP-TRANS-else");
 	INIT_CALL_END(init_full(), test_tcp(), end_full(), "test_tcp");
+	INIT_CALL_END(init_full(), test_tcp_deferred(), end_full(), "deferred TCP");
+	INIT_CALL_END(init_full(), test_tcp_stored(), end_full(), "stored TCP");
+
+	/* Session synchronization */
+	INIT_CALL_END(init_full(), test_sync(), end_full(), "sync");
 
 	END_TESTS;
 }
@@ -940,10 +940,15 @@ int init_module(void)
 {
 	START_TESTS("Fragment database");
 
-	if (is_error(pktmod_init()))
+	if (is_error(stats_init()))
 		return -EINVAL;
+	if (is_error(pktmod_init())) {
+		stats_destroy();
+		return -EINVAL;
+	}
 	if (is_error(fragdb_init())) {
 		pktmod_destroy();
+		stats_destroy();
 		return -EINVAL;
 	}
 
@@ -959,6 +964,7 @@ int init_module(void)
 
 	fragdb_destroy();
 	pktmod_destroy();
+	stats_destroy();
 
 	END_TESTS;
 }
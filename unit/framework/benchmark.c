@@ -0,0 +1,103 @@
+#include "nat64/unit/benchmark.h"
+#include "nat64/comm/types.h"
+
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/string.h>
+#include <linux/math64.h>
+
+
+#define SUB_MASK ((1 << BENCH_SUB_BITS) - 1)
+
+static unsigned int ns_to_bucket(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns <= SUB_MASK)
+		return ns;
+
+	msb = fls64(ns) - 1;
+	return ((msb - BENCH_SUB_BITS + 1) << BENCH_SUB_BITS)
+			+ ((ns >> (msb - BENCH_SUB_BITS)) & SUB_MASK);
+}
+
+/** Returns the smallest duration which would land in bucket "bucket". */
+static u64 bucket_to_ns(unsigned int bucket)
+{
+	unsigned int msb;
+
+	if (bucket <= SUB_MASK)
+		return bucket;
+
+	msb = (bucket >> BENCH_SUB_BITS) + BENCH_SUB_BITS - 1;
+	return ((u64) ((1 << BENCH_SUB_BITS) | (bucket & SUB_MASK))) << (msb - BENCH_SUB_BITS);
+}
+
+void bench_init(struct bench_result *result, char *name)
+{
+	memset(result, 0, sizeof(*result));
+	result->name = name;
+	result->min_ns = ~((u64) 0);
+}
+
+void bench_add(struct bench_result *result, ktime_t start, ktime_t end)
+{
+	u64 ns = ktime_to_ns(ktime_sub(end, start));
+
+	result->count++;
+	result->total_ns += ns;
+	if (ns < result->min_ns)
+		result->min_ns = ns;
+	if (ns > result->max_ns)
+		result->max_ns = ns;
+	result->histogram[ns_to_bucket(ns)]++;
+}
+
+void bench_merge(struct bench_result *result, struct bench_result *other)
+{
+	unsigned int i;
+
+	result->count += other->count;
+	result->failures += other->failures;
+	result->total_ns += other->total_ns;
+	result->min_ns = min(result->min_ns, other->min_ns);
+	result->max_ns = max(result->max_ns, other->max_ns);
+	for (i = 0; i < BENCH_BUCKETS; i++)
+		result->histogram[i] += other->histogram[i];
+}
+
+u64 bench_percentile(struct bench_result *result, unsigned int permille)
+{
+	u64 threshold = div64_u64(result->count * permille + 999, 1000);
+	u64 seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < BENCH_BUCKETS; i++) {
+		seen += result->histogram[i];
+		if (seen >= threshold && seen > 0)
+			return min(bucket_to_ns(i), result->max_ns);
+	}
+
+	return result->max_ns;
+}
+
+void bench_print(struct bench_result *result)
+{
+	u64 avg_ns;
+	u64 per_second;
+
+	if (result->count == 0 || result->total_ns == 0) {
+		log_info("Benchmark '%s': Nothing was measured.", result->name);
+		return;
+	}
+
+	avg_ns = div64_u64(result->total_ns, result->count);
+	per_second = div64_u64(result->count * NSEC_PER_SEC, result->total_ns);
+
+	log_info("Benchmark '%s': %llu runs (%llu failed), %llu ns/run (min %llu, max %llu), "
+			"%llu runs/sec.", result->name, result->count, result->failures, avg_ns,
+			result->min_ns, result->max_ns, per_second);
+	log_info("Benchmark '%s': p50 %llu ns, p90 %llu ns, p99 %llu ns, p99.9 %llu ns.",
+			result->name, bench_percentile(result, 500), bench_percentile(result, 900),
+			bench_percentile(result, 990), bench_percentile(result, 999));
+}
@@ -16,6 +16,11 @@ struct dst_entry *route_ipv6(struct ipv6hdr *hdr_ip, void *l4_hdr, l4_protocol l
 	return NULL;
 }
 
+u32 route6_cookie(struct dst_entry *dst)
+{
+	return 0;
+}
+
 verdict send_pkt(struct packet *pkt)
 {
 	log_debug("Step 6: Pretending I'm sending packet %p...", pkt);
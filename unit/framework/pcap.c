@@ -0,0 +1,370 @@
+#include "nat64/unit/pcap.h"
+#include "nat64/comm/types.h"
+
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/err.h>
+#include <linux/time.h>
+#include <linux/if_ether.h>
+#include <asm/uaccess.h>
+
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+
+#define ETH_P_8021Q_HLEN 4
+#define SLL_HLEN 16
+
+struct pcap_global_hdr {
+	__u32 magic;
+	__u16 version_major;
+	__u16 version_minor;
+	__s32 thiszone;
+	__u32 sigfigs;
+	__u32 snaplen;
+	__u32 linktype;
+};
+
+struct pcap_record_hdr {
+	__u32 ts_sec;
+	__u32 ts_frac;
+	__u32 incl_len;
+	__u32 orig_len;
+};
+
+/**
+ * kernel_read() and kernel_write() only accept kernel buffers (and take the offset by pointer)
+ * since Linux 4.14; before that, the VFS functions have to be told the buffer is not userspace's.
+ */
+static ssize_t file_read(struct file *file, void *buf, size_t count, loff_t *pos)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+	return kernel_read(file, buf, count, pos);
+#else
+	mm_segment_t old_fs = get_fs();
+	ssize_t result;
+
+	set_fs(KERNEL_DS);
+	result = vfs_read(file, (char __user *) buf, count, pos);
+	set_fs(old_fs);
+	return result;
+#endif
+}
+
+static ssize_t file_write(struct file *file, void *buf, size_t count, loff_t *pos)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+	return kernel_write(file, buf, count, pos);
+#else
+	mm_segment_t old_fs = get_fs();
+	ssize_t result;
+
+	set_fs(KERNEL_DS);
+	result = vfs_write(file, (const char __user *) buf, count, pos);
+	set_fs(old_fs);
+	return result;
+#endif
+}
+
+static int read_whole_file(char *path, unsigned char **result, size_t *result_len)
+{
+	struct file *file;
+	unsigned char *buffer;
+	loff_t size, pos = 0;
+	ssize_t bytes;
+	int error = 0;
+
+	file = filp_open(path, O_RDONLY, 0);
+	if (IS_ERR(file)) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not open '%s' (error %ld).", path, PTR_ERR(file));
+		return PTR_ERR(file);
+	}
+
+	size = i_size_read(file->f_path.dentry->d_inode);
+	buffer = vmalloc(size);
+	if (!buffer) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate %lld bytes for '%s'.", size, path);
+		error = -ENOMEM;
+		goto end;
+	}
+
+	while (pos < size) {
+		bytes = file_read(file, buffer + pos, size - pos, &pos);
+		if (bytes <= 0) {
+			log_err(ERR_UNKNOWN_ERROR, "Could not read '%s' (error %zd).", path, bytes);
+			vfree(buffer);
+			error = bytes ? bytes : -EIO;
+			goto end;
+		}
+	}
+
+	*result = buffer;
+	*result_len = size;
+	/* Fall through. */
+
+end:
+	filp_close(file, NULL);
+	return error;
+}
+
+/**
+ * Finds the layer-3 packet within "frame", whose layer-2 header is described by "linktype".
+ * Returns false if the frame does not contain IPv4 or IPv6.
+ */
+static bool strip_l2(__u32 linktype, unsigned char **frame, u32 *len)
+{
+	__be16 proto;
+	unsigned int offset;
+
+	switch (linktype) {
+	case LINKTYPE_RAW:
+	case LINKTYPE_IPV4:
+	case LINKTYPE_IPV6:
+		offset = 0;
+		break;
+
+	case LINKTYPE_ETHERNET:
+		if (*len < ETH_HLEN)
+			return false;
+		offset = ETH_HLEN;
+		proto = ((struct ethhdr *) *frame)->h_proto;
+		if (proto == cpu_to_be16(ETH_P_8021Q)) {
+			if (*len < ETH_HLEN + ETH_P_8021Q_HLEN)
+				return false;
+			proto = *((__be16 *) (*frame + ETH_HLEN + 2));
+			offset += ETH_P_8021Q_HLEN;
+		}
+		if (proto != cpu_to_be16(ETH_P_IP) && proto != cpu_to_be16(ETH_P_IPV6))
+			return false;
+		break;
+
+	case LINKTYPE_LINUX_SLL:
+		if (*len < SLL_HLEN)
+			return false;
+		offset = SLL_HLEN;
+		proto = *((__be16 *) (*frame + 14));
+		if (proto != cpu_to_be16(ETH_P_IP) && proto != cpu_to_be16(ETH_P_IPV6))
+			return false;
+		break;
+
+	default:
+		return false;
+	}
+
+	if (*len <= offset)
+		return false;
+	*frame += offset;
+	*len -= offset;
+
+	/* Whatever the link type claims, the packet has to agree. */
+	switch ((*frame)[0] >> 4) {
+	case 4:
+	case 6:
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Walks the records of the capture whose contents are "buffer". If "pcap"->packets is not NULL,
+ * the IP packets are stored in it; otherwise they are only counted.
+ */
+static int parse_records(unsigned char *buffer, size_t len, struct pcap_file *pcap)
+{
+	struct pcap_global_hdr *global = (struct pcap_global_hdr *) buffer;
+	struct pcap_record_hdr *record;
+	bool swapped, nsec;
+	__u32 linktype;
+	size_t offset;
+	unsigned char *data;
+	u32 data_len, incl_len, orig_len;
+	u64 frac;
+
+	if (len < sizeof(*global)) {
+		log_err(ERR_UNKNOWN_ERROR, "The file is too short to be a capture.");
+		return -EINVAL;
+	}
+
+	switch (global->magic) {
+	case PCAP_MAGIC:
+		swapped = false;
+		nsec = false;
+		break;
+	case PCAP_MAGIC_NSEC:
+		swapped = false;
+		nsec = true;
+		break;
+	case ___constant_swab32(PCAP_MAGIC):
+		swapped = true;
+		nsec = false;
+		break;
+	case ___constant_swab32(PCAP_MAGIC_NSEC):
+		swapped = true;
+		nsec = true;
+		break;
+	default:
+		log_err(ERR_UNKNOWN_ERROR, "Unknown capture magic number: 0x%x. (pcapng is not "
+				"supported; try 'editcap -F pcap'.)", global->magic);
+		return -EINVAL;
+	}
+
+#define FIELD(x) (swapped ? swab32(x) : (x))
+	linktype = FIELD(global->linktype);
+	pcap->count = 0;
+	pcap->skipped = 0;
+
+	for (offset = sizeof(*global); offset + sizeof(*record) <= len; offset += incl_len) {
+		record = (struct pcap_record_hdr *) (buffer + offset);
+		offset += sizeof(*record);
+		incl_len = FIELD(record->incl_len);
+		orig_len = FIELD(record->orig_len);
+
+		if (offset + incl_len > len) {
+			log_warning("The last record of the capture is incomplete; ignoring it.");
+			pcap->skipped++;
+			break;
+		}
+
+		data = buffer + offset;
+		data_len = incl_len;
+		if (incl_len < orig_len || !strip_l2(linktype, &data, &data_len)) {
+			pcap->skipped++;
+			continue;
+		}
+
+		if (pcap->packets) {
+			frac = FIELD(record->ts_frac);
+			pcap->packets[pcap->count].timestamp = (u64) FIELD(record->ts_sec) * NSEC_PER_SEC
+					+ (nsec ? frac : frac * NSEC_PER_USEC);
+			pcap->packets[pcap->count].data = data;
+			pcap->packets[pcap->count].len = data_len;
+		}
+		pcap->count++;
+	}
+#undef FIELD
+
+	return 0;
+}
+
+int pcap_load(char *path, struct pcap_file *pcap)
+{
+	size_t len;
+	int error;
+
+	memset(pcap, 0, sizeof(*pcap));
+
+	error = read_whole_file(path, &pcap->buffer, &len);
+	if (error)
+		return error;
+
+	/* Count first, then store. */
+	error = parse_records(pcap->buffer, len, pcap);
+	if (error)
+		goto fail;
+	if (pcap->count == 0) {
+		log_err(ERR_UNKNOWN_ERROR, "'%s' does not contain any IP packets.", path);
+		error = -EINVAL;
+		goto fail;
+	}
+
+	pcap->packets = vmalloc(pcap->count * sizeof(*pcap->packets));
+	if (!pcap->packets) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the index of %u packets.", pcap->count);
+		error = -ENOMEM;
+		goto fail;
+	}
+	error = parse_records(pcap->buffer, len, pcap);
+	if (error)
+		goto fail;
+
+	return 0;
+
+fail:
+	pcap_free(pcap);
+	return error;
+}
+
+void pcap_free(struct pcap_file *pcap)
+{
+	vfree(pcap->packets);
+	vfree(pcap->buffer);
+	memset(pcap, 0, sizeof(*pcap));
+}
+
+int pcap_create(char *path, struct pcap_output *output)
+{
+	struct pcap_global_hdr global = {
+			.magic = PCAP_MAGIC_NSEC,
+			.version_major = 2,
+			.version_minor = 4,
+			.thiszone = 0,
+			.sigfigs = 0,
+			.snaplen = 65535,
+			.linktype = LINKTYPE_RAW,
+	};
+
+	output->file = filp_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (IS_ERR(output->file)) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not create '%s' (error %ld).", path,
+				PTR_ERR(output->file));
+		return PTR_ERR(output->file);
+	}
+	output->pos = 0;
+
+	if (file_write(output->file, &global, sizeof(global), &output->pos) != sizeof(global)) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not write to '%s'.", path);
+		pcap_close(output);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * Appends "skb" to "output", starting from its layer-3 header.
+ */
+int pcap_write_skb(struct pcap_output *output, struct sk_buff *skb)
+{
+	struct pcap_record_hdr record;
+	struct timespec now;
+	unsigned char *buffer;
+	u32 len = skb->len - skb_network_offset(skb);
+	int error = 0;
+
+	buffer = kmalloc(len, GFP_KERNEL);
+	if (!buffer)
+		return -ENOMEM;
+	if (skb_copy_bits(skb, skb_network_offset(skb), buffer, len)) {
+		error = -EINVAL;
+		goto end;
+	}
+
+	getnstimeofday(&now);
+	record.ts_sec = now.tv_sec;
+	record.ts_frac = now.tv_nsec;
+	record.incl_len = len;
+	record.orig_len = len;
+
+	if (file_write(output->file, &record, sizeof(record), &output->pos) != sizeof(record)
+			|| file_write(output->file, buffer, len, &output->pos) != len)
+		error = -EIO;
+	/* Fall through. */
+
+end:
+	kfree(buffer);
+	return error;
+}
+
+void pcap_close(struct pcap_output *output)
+{
+	if (!IS_ERR_OR_NULL(output->file))
+		filp_close(output->file, NULL);
+	output->file = NULL;
+}
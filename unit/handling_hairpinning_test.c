@@ -17,6 +17,9 @@
 #include "nat64/mod/filtering_and_updating.h"
 #include "nat64/mod/translate_packet.h"
 #include "nat64/mod/core.h"
+#include "nat64/mod/stats.h"
+#include "nat64/mod/events.h"
+#include "nat64/mod/changelog.h"
 
 
 /**
@@ -355,6 +358,9 @@ static void deinit(void)
 	pool4_destroy();
 	pool6_destroy();
 	pktmod_destroy();
+	changelog_destroy();
+	events_destroy();
+	stats_destroy();
 }
 
 static int init(void)
@@ -363,6 +369,15 @@ static int init(void)
 	char *pool4[] = { NAT64_IPV4_ADDR };
 	int error;
 
+	error = stats_init();
+	if (error)
+		goto failure;
+	error = events_init();
+	if (error)
+		goto failure;
+	error = changelog_init();
+	if (error)
+		goto failure;
 	error = pktmod_init();
 	if (error)
 		goto failure;
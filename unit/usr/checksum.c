@@ -0,0 +1,77 @@
+/*
+ * The Internet checksum, computed the slow and portable way (lib/checksum.c does the same for
+ * architectures which lack assembly versions).
+ */
+
+#include <net/checksum.h>
+#include <net/ip6_checksum.h>
+
+
+static u32 do_csum(const u8 *buff, int len)
+{
+	u64 sum = 0;
+	int i;
+
+	/* Big endian 16-bit words; an odd trailing byte is padded with zero. */
+	for (i = 0; i + 1 < len; i += 2)
+		sum += (buff[i] << 8) | buff[i + 1];
+	if (len & 1)
+		sum += buff[len - 1] << 8;
+
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+/** Returns "sum" plus the checksum of "buff", in network byte order (like the kernel's). */
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	u32 result = htons(do_csum(buff, len));
+
+	return csum_add(sum, (__wsum) result);
+}
+
+__sum16 ip_fast_csum(const void *iph, unsigned int ihl)
+{
+	return csum_fold(csum_partial(iph, ihl * 4, 0));
+}
+
+__sum16 ip_compute_csum(const void *buff, int len)
+{
+	return csum_fold(csum_partial(buff, len, 0));
+}
+
+__wsum csum_tcpudp_nofold(__be32 saddr, __be32 daddr, unsigned short len, unsigned short proto,
+		__wsum sum)
+{
+	struct {
+		__be32 saddr;
+		__be32 daddr;
+		__u8 zero;
+		__u8 proto;
+		__be16 len;
+	} __attribute__((packed)) pseudo = { saddr, daddr, 0, proto, htons(len) };
+
+	return csum_partial(&pseudo, sizeof(pseudo), sum);
+}
+
+__sum16 csum_ipv6_magic(const struct in6_addr *saddr, const struct in6_addr *daddr, __u32 len,
+		unsigned short proto, __wsum csum)
+{
+	struct {
+		struct in6_addr saddr;
+		struct in6_addr daddr;
+		__be32 len;
+		__u8 zero[3];
+		__u8 proto;
+	} __attribute__((packed)) pseudo;
+
+	pseudo.saddr = *saddr;
+	pseudo.daddr = *daddr;
+	pseudo.len = htonl(len);
+	memset(pseudo.zero, 0, sizeof(pseudo.zero));
+	pseudo.proto = proto;
+
+	return csum_fold(csum_partial(&pseudo, sizeof(pseudo), csum));
+}
@@ -0,0 +1,22 @@
+#ifndef _SHIM_ASM_BYTEORDER_H
+#define _SHIM_ASM_BYTEORDER_H
+
+/* The kernel's unprefixed conversions (linux/byteorder/generic.h). */
+
+#include_next <asm/byteorder.h>
+
+#define cpu_to_be16 __cpu_to_be16
+#define cpu_to_be32 __cpu_to_be32
+#define cpu_to_be64 __cpu_to_be64
+#define be16_to_cpu __be16_to_cpu
+#define be32_to_cpu __be32_to_cpu
+#define be64_to_cpu __be64_to_cpu
+#define be16_to_cpup __be16_to_cpup
+#define be32_to_cpup __be32_to_cpup
+
+#define htons(x) __cpu_to_be16(x)
+#define ntohs(x) __be16_to_cpu(x)
+#define htonl(x) __cpu_to_be32(x)
+#define ntohl(x) __be32_to_cpu(x)
+
+#endif /* _SHIM_ASM_BYTEORDER_H */
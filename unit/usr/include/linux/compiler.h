@@ -0,0 +1,23 @@
+#ifndef _SHIM_LINUX_COMPILER_H
+#define _SHIM_LINUX_COMPILER_H
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#define __init
+#define __exit
+#define __read_mostly
+#define __percpu
+#define __rcu
+#define __user
+#define __force
+
+#define barrier() __asm__ __volatile__("" : : : "memory")
+/* One thread, so the SMP barriers only need to stop the compiler. */
+#define smp_mb()	barrier()
+#define smp_rmb()	barrier()
+#define smp_wmb()	barrier()
+
+#define ACCESS_ONCE(x) (*(volatile typeof(x) *) &(x))
+
+#endif /* _SHIM_LINUX_COMPILER_H */
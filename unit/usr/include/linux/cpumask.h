@@ -0,0 +1,12 @@
+#ifndef _SHIM_LINUX_CPUMASK_H
+#define _SHIM_LINUX_CPUMASK_H
+
+#define nr_cpu_ids 1
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < nr_cpu_ids; (cpu)++)
+#define for_each_online_cpu(cpu) for_each_possible_cpu(cpu)
+
+#define get_cpu()		0
+#define put_cpu()		do { } while (0)
+#define smp_processor_id()	0
+
+#endif /* _SHIM_LINUX_CPUMASK_H */
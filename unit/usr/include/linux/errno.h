@@ -0,0 +1,10 @@
+#ifndef _SHIM_LINUX_ERRNO_H
+#define _SHIM_LINUX_ERRNO_H
+
+#include_next <linux/errno.h>
+
+/* Kernel-only codes (include/linux/errno.h). */
+#define ERESTARTSYS	512
+#define ENOTSUPP	524
+
+#endif /* _SHIM_LINUX_ERRNO_H */
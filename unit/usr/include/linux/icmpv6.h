@@ -0,0 +1,17 @@
+#ifndef _SHIM_LINUX_ICMPV6_H
+#define _SHIM_LINUX_ICMPV6_H
+
+#include_next <linux/icmpv6.h>
+#include <linux/skbuff.h>
+
+static inline struct icmp6hdr *icmp6_hdr(const struct sk_buff *skb)
+{
+	return (struct icmp6hdr *) skb_transport_header(skb);
+}
+
+/* See icmp_send(). */
+static inline void icmpv6_send(struct sk_buff *skb, u8 type, u8 code, __u32 info)
+{
+}
+
+#endif /* _SHIM_LINUX_ICMPV6_H */
@@ -0,0 +1,9 @@
+#ifndef _SHIM_LINUX_INET_H
+#define _SHIM_LINUX_INET_H
+
+#include <linux/types.h>
+
+int in4_pton(const char *src, int srclen, u8 *dst, int delim, const char **end);
+int in6_pton(const char *src, int srclen, u8 *dst, int delim, const char **end);
+
+#endif /* _SHIM_LINUX_INET_H */
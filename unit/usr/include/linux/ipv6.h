@@ -0,0 +1,12 @@
+#ifndef _SHIM_LINUX_IPV6_H
+#define _SHIM_LINUX_IPV6_H
+
+#include_next <linux/ipv6.h>
+#include <linux/skbuff.h>
+
+static inline struct ipv6hdr *ipv6_hdr(const struct sk_buff *skb)
+{
+	return (struct ipv6hdr *) skb_network_header(skb);
+}
+
+#endif /* _SHIM_LINUX_IPV6_H */
@@ -0,0 +1,127 @@
+#ifndef _SHIM_LINUX_JHASH_H
+#define _SHIM_LINUX_JHASH_H
+
+/* Bob Jenkins' lookup3 hash, which is what the kernel's jhash is. */
+
+#include <linux/types.h>
+#include <string.h>
+
+#define JHASH_INITVAL 0xdeadbeef
+
+static inline u32 rol32(u32 word, unsigned int shift)
+{
+	return (word << shift) | (word >> ((-shift) & 31));
+}
+
+#define __jhash_mix(a, b, c) \
+{ \
+	a -= c; a ^= rol32(c, 4); c += b; \
+	b -= a; b ^= rol32(a, 6); a += c; \
+	c -= b; c ^= rol32(b, 8); b += a; \
+	a -= c; a ^= rol32(c, 16); c += b; \
+	b -= a; b ^= rol32(a, 19); a += c; \
+	c -= b; c ^= rol32(b, 4); b += a; \
+}
+
+#define __jhash_final(a, b, c) \
+{ \
+	c ^= b; c -= rol32(b, 14); \
+	a ^= c; a -= rol32(c, 11); \
+	b ^= a; b -= rol32(a, 25); \
+	c ^= b; c -= rol32(b, 16); \
+	a ^= c; a -= rol32(c, 4); \
+	b ^= a; b -= rol32(a, 14); \
+	c ^= b; c -= rol32(b, 24); \
+}
+
+static inline u32 jhash(const void *key, u32 length, u32 initval)
+{
+	const u8 *k = key;
+	u32 a, b, c, word;
+
+	a = b = c = JHASH_INITVAL + length + initval;
+
+	while (length > 12) {
+		memcpy(&word, k, 4);
+		a += word;
+		memcpy(&word, k + 4, 4);
+		b += word;
+		memcpy(&word, k + 8, 4);
+		c += word;
+		__jhash_mix(a, b, c);
+		length -= 12;
+		k += 12;
+	}
+
+	switch (length) {
+	case 12: c += (u32) k[11] << 24; /* Fall through. */
+	case 11: c += (u32) k[10] << 16; /* Fall through. */
+	case 10: c += (u32) k[9] << 8; /* Fall through. */
+	case 9: c += k[8]; /* Fall through. */
+	case 8: b += (u32) k[7] << 24; /* Fall through. */
+	case 7: b += (u32) k[6] << 16; /* Fall through. */
+	case 6: b += (u32) k[5] << 8; /* Fall through. */
+	case 5: b += k[4]; /* Fall through. */
+	case 4: a += (u32) k[3] << 24; /* Fall through. */
+	case 3: a += (u32) k[2] << 16; /* Fall through. */
+	case 2: a += (u32) k[1] << 8; /* Fall through. */
+	case 1: a += k[0];
+		__jhash_final(a, b, c);
+		break;
+	case 0:
+		break;
+	}
+
+	return c;
+}
+
+static inline u32 jhash2(const u32 *k, u32 length, u32 initval)
+{
+	u32 a, b, c;
+
+	a = b = c = JHASH_INITVAL + (length << 2) + initval;
+
+	while (length > 3) {
+		a += k[0];
+		b += k[1];
+		c += k[2];
+		__jhash_mix(a, b, c);
+		length -= 3;
+		k += 3;
+	}
+
+	switch (length) {
+	case 3: c += k[2]; /* Fall through. */
+	case 2: b += k[1]; /* Fall through. */
+	case 1: a += k[0];
+		__jhash_final(a, b, c);
+		break;
+	case 0:
+		break;
+	}
+
+	return c;
+}
+
+static inline u32 jhash_3words(u32 a, u32 b, u32 c, u32 initval)
+{
+	a += JHASH_INITVAL;
+	b += JHASH_INITVAL;
+	c += initval;
+
+	__jhash_final(a, b, c);
+
+	return c;
+}
+
+static inline u32 jhash_2words(u32 a, u32 b, u32 initval)
+{
+	return jhash_3words(a, b, 0, initval);
+}
+
+static inline u32 jhash_1word(u32 a, u32 initval)
+{
+	return jhash_3words(a, 0, 0, initval);
+}
+
+#endif /* _SHIM_LINUX_JHASH_H */
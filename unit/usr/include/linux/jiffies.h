@@ -0,0 +1,29 @@
+#ifndef _SHIM_LINUX_JIFFIES_H
+#define _SHIM_LINUX_JIFFIES_H
+
+/* Jiffies are milliseconds of the monotonic clock. */
+
+#include <linux/types.h>
+
+#define HZ 1000
+#define MAX_JIFFY_OFFSET ((LONG_MAX >> 1) - 1)
+
+unsigned long get_jiffies(void);
+#define jiffies get_jiffies()
+
+#define time_after(a, b)	((long) ((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+#define time_after_eq(a, b)	((long) ((a) - (b)) >= 0)
+#define time_before_eq(a, b)	time_after_eq(b, a)
+
+static inline unsigned long msecs_to_jiffies(const unsigned int m)
+{
+	return m;
+}
+
+static inline unsigned int jiffies_to_msecs(const unsigned long j)
+{
+	return j;
+}
+
+#endif /* _SHIM_LINUX_JIFFIES_H */
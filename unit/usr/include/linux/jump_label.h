@@ -0,0 +1,35 @@
+#ifndef _SHIM_LINUX_JUMP_LABEL_H
+#define _SHIM_LINUX_JUMP_LABEL_H
+
+/* Static keys without the code patching; just a counter. */
+
+#include <linux/types.h>
+
+struct static_key {
+	atomic_t enabled;
+};
+
+#define STATIC_KEY_INIT_FALSE	{ .enabled = { 0 } }
+#define STATIC_KEY_INIT_TRUE	{ .enabled = { 1 } }
+
+static inline bool static_key_false(struct static_key *key)
+{
+	return unlikely(key->enabled.counter > 0);
+}
+
+static inline bool static_key_true(struct static_key *key)
+{
+	return likely(key->enabled.counter > 0);
+}
+
+static inline void static_key_slow_inc(struct static_key *key)
+{
+	key->enabled.counter++;
+}
+
+static inline void static_key_slow_dec(struct static_key *key)
+{
+	key->enabled.counter--;
+}
+
+#endif /* _SHIM_LINUX_JUMP_LABEL_H */
@@ -0,0 +1,65 @@
+#ifndef _SHIM_LINUX_KERNEL_H
+#define _SHIM_LINUX_KERNEL_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <linux/printk.h>
+#include <linux/errno.h>
+#include <asm/byteorder.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define U8_MAX		((u8) ~0U)
+#define U16_MAX		((u16) ~0U)
+#define U32_MAX		((u32) ~0U)
+#define U64_MAX		((u64) ~0ULL)
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define container_of(ptr, type, member) \
+	((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define min(x, y) ({ \
+	typeof(x) _min1 = (x); \
+	typeof(y) _min2 = (y); \
+	(void) (&_min1 == &_min2); \
+	_min1 < _min2 ? _min1 : _min2; })
+#define max(x, y) ({ \
+	typeof(x) _max1 = (x); \
+	typeof(y) _max2 = (y); \
+	(void) (&_max1 == &_max2); \
+	_max1 > _max2 ? _max1 : _max2; })
+#define min_t(type, x, y) ({ \
+	type __min1 = (x); \
+	type __min2 = (y); \
+	__min1 < __min2 ? __min1 : __min2; })
+#define max_t(type, x, y) ({ \
+	type __max1 = (x); \
+	type __max2 = (y); \
+	__max1 > __max2 ? __max1 : __max2; })
+
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define roundup(x, y) ((((x) + ((y) - 1)) / (y)) * (y))
+#define ALIGN(x, a) (((x) + ((typeof(x)) (a) - 1)) & ~((typeof(x)) (a) - 1))
+
+#define BUG() abort()
+#define BUG_ON(condition) do { if (unlikely(condition)) BUG(); } while (0)
+#define WARN_ON(condition) ({ \
+	int __ret_warn_on = !!(condition); \
+	if (unlikely(__ret_warn_on)) \
+		printk_err("WARNING at %s:%d\n", __FILE__, __LINE__); \
+	unlikely(__ret_warn_on); })
+#define WARN(condition, fmt, ...) ({ \
+	int __ret_warn_on = !!(condition); \
+	if (unlikely(__ret_warn_on)) \
+		printk_err(fmt, ##__VA_ARGS__); \
+	unlikely(__ret_warn_on); })
+
+#define might_sleep() do { } while (0)
+
+int kstrtou8(const char *s, unsigned int base, u8 *res);
+int kstrtou16(const char *s, unsigned int base, u16 *res);
+int kstrtouint(const char *s, unsigned int base, unsigned int *res);
+
+#endif /* _SHIM_LINUX_KERNEL_H */
@@ -0,0 +1,23 @@
+#ifndef _SHIM_LINUX_KTIME_H
+#define _SHIM_LINUX_KTIME_H
+
+#include <linux/types.h>
+
+#define NSEC_PER_USEC	1000L
+#define NSEC_PER_MSEC	1000000L
+#define NSEC_PER_SEC	1000000000L
+
+typedef s64 ktime_t;
+
+/** Reads the monotonic clock. */
+ktime_t ktime_get(void);
+
+static inline ktime_t ktime_set(const s64 secs, const unsigned long nsecs)
+{
+	return secs * NSEC_PER_SEC + nsecs;
+}
+
+#define ktime_sub(lhs, rhs)	((lhs) - (rhs))
+#define ktime_to_ns(kt)		(kt)
+
+#endif /* _SHIM_LINUX_KTIME_H */
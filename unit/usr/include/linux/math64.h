@@ -0,0 +1,27 @@
+#ifndef _SHIM_LINUX_MATH64_H
+#define _SHIM_LINUX_MATH64_H
+
+#include <linux/types.h>
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline s64 div_s64(s64 dividend, s32 divisor)
+{
+	return dividend / divisor;
+}
+
+#define do_div(n, base) ({ \
+	u32 __base = (base); \
+	u32 __rem = (n) % __base; \
+	(n) /= __base; \
+	__rem; })
+
+#endif /* _SHIM_LINUX_MATH64_H */
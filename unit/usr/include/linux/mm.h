@@ -0,0 +1,36 @@
+#ifndef _SHIM_LINUX_MM_H
+#define _SHIM_LINUX_MM_H
+
+#include <linux/types.h>
+
+#define PAGE_SHIFT	12
+#define PAGE_SIZE	(1UL << PAGE_SHIFT)
+
+/* Shrinkers are registered, but there's no memory pressure to call them. */
+
+struct shrink_control {
+	gfp_t gfp_mask;
+	unsigned long nr_to_scan;
+};
+
+#define SHRINK_STOP (~0UL)
+#define DEFAULT_SEEKS 2
+
+struct shrinker {
+	unsigned long (*count_objects)(struct shrinker *, struct shrink_control *sc);
+	unsigned long (*scan_objects)(struct shrinker *, struct shrink_control *sc);
+	int seeks;
+	long batch;
+};
+
+static inline int register_shrinker(struct shrinker *shrinker)
+{
+	return 0;
+}
+
+static inline void unregister_shrinker(struct shrinker *shrinker)
+{
+	/* No code. */
+}
+
+#endif /* _SHIM_LINUX_MM_H */
@@ -0,0 +1,31 @@
+#ifndef _SHIM_LINUX_MODULE_H
+#define _SHIM_LINUX_MODULE_H
+
+/*
+ * A "module" is a program. Its init function runs from main(), and its parameters are taken from
+ * the command line, in insmod's name=value syntax.
+ */
+
+#include <linux/kernel.h>
+#include <linux/moduleparam.h>
+
+#define THIS_MODULE ((void *) 0)
+
+#define MODULE_LICENSE(license)
+#define MODULE_AUTHOR(author)
+#define MODULE_DESCRIPTION(description)
+
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+
+int module_main(int argc, char **argv, int (*init)(void), void (*exit)(void));
+
+#define module_init(fn) \
+	static int (*__module_init)(void) = fn;
+#define module_exit(fn) \
+	int main(int argc, char **argv) \
+	{ \
+		return module_main(argc, argv, __module_init, fn); \
+	}
+
+#endif /* _SHIM_LINUX_MODULE_H */
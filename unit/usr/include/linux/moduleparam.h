@@ -0,0 +1,27 @@
+#ifndef _SHIM_LINUX_MODULEPARAM_H
+#define _SHIM_LINUX_MODULEPARAM_H
+
+#include <linux/types.h>
+
+enum param_type {
+	PARAM_UINT,
+	PARAM_INT,
+	PARAM_USHORT,
+	PARAM_BOOL,
+};
+
+void module_param_register(const char *name, enum param_type type, void *value);
+
+#define param_type_uint		PARAM_UINT
+#define param_type_int		PARAM_INT
+#define param_type_ushort	PARAM_USHORT
+#define param_type_bool		PARAM_BOOL
+
+#define module_param(name, type, perm) \
+	static void __attribute__((constructor)) __module_param_##name(void) \
+	{ \
+		module_param_register(#name, param_type_##type, &name); \
+	}
+#define MODULE_PARM_DESC(name, description)
+
+#endif /* _SHIM_LINUX_MODULEPARAM_H */
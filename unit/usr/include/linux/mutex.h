@@ -0,0 +1,16 @@
+#ifndef _SHIM_LINUX_MUTEX_H
+#define _SHIM_LINUX_MUTEX_H
+
+/* See spinlock.h. */
+
+struct mutex {
+	int locked;
+};
+
+#define DEFINE_MUTEX(name) struct mutex name = { 0 }
+
+#define mutex_init(lock)	((lock)->locked = 0)
+#define mutex_lock(lock)	((lock)->locked = 1)
+#define mutex_unlock(lock)	((lock)->locked = 0)
+
+#endif /* _SHIM_LINUX_MUTEX_H */
@@ -0,0 +1,26 @@
+#ifndef _SHIM_LINUX_NETDEVICE_H
+#define _SHIM_LINUX_NETDEVICE_H
+
+#include <linux/types.h>
+#include <linux/if_ether.h>
+
+#define IFNAMSIZ 16
+#define LL_MAX_HEADER 128
+
+struct net_device {
+	char name[IFNAMSIZ];
+	unsigned int mtu;
+	int refcnt;
+};
+
+static inline void dev_hold(struct net_device *dev)
+{
+	dev->refcnt++;
+}
+
+static inline void dev_put(struct net_device *dev)
+{
+	dev->refcnt--;
+}
+
+#endif /* _SHIM_LINUX_NETDEVICE_H */
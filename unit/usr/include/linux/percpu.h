@@ -0,0 +1,18 @@
+#ifndef _SHIM_LINUX_PERCPU_H
+#define _SHIM_LINUX_PERCPU_H
+
+/* There's a single CPU. */
+
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+
+#define alloc_percpu(type)	((type *) kzalloc(sizeof(type), GFP_KERNEL))
+#define free_percpu(ptr)	kfree(ptr)
+#define per_cpu_ptr(ptr, cpu)	((void) (cpu), (ptr))
+
+#define this_cpu_ptr(ptr)		(ptr)
+#define this_cpu_add(pcp, val)		((pcp) += (val))
+#define this_cpu_inc(pcp)		this_cpu_add(pcp, 1)
+#define this_cpu_dec(pcp)		this_cpu_add(pcp, -1)
+
+#endif /* _SHIM_LINUX_PERCPU_H */
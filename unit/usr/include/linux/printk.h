@@ -0,0 +1,33 @@
+#ifndef _SHIM_LINUX_PRINTK_H
+#define _SHIM_LINUX_PRINTK_H
+
+/*
+ * Everything goes to standard output, except errors, which go to standard error.
+ * printk() understands the kernel's %pI4 and %pI6c.
+ */
+
+#define KERN_EMERG	""
+#define KERN_ALERT	""
+#define KERN_CRIT	""
+#define KERN_ERR	""
+#define KERN_WARNING	""
+#define KERN_NOTICE	""
+#define KERN_INFO	""
+#define KERN_DEBUG	""
+
+int printk(const char *fmt, ...);
+int printk_err(const char *fmt, ...);
+
+#define pr_crit(fmt, ...)	printk_err(fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)	printk_err(fmt, ##__VA_ARGS__)
+#define pr_warning(fmt, ...)	printk(fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...)	printk(fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)	printk(fmt, ##__VA_ARGS__)
+
+#ifdef DEBUG
+#define pr_debug(fmt, ...)	printk(fmt, ##__VA_ARGS__)
+#else
+#define pr_debug(fmt, ...)	({ if (0) printk(fmt, ##__VA_ARGS__); 0; })
+#endif
+
+#endif /* _SHIM_LINUX_PRINTK_H */
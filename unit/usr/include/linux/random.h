@@ -0,0 +1,8 @@
+#ifndef _SHIM_LINUX_RANDOM_H
+#define _SHIM_LINUX_RANDOM_H
+
+/* Filled from rand(); the benchmark only needs spread, not security. */
+
+void get_random_bytes(void *buf, int nbytes);
+
+#endif /* _SHIM_LINUX_RANDOM_H */
@@ -0,0 +1,48 @@
+#ifndef _SHIM_LINUX_RBTREE_H
+#define _SHIM_LINUX_RBTREE_H
+
+/* Red-black trees, with the same interface and node layout as the kernel's (see rbtree.c). */
+
+#include <linux/kernel.h>
+
+struct rb_node {
+	/* The parent's address; the lowest bit is the color. */
+	unsigned long __rb_parent_color;
+	struct rb_node *rb_right;
+	struct rb_node *rb_left;
+} __attribute__((aligned(sizeof(long))));
+
+struct rb_root {
+	struct rb_node *rb_node;
+};
+
+#define RB_RED		0
+#define RB_BLACK	1
+
+#define rb_parent(r)	((struct rb_node *) ((r)->__rb_parent_color & ~3UL))
+#define rb_color(r)	((r)->__rb_parent_color & 1)
+
+#define RB_ROOT	(struct rb_root) { NULL, }
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define RB_EMPTY_ROOT(root)	((root)->rb_node == NULL)
+#define RB_EMPTY_NODE(node)	((node)->__rb_parent_color == (unsigned long) (node))
+#define RB_CLEAR_NODE(node)	((node)->__rb_parent_color = (unsigned long) (node))
+
+void rb_insert_color(struct rb_node *node, struct rb_root *root);
+void rb_erase(struct rb_node *node, struct rb_root *root);
+
+struct rb_node *rb_next(const struct rb_node *node);
+struct rb_node *rb_prev(const struct rb_node *node);
+struct rb_node *rb_first(const struct rb_root *root);
+struct rb_node *rb_last(const struct rb_root *root);
+
+static inline void rb_link_node(struct rb_node *node, struct rb_node *parent,
+		struct rb_node **rb_link)
+{
+	node->__rb_parent_color = (unsigned long) parent;
+	node->rb_left = node->rb_right = NULL;
+	*rb_link = node;
+}
+
+#endif /* _SHIM_LINUX_RBTREE_H */
@@ -0,0 +1,19 @@
+#ifndef _SHIM_LINUX_RCUPDATE_H
+#define _SHIM_LINUX_RCUPDATE_H
+
+/* With a single thread, there are no readers to wait for. */
+
+#define rcu_read_lock()		do { } while (0)
+#define rcu_read_unlock()	do { } while (0)
+#define rcu_read_lock_bh()	do { } while (0)
+#define rcu_read_unlock_bh()	do { } while (0)
+
+#define rcu_dereference(p)		(p)
+#define rcu_dereference_bh(p)		(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_assign_pointer(p, v)	((p) = (v))
+
+#define synchronize_rcu()	do { } while (0)
+#define synchronize_rcu_bh()	do { } while (0)
+
+#endif /* _SHIM_LINUX_RCUPDATE_H */
@@ -0,0 +1,187 @@
+#ifndef _SHIM_LINUX_SKBUFF_H
+#define _SHIM_LINUX_SKBUFF_H
+
+/*
+ * Socket buffers. Only linear ones exist (there are no paged fragments and no frag_list), and the
+ * header offsets are plain pointers, which is what 32-bit kernels do.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/netdevice.h>
+#include <net/dst.h>
+
+#define CHECKSUM_NONE		0
+#define CHECKSUM_UNNECESSARY	1
+#define CHECKSUM_COMPLETE	2
+#define CHECKSUM_PARTIAL	3
+
+struct sk_buff {
+	struct sk_buff *next;
+	struct sk_buff *prev;
+
+	struct net_device *dev;
+	struct dst_entry *dst;
+
+	unsigned int len;
+	unsigned int data_len;
+	unsigned int truesize;
+	__be16 protocol;
+	__u8 ip_summed;
+	__u32 priority;
+	__u32 mark;
+	__wsum csum;
+
+	unsigned char *mac_header;
+	unsigned char *network_header;
+	unsigned char *transport_header;
+
+	unsigned char *head;
+	unsigned char *data;
+	unsigned char *tail;
+	unsigned char *end;
+};
+
+struct sk_buff *alloc_skb(unsigned int size, gfp_t priority);
+void kfree_skb(struct sk_buff *skb);
+struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t priority);
+
+static inline unsigned int skb_headlen(const struct sk_buff *skb)
+{
+	return skb->len - skb->data_len;
+}
+
+static inline bool skb_is_nonlinear(const struct sk_buff *skb)
+{
+	return skb->data_len;
+}
+
+static inline int skb_linearize(struct sk_buff *skb)
+{
+	return 0;
+}
+
+static inline int pskb_may_pull(struct sk_buff *skb, unsigned int len)
+{
+	return len <= skb_headlen(skb);
+}
+
+static inline unsigned int skb_headroom(const struct sk_buff *skb)
+{
+	return skb->data - skb->head;
+}
+
+static inline int skb_tailroom(const struct sk_buff *skb)
+{
+	return skb->end - skb->tail;
+}
+
+static inline void skb_reserve(struct sk_buff *skb, int len)
+{
+	skb->data += len;
+	skb->tail += len;
+}
+
+static inline unsigned char *skb_tail_pointer(const struct sk_buff *skb)
+{
+	return skb->tail;
+}
+
+static inline unsigned char *skb_put(struct sk_buff *skb, unsigned int len)
+{
+	unsigned char *tmp = skb->tail;
+
+	skb->tail += len;
+	skb->len += len;
+	BUG_ON(skb->tail > skb->end);
+	return tmp;
+}
+
+static inline unsigned char *skb_push(struct sk_buff *skb, unsigned int len)
+{
+	skb->data -= len;
+	skb->len += len;
+	BUG_ON(skb->data < skb->head);
+	return skb->data;
+}
+
+static inline unsigned char *skb_pull(struct sk_buff *skb, unsigned int len)
+{
+	if (len > skb->len)
+		return NULL;
+	skb->len -= len;
+	return skb->data += len;
+}
+
+static inline void skb_reset_mac_header(struct sk_buff *skb)
+{
+	skb->mac_header = skb->data;
+}
+
+static inline unsigned char *skb_mac_header(const struct sk_buff *skb)
+{
+	return skb->mac_header;
+}
+
+static inline void skb_reset_network_header(struct sk_buff *skb)
+{
+	skb->network_header = skb->data;
+}
+
+static inline void skb_set_network_header(struct sk_buff *skb, const int offset)
+{
+	skb->network_header = skb->data + offset;
+}
+
+static inline unsigned char *skb_network_header(const struct sk_buff *skb)
+{
+	return skb->network_header;
+}
+
+static inline int skb_network_offset(const struct sk_buff *skb)
+{
+	return skb->network_header - skb->data;
+}
+
+static inline void skb_reset_transport_header(struct sk_buff *skb)
+{
+	skb->transport_header = skb->data;
+}
+
+static inline void skb_set_transport_header(struct sk_buff *skb, const int offset)
+{
+	skb->transport_header = skb->data + offset;
+}
+
+static inline unsigned char *skb_transport_header(const struct sk_buff *skb)
+{
+	return skb->transport_header;
+}
+
+static inline int skb_transport_offset(const struct sk_buff *skb)
+{
+	return skb->transport_header - skb->data;
+}
+
+static inline struct dst_entry *skb_dst(const struct sk_buff *skb)
+{
+	return skb->dst;
+}
+
+static inline void skb_dst_set(struct sk_buff *skb, struct dst_entry *dst)
+{
+	skb->dst = dst;
+}
+
+static inline void skb_dst_drop(struct sk_buff *skb)
+{
+	dst_release(skb->dst);
+	skb->dst = NULL;
+}
+
+static inline void skb_dst_force(struct sk_buff *skb)
+{
+	/* No code; the dst is always refcounted. */
+}
+
+#endif /* _SHIM_LINUX_SKBUFF_H */
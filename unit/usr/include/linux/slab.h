@@ -0,0 +1,62 @@
+#ifndef _SHIM_LINUX_SLAB_H
+#define _SHIM_LINUX_SLAB_H
+
+/* Allocations are plain malloc()s; the flags are ignored. */
+
+#include <linux/types.h>
+#include <stdlib.h>
+
+#define GFP_ATOMIC	0x01u
+#define GFP_KERNEL	0x02u
+#define __GFP_ZERO	0x04u
+
+static inline void *kmalloc(size_t size, gfp_t flags)
+{
+	return (flags & __GFP_ZERO) ? calloc(1, size) : malloc(size);
+}
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	return calloc(1, size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return calloc(n, size);
+}
+
+static inline void kfree(const void *ptr)
+{
+	free((void *) ptr);
+}
+
+struct kmem_cache {
+	const char *name;
+	size_t size;
+};
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+		unsigned long flags, void (*ctor)(void *));
+void kmem_cache_destroy(struct kmem_cache *cache);
+
+static inline void *kmem_cache_alloc(struct kmem_cache *cache, gfp_t flags)
+{
+	return kmalloc(cache->size, flags);
+}
+
+static inline void *kmem_cache_zalloc(struct kmem_cache *cache, gfp_t flags)
+{
+	return kzalloc(cache->size, flags);
+}
+
+static inline void kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+	free(obj);
+}
+
+static inline unsigned int kmem_cache_size(struct kmem_cache *cache)
+{
+	return cache->size;
+}
+
+#endif /* _SHIM_LINUX_SLAB_H */
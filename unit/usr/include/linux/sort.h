@@ -0,0 +1,10 @@
+#ifndef _SHIM_LINUX_SORT_H
+#define _SHIM_LINUX_SORT_H
+
+#include <linux/types.h>
+
+/* Implemented on top of qsort(), which swaps the elements itself, so "swap" is ignored. */
+void sort(void *base, size_t num, size_t size, int (*cmp)(const void *, const void *),
+		void (*swap)(void *, void *, int));
+
+#endif /* _SHIM_LINUX_SORT_H */
@@ -0,0 +1,30 @@
+#ifndef _SHIM_LINUX_SPINLOCK_H
+#define _SHIM_LINUX_SPINLOCK_H
+
+/*
+ * The harness runs on a single thread, so locks only need to compile. (They still record whether
+ * they are held, so a debugger can tell.)
+ */
+
+#include <linux/types.h>
+#include <linux/rcupdate.h>
+
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#define __SPIN_LOCK_UNLOCKED(name) { 0 }
+#define DEFINE_SPINLOCK(name) spinlock_t name = __SPIN_LOCK_UNLOCKED(name)
+
+#define spin_lock_init(lock)	((lock)->locked = 0)
+#define spin_lock(lock)		((lock)->locked = 1)
+#define spin_unlock(lock)	((lock)->locked = 0)
+#define spin_lock_bh(lock)	spin_lock(lock)
+#define spin_unlock_bh(lock)	spin_unlock(lock)
+#define spin_lock_irqsave(lock, flags)		((void) (flags), spin_lock(lock))
+#define spin_unlock_irqrestore(lock, flags)	((void) (flags), spin_unlock(lock))
+
+#define local_bh_disable()	do { } while (0)
+#define local_bh_enable()	do { } while (0)
+
+#endif /* _SHIM_LINUX_SPINLOCK_H */
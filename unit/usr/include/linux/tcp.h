@@ -0,0 +1,17 @@
+#ifndef _SHIM_LINUX_TCP_H
+#define _SHIM_LINUX_TCP_H
+
+#include_next <linux/tcp.h>
+#include <linux/skbuff.h>
+
+static inline struct tcphdr *tcp_hdr(const struct sk_buff *skb)
+{
+	return (struct tcphdr *) skb_transport_header(skb);
+}
+
+static inline unsigned int tcp_hdrlen(const struct sk_buff *skb)
+{
+	return tcp_hdr(skb)->doff * 4;
+}
+
+#endif /* _SHIM_LINUX_TCP_H */
@@ -0,0 +1,55 @@
+#ifndef _SHIM_LINUX_TIMER_H
+#define _SHIM_LINUX_TIMER_H
+
+/*
+ * Timers are scheduled, but never fire. Nothing the harness measures lasts long enough for entries
+ * to expire.
+ */
+
+#include <linux/jiffies.h>
+
+struct timer_list {
+	unsigned long expires;
+	void (*function)(unsigned long);
+	unsigned long data;
+	bool pending;
+};
+
+static inline void init_timer(struct timer_list *timer)
+{
+	timer->pending = false;
+}
+
+static inline void setup_timer(struct timer_list *timer, void (*function)(unsigned long),
+		unsigned long data)
+{
+	timer->function = function;
+	timer->data = data;
+	timer->pending = false;
+}
+
+static inline int timer_pending(const struct timer_list *timer)
+{
+	return timer->pending;
+}
+
+static inline int mod_timer(struct timer_list *timer, unsigned long expires)
+{
+	int was_pending = timer->pending;
+
+	timer->expires = expires;
+	timer->pending = true;
+	return was_pending;
+}
+
+static inline int del_timer(struct timer_list *timer)
+{
+	int was_pending = timer->pending;
+
+	timer->pending = false;
+	return was_pending;
+}
+
+#define del_timer_sync(timer) del_timer(timer)
+
+#endif /* _SHIM_LINUX_TIMER_H */
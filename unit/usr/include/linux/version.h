@@ -0,0 +1,9 @@
+#ifndef _SHIM_LINUX_VERSION_H
+#define _SHIM_LINUX_VERSION_H
+
+/* The harness pretends to be the newest kernel Jool supports. */
+
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE KERNEL_VERSION(3, 13, 0)
+
+#endif /* _SHIM_LINUX_VERSION_H */
@@ -0,0 +1,21 @@
+#ifndef _SHIM_LINUX_VMALLOC_H
+#define _SHIM_LINUX_VMALLOC_H
+
+#include <stdlib.h>
+
+static inline void *vmalloc(unsigned long size)
+{
+	return malloc(size);
+}
+
+static inline void *vzalloc(unsigned long size)
+{
+	return calloc(1, size);
+}
+
+static inline void vfree(const void *addr)
+{
+	free((void *) addr);
+}
+
+#endif /* _SHIM_LINUX_VMALLOC_H */
@@ -0,0 +1,34 @@
+#ifndef _SHIM_LINUX_WORKQUEUE_H
+#define _SHIM_LINUX_WORKQUEUE_H
+
+/* Like timers, work items are queued, but never run. */
+
+#include <linux/types.h>
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+	bool pending;
+};
+
+#define INIT_WORK(work, fn) do { (work)->func = (fn); (work)->pending = false; } while (0)
+
+static inline bool schedule_work(struct work_struct *work)
+{
+	bool was_pending = work->pending;
+
+	work->pending = true;
+	return !was_pending;
+}
+
+static inline bool cancel_work_sync(struct work_struct *work)
+{
+	bool was_pending = work->pending;
+
+	work->pending = false;
+	return was_pending;
+}
+
+#endif /* _SHIM_LINUX_WORKQUEUE_H */
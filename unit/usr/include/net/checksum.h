@@ -0,0 +1,47 @@
+#ifndef _SHIM_NET_CHECKSUM_H
+#define _SHIM_NET_CHECKSUM_H
+
+/* The generic (lib/checksum.c) Internet checksum; see checksum.c. */
+
+#include <linux/types.h>
+
+__wsum csum_partial(const void *buff, int len, __wsum sum);
+__sum16 ip_fast_csum(const void *iph, unsigned int ihl);
+__sum16 ip_compute_csum(const void *buff, int len);
+__wsum csum_tcpudp_nofold(__be32 saddr, __be32 daddr, unsigned short len, unsigned short proto,
+		__wsum sum);
+
+static inline __sum16 csum_fold(__wsum csum)
+{
+	u32 sum = (u32) csum;
+
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return (__sum16) ~sum;
+}
+
+static inline __wsum csum_unfold(__sum16 n)
+{
+	return (__wsum) n;
+}
+
+static inline __wsum csum_add(__wsum csum, __wsum addend)
+{
+	u32 res = (u32) csum;
+
+	res += (u32) addend;
+	return (__wsum) (res + (res < (u32) addend));
+}
+
+static inline __wsum csum_sub(__wsum csum, __wsum addend)
+{
+	return csum_add(csum, ~addend);
+}
+
+static inline __sum16 csum_tcpudp_magic(__be32 saddr, __be32 daddr, unsigned short len,
+		unsigned short proto, __wsum sum)
+{
+	return csum_fold(csum_tcpudp_nofold(saddr, daddr, len, proto, sum));
+}
+
+#endif /* _SHIM_NET_CHECKSUM_H */
@@ -0,0 +1,34 @@
+#ifndef _SHIM_NET_DST_H
+#define _SHIM_NET_DST_H
+
+/*
+ * Routes. The harness doesn't route (the send_packet impersonator returns no routes), so these
+ * only keep the reference counts.
+ */
+
+#include <linux/types.h>
+
+struct net_device;
+
+struct dst_entry {
+	atomic_t __refcnt;
+	struct net_device *dev;
+	short error;
+	short obsolete;
+};
+
+static inline struct dst_entry *dst_clone(struct dst_entry *dst)
+{
+	if (dst)
+		dst->__refcnt.counter++;
+	return dst;
+}
+
+void dst_release(struct dst_entry *dst);
+
+static inline struct dst_entry *dst_check(struct dst_entry *dst, u32 cookie)
+{
+	return dst;
+}
+
+#endif /* _SHIM_NET_DST_H */
@@ -0,0 +1,6 @@
+#ifndef _SHIM_NET_INET_FRAG_H
+#define _SHIM_NET_INET_FRAG_H
+
+#define INETFRAGS_HASHSZ 64
+
+#endif /* _SHIM_NET_INET_FRAG_H */
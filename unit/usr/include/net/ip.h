@@ -0,0 +1,20 @@
+#ifndef _SHIM_NET_IP_H
+#define _SHIM_NET_IP_H
+
+#include <linux/ip.h>
+#include <linux/in.h>
+#include <net/checksum.h>
+#include <net/route.h>
+
+#define IP_CE		0x8000
+#define IP_DF		0x4000
+#define IP_MF		0x2000
+#define IP_OFFSET	0x1FFF
+
+static inline void ip_send_check(struct iphdr *iph)
+{
+	iph->check = 0;
+	iph->check = ip_fast_csum((unsigned char *) iph, iph->ihl);
+}
+
+#endif /* _SHIM_NET_IP_H */
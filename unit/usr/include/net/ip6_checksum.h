@@ -0,0 +1,10 @@
+#ifndef _SHIM_NET_IP6_CHECKSUM_H
+#define _SHIM_NET_IP6_CHECKSUM_H
+
+#include <linux/in6.h>
+#include <net/checksum.h>
+
+__sum16 csum_ipv6_magic(const struct in6_addr *saddr, const struct in6_addr *daddr, __u32 len,
+		unsigned short proto, __wsum csum);
+
+#endif /* _SHIM_NET_IP6_CHECKSUM_H */
@@ -0,0 +1,13 @@
+#ifndef _SHIM_NET_IP6_ROUTE_H
+#define _SHIM_NET_IP6_ROUTE_H
+
+#include <linux/skbuff.h>
+
+/* Nothing leaves the harness; the packet is consumed as if it had been sent. */
+static inline int ip6_local_out(struct sk_buff *skb)
+{
+	kfree_skb(skb);
+	return 0;
+}
+
+#endif /* _SHIM_NET_IP6_ROUTE_H */
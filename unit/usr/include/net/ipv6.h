@@ -0,0 +1,91 @@
+#ifndef _SHIM_NET_IPV6_H
+#define _SHIM_NET_IPV6_H
+
+#include <linux/ipv6.h>
+#include <linux/in6.h>
+#include <linux/jhash.h>
+#include <net/ip6_checksum.h>
+#include <net/inet_frag.h>
+
+#define NEXTHDR_HOP		0
+#define NEXTHDR_TCP		6
+#define NEXTHDR_UDP		17
+#define NEXTHDR_IPV6		41
+#define NEXTHDR_ROUTING		43
+#define NEXTHDR_FRAGMENT	44
+#define NEXTHDR_GRE		47
+#define NEXTHDR_ESP		50
+#define NEXTHDR_AUTH		51
+#define NEXTHDR_ICMP		58
+#define NEXTHDR_NONE		59
+#define NEXTHDR_DEST		60
+#define NEXTHDR_MOBILITY	135
+
+#define NEXTHDR_MAX		255
+
+#define IPV6_MIN_MTU		1280
+#define IPV6_FLOWINFO_MASK	cpu_to_be32(0x0FFFFFFF)
+#define IPV6_FLOWLABEL_MASK	cpu_to_be32(0x000FFFFF)
+
+struct frag_hdr {
+	__u8 nexthdr;
+	__u8 reserved;
+	__be16 frag_off;
+	__be32 identification;
+};
+
+#define IP6_MF		0x0001
+#define IP6_OFFSET	0xFFF8
+
+static inline bool ipv6_addr_equal(const struct in6_addr *a1, const struct in6_addr *a2)
+{
+	return ((a1->s6_addr32[0] ^ a2->s6_addr32[0])
+			| (a1->s6_addr32[1] ^ a2->s6_addr32[1])
+			| (a1->s6_addr32[2] ^ a2->s6_addr32[2])
+			| (a1->s6_addr32[3] ^ a2->s6_addr32[3])) == 0;
+}
+
+static inline int ipv6_addr_cmp(const struct in6_addr *a1, const struct in6_addr *a2)
+{
+	return memcmp(a1, a2, sizeof(struct in6_addr));
+}
+
+static inline bool ipv6_addr_any(const struct in6_addr *a)
+{
+	return (a->s6_addr32[0] | a->s6_addr32[1] | a->s6_addr32[2] | a->s6_addr32[3]) == 0;
+}
+
+static inline bool ipv6_prefix_equal(const struct in6_addr *addr1, const struct in6_addr *addr2,
+		unsigned int prefixlen)
+{
+	const __be32 *a1 = addr1->s6_addr32;
+	const __be32 *a2 = addr2->s6_addr32;
+	unsigned int pdw, pbi;
+
+	pdw = prefixlen >> 5;
+	if (pdw && memcmp(a1, a2, pdw << 2))
+		return false;
+
+	pbi = prefixlen & 0x1f;
+	if (pbi && ((a1[pdw] ^ a2[pdw]) & htonl((0xffffffff) << (32 - pbi))))
+		return false;
+
+	return true;
+}
+
+static inline void ipv6_addr_prefix(struct in6_addr *pfx, const struct in6_addr *addr, int plen)
+{
+	int o = plen >> 3, b = plen & 0x7;
+
+	memset(pfx->s6_addr, 0, sizeof(pfx->s6_addr));
+	memcpy(pfx->s6_addr, addr, o);
+	if (b != 0)
+		pfx->s6_addr[o] = addr->s6_addr[o] & (0xff00 >> b);
+}
+
+static inline u32 ipv6_addr_hash(const struct in6_addr *a)
+{
+	return (a->s6_addr32[0] ^ a->s6_addr32[1] ^ a->s6_addr32[2] ^ a->s6_addr32[3]);
+}
+
+#endif /* _SHIM_NET_IPV6_H */
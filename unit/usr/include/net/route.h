@@ -0,0 +1,18 @@
+#ifndef _SHIM_NET_ROUTE_H
+#define _SHIM_NET_ROUTE_H
+
+#include <linux/skbuff.h>
+#include <linux/ip.h>
+
+#define RT_TOS(tos) ((tos) & IPTOS_TOS_MASK)
+
+struct rtable {
+	struct dst_entry dst;
+};
+
+static inline struct rtable *skb_rtable(const struct sk_buff *skb)
+{
+	return (struct rtable *) skb_dst(skb);
+}
+
+#endif /* _SHIM_NET_ROUTE_H */
@@ -0,0 +1,7 @@
+#ifndef _SHIM_NET_TCP_H
+#define _SHIM_NET_TCP_H
+
+#include <linux/tcp.h>
+#include <net/checksum.h>
+
+#endif /* _SHIM_NET_TCP_H */
@@ -0,0 +1,21 @@
+#ifndef _SHIM_PRELUDE_H
+#define _SHIM_PRELUDE_H
+
+/*
+ * Included before every file (see the Makefile's -include).
+ *
+ * Kernel headers drag in a lot of each other, and Jool's code leans on that; pool6.c never
+ * includes list.h, for example. These are the ones it ends up taking for granted.
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/timer.h>
+#include <linux/skbuff.h>
+
+#endif /* _SHIM_PRELUDE_H */
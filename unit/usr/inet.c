@@ -0,0 +1,37 @@
+/* Textual addresses; see linux/inet.h. */
+
+#include <linux/inet.h>
+#include <sys/socket.h>
+
+/* Not <arpa/inet.h>; libc's in6_addr would collide with the kernel's. */
+extern int inet_pton(int af, const char *src, void *dst);
+
+
+static int pton(int af, const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+	char buffer[64];
+	int len;
+
+	len = (srclen < 0) ? strlen(src) : srclen;
+	if (delim != -1 && memchr(src, delim, len))
+		len = (const char *) memchr(src, delim, len) - src;
+	if (len >= sizeof(buffer))
+		return 0;
+
+	memcpy(buffer, src, len);
+	buffer[len] = '\0';
+	if (end)
+		*end = src + len;
+
+	return inet_pton(af, buffer, dst) == 1;
+}
+
+int in4_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+	return pton(AF_INET, src, srclen, dst, delim, end);
+}
+
+int in6_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+	return pton(AF_INET6, src, srclen, dst, delim, end);
+}
@@ -0,0 +1,347 @@
+/*
+ * The parts of the kernel's library which the shim headers only declare: logging, clocks,
+ * random numbers, string parsing, sorting, slab caches and the module machinery.
+ */
+
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+
+/** Prints "addr" in the compressed form (RFC 5952), like %pI6c. */
+static int print_addr6(FILE *stream, const u16 *addr)
+{
+	int zeroes_start = -1, zeroes_len = 0;
+	int run_start, i;
+	int printed = 0;
+
+	/* Find the longest run of zero groups; only runs of two or more get compressed. */
+	for (i = 0; i < 8; i++) {
+		if (addr[i])
+			continue;
+		for (run_start = i; i < 8 && !addr[i]; i++)
+			;
+		if (i - run_start > zeroes_len && i - run_start > 1) {
+			zeroes_start = run_start;
+			zeroes_len = i - run_start;
+		}
+	}
+
+	for (i = 0; i < 8; i++) {
+		if (i == zeroes_start) {
+			printed += fprintf(stream, "::");
+			i += zeroes_len - 1;
+			continue;
+		}
+		if (i != 0 && i != zeroes_start + zeroes_len)
+			printed += fprintf(stream, ":");
+		printed += fprintf(stream, "%x", ntohs(addr[i]));
+	}
+
+	return printed;
+}
+
+/**
+ * Prints "fmt" on "stream", the way vprintk() would.
+ * The kernel's %pI4 and %pI6c are understood; everything else is handed to fprintf() one
+ * conversion at a time, so the arguments are consumed correctly.
+ */
+static int vprintk_to(FILE *stream, const char *fmt, va_list args)
+{
+	char spec[32];
+	const char *start;
+	size_t len;
+	int printed = 0;
+
+	while (*fmt) {
+		if (*fmt != '%') {
+			fputc(*fmt++, stream);
+			printed++;
+			continue;
+		}
+
+		if (strncmp(fmt, "%pI4", 4) == 0) {
+			const u8 *addr = va_arg(args, const void *);
+			printed += fprintf(stream, "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+			fmt += 4;
+			continue;
+		}
+		if (strncmp(fmt, "%pI6c", 5) == 0) {
+			printed += print_addr6(stream, va_arg(args, const void *));
+			fmt += 5;
+			continue;
+		}
+
+		/* Find the end of the conversion specification. */
+		start = fmt++;
+		fmt += strspn(fmt, "-+ #0123456789.*hlLqjzt");
+		if (*fmt)
+			fmt++;
+
+		len = fmt - start;
+		if (len >= sizeof(spec) || memchr(start, '*', len)) {
+			/* Nothing in Jool needs these; print the specification verbatim. */
+			printed += fprintf(stream, "%.*s", (int) len, start);
+			continue;
+		}
+		memcpy(spec, start, len);
+		spec[len] = '\0';
+
+		switch (fmt[-1]) {
+		case '%':
+			fputc('%', stream);
+			printed++;
+			break;
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		case 'c':
+			if (strstr(spec, "ll") || strchr(spec, 'L') || strchr(spec, 'q'))
+				printed += fprintf(stream, spec, va_arg(args, long long));
+			else if (strchr(spec, 'l') || strchr(spec, 'z') || strchr(spec, 't')
+					|| strchr(spec, 'j'))
+				printed += fprintf(stream, spec, va_arg(args, long));
+			else
+				printed += fprintf(stream, spec, va_arg(args, int));
+			break;
+		case 's':
+		case 'p':
+			printed += fprintf(stream, spec, va_arg(args, void *));
+			break;
+		default:
+			printed += fprintf(stream, "%s", spec);
+			break;
+		}
+	}
+
+	return printed;
+}
+
+int printk(const char *fmt, ...)
+{
+	va_list args;
+	int result;
+
+	va_start(args, fmt);
+	result = vprintk_to(stdout, fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+int printk_err(const char *fmt, ...)
+{
+	va_list args;
+	int result;
+
+	va_start(args, fmt);
+	result = vprintk_to(stderr, fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+static u64 monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+unsigned long get_jiffies(void)
+{
+	return monotonic_ns() / NSEC_PER_MSEC;
+}
+
+ktime_t ktime_get(void)
+{
+	return monotonic_ns();
+}
+
+void get_random_bytes(void *buf, int nbytes)
+{
+	unsigned char *bytes = buf;
+	int i;
+
+	for (i = 0; i < nbytes; i++)
+		bytes[i] = rand();
+}
+
+static int kstrtoull_max(const char *s, unsigned int base, unsigned long long max,
+		unsigned long long *res)
+{
+	char *end;
+
+	if (*s == '\0' || *s == '-')
+		return -EINVAL;
+
+	errno = 0;
+	*res = strtoull(s, &end, base);
+	if (*end == '\n')
+		end++;
+	if (*end != '\0')
+		return -EINVAL;
+	if (errno == ERANGE || *res > max)
+		return -ERANGE;
+
+	return 0;
+}
+
+int kstrtou8(const char *s, unsigned int base, u8 *res)
+{
+	unsigned long long tmp;
+	int error = kstrtoull_max(s, base, U8_MAX, &tmp);
+
+	if (!error)
+		*res = tmp;
+	return error;
+}
+
+int kstrtou16(const char *s, unsigned int base, u16 *res)
+{
+	unsigned long long tmp;
+	int error = kstrtoull_max(s, base, U16_MAX, &tmp);
+
+	if (!error)
+		*res = tmp;
+	return error;
+}
+
+int kstrtouint(const char *s, unsigned int base, unsigned int *res)
+{
+	unsigned long long tmp;
+	int error = kstrtoull_max(s, base, UINT_MAX, &tmp);
+
+	if (!error)
+		*res = tmp;
+	return error;
+}
+
+void sort(void *base, size_t num, size_t size, int (*cmp)(const void *, const void *),
+		void (*swap)(void *, void *, int))
+{
+	qsort(base, num, size, cmp);
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+		unsigned long flags, void (*ctor)(void *))
+{
+	struct kmem_cache *cache;
+
+	cache = malloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	cache->name = name;
+	cache->size = size;
+	return cache;
+}
+
+void kmem_cache_destroy(struct kmem_cache *cache)
+{
+	free(cache);
+}
+
+#define MAX_PARAMS 16
+
+static struct module_param {
+	const char *name;
+	enum param_type type;
+	void *value;
+} params[MAX_PARAMS];
+static unsigned int param_count;
+
+void module_param_register(const char *name, enum param_type type, void *value)
+{
+	BUG_ON(param_count >= MAX_PARAMS);
+	params[param_count].name = name;
+	params[param_count].type = type;
+	params[param_count].value = value;
+	param_count++;
+}
+
+static int parse_param(char *arg)
+{
+	struct module_param *param;
+	char *value;
+	unsigned long long number;
+	int error;
+
+	value = strchr(arg, '=');
+	if (!value) {
+		printk_err("Expected a name=value argument; got '%s'.\n", arg);
+		return -EINVAL;
+	}
+	*value = '\0';
+	value++;
+
+	for (param = params; param < params + param_count; param++) {
+		if (strcmp(param->name, arg) != 0)
+			continue;
+
+		switch (param->type) {
+		case PARAM_UINT:
+			error = kstrtoull_max(value, 0, UINT_MAX, &number);
+			if (!error)
+				*((unsigned int *) param->value) = number;
+			break;
+		case PARAM_INT:
+			error = kstrtoull_max(value, 0, INT_MAX, &number);
+			if (!error)
+				*((int *) param->value) = number;
+			break;
+		case PARAM_USHORT:
+			error = kstrtoull_max(value, 0, USHRT_MAX, &number);
+			if (!error)
+				*((unsigned short *) param->value) = number;
+			break;
+		case PARAM_BOOL:
+			error = kstrtoull_max(value, 0, 1, &number);
+			if (!error)
+				*((bool *) param->value) = number;
+			break;
+		default:
+			error = -EINVAL;
+		}
+
+		if (error)
+			printk_err("Invalid value for parameter '%s': '%s'.\n", arg, value);
+		return error;
+	}
+
+	printk_err("Unknown parameter: '%s'.\n", arg);
+	return -EINVAL;
+}
+
+int module_main(int argc, char **argv, int (*init)(void), void (*exit)(void))
+{
+	int i;
+	int error;
+
+	for (i = 1; i < argc; i++) {
+		error = parse_param(argv[i]);
+		if (error)
+			return -error;
+	}
+
+	/* Like insmod, a failing init means the module is never loaded, so exit does not run. */
+	error = init();
+	if (error)
+		return -error;
+
+	exit();
+	return 0;
+}
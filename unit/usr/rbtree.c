@@ -0,0 +1,276 @@
+#include <linux/rbtree.h>
+
+/*
+ * The textbook (Cormen et al.) red-black tree, on top of the kernel's node layout. Missing children
+ * are black leaves.
+ */
+
+static bool is_red(struct rb_node *node)
+{
+	return node && rb_color(node) == RB_RED;
+}
+
+static void set_parent(struct rb_node *node, struct rb_node *parent)
+{
+	node->__rb_parent_color = rb_color(node) | (unsigned long) parent;
+}
+
+static void set_color(struct rb_node *node, int color)
+{
+	node->__rb_parent_color = (node->__rb_parent_color & ~1UL) | color;
+}
+
+/** Makes "new" take "old"'s place as "parent"'s child. */
+static void change_child(struct rb_node *old, struct rb_node *new, struct rb_node *parent,
+		struct rb_root *root)
+{
+	if (!parent)
+		root->rb_node = new;
+	else if (parent->rb_left == old)
+		parent->rb_left = new;
+	else
+		parent->rb_right = new;
+}
+
+static void rotate_left(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *right = node->rb_right;
+	struct rb_node *parent = rb_parent(node);
+
+	node->rb_right = right->rb_left;
+	if (right->rb_left)
+		set_parent(right->rb_left, node);
+	right->rb_left = node;
+
+	set_parent(right, parent);
+	change_child(node, right, parent, root);
+	set_parent(node, right);
+}
+
+static void rotate_right(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *left = node->rb_left;
+	struct rb_node *parent = rb_parent(node);
+
+	node->rb_left = left->rb_right;
+	if (left->rb_right)
+		set_parent(left->rb_right, node);
+	left->rb_right = node;
+
+	set_parent(left, parent);
+	change_child(node, left, parent, root);
+	set_parent(node, left);
+}
+
+void rb_insert_color(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *parent, *gparent, *uncle;
+
+	set_color(node, RB_RED);
+
+	while ((parent = rb_parent(node)) && is_red(parent)) {
+		gparent = rb_parent(parent);
+
+		if (parent == gparent->rb_left) {
+			uncle = gparent->rb_right;
+			if (is_red(uncle)) {
+				set_color(parent, RB_BLACK);
+				set_color(uncle, RB_BLACK);
+				set_color(gparent, RB_RED);
+				node = gparent;
+				continue;
+			}
+			if (node == parent->rb_right) {
+				rotate_left(parent, root);
+				node = parent;
+				parent = rb_parent(node);
+			}
+			set_color(parent, RB_BLACK);
+			set_color(gparent, RB_RED);
+			rotate_right(gparent, root);
+		} else {
+			uncle = gparent->rb_left;
+			if (is_red(uncle)) {
+				set_color(parent, RB_BLACK);
+				set_color(uncle, RB_BLACK);
+				set_color(gparent, RB_RED);
+				node = gparent;
+				continue;
+			}
+			if (node == parent->rb_left) {
+				rotate_right(parent, root);
+				node = parent;
+				parent = rb_parent(node);
+			}
+			set_color(parent, RB_BLACK);
+			set_color(gparent, RB_RED);
+			rotate_left(gparent, root);
+		}
+	}
+
+	set_color(root->rb_node, RB_BLACK);
+}
+
+/** Restores the colors after a black node was removed; "node" (maybe NULL) took its place. */
+static void erase_color(struct rb_node *node, struct rb_node *parent, struct rb_root *root)
+{
+	struct rb_node *sibling;
+
+	while (node != root->rb_node && !is_red(node)) {
+		if (node == parent->rb_left) {
+			sibling = parent->rb_right;
+			if (is_red(sibling)) {
+				set_color(sibling, RB_BLACK);
+				set_color(parent, RB_RED);
+				rotate_left(parent, root);
+				sibling = parent->rb_right;
+			}
+			if (!is_red(sibling->rb_left) && !is_red(sibling->rb_right)) {
+				set_color(sibling, RB_RED);
+				node = parent;
+				parent = rb_parent(node);
+				continue;
+			}
+			if (!is_red(sibling->rb_right)) {
+				set_color(sibling->rb_left, RB_BLACK);
+				set_color(sibling, RB_RED);
+				rotate_right(sibling, root);
+				sibling = parent->rb_right;
+			}
+			set_color(sibling, rb_color(parent));
+			set_color(parent, RB_BLACK);
+			set_color(sibling->rb_right, RB_BLACK);
+			rotate_left(parent, root);
+		} else {
+			sibling = parent->rb_left;
+			if (is_red(sibling)) {
+				set_color(sibling, RB_BLACK);
+				set_color(parent, RB_RED);
+				rotate_right(parent, root);
+				sibling = parent->rb_left;
+			}
+			if (!is_red(sibling->rb_left) && !is_red(sibling->rb_right)) {
+				set_color(sibling, RB_RED);
+				node = parent;
+				parent = rb_parent(node);
+				continue;
+			}
+			if (!is_red(sibling->rb_left)) {
+				set_color(sibling->rb_right, RB_BLACK);
+				set_color(sibling, RB_RED);
+				rotate_left(sibling, root);
+				sibling = parent->rb_left;
+			}
+			set_color(sibling, rb_color(parent));
+			set_color(parent, RB_BLACK);
+			set_color(sibling->rb_left, RB_BLACK);
+			rotate_right(parent, root);
+		}
+		node = root->rb_node;
+		break;
+	}
+
+	if (node)
+		set_color(node, RB_BLACK);
+}
+
+void rb_erase(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node *child, *parent, *successor;
+	int color;
+
+	if (!node->rb_left || !node->rb_right) {
+		child = node->rb_left ? node->rb_left : node->rb_right;
+		parent = rb_parent(node);
+		color = rb_color(node);
+		if (child)
+			set_parent(child, parent);
+		change_child(node, child, parent, root);
+	} else {
+		successor = node->rb_right;
+		while (successor->rb_left)
+			successor = successor->rb_left;
+
+		/* Unlink the successor... */
+		child = successor->rb_right;
+		parent = rb_parent(successor);
+		color = rb_color(successor);
+		if (child)
+			set_parent(child, parent);
+		change_child(successor, child, parent, root);
+		if (parent == node)
+			parent = successor;
+
+		/* ...and move it where "node" was. */
+		successor->__rb_parent_color = node->__rb_parent_color;
+		successor->rb_left = node->rb_left;
+		successor->rb_right = node->rb_right;
+		change_child(node, successor, rb_parent(node), root);
+		set_parent(successor->rb_left, successor);
+		if (successor->rb_right)
+			set_parent(successor->rb_right, successor);
+	}
+
+	if (color == RB_BLACK)
+		erase_color(child, parent, root);
+}
+
+struct rb_node *rb_first(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+
+	if (!node)
+		return NULL;
+	while (node->rb_left)
+		node = node->rb_left;
+	return node;
+}
+
+struct rb_node *rb_last(const struct rb_root *root)
+{
+	struct rb_node *node = root->rb_node;
+
+	if (!node)
+		return NULL;
+	while (node->rb_right)
+		node = node->rb_right;
+	return node;
+}
+
+struct rb_node *rb_next(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	if (RB_EMPTY_NODE(node))
+		return NULL;
+
+	if (node->rb_right) {
+		node = node->rb_right;
+		while (node->rb_left)
+			node = node->rb_left;
+		return (struct rb_node *) node;
+	}
+
+	while ((parent = rb_parent(node)) && node == parent->rb_right)
+		node = parent;
+	return parent;
+}
+
+struct rb_node *rb_prev(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	if (RB_EMPTY_NODE(node))
+		return NULL;
+
+	if (node->rb_left) {
+		node = node->rb_left;
+		while (node->rb_right)
+			node = node->rb_right;
+		return (struct rb_node *) node;
+	}
+
+	while ((parent = rb_parent(node)) && node == parent->rb_left)
+		node = parent;
+	return parent;
+}
@@ -0,0 +1,82 @@
+/* Socket buffers and routes; see linux/skbuff.h and net/dst.h. */
+
+#include <linux/skbuff.h>
+#include <net/dst.h>
+
+
+struct sk_buff *alloc_skb(unsigned int size, gfp_t priority)
+{
+	struct sk_buff *skb;
+
+	skb = kzalloc(sizeof(*skb), priority);
+	if (!skb)
+		return NULL;
+
+	skb->head = kmalloc(size, priority);
+	if (!skb->head) {
+		kfree(skb);
+		return NULL;
+	}
+
+	skb->data = skb->head;
+	skb->tail = skb->head;
+	skb->end = skb->head + size;
+	skb->truesize = size + sizeof(*skb);
+
+	return skb;
+}
+
+void kfree_skb(struct sk_buff *skb)
+{
+	if (!skb)
+		return;
+
+	dst_release(skb->dst);
+	kfree(skb->head);
+	kfree(skb);
+}
+
+/**
+ * Unlike the kernel's, the clone does not share the data with the original; it gets a copy.
+ * Nothing in Jool writes on a clone, so nobody can tell.
+ */
+struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t priority)
+{
+	struct sk_buff *clone;
+	unsigned int size = skb->end - skb->head;
+
+	clone = alloc_skb(size, priority);
+	if (!clone)
+		return NULL;
+
+	memcpy(clone->head, skb->head, size);
+	clone->next = NULL;
+	clone->prev = NULL;
+	clone->dev = skb->dev;
+	clone->dst = dst_clone(skb->dst);
+	clone->len = skb->len;
+	clone->data_len = skb->data_len;
+	clone->protocol = skb->protocol;
+	clone->ip_summed = skb->ip_summed;
+	clone->priority = skb->priority;
+	clone->mark = skb->mark;
+	clone->csum = skb->csum;
+
+#define CLONE_POINTER(field) \
+	clone->field = skb->field ? clone->head + (skb->field - skb->head) : NULL
+	CLONE_POINTER(mac_header);
+	CLONE_POINTER(network_header);
+	CLONE_POINTER(transport_header);
+	CLONE_POINTER(data);
+	CLONE_POINTER(tail);
+#undef CLONE_POINTER
+
+	return clone;
+}
+
+/* Routes are never allocated here (see net/dst.h), so there is nothing to free. */
+void dst_release(struct dst_entry *dst)
+{
+	if (dst)
+		dst->__refcnt.counter--;
+}
@@ -3,90 +3,208 @@
 #include "nat64/comm/str_utils.h"
 #include "nat64/usr/netlink.h"
 #include "nat64/usr/dns.h"
+#include "nat64/usr/output.h"
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <arpa/inet.h>
 
 
 #define HDR_LEN sizeof(struct request_hdr)
 #define PAYLOAD_LEN sizeof(struct request_bib)
+/** Maximum number of entries sent to the kernel per import request. */
+#define IMPORT_BATCH_SIZE 1024
 
 
 struct display_params {
 	bool numeric_hostname;
+	enum output_format format;
+	l4_protocol l4_proto;
 	int row_count;
+	/** Number of "rows" which have not been printed yet. */
+	unsigned int pending;
+	/** Entries waiting for their names; unused if "numeric_hostname". */
+	struct bib_entry_us *rows;
+	unsigned int row_capacity;
 };
 
+static void print_bib_entry(struct bib_entry_us *entry, bool numeric_hostname)
+{
+	printf("[%s] ", entry->is_static ? "Static" : "Dynamic");
+	print_ipv4_tuple(&entry->ipv4, true);
+	printf(" - ");
+	print_ipv6_tuple(&entry->ipv6, numeric_hostname);
+	printf("\n");
+}
+
+/**
+ * Stores "entries" in "params" and requests their names, so they can be resolved concurrently
+ * while the rest of the table arrives.
+ */
+static int defer_entries(struct display_params *params, struct bib_entry_us *entries,
+		__u16 entry_count)
+{
+	struct bib_entry_us *rows;
+	unsigned int capacity;
+	__u16 i;
+
+	if (params->pending + entry_count > params->row_capacity) {
+		capacity = params->row_capacity ? params->row_capacity : 256;
+		while (capacity < params->pending + entry_count)
+			capacity *= 2;
+
+		rows = realloc(params->rows, capacity * sizeof(*rows));
+		if (!rows) {
+			log_err(ERR_ALLOC_FAILED, "Out of memory.");
+			return -ENOMEM;
+		}
+		params->rows = rows;
+		params->row_capacity = capacity;
+	}
+
+	for (i = 0; i < entry_count; i++) {
+		params->rows[params->pending + i] = entries[i];
+		dns_request_ipv6(&entries[i].ipv6.address);
+	}
+
+	params->pending += entry_count;
+	return 0;
+}
+
+/**
+ * Prints the pending rows, in order, for as long as their names are ready. If "wait" is true,
+ * prints all of them, waiting for their names if necessary.
+ */
+static void print_rows(struct display_params *params, bool wait)
+{
+	struct bib_entry_us *row;
+	unsigned int i;
+
+	for (i = 0; i < params->pending; i++) {
+		row = &params->rows[i];
+		if (!wait && !(dns_ready_ipv6(&row->ipv6.address)))
+			break;
+		print_bib_entry(row, false);
+	}
+
+	params->pending -= i;
+	memmove(params->rows, params->rows + i, params->pending * sizeof(*params->rows));
+	fflush(stdout);
+}
+
 static int bib_display_response(struct nl_msg *msg, void *arg)
 {
 	struct nlmsghdr *hdr;
 	struct bib_entry_us *entries;
 	struct display_params *params = arg;
 	__u16 entry_count, i;
+	int error;
 
 	hdr = nlmsg_hdr(msg);
-	entries = nlmsg_data(hdr);
-	entry_count = nlmsg_datalen(hdr) / sizeof(*entries);
-
-	for (i = 0; i < entry_count; i++) {
-		printf("[%s] ", entries[i].is_static ? "Static" : "Dynamic");
-		print_ipv4_tuple(&entries[i].ipv4, true);
-		printf(" - ");
-		print_ipv6_tuple(&entries[i].ipv6, params->numeric_hostname);
-		printf("\n");
+	entries = netlink_data(hdr);
+	entry_count = netlink_datalen(hdr) / sizeof(*entries);
+
+	if (params->format != OUTPUT_TEXT) {
+		for (i = 0; i < entry_count; i++)
+			output_bib_entry(params->format, params->l4_proto, &entries[i]);
+	} else if (params->numeric_hostname) {
+		for (i = 0; i < entry_count; i++)
+			print_bib_entry(&entries[i], true);
+	} else {
+		error = defer_entries(params, entries, entry_count);
+		if (error)
+			return error;
+		print_rows(params, false);
 	}
 
 	params->row_count += entry_count;
 	return 0;
 }
 
-static bool display_single_table(char *table_name, l4_protocol l4_proto, bool numeric_hostname)
+static bool display_single_table(char *table_name, l4_protocol l4_proto, bool numeric_hostname,
+		enum output_format format, struct table_query *query)
 {
 	unsigned char request[HDR_LEN + PAYLOAD_LEN];
 	struct request_hdr *hdr = (struct request_hdr *) request;
 	struct request_bib *payload = (struct request_bib *) (request + HDR_LEN);
 	struct display_params params;
+	bool resolve;
 	bool error;
 
-	printf("%s:\n", table_name);
+	if (format == OUTPUT_TEXT)
+		printf("%s:\n", table_name);
 
 	hdr->length = sizeof(request);
 	hdr->mode = MODE_BIB;
 	hdr->operation = OP_DISPLAY;
 	payload->l4_proto = l4_proto;
+	payload->display.query = *query;
 
 	params.numeric_hostname = numeric_hostname;
+	params.format = format;
+	params.l4_proto = l4_proto;
 	params.row_count = 0;
+	params.pending = 0;
+	params.rows = NULL;
+	params.row_capacity = 0;
+
+	resolve = (format == OUTPUT_TEXT) && !numeric_hostname;
+	if (resolve)
+		dns_start();
 
 	error = netlink_request(request, hdr->length, bib_display_response, &params);
-	if (!error) {
+	if (resolve) {
+		if (!error)
+			print_rows(&params, true);
+		dns_stop();
+	}
+
+	if (!error && format == OUTPUT_TEXT) {
 		if (params.row_count > 0)
 			printf("  (Fetched %u entries.)\n", params.row_count);
 		else
 			printf("  (empty)\n");
 	}
 
+	free(params.rows);
 	return error;
 }
 
-int bib_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname)
+int bib_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname,
+		enum output_format format, struct table_query *query)
 {
 	int tcp_error = 0;
 	int udp_error = 0;
 	int icmp_error = 0;
+	int output_error;
+
+	output_start(format);
+	output_bib_header(format);
 
 	if (use_tcp)
-		tcp_error = display_single_table("TCP", L4PROTO_TCP, numeric_hostname);
+		tcp_error = display_single_table("TCP", L4PROTO_TCP, numeric_hostname, format, query);
 	if (use_udp)
-		udp_error = display_single_table("UDP", L4PROTO_UDP, numeric_hostname);
+		udp_error = display_single_table("UDP", L4PROTO_UDP, numeric_hostname, format, query);
 	if (use_icmp)
-		icmp_error = display_single_table("ICMP", L4PROTO_ICMP, numeric_hostname);
+		icmp_error = display_single_table("ICMP", L4PROTO_ICMP, numeric_hostname, format, query);
 
-	return (tcp_error || udp_error || icmp_error) ? -EINVAL : 0;
+	output_error = output_end();
+
+	return (tcp_error || udp_error || icmp_error || output_error) ? -EINVAL : 0;
 }
 
 static int bib_count_response(struct nl_msg *msg, void *arg)
 {
-	__u64 *conf = nlmsg_data(nlmsg_hdr(msg));
-	printf("%llu\n", *conf);
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct table_count_us *count = netlink_data(hdr);
+
+	/* Older modules only send the count. */
+	if (netlink_datalen(hdr) >= sizeof(*count))
+		printf("%llu (%llu bytes)\n", count->count, count->bytes);
+	else
+		printf("%llu\n", count->count);
 	return 0;
 }
 
@@ -205,3 +323,323 @@ int bib_remove_ipv4(bool use_tcp, bool use_udp, bool use_icmp, struct ipv4_tuple
 
 	return exec_request(use_tcp, use_udp, use_icmp, hdr, payload, bib_remove_response);
 }
+
+static char *l4proto_name(l4_protocol l4_proto)
+{
+	switch (l4_proto) {
+	case L4PROTO_TCP:
+		return "TCP";
+	case L4PROTO_UDP:
+		return "UDP";
+	case L4PROTO_ICMP:
+		return "ICMP";
+	default:
+		return NULL;
+	}
+}
+
+struct export_params {
+	FILE *file;
+	l4_protocol l4_proto;
+	unsigned int count;
+};
+
+static int bib_export_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr;
+	struct bib_entry_us *entries;
+	struct export_params *params = arg;
+	char addr6[INET6_ADDRSTRLEN];
+	char addr4[INET_ADDRSTRLEN];
+	__u16 entry_count, i;
+
+	hdr = nlmsg_hdr(msg);
+	entries = netlink_data(hdr);
+	entry_count = netlink_datalen(hdr) / sizeof(*entries);
+
+	for (i = 0; i < entry_count; i++) {
+		if (!entries[i].is_static)
+			continue;
+
+		inet_ntop(AF_INET6, &entries[i].ipv6.address, addr6, sizeof(addr6));
+		inet_ntop(AF_INET, &entries[i].ipv4.address, addr4, sizeof(addr4));
+		fprintf(params->file, "%s %s#%u %s#%u\n", l4proto_name(params->l4_proto),
+				addr6, entries[i].ipv6.l4_id, addr4, entries[i].ipv4.l4_id);
+		params->count++;
+	}
+
+	return 0;
+}
+
+static int export_single_table(struct nl_sock *sk, l4_protocol l4_proto,
+		struct export_params *params)
+{
+	unsigned char request[HDR_LEN + PAYLOAD_LEN];
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct request_bib *payload = (struct request_bib *) (request + HDR_LEN);
+
+	hdr->length = sizeof(request);
+	hdr->mode = MODE_BIB;
+	hdr->operation = OP_DISPLAY;
+	payload->l4_proto = l4_proto;
+	memset(&payload->display.query, 0, sizeof(payload->display.query));
+
+	params->l4_proto = l4_proto;
+	return netlink_send(sk, request, hdr->length, bib_export_response, params);
+}
+
+int bib_export(bool use_tcp, bool use_udp, bool use_icmp, char *file_name)
+{
+	struct export_params params;
+	struct nl_sock *sk;
+	bool use_stdout = strcmp(file_name, "-") == 0;
+	int error;
+
+	params.file = use_stdout ? stdout : fopen(file_name, "w");
+	if (!params.file) {
+		log_err(ERR_PARSE_FILE, "Cannot open '%s' for writing.", file_name);
+		return -EINVAL;
+	}
+	params.count = 0;
+
+	error = netlink_open(&sk);
+	if (error)
+		goto end;
+
+	if (use_tcp)
+		error = export_single_table(sk, L4PROTO_TCP, &params);
+	if (!error && use_udp)
+		error = export_single_table(sk, L4PROTO_UDP, &params);
+	if (!error && use_icmp)
+		error = export_single_table(sk, L4PROTO_ICMP, &params);
+
+	netlink_close(sk);
+	/* Fall through. */
+
+end:
+	if (!use_stdout && fclose(params.file) != 0 && !error) {
+		log_err(ERR_PARSE_FILE, "Could not finish writing '%s'.", file_name);
+		error = -EINVAL;
+	}
+	if (!error && !use_stdout)
+		log_info("Exported %u static BIB entries.", params.count);
+	return error;
+}
+
+struct import_list {
+	struct bib_import_us *entries;
+	/** Line of the file each entry was read from. */
+	unsigned int *lines;
+	unsigned int count;
+	unsigned int capacity;
+};
+
+static int parse_l4_proto(char *str, l4_protocol *result)
+{
+	if (strcasecmp(str, "TCP") == 0)
+		*result = L4PROTO_TCP;
+	else if (strcasecmp(str, "UDP") == 0)
+		*result = L4PROTO_UDP;
+	else if (strcasecmp(str, "ICMP") == 0)
+		*result = L4PROTO_ICMP;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Parses a "PROTOCOL ADDR6#NUM ADDR4#NUM" line. Sets "empty" if the line has no entry (blank or
+ * comment).
+ */
+static int parse_line(char *line, unsigned int line_num, struct bib_import_us *entry, bool *empty)
+{
+	const char *DELIMITERS = " \t\r\n";
+	char *save;
+	char *token;
+	int error;
+
+	*empty = false;
+
+	/* The address parsers use strtok(), so strtok_r() is used here. */
+	token = strtok_r(line, DELIMITERS, &save);
+	if (!token || token[0] == '#') {
+		*empty = true;
+		return 0;
+	}
+	if (parse_l4_proto(token, &entry->l4_proto)) {
+		log_err(ERR_PARSE_FILE, "Line %u: '%s' is not TCP, UDP or ICMP.", line_num, token);
+		return -EINVAL;
+	}
+
+	token = strtok_r(NULL, DELIMITERS, &save);
+	if (!token) {
+		log_err(ERR_PARSE_FILE, "Line %u: Missing IPv6 address#port.", line_num);
+		return -EINVAL;
+	}
+	error = str_to_addr6_port(token, &entry->ipv6);
+	if (error) {
+		log_err(ERR_PARSE_FILE, "Line %u: Invalid IPv6 address#port.", line_num);
+		return error;
+	}
+
+	token = strtok_r(NULL, DELIMITERS, &save);
+	if (!token) {
+		log_err(ERR_PARSE_FILE, "Line %u: Missing IPv4 address#port.", line_num);
+		return -EINVAL;
+	}
+	error = str_to_addr4_port(token, &entry->ipv4);
+	if (error) {
+		log_err(ERR_PARSE_FILE, "Line %u: Invalid IPv4 address#port.", line_num);
+		return error;
+	}
+
+	token = strtok_r(NULL, DELIMITERS, &save);
+	if (token && token[0] != '#') {
+		log_err(ERR_PARSE_FILE, "Line %u: Unexpected '%s'.", line_num, token);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int list_add(struct import_list *list, struct bib_import_us *entry, unsigned int line_num)
+{
+	struct bib_import_us *entries;
+	unsigned int *lines;
+	unsigned int capacity;
+
+	if (list->count == list->capacity) {
+		capacity = list->capacity ? (2 * list->capacity) : IMPORT_BATCH_SIZE;
+
+		entries = realloc(list->entries, capacity * sizeof(*entries));
+		if (!entries)
+			goto fail;
+		list->entries = entries;
+
+		lines = realloc(list->lines, capacity * sizeof(*lines));
+		if (!lines)
+			goto fail;
+		list->lines = lines;
+
+		list->capacity = capacity;
+	}
+
+	list->entries[list->count] = *entry;
+	list->lines[list->count] = line_num;
+	list->count++;
+	return 0;
+
+fail:
+	log_err(ERR_ALLOC_FAILED, "Out of memory.");
+	return -ENOMEM;
+}
+
+/**
+ * Reads all of "file_name"'s entries, so a typo anywhere can stop the import before it starts.
+ */
+static int read_file(char *file_name, struct import_list *list)
+{
+	FILE *file;
+	char *line = NULL;
+	size_t line_size = 0;
+	unsigned int line_num = 0;
+	struct bib_import_us entry;
+	bool empty;
+	int error = 0;
+
+	file = (strcmp(file_name, "-") == 0) ? stdin : fopen(file_name, "r");
+	if (!file) {
+		log_err(ERR_PARSE_FILE, "Cannot open '%s'.", file_name);
+		return -EINVAL;
+	}
+
+	while (getline(&line, &line_size, file) != -1) {
+		line_num++;
+		error = parse_line(line, line_num, &entry, &empty);
+		if (error)
+			break;
+		if (!empty) {
+			error = list_add(list, &entry, line_num);
+			if (error)
+				break;
+		}
+	}
+
+	free(line);
+	if (file != stdin)
+		fclose(file);
+	return error;
+}
+
+static int bib_import_response(struct nl_msg *msg, void *arg)
+{
+	return 0;
+}
+
+int bib_import(char *file_name)
+{
+	struct import_list list = { NULL, NULL, 0, 0 };
+	unsigned char *request;
+	struct request_hdr *hdr;
+	struct request_bib *payload;
+	struct nl_sock *sk;
+	unsigned int sent, batch;
+	int error;
+
+	error = read_file(file_name, &list);
+	if (error)
+		goto end;
+	if (list.count == 0) {
+		log_info("The file contains no entries.");
+		goto end;
+	}
+
+	request = malloc(HDR_LEN + PAYLOAD_LEN + IMPORT_BATCH_SIZE * sizeof(*list.entries));
+	if (!request) {
+		log_err(ERR_ALLOC_FAILED, "Out of memory.");
+		error = -ENOMEM;
+		goto end;
+	}
+	hdr = (struct request_hdr *) request;
+	payload = (struct request_bib *) (request + HDR_LEN);
+
+	error = netlink_open(&sk);
+	if (error)
+		goto free_request;
+
+	for (sent = 0; sent < list.count; sent += batch) {
+		batch = list.count - sent;
+		if (batch > IMPORT_BATCH_SIZE)
+			batch = IMPORT_BATCH_SIZE;
+
+		hdr->length = HDR_LEN + PAYLOAD_LEN + batch * sizeof(*list.entries);
+		hdr->mode = MODE_BIB;
+		hdr->operation = OP_IMPORT;
+		payload->import.count = batch;
+		memcpy(payload + 1, &list.entries[sent], batch * sizeof(*list.entries));
+
+		error = netlink_send(sk, request, hdr->length, bib_import_response, NULL);
+		if (error) {
+			log_err(ERR_BIB_REINSERT, "The entries from lines %u through %u could not be added "
+					"(see the kernel log). The %u before them were.",
+					list.lines[sent], list.lines[sent + batch - 1], sent);
+			break;
+		}
+	}
+
+	if (!error)
+		log_info("Imported %u BIB entries.", list.count);
+
+	netlink_close(sk);
+	/* Fall through. */
+
+free_request:
+	free(request);
+	/* Fall through. */
+
+end:
+	free(list.entries);
+	free(list.lines);
+	return error;
+}
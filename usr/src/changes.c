@@ -0,0 +1,161 @@
+#include "nat64/usr/changes.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/usr/netlink.h"
+#include "nat64/usr/dns.h"
+#include <errno.h>
+#include <string.h>
+
+
+struct display_params {
+	enum output_format format;
+	bool numeric_hostname;
+	/** Generation of the last change printed. */
+	__u64 latest;
+};
+
+static char *l4proto_name(__u8 l4_proto)
+{
+	switch (l4_proto) {
+	case L4PROTO_TCP:
+		return "TCP";
+	case L4PROTO_UDP:
+		return "UDP";
+	case L4PROTO_ICMP:
+		return "ICMP";
+	}
+
+	return "?";
+}
+
+static char *type_name(__u8 type)
+{
+	switch (type) {
+	case CHANGE_CREATED:
+		return "Created";
+	case CHANGE_UPDATED:
+		return "Updated";
+	case CHANGE_REMOVED:
+		return "Removed";
+	}
+
+	return "?";
+}
+
+static void print_change(struct change_us *change, bool numeric_hostname)
+{
+	printf("%llu: %s %s", change->generation, type_name(change->type),
+			l4proto_name(change->l4_proto));
+
+	if (change->table == CHANGE_BIB) {
+		printf(" %sBIB entry: ", change->is_static ? "static " : "");
+		print_ipv6_tuple(&change->ipv6.remote, numeric_hostname);
+		printf(" - ");
+		print_ipv4_tuple(&change->ipv4.local, numeric_hostname);
+	} else {
+		printf(" session: ");
+		print_ipv6_tuple(&change->ipv6.remote, numeric_hostname);
+		printf(" ");
+		print_ipv6_tuple(&change->ipv6.local, true);
+		printf(" - ");
+		print_ipv4_tuple(&change->ipv4.local, true);
+		printf(" ");
+		print_ipv4_tuple(&change->ipv4.remote, numeric_hostname);
+	}
+
+	printf("\n");
+}
+
+static int changes_display_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr;
+	struct change_us *changes;
+	struct display_params *params = arg;
+	__u16 change_count, i;
+
+	hdr = nlmsg_hdr(msg);
+	changes = netlink_data(hdr);
+	change_count = netlink_datalen(hdr) / sizeof(*changes);
+
+	for (i = 0; i < change_count; i++) {
+		if (params->format == OUTPUT_TEXT)
+			print_change(&changes[i], params->numeric_hostname);
+		else
+			output_change(params->format, &changes[i]);
+	}
+
+	if (change_count > 0)
+		params->latest = changes[change_count - 1].generation;
+	return 0;
+}
+
+static int range_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+
+	if (netlink_datalen(hdr) < sizeof(struct changelog_range_us)) {
+		log_err(ERR_NETLINK, "The module's response is too short.");
+		return -EINVAL;
+	}
+
+	memcpy(arg, netlink_data(hdr), sizeof(struct changelog_range_us));
+	return 0;
+}
+
+static int get_range(struct changelog_range_us *range)
+{
+	struct request_hdr request = {
+			.length = sizeof(request),
+			.mode = MODE_CHANGES,
+			.operation = OP_COUNT,
+	};
+
+	return netlink_request(&request, request.length, range_response, range);
+}
+
+int changes_display(bool since_set, __u64 since, enum output_format format,
+		bool numeric_hostname)
+{
+	unsigned char request[sizeof(struct request_hdr) + sizeof(struct request_changes)];
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct request_changes *payload = (struct request_changes *) (hdr + 1);
+	struct changelog_range_us range;
+	struct display_params params;
+	int output_error;
+	int error;
+
+	error = get_range(&range);
+	if (error)
+		return error;
+
+	if (!since_set) {
+		printf("Latest generation: %llu\n", range.latest);
+		printf("Oldest generation --since accepts: %llu\n", range.oldest);
+		return 0;
+	}
+
+	/* The module would refuse this too, but its reason would only reach the kernel log. */
+	if (since < range.oldest || since > range.latest) {
+		log_err(ERR_UNKNOWN_ERROR, "The changes since generation %llu are no longer available "
+				"(the log covers %llu to %llu); display the tables again instead.",
+				since, range.oldest, range.latest);
+		return -ESTALE;
+	}
+
+	hdr->length = sizeof(request);
+	hdr->mode = MODE_CHANGES;
+	hdr->operation = OP_DISPLAY;
+	payload->since = since;
+
+	params.format = format;
+	params.numeric_hostname = numeric_hostname;
+	params.latest = since;
+
+	output_start(format);
+	output_change_header(format);
+	error = netlink_request(request, hdr->length, changes_display_response, &params);
+	if (!error && format == OUTPUT_TEXT)
+		printf("Latest generation: %llu\n", params.latest);
+
+	output_error = output_end();
+	return error ? error : output_error;
+}
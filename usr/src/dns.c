@@ -1,63 +1,413 @@
 #include "nat64/usr/dns.h"
+#include <errno.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-void print_ipv6_tuple(struct ipv6_tuple_address *tuple, bool numeric_hostname)
+
+/** Maximum number of names being looked up at the same time. */
+#define DNS_WORKERS 16
+/** Number of slots of the cache's hash table. */
+#define DNS_SLOTS 4096
+
+enum dns_state {
+	/** Nobody has attempted to resolve the address yet. */
+	DNS_NEW,
+	/** The address is waiting for a worker. */
+	DNS_QUEUED,
+	/** A worker is resolving the address. */
+	DNS_RESOLVING,
+	/** The resolver answered ("name" holds the outcome). */
+	DNS_DONE,
+};
+
+struct dns_entry {
+	/** AF_INET or AF_INET6. */
+	int family;
+	union {
+		struct in_addr v4;
+		struct in6_addr v6;
+	} addr;
+	enum dns_state state;
+	/** The address's name. NULL if it has none. */
+	char *name;
+	/** Point in time after which the printing functions stop waiting for the lookup. */
+	struct timespec deadline;
+	/** Next entry from the same slot of "cache". */
+	struct dns_entry *next;
+	/** Next entry from "queue". */
+	struct dns_entry *next_queued;
+};
+
+/** Every address that has been requested, resolved or not. Lives until the program ends. */
+static struct dns_entry *cache[DNS_SLOTS];
+/** Entries waiting for a worker, oldest first. */
+static struct dns_entry *queue;
+static struct dns_entry **queue_tail = &queue;
+static unsigned int queue_len;
+
+/** Whether the queue is being served (ie. we're between dns_start() and dns_stop()). */
+static bool running;
+/** Number of workers alive. They quit once the queue runs dry. */
+static unsigned int worker_count;
+/** Number of workers currently waiting for the resolver. */
+static unsigned int busy_workers;
+/** Milliseconds the printing functions wait for each lookup. */
+static unsigned int timeout = DNS_DEFAULT_TIMEOUT;
+
+/** Protects everything above. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/** Signaled whenever a lookup ends. */
+static pthread_cond_t lookup_done = PTHREAD_COND_INITIALIZER;
+
+
+static unsigned int hash_addr(const void *addr, size_t len)
 {
-	char hostname[NI_MAXHOST], service[NI_MAXSERV];
-	char hostaddr[INET6_ADDRSTRLEN];
+	const unsigned char *bytes = addr;
+	unsigned int hash = 2166136261U; /* FNV-1a. */
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619U;
+	}
+
+	return hash % DNS_SLOTS;
+}
+
+static size_t addr_len(int family)
+{
+	return (family == AF_INET) ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+}
+
+/**
+ * Returns the cache entry of "addr", creating it if it doesn't exist. Returns NULL on allocation
+ * failure. Assumes the lock is held.
+ */
+static struct dns_entry *get_entry(int family, const void *addr)
+{
+	size_t len = addr_len(family);
+	unsigned int slot = hash_addr(addr, len);
+	struct dns_entry *entry;
+
+	for (entry = cache[slot]; entry; entry = entry->next)
+		if (entry->family == family && memcmp(&entry->addr, addr, len) == 0)
+			return entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+
+	entry->family = family;
+	memcpy(&entry->addr, addr, len);
+	entry->state = DNS_NEW;
+	entry->next = cache[slot];
+	cache[slot] = entry;
+
+	return entry;
+}
+
+/**
+ * Asks the resolver for "entry"'s name, and stores the outcome in "entry". Blocks. The lock must
+ * NOT be held when this is called; it is held when this returns.
+ */
+static void resolve(struct dns_entry *entry)
+{
+	char hostname[NI_MAXHOST];
+	struct sockaddr_in sa4;
 	struct sockaddr_in6 sa6;
-	int err;
+	struct sockaddr *sa;
+	socklen_t sa_len;
+	int error;
 
-	if (numeric_hostname)
-		goto print_numeric;
+	if (entry->family == AF_INET) {
+		memset(&sa4, 0, sizeof(sa4));
+		sa4.sin_family = AF_INET;
+		sa4.sin_addr = entry->addr.v4;
+		sa = (struct sockaddr *) &sa4;
+		sa_len = sizeof(sa4);
+	} else {
+		memset(&sa6, 0, sizeof(sa6));
+		sa6.sin6_family = AF_INET6;
+		sa6.sin6_addr = entry->addr.v6;
+		sa = (struct sockaddr *) &sa6;
+		sa_len = sizeof(sa6);
+	}
 
-	memset(&sa6, 0, sizeof(struct sockaddr_in6));
-	sa6.sin6_family = AF_INET6;
-	sa6.sin6_port = htons(tuple->l4_id);
-	sa6.sin6_addr = tuple->address;
+	error = getnameinfo(sa, sa_len, hostname, sizeof(hostname), NULL, 0, NI_NAMEREQD);
 
-	err = getnameinfo((const struct sockaddr*) &sa6, sizeof(sa6),
-			hostname, sizeof(hostname), service, sizeof(service), 0);
-	if (err != 0) {
-		log_err(ERR_UNKNOWN_ERROR, "getnameinfo failed: %s", gai_strerror(err));
-		goto print_numeric;
+	pthread_mutex_lock(&lock);
+	if (!error) {
+		entry->name = strdup(hostname);
+		entry->state = DNS_DONE;
+	} else if (error == EAI_AGAIN || error == EAI_FAIL || error == EAI_SYSTEM) {
+		/* The resolver is having a bad day; don't remember that, let the next query retry. */
+		entry->state = DNS_NEW;
+	} else {
+		/* Addresses without names are perfectly normal; they're just printed numerically. */
+		entry->state = DNS_DONE;
 	}
+	pthread_cond_broadcast(&lookup_done);
+}
 
-	printf("%s#%s", hostname, service);
-	return;
+static void *worker_fn(void *arg)
+{
+	struct dns_entry *entry;
 
-print_numeric:
-	inet_ntop(AF_INET6, &tuple->address, hostaddr, sizeof(hostaddr));
-	printf("%s#%u", hostaddr, tuple->l4_id);
+	pthread_mutex_lock(&lock);
+	while (queue) {
+		entry = queue;
+		queue = entry->next_queued;
+		if (!queue)
+			queue_tail = &queue;
+		queue_len--;
+
+		entry->state = DNS_RESOLVING;
+		busy_workers++;
+		pthread_mutex_unlock(&lock);
+
+		resolve(entry);
+		busy_workers--;
+	}
+	worker_count--;
+	pthread_mutex_unlock(&lock);
+
+	return NULL;
 }
 
-void print_ipv4_tuple(struct ipv4_tuple_address *tuple, bool numeric_hostname)
+/**
+ * Makes sure there are enough workers to serve the queue. Assumes the lock is held.
+ */
+static void spawn_workers(void)
+{
+	pthread_attr_t attr;
+	pthread_t worker;
+	int error;
+
+	if (!running)
+		return;
+
+	/* Nobody waits for the workers; the ones stuck in the resolver are simply abandoned. */
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	while (worker_count < DNS_WORKERS && worker_count - busy_workers < queue_len) {
+		error = pthread_create(&worker, &attr, worker_fn, NULL);
+		if (error) {
+			log_err(ERR_UNKNOWN_ERROR, "Could not create a DNS worker: %s", strerror(error));
+			break;
+		}
+		worker_count++;
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+/**
+ * Sets "entry"'s deadline to "timeout" milliseconds from now.
+ */
+static void set_deadline(struct dns_entry *entry)
 {
-	char hostname[NI_MAXHOST], service[NI_MAXSERV];
-	char *hostaddr;
-	struct sockaddr_in sa;
-	int err;
+	struct timespec *deadline = &entry->deadline;
+
+	clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += timeout / 1000;
+	deadline->tv_nsec += (timeout % 1000) * 1000000L;
+	if (deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/**
+ * Returns whether "entry"'s lookup is still worth waiting for. Assumes the lock is held.
+ */
+static bool is_pending(struct dns_entry *entry)
+{
+	struct timespec now;
+
+	if (entry->state != DNS_QUEUED && entry->state != DNS_RESOLVING)
+		return false;
 
-	if (numeric_hostname)
-		goto print_numeric;
+	clock_gettime(CLOCK_REALTIME, &now);
+	if (now.tv_sec != entry->deadline.tv_sec)
+		return now.tv_sec < entry->deadline.tv_sec;
+	return now.tv_nsec < entry->deadline.tv_nsec;
+}
+
+static void request(int family, const void *addr)
+{
+	struct dns_entry *entry;
 
-	memset(&sa, 0, sizeof(struct sockaddr_in));
-	sa.sin_family = AF_INET;
-	sa.sin_port = htons(tuple->l4_id);
-	sa.sin_addr = tuple->address;
+	pthread_mutex_lock(&lock);
 
-	err = getnameinfo((const struct sockaddr*) &sa, sizeof(sa),
-			hostname, sizeof(hostname), service, sizeof(service), 0);
-	if (err != 0) {
-		log_err(ERR_UNKNOWN_ERROR, "getnameinfo failed: %s", gai_strerror(err));
-		goto print_numeric;
+	entry = get_entry(family, addr);
+	if (entry && entry->state == DNS_NEW) {
+		entry->state = DNS_QUEUED;
+		entry->next_queued = NULL;
+		*queue_tail = entry;
+		queue_tail = &entry->next_queued;
+		queue_len++;
+		set_deadline(entry);
+		spawn_workers();
 	}
 
-	printf("%s#%s", hostname, service);
-	return;
+	pthread_mutex_unlock(&lock);
+}
+
+void dns_request_ipv6(struct in6_addr *addr)
+{
+	request(AF_INET6, addr);
+}
 
-print_numeric:
-	hostaddr = inet_ntoa(tuple->address);
+void dns_request_ipv4(struct in_addr *addr)
+{
+	request(AF_INET, addr);
+}
+
+/**
+ * Returns whether the printing functions are done waiting for the name of "addr".
+ */
+static bool is_ready(int family, const void *addr)
+{
+	struct dns_entry *entry;
+	bool ready;
+
+	pthread_mutex_lock(&lock);
+	entry = get_entry(family, addr);
+	ready = !entry || !is_pending(entry);
+	pthread_mutex_unlock(&lock);
+
+	return ready;
+}
+
+bool dns_ready_ipv6(struct in6_addr *addr)
+{
+	return is_ready(AF_INET6, addr);
+}
+
+bool dns_ready_ipv4(struct in_addr *addr)
+{
+	return is_ready(AF_INET, addr);
+}
+
+void dns_set_timeout(unsigned int millis)
+{
+	timeout = millis;
+}
+
+void dns_start(void)
+{
+	struct dns_entry *entry;
+
+	pthread_mutex_lock(&lock);
+	running = true;
+	/* Whatever was requested earlier only starts counting now. */
+	for (entry = queue; entry; entry = entry->next_queued)
+		set_deadline(entry);
+	spawn_workers();
+	pthread_mutex_unlock(&lock);
+}
+
+void dns_stop(void)
+{
+	struct dns_entry *entry;
+
+	pthread_mutex_lock(&lock);
+
+	/*
+	 * Nobody got to these in time, which says nothing about their names, so they're forgotten
+	 * rather than cached. The next request queues them again.
+	 */
+	for (entry = queue; entry; entry = entry->next_queued)
+		entry->state = DNS_NEW;
+	queue = NULL;
+	queue_tail = &queue;
+	queue_len = 0;
+	running = false;
+
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Returns the name of "addr", or NULL if it has none or it could not be found in time.
+ */
+static char *get_name(int family, const void *addr)
+{
+	struct dns_entry *entry;
+	char *name;
+
+	pthread_mutex_lock(&lock);
+
+	entry = get_entry(family, addr);
+	if (!entry) {
+		pthread_mutex_unlock(&lock);
+		return NULL;
+	}
+
+	if (entry->state == DNS_NEW) {
+		/* Nobody requested it in advance, so there's no batch to wait for. */
+		entry->state = DNS_RESOLVING;
+		set_deadline(entry);
+		pthread_mutex_unlock(&lock);
+		resolve(entry);
+	}
+
+	while (is_pending(entry)) {
+		if (pthread_cond_timedwait(&lookup_done, &lock, &entry->deadline) == ETIMEDOUT)
+			break;
+	}
+
+	name = (entry->state == DNS_DONE) ? entry->name : NULL;
+	pthread_mutex_unlock(&lock);
+	return name;
+}
+
+/**
+ * Prints "name"#"port". The port is printed as a service name if /etc/services knows it.
+ */
+static void print_named_tuple(char *name, __u16 port)
+{
+	struct servent *service;
+
+	service = getservbyport(htons(port), NULL);
+	if (service)
+		printf("%s#%s", name, service->s_name);
+	else
+		printf("%s#%u", name, port);
+}
+
+void print_ipv6_tuple(struct ipv6_tuple_address *tuple, bool numeric_hostname)
+{
+	char hostaddr[INET6_ADDRSTRLEN];
+	char *name;
+
+	if (!numeric_hostname) {
+		name = get_name(AF_INET6, &tuple->address);
+		if (name) {
+			print_named_tuple(name, tuple->l4_id);
+			return;
+		}
+	}
+
+	inet_ntop(AF_INET6, &tuple->address, hostaddr, sizeof(hostaddr));
 	printf("%s#%u", hostaddr, tuple->l4_id);
 }
+
+void print_ipv4_tuple(struct ipv4_tuple_address *tuple, bool numeric_hostname)
+{
+	char *name;
+
+	if (!numeric_hostname) {
+		name = get_name(AF_INET, &tuple->address);
+		if (name) {
+			print_named_tuple(name, tuple->l4_id);
+			return;
+		}
+	}
+
+	printf("%s#%u", inet_ntoa(tuple->address), tuple->l4_id);
+}
@@ -0,0 +1,127 @@
+#include "nat64/usr/events.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/comm/events.h"
+#include "nat64/usr/netlink.h"
+#include "nat64/usr/stats.h"
+#include "nat64/usr/dns.h"
+#include <errno.h>
+
+
+struct display_params {
+	bool numeric_hostname;
+	int row_count;
+};
+
+static char *l4proto_name(__u8 l4_proto)
+{
+	switch (l4_proto) {
+	case L4PROTO_TCP:
+		return "TCP";
+	case L4PROTO_UDP:
+		return "UDP";
+	case L4PROTO_ICMP:
+		return "ICMP";
+	}
+
+	return "?";
+}
+
+static void print_pair(struct event_us *event, bool numeric_hostname)
+{
+	print_ipv6_tuple(&event->ipv6, numeric_hostname);
+	printf(" - ");
+	print_ipv4_tuple(&event->ipv4, numeric_hostname);
+}
+
+static int events_display_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr;
+	struct event_us *events;
+	struct display_params *params = arg;
+	__u16 event_count, i;
+
+	hdr = nlmsg_hdr(msg);
+	events = netlink_data(hdr);
+	event_count = netlink_datalen(hdr) / sizeof(*events);
+
+	for (i = 0; i < event_count; i++) {
+		struct event_us *event = &events[i];
+
+		printf("%llu ms ago, %s: ", event->age, l4proto_name(event->l4_proto));
+
+		switch (event->type) {
+		case EVENT_BIB_CREATED:
+			printf("BIB entry created: ");
+			print_pair(event, params->numeric_hostname);
+			break;
+		case EVENT_BIB_REMOVED:
+			printf("BIB entry removed: ");
+			print_pair(event, params->numeric_hostname);
+			break;
+		case EVENT_SESSION_CREATED:
+			printf("Session created: ");
+			print_pair(event, params->numeric_hostname);
+			break;
+		case EVENT_SESSION_EXPIRED:
+			printf("Session expired: ");
+			print_pair(event, params->numeric_hostname);
+			break;
+		case EVENT_POOL4_EXHAUSTED:
+			printf("pool4 ran out of transport addresses for ");
+			print_ipv6_tuple(&event->ipv6, params->numeric_hostname);
+			break;
+		case EVENT_DROP:
+			printf("Dropped (%s) a packet from ", stats_name(event->reason));
+			if (event->ipv4.address.s_addr != 0)
+				print_ipv4_tuple(&event->ipv4, params->numeric_hostname);
+			else
+				print_ipv6_tuple(&event->ipv6, params->numeric_hostname);
+			break;
+		default:
+			printf("Unknown event #%u", event->type);
+		}
+
+		printf("\n");
+	}
+
+	params->row_count += event_count;
+	return 0;
+}
+
+static int events_follow_response(struct nl_msg *msg, void *arg)
+{
+	int error;
+
+	error = events_display_response(msg, arg);
+	/* Whoever is reading (eg. a pipe) shouldn't have to wait for the buffer to fill up. */
+	fflush(stdout);
+
+	return error;
+}
+
+int events_display(bool numeric_hostname, bool follow)
+{
+	struct request_hdr request = {
+			.length = sizeof(request),
+			.mode = MODE_EVENTS,
+			.operation = OP_DISPLAY,
+	};
+	struct display_params params;
+	int error;
+
+	params.numeric_hostname = numeric_hostname;
+	params.row_count = 0;
+
+	if (follow)
+		return netlink_listen_events(events_follow_response, &params);
+
+	error = netlink_request(&request, request.length, events_display_response, &params);
+	if (!error) {
+		if (params.row_count > 0)
+			log_info("  (Fetched %u events.)\n", params.row_count);
+		else
+			log_info("  (No new events.)\n");
+	}
+
+	return error;
+}
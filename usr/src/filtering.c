@@ -7,9 +7,18 @@
 #define HDR_LEN sizeof(struct request_hdr)
 #define PAYLOAD_LEN sizeof(struct filtering_config)
 
+static void print_limit(char *name, char *opt, __u64 limit)
+{
+	printf("%s (%s): ", name, opt);
+	if (limit)
+		printf("%llu\n", limit);
+	else
+		printf("unlimited\n");
+}
+
 static int handle_display_response(struct nl_msg *msg, void *arg)
 {
-	struct filtering_config *conf = nlmsg_data(nlmsg_hdr(msg));
+	struct filtering_config *conf = netlink_data(nlmsg_hdr(msg));
 
 	printf("Address dependent filtering (%s): %s\n", DROP_BY_ADDR_OPT,
 			conf->drop_by_addr ? "ON" : "OFF");
@@ -17,6 +26,8 @@ static int handle_display_response(struct nl_msg *msg, void *arg)
 			conf->drop_icmp6_info ? "ON" : "OFF");
 	printf("Dropping externally initiated TCP connections (%s): %s\n", DROP_EXTERNAL_TCP_OPT,
 			conf->drop_external_tcp ? "ON" : "OFF");
+	printf("Deferring externally initiated TCP sessions (%s): %s\n", DEFER_EXTERNAL_TCP_OPT,
+			conf->defer_external_tcp ? "ON" : "OFF");
 	printf("UDP session lifetime (%s): ", UDP_TIMEOUT_OPT);
 	print_time(conf->to.udp);
 	printf("TCP established session lifetime (%s): ", TCP_EST_TIMEOUT_OPT);
@@ -25,6 +36,16 @@ static int handle_display_response(struct nl_msg *msg, void *arg)
 	print_time(conf->to.tcp_trans);
 	printf("ICMP session lifetime (%s): ", ICMP_TIMEOUT_OPT);
 	print_time(conf->to.icmp);
+	print_limit("Maximum BIB entries", BIB_MAX_OPT, conf->max.bib);
+	print_limit("Maximum sessions", SESSION_MAX_OPT, conf->max.session);
+	print_limit("Maximum BIB entries per IPv6 node", BIB_NODE_MAX_OPT, conf->max.bib_per_node);
+	print_limit("Maximum sessions per IPv6 node", SESSION_NODE_MAX_OPT,
+			conf->max.session_per_node);
+	printf("Early session eviction (%s): ", SESSION_EVICT_OPT);
+	if (conf->max.session_evict)
+		printf("at %llu sessions\n", conf->max.session_evict);
+	else
+		printf("OFF\n");
 
 	return 0;
 }
@@ -9,7 +9,7 @@
 
 static int handle_display_response(struct nl_msg *msg, void *arg)
 {
-	struct fragmentation_config *conf = nlmsg_data(nlmsg_hdr(msg));
+	struct fragmentation_config *conf = netlink_data(nlmsg_hdr(msg));
 
 	printf("Fragments arrival time slot (%s): ", FRAGMENTATION_TIMEOUT_OPT);
 	print_time(conf->fragment_timeout);
@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <argp.h>
 #include <arpa/inet.h>
 #include <linux/types.h>
@@ -21,9 +22,17 @@
 #include "nat64/usr/pool4.h"
 #include "nat64/usr/bib.h"
 #include "nat64/usr/session.h"
+#include "nat64/usr/snapshot.h"
 #include "nat64/usr/filtering.h"
 #include "nat64/usr/translate.h"
 #include "nat64/usr/fragmentation.h"
+#include "nat64/usr/stats.h"
+#include "nat64/usr/events.h"
+#include "nat64/usr/latency.h"
+#include "nat64/usr/sync.h"
+#include "nat64/usr/changes.h"
+#include "nat64/usr/dns.h"
+#include "nat64/usr/netlink.h"
 
 
 const char *argp_program_version = "3.1.4";
@@ -52,11 +61,35 @@ struct arguments {
 	bool bib6_set;
 	struct ipv4_tuple_address bib4;
 	bool bib4_set;
+	char *bib_file;
+	char *snapshot_file;
+	struct table_query query;
+	__u64 dns_timeout;
+	enum output_format format;
 
 	/* Filtering, translate, fragmentation */
 	struct filtering_config filtering;
 	struct translate_config translate;
 	struct fragmentation_config fragmentation;
+
+	/* Events */
+	bool follow;
+
+	/* Changes */
+	__u64 since;
+	bool since_set;
+
+	/* Sync */
+	char *sync_peer;
+	char *sync_local;
+	char *sync_from;
+	bool loopback;
+
+	/* Latency */
+	struct latency_config latency;
+
+	/* Batch */
+	char *batch_file;
 };
 
 /**
@@ -71,6 +104,9 @@ enum argp_flags {
 	ARGP_FILTERING = 'y',
 	ARGP_TRANSLATE = 'z',
 	ARGP_FRAGMENTATION = 'f',
+	ARGP_STATS = 'S',
+	ARGP_EVENTS = 'E',
+	ARGP_LATENCY = 'L',
 
 	/* Operations */
 	ARGP_DISPLAY = 'd',
@@ -90,20 +126,39 @@ enum argp_flags {
 	/*
 	ARGP_STATIC = 2000,
 	ARGP_DYNAMIC = 2001,
+	*/
 	ARGP_IPV6 = 2010,
 	ARGP_IPV4 = 2011,
-	*/
+	ARGP_PORTS = 2012,
+	ARGP_STATE = 2013,
+	ARGP_MIN_LIFETIME = 2014,
+	ARGP_MAX_LIFETIME = 2015,
+	ARGP_OFFSET = 2016,
+	ARGP_LIMIT = 2017,
+	ARGP_DNS_TIMEOUT = 2018,
+	ARGP_FORMAT = 2019,
 	ARGP_BIB_IPV6 = 2020,
 	ARGP_BIB_IPV4 = 2021,
+	ARGP_IMPORT = 2030,
+	ARGP_EXPORT = 2031,
+	ARGP_FLUSH = 2032,
+	ARGP_SNAPSHOT = 2033,
+	ARGP_RESTORE = 2034,
 
 	/* Filtering */
 	ARGP_DROP_ADDR = 3000,
 	ARGP_DROP_INFO = 3001,
 	ARGP_DROP_TCP = 3002,
+	ARGP_DEFER_TCP = 3003,
 	ARGP_UDP_TO = 3010,
 	ARGP_ICMP_TO = 3011,
 	ARGP_TCP_TO = 3012,
 	ARGP_TCP_TRANS_TO = 3013,
+	ARGP_BIB_MAX = 3020,
+	ARGP_SESSION_MAX = 3021,
+	ARGP_BIB_NODE_MAX = 3022,
+	ARGP_SESSION_NODE_MAX = 3023,
+	ARGP_SESSION_EVICT = 3024,
 
 	/* Translate */
 	ARGP_RESET_TCLASS = 4002,
@@ -117,15 +172,42 @@ enum argp_flags {
 
 	/* Fragmentation */
 	ARGP_FRAG_TO = 5000,
+
+	/* Events */
+	ARGP_FOLLOW = 5500,
+
+	/* Changes */
+	ARGP_CHANGES = 5700,
+	ARGP_SINCE = 5701,
+
+	/* Sync */
+	ARGP_SYNC = 5600,
+	ARGP_SEND = 5601,
+	ARGP_RECEIVE = 5602,
+	ARGP_LOOPBACK = 5603,
+	ARGP_FROM = 5604,
+
+	/* Latency */
+	ARGP_LATENCY_ENABLED = 6000,
+	ARGP_LATENCY_RESET = 6001,
+
+	/* Batch */
+	ARGP_BATCH = 7000,
 };
 
 #define NUM_FORMAT "NUM"
+#define FORMAT_FORMAT "FORMAT"
 #define PREFIX_FORMAT "ADDR6/NUM"
 #define IPV6_TRANSPORT_FORMAT "ADDR6#NUM"
 #define IPV4_TRANSPORT_FORMAT "ADDR4#NUM"
 #define IPV4_ADDR_FORMAT "ADDR4"
 #define BOOL_FORMAT "BOOL"
 #define NUM_ARR_FORMAT "NUM[,NUM]*"
+#define FILE_FORMAT "FILE"
+#define PORT_RANGE_FORMAT "NUM[-NUM]"
+#define STATE_FORMAT "STATE"
+#define TRANSPORT_FORMAT "ADDR#NUM"
+#define ADDR_FORMAT "ADDR"
 
 
 /*
@@ -162,31 +244,66 @@ static struct argp_option options[] =
 	{ "tcp",		ARGP_TCP,		NULL, 0, "Print the TCP BIB." },
 	{ "udp",		ARGP_UDP,		NULL, 0, "Print the UDP BIB." },
 	{ "numeric",	ARGP_NUMERIC_HOSTNAME,	NULL, 0, "Don't resolve names." },
+	{ "dnsTimeout",	ARGP_DNS_TIMEOUT,	NUM_FORMAT, 0,
+			"Milliseconds to wait for each name before printing its address numerically. "
+			"Available on display operation only." },
+	{ "format",		ARGP_FORMAT,	FORMAT_FORMAT, 0,
+			"text (default), csv, json-lines or binary. The last three print one machine-readable "
+			"record per entry, and never resolve names. Available on display operation only." },
 	/*
 	{ "static",		ARGP_STATIC,	NULL, 0,
 			"Filter out entries created dynamically (by incoming connections). " },
 	{ "dynamic",	ARGP_DYNAMIC,	NULL, 0,
 			"Filter out entries created statically (by the user). " },
-	{ "ipv4",		ARGP_IPV4,		IPV4_TRANSPORT_FORMAT, 0,
-			"Filter out entries unrelated to the following IPv4 address and/or port." },
-	{ "ipv6",		ARGP_IPV6,		IPV6_TRANSPORT_FORMAT, 0,
-			"Filter out entries unrelated to the following IPv4 address and/or port." },
 	*/
+	{ "ipv6",		ARGP_IPV6,		PREFIX_FORMAT, 0,
+			"Only print the entries whose IPv6 address belongs to this prefix. "
+			"Available on display operation only." },
+	{ "ipv4",		ARGP_IPV4,		IPV4_ADDR_FORMAT, 0,
+			"Only print the entries which use this address from the IPv4 pool. "
+			"Available on display operation only." },
+	{ "ports",		ARGP_PORTS,		PORT_RANGE_FORMAT, 0,
+			"Only print the entries whose IPv4 port (or ICMP identifier) belongs to this range. "
+			"Available on display operation only." },
+	{ "offset",		ARGP_OFFSET,	NUM_FORMAT, 0,
+			"Skip this many matching entries from each table. Available on display operation only." },
+	{ "limit",		ARGP_LIMIT,		NUM_FORMAT, 0,
+			"Print at most this many entries from each table. Available on display operation only." },
 	{ "bib6",		ARGP_BIB_IPV6,	IPV6_TRANSPORT_FORMAT, 0,
 			"This is the addres#port of the remote IPv6 node of the entry to be added or removed. "
 			"Available on add and remove operations only." },
 	{ "bib4",		ARGP_BIB_IPV4,	IPV4_TRANSPORT_FORMAT, 0,
 			"This is the local IPv4 addres#port of the entry to be added or removed. "
 			"Available on add and remove operations only." },
+	{ "import",		ARGP_IMPORT,	FILE_FORMAT, 0,
+			"(Operation) Add the static entries listed in FILE (\"-\" is standard input)." },
+	{ "export",		ARGP_EXPORT,	FILE_FORMAT, 0,
+			"(Operation) Write the static entries to FILE (\"-\" is standard output), in the "
+			"format --import expects." },
 
 	{ NULL, 0, NULL, 0, "Session options:", 21 },
 	{ "session",	ARGP_SESSION,	NULL, 0, "The command will operate on the session tables." },
 	{ "display",	ARGP_DISPLAY,	NULL, 0, "(Operation) Print the table as output (default)." },
 	{ "count",		ARGP_COUNT,		NULL, 0, "(Operation) Print the number of session entries registered." },
+	{ "flush",		ARGP_FLUSH,		NULL, 0,
+			"(Operation) Remove the sessions of the IPv6 nodes from --ipv6, and their dynamic BIB "
+			"entries." },
+	{ "snapshot",	ARGP_SNAPSHOT,	FILE_FORMAT, 0,
+			"(Operation) Write an image of the BIB and session tables to FILE (\"-\" is standard "
+			"output), so they can be restored after reloading Jool." },
+	{ "restore",	ARGP_RESTORE,	FILE_FORMAT, 0,
+			"(Operation) Add the BIB entries and sessions from the FILE image (\"-\" is standard "
+			"input) to the tables." },
 	{ "icmp",		ARGP_ICMP,		NULL, 0, "Operate on the ICMP session table." },
 	{ "tcp",		ARGP_TCP,		NULL, 0, "Operate on the TCP session table." },
 	{ "udp",		ARGP_UDP,		NULL, 0, "Operate on the UDP session table." },
 	{ "numeric",	ARGP_NUMERIC_HOSTNAME,	NULL, 0, "Don't resolve names." },
+	{ "dnsTimeout",	ARGP_DNS_TIMEOUT,	NUM_FORMAT, 0,
+			"Milliseconds to wait for each name before printing its address numerically. "
+			"Available on display operation only." },
+	{ "format",		ARGP_FORMAT,	FORMAT_FORMAT, 0,
+			"text (default), csv, json-lines or binary. The last three print one machine-readable "
+			"record per entry, and never resolve names. Available on display operation only." },
 	/*
 	{ "static",		ARGP_STATIC,	NULL, 0,
 			"Filter out entries created dynamically (by incoming connections from IPv6 networks). "
@@ -195,6 +312,30 @@ static struct argp_option options[] =
 			"Filter out entries created statically (by the user). "
 			"Available on display operation only. " },
 	 */
+	{ "ipv6",		ARGP_IPV6,		PREFIX_FORMAT, 0,
+			"Only print the sessions whose IPv6 node belongs to this prefix. "
+			"Available on display operation only." },
+	{ "ipv4",		ARGP_IPV4,		IPV4_ADDR_FORMAT, 0,
+			"Only print the sessions which use this address from the IPv4 pool. "
+			"Available on display operation only." },
+	{ "ports",		ARGP_PORTS,		PORT_RANGE_FORMAT, 0,
+			"Only print the sessions whose IPv4 port (or ICMP identifier) belongs to this range. "
+			"Available on display operation only." },
+	{ "state",		ARGP_STATE,		STATE_FORMAT, 0,
+			"Only print the TCP sessions which are in this state (eg. ESTABLISHED). "
+			"Available on display operation only." },
+	{ "minLifetime",ARGP_MIN_LIFETIME,	NUM_FORMAT, 0,
+			"Only print the sessions which will live at least this many more seconds. "
+			"Available on display operation only." },
+	{ "maxLifetime",ARGP_MAX_LIFETIME,	NUM_FORMAT, 0,
+			"Only print the sessions which will live at most this many more seconds. "
+			"Available on display operation only." },
+	{ "offset",		ARGP_OFFSET,	NUM_FORMAT, 0,
+			"Skip this many matching sessions from each table. "
+			"Available on display operation only." },
+	{ "limit",		ARGP_LIMIT,		NUM_FORMAT, 0,
+			"Print at most this many sessions from each table. "
+			"Available on display operation only." },
 
 	{ NULL, 0, NULL, 0, "'Filtering and Updating' step options:", 30 },
 	{ "filtering",			ARGP_FILTERING,		NULL, 0,
@@ -206,6 +347,9 @@ static struct argp_option options[] =
 			"Filter ICMPv6 Informational packets." },
 	{ DROP_EXTERNAL_TCP_OPT,ARGP_DROP_TCP,		BOOL_FORMAT, 0,
 			"Drop externally initiated TCP connections." },
+	{ DEFER_EXTERNAL_TCP_OPT,ARGP_DEFER_TCP,	BOOL_FORMAT, 0,
+			"Create sessions for externally initiated TCP connections only once the IPv6 node "
+			"answers." },
 	{ UDP_TIMEOUT_OPT,		ARGP_UDP_TO,		NUM_FORMAT, 0,
 			"Set the timeout for new UDP sessions." },
 	{ ICMP_TIMEOUT_OPT,		ARGP_ICMP_TO,		NUM_FORMAT, 0,
@@ -214,6 +358,16 @@ static struct argp_option options[] =
 			"Set the established connection idle-timeout for new TCP sessions." },
 	{ TCP_TRANS_TIMEOUT_OPT,ARGP_TCP_TRANS_TO,	NUM_FORMAT, 0,
 			"Set the transitory connection idle-timeout for new TCP sessions." },
+	{ BIB_MAX_OPT,			ARGP_BIB_MAX,		NUM_FORMAT, 0,
+			"Set the maximum number of BIB entries (0 = unlimited)." },
+	{ SESSION_MAX_OPT,		ARGP_SESSION_MAX,	NUM_FORMAT, 0,
+			"Set the maximum number of sessions (0 = unlimited)." },
+	{ BIB_NODE_MAX_OPT,		ARGP_BIB_NODE_MAX,	NUM_FORMAT, 0,
+			"Set the maximum number of BIB entries a single IPv6 node can own (0 = unlimited)." },
+	{ SESSION_NODE_MAX_OPT,	ARGP_SESSION_NODE_MAX, NUM_FORMAT, 0,
+			"Set the maximum number of sessions a single IPv6 node can own (0 = unlimited)." },
+	{ SESSION_EVICT_OPT,	ARGP_SESSION_EVICT,	NUM_FORMAT, 0,
+			"Expire idle sessions early once there are this many sessions (0 = never)." },
 
 	{ NULL, 0, NULL, 0, "'Translate the Packet' step options:", 31 },
 	{ "translate",			ARGP_TRANSLATE,		NULL, 0,
@@ -235,6 +389,50 @@ static struct argp_option options[] =
 	{ FRAGMENTATION_TIMEOUT_OPT,		ARGP_FRAG_TO,		NUM_FORMAT, 0,
 			"Set the timeout for arrival of fragments." },
 
+	{ NULL, 0, NULL, 0, "Statistics options:", 50 },
+	{ "stats",		ARGP_STATS,		NULL, 0, "Print the translator's counters." },
+	{ "events",		ARGP_EVENTS,	NULL, 0,
+			"Print (and forget) the table events recorded since the last time you asked." },
+	{ "follow",		ARGP_FOLLOW,	NULL, 0,
+			"(With --events.) Keep printing the events as they happen, until interrupted." },
+	{ "changes",	ARGP_CHANGES,	NULL, 0,
+			"Print the tables' current generation, and the oldest one --since accepts. "
+			"Will be implicit if --since is entered." },
+	{ "since",		ARGP_SINCE,		NUM_FORMAT, 0,
+			"(With --changes.) Print the BIB entries and sessions created, changed or removed "
+			"after this generation." },
+	{ "format",		ARGP_FORMAT,	FORMAT_FORMAT, 0,
+			"(With --since.) text (default), csv, json-lines or binary." },
+	{ "latency",	ARGP_LATENCY,	NULL, 0,
+			"Print how long each translation step has been taking. "
+			"Will be implicit if any other latency command is entered." },
+	{ LATENCY_ENABLED_OPT,	ARGP_LATENCY_ENABLED,	BOOL_FORMAT, 0,
+			"Measure the translation steps (off by default; costs a clock read per step)." },
+	{ LATENCY_RESET_OPT,	ARGP_LATENCY_RESET,		NULL, 0,
+			"Forget the measurements done so far." },
+
+	{ NULL, 0, NULL, 0, "Session synchronization options:", 55 },
+	{ "sync",		ARGP_SYNC,		NULL, 0,
+			"Keep the sessions of a backup translator in sync with this one's. "
+			"Will be implicit if any other sync command is entered." },
+	{ "send",		ARGP_SEND,		TRANSPORT_FORMAT, 0,
+			"Send every session change to the backup listening at this address#port, until "
+			"interrupted. Run this on the active translator." },
+	{ "receive",	ARGP_RECEIVE,	TRANSPORT_FORMAT, 0,
+			"Install the session changes which arrive to this local address#port, until "
+			"interrupted. Run this on the backup translator." },
+	{ "from",		ARGP_FROM,		ADDR_FORMAT, 0,
+			"(With --receive.) Address of the active translator. Datagrams from anywhere else "
+			"are ignored." },
+	{ "loopback",	ARGP_LOOPBACK,	NULL, 0,
+			"(With --receive.) Print the session changes instead of installing them." },
+
+	{ NULL, 0, NULL, 0, "Batch options:", 60 },
+	{ "batch",		ARGP_BATCH,		FILE_FORMAT, 0,
+			"Read one command per line from FILE (\"-\" is standard input), and apply all of them "
+			"at once, or none. Only pool additions and removals, and filtering, translate and "
+			"fragmentation updates are allowed." },
+
 	{ NULL },
 };
 
@@ -246,6 +444,7 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 	struct arguments *arguments = state->input;
 	int error = 0;
 	__u16 temp;
+	bool temp_bool;
 
 	switch (key) {
 	case ARGP_POOL6:
@@ -269,6 +468,30 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 	case ARGP_FRAGMENTATION:
 		arguments->mode = MODE_FRAGMENTATION;
 		break;
+	case ARGP_STATS:
+		arguments->mode = MODE_STATS;
+		break;
+	case ARGP_EVENTS:
+		arguments->mode = MODE_EVENTS;
+		break;
+	case ARGP_FOLLOW:
+		arguments->mode = MODE_EVENTS;
+		arguments->follow = true;
+		break;
+	case ARGP_CHANGES:
+		arguments->mode = MODE_CHANGES;
+		break;
+	case ARGP_SINCE:
+		arguments->mode = MODE_CHANGES;
+		arguments->since_set = true;
+		error = str_to_u64(arg, &arguments->since, 0, ~((__u64) 0));
+		break;
+	case ARGP_LATENCY:
+		arguments->mode = MODE_LATENCY;
+		break;
+	case ARGP_SYNC:
+		arguments->mode = MODE_SYNC;
+		break;
 
 	case ARGP_DISPLAY:
 		arguments->operation = OP_DISPLAY;
@@ -321,6 +544,63 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 		error = str_to_addr4_port(arg, &arguments->bib4);
 		arguments->bib4_set = true;
 		break;
+	case ARGP_IMPORT:
+		arguments->operation = OP_IMPORT;
+		arguments->bib_file = arg;
+		break;
+	case ARGP_EXPORT:
+		arguments->operation = OP_DISPLAY;
+		arguments->bib_file = arg;
+		break;
+	case ARGP_FLUSH:
+		arguments->operation = OP_FLUSH;
+		break;
+	case ARGP_SNAPSHOT:
+		arguments->operation = OP_DISPLAY;
+		arguments->snapshot_file = arg;
+		break;
+	case ARGP_RESTORE:
+		arguments->operation = OP_ADD;
+		arguments->snapshot_file = arg;
+		break;
+	case ARGP_IPV6:
+		arguments->query.flags |= QUERY_IPV6_MASK;
+		error = str_to_network6(arg, &arguments->query.ipv6);
+		break;
+	case ARGP_IPV4:
+		arguments->query.flags |= QUERY_IPV4_MASK;
+		error = str_to_addr4(arg, &arguments->query.ipv4);
+		break;
+	case ARGP_PORTS:
+		arguments->query.flags |= QUERY_PORTS_MASK;
+		error = str_to_port_range(arg, &arguments->query.port_min, &arguments->query.port_max);
+		break;
+	case ARGP_STATE:
+		arguments->query.flags |= QUERY_STATE_MASK;
+		error = str_to_tcp_state(arg, &arguments->query.state);
+		break;
+	case ARGP_MIN_LIFETIME:
+		arguments->query.flags |= QUERY_LIFETIME_MASK;
+		error = str_to_u64(arg, &arguments->query.lifetime_min, 0, ~((__u64) 0) / 1000);
+		arguments->query.lifetime_min *= 1000;
+		break;
+	case ARGP_MAX_LIFETIME:
+		arguments->query.flags |= QUERY_LIFETIME_MASK;
+		error = str_to_u64(arg, &arguments->query.lifetime_max, 0, ~((__u64) 0) / 1000);
+		arguments->query.lifetime_max *= 1000;
+		break;
+	case ARGP_OFFSET:
+		error = str_to_u64(arg, &arguments->query.offset, 0, ~((__u64) 0));
+		break;
+	case ARGP_LIMIT:
+		error = str_to_u64(arg, &arguments->query.limit, 0, ~((__u64) 0));
+		break;
+	case ARGP_DNS_TIMEOUT:
+		error = str_to_u64(arg, &arguments->dns_timeout, 0, UINT_MAX);
+		break;
+	case ARGP_FORMAT:
+		error = str_to_output_format(arg, &arguments->format);
+		break;
 
 	case ARGP_DROP_ADDR:
 		arguments->mode = MODE_FILTERING;
@@ -337,6 +617,11 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 		arguments->operation |= DROP_EXTERNAL_TCP_MASK;
 		error = str_to_bool(arg, &arguments->filtering.drop_external_tcp);
 		break;
+	case ARGP_DEFER_TCP:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= DEFER_EXTERNAL_TCP_MASK;
+		error = str_to_bool(arg, &arguments->filtering.defer_external_tcp);
+		break;
 	case ARGP_UDP_TO:
 		arguments->mode = MODE_FILTERING;
 		arguments->operation |= UDP_TIMEOUT_MASK;
@@ -361,6 +646,31 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 		error = str_to_u16(arg, &temp, TCP_TRANS, 0xFFFF);
 		arguments->filtering.to.tcp_trans = temp * 1000;
 		break;
+	case ARGP_BIB_MAX:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= BIB_MAX_MASK;
+		error = str_to_u64(arg, &arguments->filtering.max.bib, 0, ~((__u64) 0));
+		break;
+	case ARGP_SESSION_MAX:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= SESSION_MAX_MASK;
+		error = str_to_u64(arg, &arguments->filtering.max.session, 0, ~((__u64) 0));
+		break;
+	case ARGP_BIB_NODE_MAX:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= BIB_NODE_MAX_MASK;
+		error = str_to_u64(arg, &arguments->filtering.max.bib_per_node, 0, ~((__u64) 0));
+		break;
+	case ARGP_SESSION_NODE_MAX:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= SESSION_NODE_MAX_MASK;
+		error = str_to_u64(arg, &arguments->filtering.max.session_per_node, 0, ~((__u64) 0));
+		break;
+	case ARGP_SESSION_EVICT:
+		arguments->mode = MODE_FILTERING;
+		arguments->operation |= SESSION_EVICT_MASK;
+		error = str_to_u64(arg, &arguments->filtering.max.session_evict, 0, ~((__u64) 0));
+		break;
 
 	case ARGP_RESET_TCLASS:
 		arguments->mode = MODE_TRANSLATE;
@@ -411,6 +721,38 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 		arguments->fragmentation.fragment_timeout = temp * 1000;
 		break;
 
+	case ARGP_LATENCY_ENABLED:
+		arguments->mode = MODE_LATENCY;
+		arguments->operation |= LATENCY_ENABLED_MASK;
+		error = str_to_bool(arg, &temp_bool);
+		arguments->latency.enabled = temp_bool;
+		break;
+	case ARGP_BATCH:
+		arguments->batch_file = arg;
+		break;
+
+	case ARGP_SEND:
+		arguments->mode = MODE_SYNC;
+		arguments->sync_peer = arg;
+		break;
+	case ARGP_RECEIVE:
+		arguments->mode = MODE_SYNC;
+		arguments->sync_local = arg;
+		break;
+	case ARGP_FROM:
+		arguments->mode = MODE_SYNC;
+		arguments->sync_from = arg;
+		break;
+	case ARGP_LOOPBACK:
+		arguments->mode = MODE_SYNC;
+		arguments->loopback = true;
+		break;
+
+	case ARGP_LATENCY_RESET:
+		arguments->mode = MODE_LATENCY;
+		arguments->operation |= LATENCY_RESET_MASK;
+		break;
+
 	default:
 		return ARGP_ERR_UNKNOWN;
 	}
@@ -435,14 +777,16 @@ static char doc[] = "jool -- The Jool kernel module's configuration interface.\v
  * Uses argp.h to read the parameters from the user, validates them, and returns the result as a
  * structure.
  */
-static int parse_args(int argc, char **argv, struct arguments *result)
+static int parse_args(int argc, char **argv, unsigned int flags, struct arguments *result)
 {
 	int error;
 	struct argp argp = { options, parse_opt, args_doc, doc };
 
 	memset(result, 0, sizeof(*result));
+	result->query.lifetime_max = ~((__u64) 0);
+	result->dns_timeout = DNS_DEFAULT_TIMEOUT;
 
-	error = argp_parse(&argp, argc, argv, 0, NULL, result);
+	error = argp_parse(&argp, argc, argv, flags, NULL, result);
 	if (error != 0)
 		return error;
 
@@ -460,128 +804,197 @@ static int parse_args(int argc, char **argv, struct arguments *result)
 	return 0;
 }
 
-/*
- * The main function.
+/**
+ * Sends the request "args" describes to the kernel module.
  */
-static int main_wrapped(int argc, char **argv)
+static int execute(struct arguments *args)
 {
-	struct arguments args;
 	int error;
 
-	error = parse_args(argc, argv, &args);
-	if (error)
-		return error;
-
-	switch (args.mode) {
+	switch (args->mode) {
 	case MODE_POOL6:
-		switch (args.operation) {
+		switch (args->operation) {
 		case OP_DISPLAY:
 			return pool6_display();
 		case OP_COUNT:
 			return pool6_count();
 		case OP_ADD:
-			if (!args.pool6_prefix_set) {
+			if (!args->pool6_prefix_set) {
 				log_err(ERR_MISSING_PARAM, "Please enter the prefix to be added (--prefix).");
 				return -EINVAL;
 			}
-			return pool6_add(&args.pool6_prefix);
+			return pool6_add(&args->pool6_prefix);
 		case OP_REMOVE:
-			if (!args.pool6_prefix_set) {
+			if (!args->pool6_prefix_set) {
 				log_err(ERR_MISSING_PARAM, "Please enter the prefix to be removed (--prefix).");
 				return -EINVAL;
 			}
-			return pool6_remove(&args.pool6_prefix);
+			return pool6_remove(&args->pool6_prefix);
 		default:
-			log_err(ERR_UNKNOWN_OP, "Unknown operation for IPv6 pool mode: %u.", args.operation);
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for IPv6 pool mode: %u.", args->operation);
 			return -EINVAL;
 		}
 		break;
 
 	case MODE_POOL4:
-		switch (args.operation) {
+		switch (args->operation) {
 		case OP_DISPLAY:
 			return pool4_display();
 		case OP_COUNT:
 			return pool4_count();
 		case OP_ADD:
-			if (!args.pool4_addr_set) {
+			if (!args->pool4_addr_set) {
 				log_err(ERR_MISSING_PARAM, "Please enter the address to be added (--address).");
 				return -EINVAL;
 			}
-			return pool4_add(&args.pool4_addr);
+			return pool4_add(&args->pool4_addr);
 		case OP_REMOVE:
-			if (!args.pool4_addr_set) {
+			if (!args->pool4_addr_set) {
 				log_err(ERR_MISSING_PARAM, "Please enter the address to be removed (--address).");
 				return -EINVAL;
 			}
-			return pool4_remove(&args.pool4_addr);
+			return pool4_remove(&args->pool4_addr);
 		default:
-			log_err(ERR_UNKNOWN_OP, "Unknown operation for IPv4 pool mode: %u.", args.operation);
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for IPv4 pool mode: %u.", args->operation);
 			return -EINVAL;
 		}
 		break;
 
 	case MODE_BIB:
-		switch (args.operation) {
+		switch (args->operation) {
 		case OP_DISPLAY:
-			return bib_display(args.tcp, args.udp, args.icmp, args.numeric_hostname);
+			if (args->bib_file)
+				return bib_export(args->tcp, args->udp, args->icmp, args->bib_file);
+			return bib_display(args->tcp, args->udp, args->icmp, args->numeric_hostname,
+					args->format, &args->query);
 		case OP_COUNT:
-			return bib_count(args.tcp, args.udp, args.icmp);
+			return bib_count(args->tcp, args->udp, args->icmp);
 
 		case OP_ADD:
 			error = 0;
-			if (!args.bib6_set) {
+			if (!args->bib6_set) {
 				log_err(ERR_MISSING_PARAM, "Missing IPv6 address#port (--bib6).");
 				error = -EINVAL;
 			}
-			if (!args.bib4_set) {
+			if (!args->bib4_set) {
 				log_err(ERR_MISSING_PARAM, "Missing IPv4 address#port (--bib4).");
 				error = -EINVAL;
 			}
 			if (error)
 				return error;
 
-			return bib_add(args.tcp, args.udp, args.icmp, &args.bib6, &args.bib4);
+			return bib_add(args->tcp, args->udp, args->icmp, &args->bib6, &args->bib4);
 
 		case OP_REMOVE:
-			if (args.bib6_set)
-				return bib_remove_ipv6(args.tcp, args.udp, args.icmp, &args.bib6);
-			else if (args.bib4_set)
-				return bib_remove_ipv4(args.tcp, args.udp, args.icmp, &args.bib4);
+			if (args->bib6_set)
+				return bib_remove_ipv6(args->tcp, args->udp, args->icmp, &args->bib6);
+			else if (args->bib4_set)
+				return bib_remove_ipv4(args->tcp, args->udp, args->icmp, &args->bib4);
 
 			log_err(ERR_MISSING_PARAM, "I need either the IPv4 transport address or the IPv6 "
 					"transport address of the entry you want to remove.");
 			return -EINVAL;
 
+		case OP_IMPORT:
+			return bib_import(args->bib_file);
+
 		default:
-			log_err(ERR_UNKNOWN_OP, "Unknown operation for session mode: %u.", args.operation);
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for session mode: %u.", args->operation);
 			return -EINVAL;
 		}
 		break;
 
 	case MODE_SESSION:
-		switch (args.operation) {
+		switch (args->operation) {
 		case OP_DISPLAY:
-			return session_display(args.tcp, args.udp, args.icmp, args.numeric_hostname);
+			if (args->snapshot_file)
+				return snapshot_save(args->snapshot_file);
+			return session_display(args->tcp, args->udp, args->icmp, args->numeric_hostname,
+					args->format, &args->query);
 		case OP_COUNT:
-			return session_count(args.tcp, args.udp, args.icmp);
+			return session_count(args->tcp, args->udp, args->icmp);
+		case OP_FLUSH:
+			if (!(args->query.flags & QUERY_IPV6_MASK)) {
+				log_err(ERR_MISSING_PARAM, "Missing the IPv6 node or prefix to flush (--ipv6).");
+				return -EINVAL;
+			}
+			return session_flush(args->tcp, args->udp, args->icmp, &args->query.ipv6);
+		case OP_ADD:
+			if (!args->snapshot_file) {
+				log_err(ERR_MISSING_PARAM, "Missing the image to restore (--restore).");
+				return -EINVAL;
+			}
+			return snapshot_restore(args->snapshot_file);
 		default:
-			log_err(ERR_UNKNOWN_OP, "Unknown operation for session mode: %u.", args.operation);
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for session mode: %u.", args->operation);
 			return -EINVAL;
 		}
 		break;
 
 	case MODE_FILTERING:
-		return filtering_request(args.operation, &args.filtering);
+		return filtering_request(args->operation, &args->filtering);
 
 	case MODE_TRANSLATE:
-		error = translate_request(args.operation, &args.translate);
-		if (args.translate.mtu_plateaus)
-			free(args.translate.mtu_plateaus);
+		error = translate_request(args->operation, &args->translate);
+		if (args->translate.mtu_plateaus)
+			free(args->translate.mtu_plateaus);
 		return error;
 
 	case MODE_FRAGMENTATION:
-		return fragmentation_request(args.operation, &args.fragmentation);
+		return fragmentation_request(args->operation, &args->fragmentation);
+
+	case MODE_STATS:
+		switch (args->operation) {
+		case OP_DISPLAY:
+			return stats_display();
+		default:
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for stats mode: %u.", args->operation);
+			return -EINVAL;
+		}
+		break;
+
+	case MODE_EVENTS:
+		switch (args->operation) {
+		case OP_DISPLAY:
+			return events_display(args->numeric_hostname, args->follow);
+		default:
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for events mode: %u.", args->operation);
+			return -EINVAL;
+		}
+		break;
+
+	case MODE_CHANGES:
+		switch (args->operation) {
+		case OP_DISPLAY:
+			return changes_display(args->since_set, args->since, args->format,
+					args->numeric_hostname);
+		default:
+			log_err(ERR_UNKNOWN_OP, "Unknown operation for changes mode: %u.", args->operation);
+			return -EINVAL;
+		}
+		break;
+
+	case MODE_LATENCY:
+		return latency_request(args->operation, &args->latency);
+
+	case MODE_SYNC:
+		if (args->sync_peer && args->sync_local) {
+			log_err(ERR_UNKNOWN_OP, "A translator cannot send and receive at the same time.");
+			return -EINVAL;
+		}
+		if (args->sync_peer)
+			return sync_send(args->sync_peer);
+		if (args->sync_local) {
+			if (!args->sync_from) {
+				log_err(ERR_MISSING_PARAM, "Please enter the address of the active "
+						"translator (--from); the receiver ignores everyone else.");
+				return -EINVAL;
+			}
+			return sync_receive(args->sync_local, args->sync_from, args->loopback);
+		}
+		log_err(ERR_MISSING_PARAM, "Please enter where to send the sessions to (--send) or "
+				"where to receive them from (--receive).");
+		return -EINVAL;
 
 	default:
 		log_err(ERR_EMPTY_COMMAND, "Command seems empty; --help or --usage for info.");
@@ -589,6 +1002,104 @@ static int main_wrapped(int argc, char **argv)
 	}
 }
 
+
+/** Maximum number of words a batch line can have. */
+#define BATCH_MAX_ARGS 64
+
+/**
+ * Executes every command from "file_name" as a single batch (see netlink_batch_begin()).
+ */
+static int run_batch(char *file_name)
+{
+	const char *DELIMITERS = " \t\r\n";
+	FILE *file;
+	char *line = NULL;
+	size_t line_size = 0;
+	unsigned int line_num = 0;
+	char *argv[BATCH_MAX_ARGS + 1];
+	int argc;
+	char *save;
+	char *token;
+	struct arguments args;
+	int error;
+
+	file = (strcmp(file_name, "-") == 0) ? stdin : fopen(file_name, "r");
+	if (!file) {
+		log_err(ERR_PARSE_FILE, "Cannot open '%s'.", file_name);
+		return -EINVAL;
+	}
+
+	error = netlink_batch_begin();
+	if (error)
+		goto end;
+
+	while (getline(&line, &line_size, file) != -1) {
+		line_num++;
+
+		argv[0] = "jool";
+		argc = 1;
+		for (token = strtok_r(line, DELIMITERS, &save); token && token[0] != '#';
+				token = strtok_r(NULL, DELIMITERS, &save)) {
+			if (argc == BATCH_MAX_ARGS) {
+				log_err(ERR_PARSE_FILE, "Line %u has too many words.", line_num);
+				error = -EINVAL;
+				goto abort;
+			}
+			argv[argc++] = token;
+		}
+		argv[argc] = NULL;
+
+		if (argc == 1)
+			continue; /* Blank line or comment. */
+
+		error = parse_args(argc, argv, ARGP_NO_EXIT | ARGP_NO_HELP, &args);
+		if (error > 0)
+			error = -error; /* argp returns positive error codes. */
+		if (!error && args.batch_file) {
+			log_err(ERR_PARSE_FILE, "Batches cannot be nested.");
+			error = -EINVAL;
+		}
+		if (!error)
+			error = execute(&args);
+		if (error) {
+			log_err(ERR_PARSE_FILE, "Line %u is invalid; nothing was applied.", line_num);
+			goto abort;
+		}
+	}
+
+	error = netlink_batch_commit();
+	goto end;
+
+abort:
+	netlink_batch_abort();
+	/* Fall through. */
+
+end:
+	free(line);
+	if (file != stdin)
+		fclose(file);
+	return error;
+}
+
+/*
+ * The main function.
+ */
+static int main_wrapped(int argc, char **argv)
+{
+	struct arguments args;
+	int error;
+
+	error = parse_args(argc, argv, 0, &args);
+	if (error)
+		return error;
+
+	if (args.batch_file)
+		return run_batch(args.batch_file);
+
+	dns_set_timeout(args.dns_timeout);
+	return execute(&args);
+}
+
 int main(int argc, char **argv)
 {
 	return -main_wrapped(argc, argv);
@@ -0,0 +1,125 @@
+#include "nat64/usr/latency.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/usr/netlink.h"
+#include <errno.h>
+
+
+#define HDR_LEN sizeof(struct request_hdr)
+#define PAYLOAD_LEN sizeof(struct latency_config)
+/** Width of the longest histogram bar. */
+#define BAR_WIDTH 40
+
+/** Human-readable names of the stages, indexed by enum latency_stage. */
+static char *names[] = {
+	[LATENCY_FRAGMENT] = "Fragment arrival",
+	[LATENCY_INCOMING_TUPLE] = "Determine incoming tuple",
+	[LATENCY_FILTERING] = "Filtering and updating",
+	[LATENCY_OUTGOING_TUPLE] = "Compute outgoing tuple",
+	[LATENCY_TRANSLATE] = "Translate the packet",
+	[LATENCY_SEND] = "Routing and dispatch",
+};
+
+/**
+ * Returns the upper bound of the bucket "permille"/1000 of the "count" samples in "histogram" did
+ * not exceed.
+ */
+static __u64 percentile(__u64 *histogram, __u64 count, unsigned int permille)
+{
+	__u64 threshold = (count * permille + 999) / 1000;
+	__u64 seen = 0;
+	int i;
+
+	for (i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		seen += histogram[i];
+		if (seen >= threshold)
+			return 1ULL << (i + 1);
+	}
+
+	return 1ULL << LATENCY_BUCKETS;
+}
+
+static void print_stage(int stage, __u64 total_ns, __u64 *histogram)
+{
+	__u64 count = 0, max = 0;
+	int i, j, first = -1, last = -1;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		count += histogram[i];
+		if (histogram[i] > max)
+			max = histogram[i];
+		if (histogram[i]) {
+			if (first == -1)
+				first = i;
+			last = i;
+		}
+	}
+
+	printf("%s:\n", names[stage]);
+	if (count == 0) {
+		printf("  (Nothing measured.)\n\n");
+		return;
+	}
+
+	printf("  %llu packets, %llu ns average, p50 < %llu ns, p90 < %llu ns, p99 < %llu ns\n",
+			count, total_ns / count, percentile(histogram, count, 500),
+			percentile(histogram, count, 900), percentile(histogram, count, 990));
+
+	for (i = first; i <= last; i++) {
+		if (i == LATENCY_BUCKETS - 1)
+			printf("  %10llu %-12s ns: ", 1ULL << i, "or more");
+		else
+			printf("  %10llu - %-10llu ns: ", i ? (1ULL << i) : 0,
+					(1ULL << (i + 1)) - 1);
+		for (j = 0; j < (histogram[i] * BAR_WIDTH + max - 1) / max; j++)
+			printf("#");
+		printf(" %llu\n", histogram[i]);
+	}
+	printf("\n");
+}
+
+static int handle_display_response(struct nl_msg *msg, void *arg)
+{
+	struct latency_us *latency = netlink_data(nlmsg_hdr(msg));
+	int stage;
+
+	if (netlink_datalen(nlmsg_hdr(msg)) < sizeof(*latency)) {
+		log_err(ERR_UNKNOWN_ERROR, "The kernel module's response is too short.");
+		return -EINVAL;
+	}
+
+	printf("Measuring (%s): %s\n\n", LATENCY_ENABLED_OPT, latency->enabled ? "ON" : "OFF");
+	for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++)
+		print_stage(stage, latency->total_ns[stage], latency->histogram[stage]);
+
+	return 0;
+}
+
+static int handle_update_response(struct nl_msg *msg, void *arg)
+{
+	log_info("Value changed successfully.");
+	return 0;
+}
+
+int latency_request(__u32 operation, struct latency_config *config)
+{
+	if (operation == 0) {
+		struct request_hdr request;
+
+		request.length = sizeof(request);
+		request.mode = MODE_LATENCY;
+		request.operation = 0;
+
+		return netlink_request(&request, request.length, handle_display_response, NULL);
+	} else {
+		unsigned char request[HDR_LEN + PAYLOAD_LEN];
+		struct request_hdr *hdr = (struct request_hdr *) request;
+		struct latency_config *payload = (struct latency_config *) (request + HDR_LEN);
+
+		hdr->length = sizeof(request);
+		hdr->mode = MODE_LATENCY;
+		hdr->operation = operation;
+		*payload = *config;
+
+		return netlink_request(request, hdr->length, handle_update_response, NULL);
+	}
+}
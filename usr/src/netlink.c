@@ -1,61 +1,491 @@
 #include "nat64/usr/netlink.h"
 #include "nat64/comm/config_proto.h"
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <linux/genetlink.h>
 
-int netlink_request(void *request, __u16 request_len, int (*cb)(struct nl_msg *, void *),
-		void *cb_arg)
+
+/** Requests collected since netlink_batch_begin(), behind room for their headers. NULL if off. */
+static unsigned char *batch;
+static size_t batch_len;
+static size_t batch_capacity;
+static __u32 batch_count;
+
+/** The module's Generic Netlink family. Zero until resolve_family() finds it. */
+static int family_id;
+/** The family's multicast groups. Zero until resolve_family() finds them. */
+static int events_group_id;
+static int sync_group_id;
+
+/**
+ * The state of a request while it waits for the kernel's response.
+ */
+struct response {
+	int (*cb)(struct nl_msg *, void *);
+	void *cb_arg;
+	/** The module has sent some data (as opposed to only an ack). */
+	bool data;
+	/** The module is done responding. */
+	bool done;
+};
+
+static int response_valid(struct nl_msg *msg, void *arg)
+{
+	struct response *response = arg;
+
+	response->data = true;
+	return response->cb(msg, response->cb_arg);
+}
+
+static int response_ack(struct nl_msg *msg, void *arg)
+{
+	struct response *response = arg;
+	int error = 0;
+
+	/* Requests which only change something are answered with nothing but the ack. */
+	if (!response->data)
+		error = response->cb(msg, response->cb_arg);
+
+	response->done = true;
+	return (error < 0) ? error : NL_STOP;
+}
+
+static int response_finish(struct nl_msg *msg, void *arg)
+{
+	struct response *response = arg;
+
+	response->done = true;
+	return NL_STOP;
+}
+
+/**
+ * Makes "sk" hand the responses it receives to "response".
+ */
+static int listen_response(struct nl_sock *sk, struct response *response)
+{
+	int error;
+
+	error = nl_socket_modify_cb(sk, NL_CB_VALID, NL_CB_CUSTOM, response_valid, response);
+	if (error >= 0)
+		error = nl_socket_modify_cb(sk, NL_CB_ACK, NL_CB_CUSTOM, response_ack, response);
+	if (error >= 0)
+		error = nl_socket_modify_cb(sk, NL_CB_FINISH, NL_CB_CUSTOM, response_finish, response);
+
+	return error;
+}
+
+/**
+ * Reads until the kernel is done responding.
+ * Data responses are followed by an ack, which has to be consumed before the next request.
+ */
+static int receive_response(struct nl_sock *sk, struct response *response)
+{
+	int error;
+
+	while (!response->done) {
+		error = nl_recvmsgs_default(sk);
+		if (error < 0)
+			return error;
+	}
+
+	return 0;
+}
+
+/**
+ * Parses the response to resolve_family()'s request. The format is the one of the Generic
+ * Netlink controller (see linux/genetlink.h).
+ */
+static int family_response(struct nl_msg *msg, void *arg)
+{
+	struct nlattr *attrs[CTRL_ATTR_MAX + 1];
+	struct nlattr *group_attrs[CTRL_ATTR_MCAST_GRP_MAX + 1];
+	struct nlattr *group;
+	int remaining;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, attrs, CTRL_ATTR_MAX, NULL) < 0)
+		return NL_SKIP;
+
+	if (attrs[CTRL_ATTR_FAMILY_ID])
+		family_id = nla_get_u16(attrs[CTRL_ATTR_FAMILY_ID]);
+
+	if (!attrs[CTRL_ATTR_MCAST_GROUPS])
+		return NL_OK;
+
+	nla_for_each_nested(group, attrs[CTRL_ATTR_MCAST_GROUPS], remaining) {
+		char *name;
+
+		if (nla_parse_nested(group_attrs, CTRL_ATTR_MCAST_GRP_MAX, group, NULL) < 0)
+			continue;
+		if (!group_attrs[CTRL_ATTR_MCAST_GRP_NAME] || !group_attrs[CTRL_ATTR_MCAST_GRP_ID])
+			continue;
+
+		name = nla_get_string(group_attrs[CTRL_ATTR_MCAST_GRP_NAME]);
+		if (strcmp(name, JOOL_GENL_EVENTS_GROUP) == 0)
+			events_group_id = nla_get_u32(group_attrs[CTRL_ATTR_MCAST_GRP_ID]);
+		else if (strcmp(name, JOOL_GENL_SYNC_GROUP) == 0)
+			sync_group_id = nla_get_u32(group_attrs[CTRL_ATTR_MCAST_GRP_ID]);
+	}
+
+	return NL_OK;
+}
+
+/**
+ * Asks the kernel for the identifiers of the module's family and multicast groups.
+ * (libnl-genl's genl_ctrl_resolve() does the same thing, but this saves us the dependency.)
+ */
+static int resolve_family(struct nl_sock *sk)
+{
+	struct response response = { family_response, NULL, false, false };
+	struct nl_msg *msg;
+	struct genlmsghdr hdr = { .cmd = CTRL_CMD_GETFAMILY, .version = 1 };
+	int error;
+
+	if (family_id)
+		return 0;
+
+	msg = nlmsg_alloc_simple(GENL_ID_CTRL, 0);
+	if (!msg) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the family request.");
+		return -ENOMEM;
+	}
+	if (nlmsg_append(msg, &hdr, sizeof(hdr), NLMSG_ALIGNTO) < 0
+			|| nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, JOOL_GENL_FAMILY) < 0) {
+		log_err(ERR_ALLOC_FAILED, "Could not build the family request.");
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+
+	error = listen_response(sk, &response);
+	if (error >= 0)
+		error = nl_send_auto_complete(sk, msg);
+	nlmsg_free(msg);
+	if (error >= 0)
+		error = receive_response(sk, &response);
+
+	if (error < 0 || !family_id) {
+		log_err(ERR_NETLINK, "Could not find the NAT64's Generic Netlink family (is it really "
+				"up?).\nNetlink error message: %s (Code %d)", nl_geterror(error), error);
+		family_id = 0;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int netlink_open(struct nl_sock **result)
 {
 	struct nl_sock *sk;
-	enum nl_cb_type callbacks[] = { NL_CB_VALID, NL_CB_FINISH, NL_CB_ACK };
-	int i;
 	int error;
 
+	if (batch) {
+		log_err(ERR_UNKNOWN_OP, "This command cannot be part of a batch.");
+		return -EINVAL;
+	}
+
 	sk = nl_socket_alloc();
 	if (!sk) {
 		log_err(ERR_ALLOC_FAILED, "Could not allocate a socket; cannot speak to the NAT64.");
 		return -ENOMEM;
 	}
 
-	for (i = 0; i < (sizeof(callbacks) / sizeof(callbacks[0])); i++) {
-		error = nl_socket_modify_cb(sk, callbacks[i], NL_CB_CUSTOM, cb, cb_arg);
-		if (error < 0) {
-			log_err(ERR_NETLINK, "Could not register response handler. "
-					"I won't be able to parse the NAT64's response, so I won't send the request.\n"
-					"Netlink error message: %s (Code %d)", nl_geterror(error), error);
-			goto fail_free;
-		}
+	error = nl_connect(sk, NETLINK_GENERIC);
+	if (error < 0) {
+		log_err(ERR_NETLINK, "Could not bind the socket to the NAT64.\n"
+				"Netlink error message: %s (Code %d)", nl_geterror(error), error);
+		nl_socket_free(sk);
+		return -EINVAL;
+	}
+
+	error = resolve_family(sk);
+	if (error) {
+		netlink_close(sk);
+		return error;
 	}
 
-	error = nl_connect(sk, NETLINK_USERSOCK);
+	*result = sk;
+	return 0;
+}
+
+void netlink_close(struct nl_sock *sk)
+{
+	nl_close(sk);
+	nl_socket_free(sk);
+}
+
+void *netlink_data(struct nlmsghdr *hdr)
+{
+	return ((unsigned char *) nlmsg_data(hdr)) + GENL_HDRLEN;
+}
+
+int netlink_datalen(struct nlmsghdr *hdr)
+{
+	if (hdr->nlmsg_type == NLMSG_ERROR || nlmsg_datalen(hdr) < GENL_HDRLEN)
+		return 0;
+	return nlmsg_datalen(hdr) - GENL_HDRLEN;
+}
+
+int netlink_send(struct nl_sock *sk, void *request, __u32 request_len,
+		int (*cb)(struct nl_msg *, void *), void *cb_arg)
+{
+	struct response response = { cb, cb_arg, false, false };
+	struct nl_msg *msg;
+	struct genlmsghdr hdr = { .cmd = JOOL_CMD_REQUEST, .version = JOOL_GENL_VERSION };
+	int flags;
+	int error;
+
+	error = listen_response(sk, &response);
 	if (error < 0) {
-		log_err(ERR_NETLINK, "Could not bind the socket to the NAT64.\n"
+		log_err(ERR_NETLINK, "Could not register response handler. "
+				"I won't be able to parse the NAT64's response, so I won't send the request.\n"
 				"Netlink error message: %s (Code %d)", nl_geterror(error), error);
-		goto fail_free;
+		return -EINVAL;
 	}
 
-	error = nl_send_simple(sk, MSG_TYPE_NAT64, 0, request, request_len);
+	/* Tables can be large, so the module hands them over as dumps, one message at a time. */
+	flags = is_dump_request(request) ? NLM_F_DUMP : 0;
+
+	/* nl_send_simple() would cap the request at libnl's default message size (a page). */
+	msg = nlmsg_alloc_size(nlmsg_total_size(GENL_HDRLEN + request_len));
+	if (!msg) {
+		log_err(ERR_ALLOC_FAILED, "Could not allocate the request.");
+		return -ENOMEM;
+	}
+	if (!nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, family_id, GENL_HDRLEN + request_len,
+			flags)) {
+		log_err(ERR_ALLOC_FAILED, "Could not fit the request in the message.");
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+	memcpy(nlmsg_data(nlmsg_hdr(msg)), &hdr, sizeof(hdr));
+	memcpy(netlink_data(nlmsg_hdr(msg)), request, request_len);
+
+	error = nl_send_auto_complete(sk, msg);
+	nlmsg_free(msg);
 	if (error < 0) {
 		log_err(ERR_NETLINK, "Could not send the request to the NAT64 (is it really up?).\n"
 				"Netlink error message: %s (Code %d)", nl_geterror(error), error);
-		goto fail_close;
+		return -EINVAL;
 	}
 
-	error = nl_recvmsgs_default(sk);
+	error = receive_response(sk, &response);
 	if (error < 0) {
 		log_err(ERR_NETLINK, "%s (System error %d)", nl_geterror(error), error);
-		goto fail_close;
+		return -EINVAL;
 	}
 
-	nl_close(sk);
-	nl_socket_free(sk);
 	return 0;
+}
 
-fail_close:
-	nl_close(sk);
+int netlink_subscribe(char *group, struct nl_sock **result)
+{
+	struct nl_sock *sk;
+	int group_id;
+	int error;
+
+	error = netlink_open(&sk);
+	if (error)
+		return error;
+
+	if (strcmp(group, JOOL_GENL_EVENTS_GROUP) == 0)
+		group_id = events_group_id;
+	else if (strcmp(group, JOOL_GENL_SYNC_GROUP) == 0)
+		group_id = sync_group_id;
+	else
+		group_id = 0;
+
+	if (!group_id) {
+		log_err(ERR_NETLINK, "The NAT64 does not publish to a '%s' group.", group);
+		netlink_close(sk);
+		return -EINVAL;
+	}
+
+	/* Published messages are not responses to anything, so their sequence numbers are zero. */
+	nl_socket_disable_seq_check(sk);
+	error = nl_socket_add_membership(sk, group_id);
+	if (error < 0) {
+		log_err(ERR_NETLINK, "Could not subscribe to the NAT64's '%s' group.\n"
+				"Netlink error message: %s (Code %d)", group, nl_geterror(error), error);
+		netlink_close(sk);
+		return -EINVAL;
+	}
+
+	*result = sk;
+	return 0;
+}
+
+int netlink_receive(struct nl_sock *sk, int (*cb)(struct nl_msg *, void *), void *cb_arg)
+{
+	int error;
+
+	error = nl_socket_modify_cb(sk, NL_CB_VALID, NL_CB_CUSTOM, cb, cb_arg);
+	if (error >= 0)
+		error = nl_recvmsgs_default(sk);
+
+	/* The socket's buffer overflowed, which means some messages went to waste. */
+	if (error == -NLE_NOMEM)
+		return -ENOBUFS;
+	if (error < 0) {
+		log_err(ERR_NETLINK, "%s (System error %d)", nl_geterror(error), error);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int netlink_listen_events(int (*cb)(struct nl_msg *, void *), void *cb_arg)
+{
+	struct nl_sock *sk;
+	int error;
+
+	error = netlink_subscribe(JOOL_GENL_EVENTS_GROUP, &sk);
+	if (error)
+		return error;
+
+	do {
+		error = netlink_receive(sk, cb, cb_arg);
+		if (error == -ENOBUFS) {
+			log_info("(Some events were lost; they arrived faster than they were printed.)");
+			error = 0;
+		}
+	} while (!error);
+
+	netlink_close(sk);
+	return error;
+}
+
+/**
+ * Mirrors the module's is_batchable().
+ */
+static bool is_batchable(struct request_hdr *request)
+{
+	switch (request->mode) {
+	case MODE_POOL6:
+	case MODE_POOL4:
+		return request->operation == OP_ADD || request->operation == OP_REMOVE;
+	case MODE_FILTERING:
+	case MODE_FRAGMENTATION:
+	case MODE_TRANSLATE:
+		return request->operation != 0;
+	}
+
+	return false;
+}
+
+static int batch_add(void *request, __u16 request_len)
+{
+	unsigned char *tmp;
+	size_t capacity;
+
+	if (request_len < sizeof(struct request_hdr) || !is_batchable(request)) {
+		log_err(ERR_UNKNOWN_OP, "This command cannot be part of a batch.");
+		return -EINVAL;
+	}
+
+	if (batch_len + BATCH_ALIGN(request_len) > batch_capacity) {
+		capacity = 2 * batch_capacity;
+		while (capacity < batch_len + BATCH_ALIGN(request_len))
+			capacity *= 2;
+
+		tmp = realloc(batch, capacity);
+		if (!tmp) {
+			log_err(ERR_ALLOC_FAILED, "Out of memory.");
+			return -ENOMEM;
+		}
+		batch = tmp;
+		batch_capacity = capacity;
+	}
+
+	memcpy(batch + batch_len, request, request_len);
+	memset(batch + batch_len + request_len, 0, BATCH_ALIGN(request_len) - request_len);
+	batch_len += BATCH_ALIGN(request_len);
+	batch_count++;
+
+	return 0;
+}
+
+int netlink_batch_begin(void)
+{
+	batch_capacity = 4096;
+	batch = malloc(batch_capacity);
+	if (!batch) {
+		log_err(ERR_ALLOC_FAILED, "Out of memory.");
+		return -ENOMEM;
+	}
+
+	batch_len = BATCH_ALIGN(sizeof(struct request_hdr) + sizeof(struct request_batch));
+	batch_count = 0;
+	return 0;
+}
+
+static int batch_response(struct nl_msg *msg, void *arg)
+{
+	return 0;
+}
+
+int netlink_batch_commit(void)
+{
+	unsigned char *request = batch;
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct request_batch *payload = (struct request_batch *) (hdr + 1);
+	struct nl_sock *sk;
+	int error;
+
+	/* Stop collecting, so the socket can actually be opened. */
+	batch = NULL;
+
+	if (batch_count == 0) {
+		log_info("The batch is empty.");
+		error = 0;
+		goto end;
+	}
+
+	hdr->length = batch_len;
+	hdr->mode = MODE_BATCH;
+	hdr->operation = 0;
+	payload->count = batch_count;
+
+	error = netlink_open(&sk);
+	if (error)
+		goto end;
+
+	/* The default send buffer might be too small for a large batch. */
+	nl_socket_set_buffer_size(sk, 0, nlmsg_total_size(batch_len) + 4096);
+
+	error = netlink_send(sk, request, batch_len, batch_response, NULL);
+	if (!error)
+		log_info("Applied %u changes.", batch_count);
+
+	netlink_close(sk);
 	/* Fall through. */
 
-fail_free:
-	nl_socket_free(sk);
-	return -EINVAL;
+end:
+	free(request);
+	return error;
+}
+
+void netlink_batch_abort(void)
+{
+	free(batch);
+	batch = NULL;
+}
+
+int netlink_request(void *request, __u16 request_len, int (*cb)(struct nl_msg *, void *),
+		void *cb_arg)
+{
+	struct nl_sock *sk;
+	int error;
+
+	if (batch)
+		return batch_add(request, request_len);
+
+	error = netlink_open(&sk);
+	if (error)
+		return error;
+
+	error = netlink_send(sk, request, request_len, cb, cb_arg);
+
+	netlink_close(sk);
+	return error;
 }
@@ -0,0 +1,218 @@
+#include "nat64/usr/output.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+
+/** Size of stdout's buffer while printing records. */
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+static char buffer[OUTPUT_BUFFER_SIZE];
+
+
+int str_to_output_format(const char *str, enum output_format *result)
+{
+	if (strcmp(str, "text") == 0)
+		*result = OUTPUT_TEXT;
+	else if (strcmp(str, "csv") == 0)
+		*result = OUTPUT_CSV;
+	else if (strcmp(str, "json-lines") == 0)
+		*result = OUTPUT_JSON_LINES;
+	else if (strcmp(str, "binary") == 0)
+		*result = OUTPUT_BINARY;
+	else {
+		log_err(ERR_PARSE_FORMAT, "'%s' is not a valid output format. "
+				"Expected text, csv, json-lines or binary.", str);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void output_start(enum output_format format)
+{
+	if (format != OUTPUT_TEXT)
+		setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+}
+
+int output_end(void)
+{
+	if (fflush(stdout) != 0 || ferror(stdout)) {
+		log_err(ERR_UNKNOWN_ERROR, "Could not write the output: %s", strerror(errno));
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static char *l4proto_name(l4_protocol l4_proto)
+{
+	switch (l4_proto) {
+	case L4PROTO_TCP:
+		return "TCP";
+	case L4PROTO_UDP:
+		return "UDP";
+	case L4PROTO_ICMP:
+		return "ICMP";
+	default:
+		return "unknown";
+	}
+}
+
+static void output_record(__u8 type, l4_protocol l4_proto, void *entry, __u16 length)
+{
+	struct output_record hdr;
+
+	hdr.type = type;
+	hdr.l4_proto = l4_proto;
+	hdr.length = length;
+
+	fwrite(&hdr, sizeof(hdr), 1, stdout);
+	fwrite(entry, length, 1, stdout);
+}
+
+void output_bib_header(enum output_format format)
+{
+	if (format == OUTPUT_CSV)
+		fputs("protocol,static,ipv6_address,ipv6_port,ipv4_address,ipv4_port,generation\n",
+				stdout);
+}
+
+void output_bib_entry(enum output_format format, l4_protocol l4_proto, struct bib_entry_us *entry)
+{
+	char addr6[INET6_ADDRSTRLEN];
+	char addr4[INET_ADDRSTRLEN];
+
+	if (format == OUTPUT_BINARY) {
+		output_record(RECORD_BIB, l4_proto, entry, sizeof(*entry));
+		return;
+	}
+
+	inet_ntop(AF_INET6, &entry->ipv6.address, addr6, sizeof(addr6));
+	inet_ntop(AF_INET, &entry->ipv4.address, addr4, sizeof(addr4));
+
+	if (format == OUTPUT_CSV) {
+		printf("%s,%u,%s,%u,%s,%u,%llu\n", l4proto_name(l4_proto), entry->is_static,
+				addr6, entry->ipv6.l4_id, addr4, entry->ipv4.l4_id, entry->generation);
+	} else {
+		printf("{\"protocol\":\"%s\",\"static\":%s,"
+				"\"ipv6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"ipv4\":{\"address\":\"%s\",\"port\":%u},\"generation\":%llu}\n",
+				l4proto_name(l4_proto), entry->is_static ? "true" : "false",
+				addr6, entry->ipv6.l4_id, addr4, entry->ipv4.l4_id, entry->generation);
+	}
+}
+
+void output_session_header(enum output_format format)
+{
+	if (format == OUTPUT_CSV)
+		fputs("protocol,expires_ms,"
+				"remote6_address,remote6_port,local6_address,local6_port,"
+				"local4_address,local4_port,remote4_address,remote4_port,generation\n", stdout);
+}
+
+void output_session_entry(enum output_format format, struct session_entry_us *entry)
+{
+	char remote6[INET6_ADDRSTRLEN], local6[INET6_ADDRSTRLEN];
+	char local4[INET_ADDRSTRLEN], remote4[INET_ADDRSTRLEN];
+	char *proto;
+
+	if (format == OUTPUT_BINARY) {
+		output_record(RECORD_SESSION, entry->l4_proto, entry, sizeof(*entry));
+		return;
+	}
+
+	inet_ntop(AF_INET6, &entry->ipv6.remote.address, remote6, sizeof(remote6));
+	inet_ntop(AF_INET6, &entry->ipv6.local.address, local6, sizeof(local6));
+	inet_ntop(AF_INET, &entry->ipv4.local.address, local4, sizeof(local4));
+	inet_ntop(AF_INET, &entry->ipv4.remote.address, remote4, sizeof(remote4));
+	proto = l4proto_name(entry->l4_proto);
+
+	if (format == OUTPUT_CSV) {
+		printf("%s,%llu,%s,%u,%s,%u,%s,%u,%s,%u,%llu\n", proto, entry->dying_time,
+				remote6, entry->ipv6.remote.l4_id, local6, entry->ipv6.local.l4_id,
+				local4, entry->ipv4.local.l4_id, remote4, entry->ipv4.remote.l4_id,
+				entry->generation);
+	} else {
+		printf("{\"protocol\":\"%s\",\"expires_ms\":%llu,"
+				"\"remote6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"local6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"local4\":{\"address\":\"%s\",\"port\":%u},"
+				"\"remote4\":{\"address\":\"%s\",\"port\":%u},\"generation\":%llu}\n",
+				proto, entry->dying_time,
+				remote6, entry->ipv6.remote.l4_id, local6, entry->ipv6.local.l4_id,
+				local4, entry->ipv4.local.l4_id, remote4, entry->ipv4.remote.l4_id,
+				entry->generation);
+	}
+}
+
+static char *change_type_name(__u8 type)
+{
+	switch (type) {
+	case CHANGE_CREATED:
+		return "created";
+	case CHANGE_UPDATED:
+		return "updated";
+	case CHANGE_REMOVED:
+		return "removed";
+	default:
+		return "unknown";
+	}
+}
+
+void output_change_header(enum output_format format)
+{
+	if (format == OUTPUT_CSV)
+		fputs("generation,table,change,protocol,static,"
+				"remote6_address,remote6_port,local6_address,local6_port,"
+				"local4_address,local4_port,remote4_address,remote4_port\n", stdout);
+}
+
+void output_change(enum output_format format, struct change_us *change)
+{
+	char remote6[INET6_ADDRSTRLEN], local6[INET6_ADDRSTRLEN];
+	char local4[INET_ADDRSTRLEN], remote4[INET_ADDRSTRLEN];
+	bool is_bib = (change->table == CHANGE_BIB);
+	char *proto, *type;
+
+	if (format == OUTPUT_BINARY) {
+		output_record(RECORD_CHANGE, change->l4_proto, change, sizeof(*change));
+		return;
+	}
+
+	inet_ntop(AF_INET6, &change->ipv6.remote.address, remote6, sizeof(remote6));
+	inet_ntop(AF_INET6, &change->ipv6.local.address, local6, sizeof(local6));
+	inet_ntop(AF_INET, &change->ipv4.local.address, local4, sizeof(local4));
+	inet_ntop(AF_INET, &change->ipv4.remote.address, remote4, sizeof(remote4));
+	proto = l4proto_name(change->l4_proto);
+	type = change_type_name(change->type);
+
+	if (format == OUTPUT_CSV && is_bib) {
+		/* BIB entries only have the remote IPv6 and local IPv4 addresses. */
+		printf("%llu,bib,%s,%s,%u,%s,%u,,,%s,%u,,\n", change->generation, type, proto,
+				change->is_static, remote6, change->ipv6.remote.l4_id,
+				local4, change->ipv4.local.l4_id);
+	} else if (format == OUTPUT_CSV) {
+		printf("%llu,session,%s,%s,,%s,%u,%s,%u,%s,%u,%s,%u\n", change->generation, type,
+				proto, remote6, change->ipv6.remote.l4_id, local6, change->ipv6.local.l4_id,
+				local4, change->ipv4.local.l4_id, remote4, change->ipv4.remote.l4_id);
+	} else if (is_bib) {
+		printf("{\"generation\":%llu,\"table\":\"bib\",\"change\":\"%s\","
+				"\"protocol\":\"%s\",\"static\":%s,"
+				"\"ipv6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"ipv4\":{\"address\":\"%s\",\"port\":%u}}\n",
+				change->generation, type, proto, change->is_static ? "true" : "false",
+				remote6, change->ipv6.remote.l4_id, local4, change->ipv4.local.l4_id);
+	} else {
+		printf("{\"generation\":%llu,\"table\":\"session\",\"change\":\"%s\","
+				"\"protocol\":\"%s\","
+				"\"remote6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"local6\":{\"address\":\"%s\",\"port\":%u},"
+				"\"local4\":{\"address\":\"%s\",\"port\":%u},"
+				"\"remote4\":{\"address\":\"%s\",\"port\":%u}}\n",
+				change->generation, type, proto,
+				remote6, change->ipv6.remote.l4_id, local6, change->ipv6.local.l4_id,
+				local4, change->ipv4.local.l4_id, remote4, change->ipv4.remote.l4_id);
+	}
+}
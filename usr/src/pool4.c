@@ -16,8 +16,8 @@ static int pool4_display_response(struct nl_msg *msg, void *arg)
 	__u16 addr_count, i;
 
 	hdr = nlmsg_hdr(msg);
-	addresses = nlmsg_data(hdr);
-	addr_count = nlmsg_datalen(hdr) / sizeof(*addresses);
+	addresses = netlink_data(hdr);
+	addr_count = netlink_datalen(hdr) / sizeof(*addresses);
 
 	for (i = 0; i < addr_count; i++)
 		printf("%s\n", inet_ntoa(addresses[i]));
@@ -49,7 +49,7 @@ int pool4_display(void)
 
 static int pool4_count_response(struct nl_msg *msg, void *arg)
 {
-	__u64 *conf = nlmsg_data(nlmsg_hdr(msg));
+	__u64 *conf = netlink_data(nlmsg_hdr(msg));
 	printf("%llu\n", *conf);
 	return 0;
 }
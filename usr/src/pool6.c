@@ -17,8 +17,8 @@ static int pool6_display_response(struct nl_msg *msg, void *arg)
 	char addr_str[INET6_ADDRSTRLEN];
 
 	hdr = nlmsg_hdr(msg);
-	prefixes = nlmsg_data(hdr);
-	pref_count = nlmsg_datalen(hdr) / sizeof(*prefixes);
+	prefixes = netlink_data(hdr);
+	pref_count = netlink_datalen(hdr) / sizeof(*prefixes);
 
 	for (i = 0; i < pref_count; i++) {
 		inet_ntop(AF_INET6, &prefixes[i].address, addr_str, INET6_ADDRSTRLEN);
@@ -52,7 +52,7 @@ int pool6_display(void)
 
 static int pool6_count_response(struct nl_msg *msg, void *arg)
 {
-	__u64 *conf = nlmsg_data(nlmsg_hdr(msg));
+	__u64 *conf = netlink_data(nlmsg_hdr(msg));
 	printf("%llu\n", *conf);
 	return 0;
 }
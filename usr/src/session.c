@@ -3,7 +3,11 @@
 #include "nat64/comm/str_utils.h"
 #include "nat64/usr/netlink.h"
 #include "nat64/usr/dns.h"
+#include "nat64/usr/output.h"
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <sys/socket.h>
 
@@ -13,97 +17,206 @@
 
 struct display_params {
 	bool numeric_hostname;
+	enum output_format format;
 	int row_count;
+	/** Number of "rows" which have not been printed yet. */
+	unsigned int pending;
+	/** Sessions waiting for their names; unused if "numeric_hostname". */
+	struct session_entry_us *rows;
+	unsigned int row_capacity;
 };
 
-static int session_display_response(struct nl_msg *msg, void *arg)
+static void print_session_entry(struct session_entry_us *entry, bool numeric_hostname)
 {
-	struct nlmsghdr *hdr;
-	struct session_entry_us *entries;
-	struct display_params *params = arg;
-	__u16 entry_count, i;
+	printf("Expires in ");
+	print_time(entry->dying_time);
 
-	hdr = nlmsg_hdr(msg);
-	entries = nlmsg_data(hdr);
-	entry_count = nlmsg_datalen(hdr) / sizeof(*entries);
+	printf("Remote: ");
+	print_ipv4_tuple(&entry->ipv4.remote, numeric_hostname);
+
+	printf("\t");
+	print_ipv6_tuple(&entry->ipv6.remote, numeric_hostname);
+	printf("\n");
+
+	printf("Local: ");
+	print_ipv4_tuple(&entry->ipv4.local, true);
+
+	printf("\t");
+	print_ipv6_tuple(&entry->ipv6.local, true);
+	printf("\n");
+
+	printf("---------------------------------\n");
+}
+
+/**
+ * Stores "entries" in "params" and requests their names, so they can be resolved concurrently
+ * while the rest of the table arrives.
+ */
+static int defer_entries(struct display_params *params, struct session_entry_us *entries,
+		__u16 entry_count)
+{
+	struct session_entry_us *rows;
+	unsigned int capacity;
+	__u16 i;
+
+	if (params->pending + entry_count > params->row_capacity) {
+		capacity = params->row_capacity ? params->row_capacity : 256;
+		while (capacity < params->pending + entry_count)
+			capacity *= 2;
+
+		rows = realloc(params->rows, capacity * sizeof(*rows));
+		if (!rows) {
+			log_err(ERR_ALLOC_FAILED, "Out of memory.");
+			return -ENOMEM;
+		}
+		params->rows = rows;
+		params->row_capacity = capacity;
+	}
 
 	for (i = 0; i < entry_count; i++) {
-		struct session_entry_us *entry = &entries[i];
+		params->rows[params->pending + i] = entries[i];
+		dns_request_ipv4(&entries[i].ipv4.remote.address);
+		dns_request_ipv6(&entries[i].ipv6.remote.address);
+	}
 
-		printf("Expires in ");
-		print_time(entry->dying_time);
+	params->pending += entry_count;
+	return 0;
+}
 
-		printf("Remote: ");
-		print_ipv4_tuple(&entry->ipv4.remote, params->numeric_hostname);
+/**
+ * Prints the pending rows, in order, for as long as their names are ready. If "wait" is true,
+ * prints all of them, waiting for their names if necessary.
+ */
+static void print_rows(struct display_params *params, bool wait)
+{
+	struct session_entry_us *row;
+	unsigned int i;
 
-		printf("\t");
-		print_ipv6_tuple(&entry->ipv6.remote, params->numeric_hostname);
-		printf("\n");
+	for (i = 0; i < params->pending; i++) {
+		row = &params->rows[i];
+		if (!wait && !(dns_ready_ipv4(&row->ipv4.remote.address)
+				&& dns_ready_ipv6(&row->ipv6.remote.address)))
+			break;
+		print_session_entry(row, false);
+	}
 
-		printf("Local: ");
-		print_ipv4_tuple(&entry->ipv4.local, true);
+	params->pending -= i;
+	memmove(params->rows, params->rows + i, params->pending * sizeof(*params->rows));
+	fflush(stdout);
+}
+
+static int session_display_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr;
+	struct session_entry_us *entries;
+	struct display_params *params = arg;
+	__u16 entry_count, i;
+	int error;
 
-		printf("\t");
-		print_ipv6_tuple(&entry->ipv6.local, true);
-		printf("\n");
+	hdr = nlmsg_hdr(msg);
+	entries = netlink_data(hdr);
+	entry_count = netlink_datalen(hdr) / sizeof(*entries);
 
-		printf("---------------------------------\n");
+	if (params->format != OUTPUT_TEXT) {
+		for (i = 0; i < entry_count; i++)
+			output_session_entry(params->format, &entries[i]);
+	} else if (params->numeric_hostname) {
+		for (i = 0; i < entry_count; i++)
+			print_session_entry(&entries[i], true);
+	} else {
+		error = defer_entries(params, entries, entry_count);
+		if (error)
+			return error;
+		print_rows(params, false);
 	}
 
 	params->row_count += entry_count;
 	return 0;
 }
 
-static bool display_single_table(char *table_name, u_int8_t l4_proto, bool numeric_hostname)
+static bool display_single_table(char *table_name, u_int8_t l4_proto, bool numeric_hostname,
+		enum output_format format, struct table_query *query)
 {
 	unsigned char request[HDR_LEN + PAYLOAD_LEN];
 	struct request_hdr *hdr = (struct request_hdr *) request;
 	struct request_session *payload = (struct request_session *) (request + HDR_LEN);
 	struct display_params params;
+	bool resolve;
 	bool error;
 
-	printf("%s:\n", table_name);
-	printf("---------------------------------\n");
+	if (format == OUTPUT_TEXT) {
+		printf("%s:\n", table_name);
+		printf("---------------------------------\n");
+	}
 
 	hdr->length = sizeof(request);
 	hdr->mode = MODE_SESSION;
 	hdr->operation = OP_DISPLAY;
 	payload->l4_proto = l4_proto;
+	payload->display.query = *query;
 
 	params.numeric_hostname = numeric_hostname;
+	params.format = format;
 	params.row_count = 0;
+	params.pending = 0;
+	params.rows = NULL;
+	params.row_capacity = 0;
+
+	resolve = (format == OUTPUT_TEXT) && !numeric_hostname;
+	if (resolve)
+		dns_start();
 
 	error = netlink_request(request, hdr->length, session_display_response, &params);
-	if (!error) {
+	if (resolve) {
+		if (!error)
+			print_rows(&params, true);
+		dns_stop();
+	}
+
+	if (!error && format == OUTPUT_TEXT) {
 		if (params.row_count > 0)
 			log_info("  (Fetched %u entries.)\n", params.row_count);
 		else
 			log_info("  (empty)\n");
 	}
 
+	free(params.rows);
 	return error;
 }
 
-int session_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname)
+int session_display(bool use_tcp, bool use_udp, bool use_icmp, bool numeric_hostname,
+		enum output_format format, struct table_query *query)
 {
 	int tcp_error = 0;
 	int udp_error = 0;
 	int icmp_error = 0;
+	int output_error;
+
+	output_start(format);
+	output_session_header(format);
 
 	if (use_tcp)
-		tcp_error = display_single_table("TCP", L4PROTO_TCP, numeric_hostname);
+		tcp_error = display_single_table("TCP", L4PROTO_TCP, numeric_hostname, format, query);
 	if (use_udp)
-		udp_error = display_single_table("UDP", L4PROTO_UDP, numeric_hostname);
+		udp_error = display_single_table("UDP", L4PROTO_UDP, numeric_hostname, format, query);
 	if (use_icmp)
-		icmp_error = display_single_table("ICMP", L4PROTO_ICMP, numeric_hostname);
+		icmp_error = display_single_table("ICMP", L4PROTO_ICMP, numeric_hostname, format, query);
 
-	return (tcp_error || udp_error || icmp_error) ? -EINVAL : 0;
+	output_error = output_end();
+
+	return (tcp_error || udp_error || icmp_error || output_error) ? -EINVAL : 0;
 }
 
 static int session_count_response(struct nl_msg *msg, void *arg)
 {
-	__u64 *conf = nlmsg_data(nlmsg_hdr(msg));
-	printf("%llu\n", *conf);
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct table_count_us *count = netlink_data(hdr);
+
+	/* Older modules only send the count. */
+	if (netlink_datalen(hdr) >= sizeof(*count))
+		printf("%llu (%llu bytes)\n", count->count, count->bytes);
+	else
+		printf("%llu\n", count->count);
 	return 0;
 }
 
@@ -138,3 +251,45 @@ int session_count(bool use_tcp, bool use_udp, bool use_icmp)
 
 	return (tcp_error || udp_error || icmp_error) ? -EINVAL : 0;
 }
+
+static int session_flush_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct flush_count_us *count = netlink_data(hdr);
+
+	printf("%llu sessions and %llu BIB entries removed.\n", count->session, count->bib);
+	return 0;
+}
+
+static bool flush_single_table(char *table_name, u_int8_t l4_proto, struct ipv6_prefix *prefix)
+{
+	unsigned char request[HDR_LEN + PAYLOAD_LEN];
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct request_session *payload = (struct request_session *) (request + HDR_LEN);
+
+	printf("%s: ", table_name);
+
+	hdr->length = sizeof(request);
+	hdr->mode = MODE_SESSION;
+	hdr->operation = OP_FLUSH;
+	payload->l4_proto = l4_proto;
+	payload->flush.prefix = *prefix;
+
+	return netlink_request(request, hdr->length, session_flush_response, NULL);
+}
+
+int session_flush(bool use_tcp, bool use_udp, bool use_icmp, struct ipv6_prefix *prefix)
+{
+	int tcp_error = 0;
+	int udp_error = 0;
+	int icmp_error = 0;
+
+	if (use_tcp)
+		tcp_error = flush_single_table("TCP", L4PROTO_TCP, prefix);
+	if (use_udp)
+		udp_error = flush_single_table("UDP", L4PROTO_UDP, prefix);
+	if (use_icmp)
+		icmp_error = flush_single_table("ICMP", L4PROTO_ICMP, prefix);
+
+	return (tcp_error || udp_error || icmp_error) ? -EINVAL : 0;
+}
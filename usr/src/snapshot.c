@@ -0,0 +1,442 @@
+#include "nat64/usr/snapshot.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/comm/sync.h"
+#include "nat64/usr/netlink.h"
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+
+#if SNAPSHOT_BLOCK_MAX > SYNC_REQUEST_MAX
+#error "The module would refuse the session blocks."
+#endif
+
+/** Size of the largest record; the block buffers need to hold SNAPSHOT_BLOCK_MAX of them. */
+#define RECORD_MAX_LEN sizeof(struct sync_session)
+
+/**
+ * The state of snapshot_save().
+ */
+struct writer {
+	FILE *file;
+	/** The block being collected. Its records are in "records"; it is written once it fills up. */
+	struct snapshot_block block;
+	unsigned char records[SNAPSHOT_BLOCK_MAX * RECORD_MAX_LEN];
+	size_t record_len;
+	/** Protocol of the BIB being dumped. */
+	l4_protocol l4_proto;
+
+	unsigned int bib_count;
+	unsigned int session_count;
+	/** Writing failed, so there is no point in going on. */
+	bool failed;
+};
+
+static __u64 now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return ((__u64) now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+static char *block_name(__u8 type)
+{
+	return (type == SNAPSHOT_BIB) ? "BIB" : "session";
+}
+
+static int write_block(struct writer *writer)
+{
+	__u16 count = ntohs(writer->block.count);
+
+	if (!count)
+		return 0;
+
+	if (fwrite(&writer->block, sizeof(writer->block), 1, writer->file) != 1
+			|| fwrite(writer->records, writer->record_len, count, writer->file) != count) {
+		log_err(ERR_PARSE_FILE, "Could not write the %s entries.", block_name(writer->block.type));
+		writer->failed = true;
+		return -EINVAL;
+	}
+
+	writer->block.count = 0;
+	return 0;
+}
+
+static int write_record(struct writer *writer, __u8 type, void *record, size_t record_len)
+{
+	__u16 count = ntohs(writer->block.count);
+	int error;
+
+	if (count && (writer->block.type != type || count == SNAPSHOT_BLOCK_MAX)) {
+		error = write_block(writer);
+		if (error)
+			return error;
+		count = 0;
+	}
+
+	if (!count) {
+		memset(&writer->block, 0, sizeof(writer->block));
+		writer->block.type = type;
+		writer->record_len = record_len;
+	}
+
+	memcpy(writer->records + count * record_len, record, record_len);
+	writer->block.count = htons(count + 1);
+	return 0;
+}
+
+static int save_bib_response(struct nl_msg *msg, void *arg)
+{
+	struct writer *writer = arg;
+	struct nlmsghdr *hdr;
+	struct bib_entry_us *entries;
+	struct snapshot_bib record;
+	__u16 entry_count, i;
+	int error;
+
+	hdr = nlmsg_hdr(msg);
+	entries = netlink_data(hdr);
+	entry_count = netlink_datalen(hdr) / sizeof(*entries);
+
+	for (i = 0; i < entry_count && !writer->failed; i++) {
+		/* The dynamic ones come back with their sessions. */
+		if (!entries[i].is_static)
+			continue;
+
+		memset(&record, 0, sizeof(record));
+		record.l4_proto = writer->l4_proto;
+		record.addr6 = entries[i].ipv6.address;
+		record.port6 = htons(entries[i].ipv6.l4_id);
+		record.addr4 = entries[i].ipv4.address;
+		record.port4 = htons(entries[i].ipv4.l4_id);
+
+		error = write_record(writer, SNAPSHOT_BIB, &record, sizeof(record));
+		if (error)
+			return error;
+		writer->bib_count++;
+	}
+
+	return 0;
+}
+
+static int save_session_response(struct nl_msg *msg, void *arg)
+{
+	struct writer *writer = arg;
+	struct nlmsghdr *hdr;
+	struct sync_session *records;
+	__u16 record_count, i;
+	int error;
+
+	hdr = nlmsg_hdr(msg);
+	records = netlink_data(hdr);
+	record_count = netlink_datalen(hdr) / sizeof(*records);
+
+	for (i = 0; i < record_count && !writer->failed; i++) {
+		error = write_record(writer, SNAPSHOT_SESSIONS, &records[i], sizeof(records[i]));
+		if (error)
+			return error;
+		writer->session_count++;
+	}
+
+	return 0;
+}
+
+static int save_bib(struct nl_sock *sk, struct writer *writer, l4_protocol l4_proto)
+{
+	unsigned char request[sizeof(struct request_hdr) + sizeof(struct request_bib)];
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct request_bib *payload = (struct request_bib *) (hdr + 1);
+
+	hdr->length = sizeof(request);
+	hdr->mode = MODE_BIB;
+	hdr->operation = OP_DISPLAY;
+	payload->l4_proto = l4_proto;
+	memset(&payload->display.query, 0, sizeof(payload->display.query));
+
+	writer->l4_proto = l4_proto;
+	return netlink_send(sk, request, hdr->length, save_bib_response, writer);
+}
+
+static int save_sessions(struct nl_sock *sk, struct writer *writer)
+{
+	struct request_hdr request = {
+			.length = sizeof(request),
+			.mode = MODE_SYNC,
+			.operation = OP_DISPLAY,
+	};
+
+	return netlink_send(sk, &request, request.length, save_session_response, writer);
+}
+
+int snapshot_save(char *file_name)
+{
+	struct writer *writer;
+	struct snapshot_hdr hdr;
+	struct nl_sock *sk;
+	bool use_stdout = strcmp(file_name, "-") == 0;
+	int error;
+
+	/* The block buffer is a bit large for the stack. */
+	writer = calloc(1, sizeof(*writer));
+	if (!writer) {
+		log_err(ERR_ALLOC_FAILED, "Out of memory.");
+		return -ENOMEM;
+	}
+
+	writer->file = use_stdout ? stdout : fopen(file_name, "wb");
+	if (!writer->file) {
+		log_err(ERR_PARSE_FILE, "Cannot open '%s' for writing.", file_name);
+		error = -EINVAL;
+		goto free_writer;
+	}
+
+	error = netlink_open(&sk);
+	if (error)
+		goto close_file;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+	hdr.version = SNAPSHOT_VERSION;
+	hdr.time = htobe64(now_ms());
+	if (fwrite(&hdr, sizeof(hdr), 1, writer->file) != 1) {
+		log_err(ERR_PARSE_FILE, "Could not write the image's header.");
+		error = -EINVAL;
+		goto close_socket;
+	}
+
+	error = save_bib(sk, writer, L4PROTO_TCP);
+	if (!error)
+		error = save_bib(sk, writer, L4PROTO_UDP);
+	if (!error)
+		error = save_bib(sk, writer, L4PROTO_ICMP);
+	if (!error)
+		error = save_sessions(sk, writer);
+	if (!error)
+		error = write_block(writer);
+	if (writer->failed)
+		error = -EINVAL;
+	/* Fall through. */
+
+close_socket:
+	netlink_close(sk);
+	/* Fall through. */
+
+close_file:
+	if (!use_stdout && fclose(writer->file) != 0 && !error) {
+		log_err(ERR_PARSE_FILE, "Could not finish writing '%s'.", file_name);
+		error = -EINVAL;
+	}
+	if (!error && !use_stdout)
+		log_info("Saved %u static BIB entries and %u sessions.", writer->bib_count,
+				writer->session_count);
+	/* Fall through. */
+
+free_writer:
+	free(writer);
+	return error;
+}
+
+/**
+ * The state of snapshot_restore().
+ */
+struct reader {
+	FILE *file;
+	struct nl_sock *sk;
+	/** Milliseconds that have passed since the image was taken. */
+	__u64 elapsed;
+	/** The request being built. The records of the current block are read right into it. */
+	unsigned char *request;
+
+	unsigned int bib_count;
+	unsigned int session_count;
+	unsigned int expired_count;
+};
+
+static int restore_response(struct nl_msg *msg, void *arg)
+{
+	return 0;
+}
+
+static int restore_bib(struct reader *reader, __u16 count)
+{
+	struct request_hdr *hdr = (struct request_hdr *) reader->request;
+	struct request_bib *payload = (struct request_bib *) (hdr + 1);
+	struct bib_import_us *entries = (struct bib_import_us *) (payload + 1);
+	struct snapshot_bib record;
+	__u16 i;
+	int error;
+
+	for (i = 0; i < count; i++) {
+		if (fread(&record, sizeof(record), 1, reader->file) != 1)
+			return -EIO;
+
+		entries[i].l4_proto = record.l4_proto;
+		entries[i].ipv6.address = record.addr6;
+		entries[i].ipv6.l4_id = ntohs(record.port6);
+		entries[i].ipv4.address = record.addr4;
+		entries[i].ipv4.l4_id = ntohs(record.port4);
+	}
+
+	hdr->length = sizeof(*hdr) + sizeof(*payload) + count * sizeof(*entries);
+	hdr->mode = MODE_BIB;
+	hdr->operation = OP_IMPORT;
+	payload->import.count = count;
+
+	error = netlink_send(reader->sk, reader->request, hdr->length, restore_response, NULL);
+	if (error) {
+		log_err(ERR_BIB_REINSERT, "Some static BIB entries could not be restored (see the "
+				"kernel log). Is the module fresh, and is its pool4 the same as before?");
+		return error;
+	}
+
+	reader->bib_count += count;
+	return 0;
+}
+
+static int restore_sessions(struct reader *reader, __u16 count)
+{
+	struct request_hdr *hdr = (struct request_hdr *) reader->request;
+	struct sync_batch *batch = (struct sync_batch *) (hdr + 1);
+	struct sync_session *records = (struct sync_session *) (batch + 1);
+	__u64 lifetime;
+	__u16 kept, i;
+
+	if (fread(records, sizeof(*records), count, reader->file) != count)
+		return -EIO;
+
+	/* The sessions aged while the module was away. */
+	for (i = 0, kept = 0; i < count; i++) {
+		lifetime = ntohl(records[i].lifetime);
+		if (lifetime <= reader->elapsed) {
+			reader->expired_count++;
+			continue;
+		}
+
+		records[kept] = records[i];
+		records[kept].lifetime = htonl(lifetime - reader->elapsed);
+		kept++;
+	}
+
+	if (!kept)
+		return 0;
+
+	hdr->length = sizeof(*hdr) + sizeof(*batch) + kept * sizeof(*records);
+	hdr->mode = MODE_SYNC;
+	hdr->operation = OP_ADD;
+	batch->version = SYNC_VERSION;
+	batch->flags = 0;
+	batch->count = htons(kept);
+
+	reader->session_count += kept;
+	/* The module rejects the sessions it cannot install one by one (see --stats). */
+	return netlink_send(reader->sk, reader->request, hdr->length, restore_response, NULL);
+}
+
+static int read_header(struct reader *reader)
+{
+	struct snapshot_hdr hdr;
+	__u64 now, then;
+
+	if (fread(&hdr, sizeof(hdr), 1, reader->file) != 1
+			|| memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0) {
+		log_err(ERR_PARSE_FILE, "The file is not a table image.");
+		return -EINVAL;
+	}
+	if (hdr.version != SNAPSHOT_VERSION) {
+		log_err(ERR_PARSE_FILE, "The image's version is %u; I only understand %u.",
+				hdr.version, SNAPSHOT_VERSION);
+		return -EINVAL;
+	}
+
+	now = now_ms();
+	then = be64toh(hdr.time);
+	reader->elapsed = (now > then) ? (now - then) : 0;
+	return 0;
+}
+
+int snapshot_restore(char *file_name)
+{
+	struct reader reader;
+	struct snapshot_block block;
+	__u16 count;
+	bool use_stdin = strcmp(file_name, "-") == 0;
+	int error;
+
+	memset(&reader, 0, sizeof(reader));
+
+	reader.file = use_stdin ? stdin : fopen(file_name, "rb");
+	if (!reader.file) {
+		log_err(ERR_PARSE_FILE, "Cannot open '%s'.", file_name);
+		return -EINVAL;
+	}
+
+	error = read_header(&reader);
+	if (error)
+		goto close_file;
+
+	reader.request = malloc(sizeof(struct request_hdr) + sizeof(struct request_bib)
+			+ SNAPSHOT_BLOCK_MAX * sizeof(struct bib_import_us)
+			+ sizeof(struct sync_batch) + SNAPSHOT_BLOCK_MAX * sizeof(struct sync_session));
+	if (!reader.request) {
+		log_err(ERR_ALLOC_FAILED, "Out of memory.");
+		error = -ENOMEM;
+		goto close_file;
+	}
+
+	error = netlink_open(&reader.sk);
+	if (error)
+		goto free_request;
+
+	while (fread(&block, sizeof(block), 1, reader.file) == 1) {
+		count = ntohs(block.count);
+		if (count > SNAPSHOT_BLOCK_MAX) {
+			log_err(ERR_PARSE_FILE, "The image is corrupted (a block has %u records).", count);
+			error = -EINVAL;
+			break;
+		}
+
+		switch (block.type) {
+		case SNAPSHOT_BIB:
+			error = restore_bib(&reader, count);
+			break;
+		case SNAPSHOT_SESSIONS:
+			error = restore_sessions(&reader, count);
+			break;
+		default:
+			log_err(ERR_PARSE_FILE, "The image is corrupted (unknown block type %u).",
+					block.type);
+			error = -EINVAL;
+		}
+
+		if (error == -EIO)
+			log_err(ERR_PARSE_FILE, "The image is truncated.");
+		if (error)
+			break;
+	}
+
+	if (!error && ferror(reader.file)) {
+		log_err(ERR_PARSE_FILE, "Could not read '%s'.", file_name);
+		error = -EINVAL;
+	}
+	if (!error)
+		log_info("Restored %u static BIB entries and %u sessions (%u had expired). "
+				"Sessions the module rejected are counted in --stats.",
+				reader.bib_count, reader.session_count, reader.expired_count);
+
+	netlink_close(reader.sk);
+	/* Fall through. */
+
+free_request:
+	free(reader.request);
+	/* Fall through. */
+
+close_file:
+	if (!use_stdin)
+		fclose(reader.file);
+	return error;
+}
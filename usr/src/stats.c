@@ -0,0 +1,91 @@
+#include "nat64/usr/stats.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/comm/stats.h"
+#include "nat64/usr/netlink.h"
+#include <errno.h>
+
+
+/** Human-readable names of the counters, indexed by enum stat_counter. */
+static char *names[] = {
+	[STAT_ACCEPTED] = "Packets ignored (not meant for translation)",
+	[STAT_STOLEN] = "Packets stolen",
+	[STAT_DROPPED] = "Packets dropped",
+	[STAT_PKTS_6TO4] = "Packets translated 6->4",
+	[STAT_BYTES_6TO4] = "Bytes translated 6->4",
+	[STAT_PKTS_4TO6] = "Packets translated 4->6",
+	[STAT_BYTES_4TO6] = "Bytes translated 4->6",
+	[STAT_HAIRPINNED] = "Packets hairpinned",
+	[STAT_TRANSLATE_FAILED] = "Translation failures",
+	[STAT_INVALID_PACKET] = "Invalid packets",
+	[STAT_BAD_CHECKSUM] = "Bad checksums",
+	[STAT_FRAG_STORED] = "Fragments stored",
+	[STAT_FRAG_REASSEMBLED] = "Fragmented packets completed",
+	[STAT_FRAG_EXPIRED] = "Fragmented packets expired",
+	[STAT_HAIRPIN_LOOP] = "Hairpinning loops",
+	[STAT_POOL6_MISMATCH] = "Rejected by pool6",
+	[STAT_POOL4_MISMATCH] = "Rejected by pool4",
+	[STAT_NO_BIB] = "IPv4 packets without BIB entry",
+	[STAT_FILTER_ADDR] = "Blocked by address-dependent filtering",
+	[STAT_FILTER_ICMP6_INFO] = "ICMPv6 informational packets filtered",
+	[STAT_FILTER_EXTERNAL_TCP] = "Externally initiated TCP connections filtered",
+	[STAT_TCP_NO_STATE] = "TCP packets without state",
+	[STAT_TCP_V4_SYN] = "IPv4-initiated TCP connections dropped",
+	[STAT_POOL4_EXHAUSTED] = "IPv4 transport address exhaustion",
+	[STAT_BIB_CREATED] = "BIB entries created",
+	[STAT_BIB_REMOVED] = "BIB entries removed",
+	[STAT_SESSION_CREATED] = "Sessions created",
+	[STAT_SESSION_EXPIRED] = "Sessions expired",
+	[STAT_PROBES_SENT] = "TCP probes sent",
+	[STAT_ROUTE_FAILED] = "Routing failures",
+	[STAT_SEND_FAILED] = "Dispatch failures",
+	[STAT_ALLOC_FAILED] = "Allocation failures",
+	[STAT_EVENTS_SUPPRESSED] = "Events suppressed by rate limiting",
+	[STAT_EVENTS_LOST] = "Events lost (not fetched in time)",
+	[STAT_BIB_LIMIT] = "BIB entries refused (limit reached)",
+	[STAT_SESSION_LIMIT] = "Sessions refused (limit reached)",
+	[STAT_SESSION_EVICTED] = "Sessions evicted early",
+	[STAT_SYN_PENDING] = "IPv4 SYNs forwarded without a session",
+	[STAT_SYN_PENDING_LOST] = "Pending IPv4 SYNs lost (table full)",
+	[STAT_SYN_STORED] = "IPv4 SYNs stored",
+	[STAT_SYN_STORE_DROPPED] = "IPv4 SYNs not stored (storage full)",
+	[STAT_SYNC_LOST] = "Session changes not synchronized (not fetched in time)",
+	[STAT_SYNC_APPLIED] = "Session changes applied (from the peer or an image)",
+	[STAT_SYNC_REJECTED] = "Session changes rejected (from the peer or an image)",
+};
+
+char *stats_name(unsigned int counter)
+{
+	return (counter < STAT_COUNT && names[counter]) ? names[counter] : "Unknown counter";
+}
+
+static int stats_display_response(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr;
+	__u64 *counters;
+	int counter_count, i;
+
+	hdr = nlmsg_hdr(msg);
+	counters = netlink_data(hdr);
+	counter_count = netlink_datalen(hdr) / sizeof(*counters);
+
+	/* The kernel module might be older or newer than us. */
+	for (i = 0; i < counter_count; i++) {
+		if (i < STAT_COUNT && names[i])
+			printf("%s: %llu\n", names[i], counters[i]);
+		else
+			printf("Unknown counter #%d: %llu\n", i, counters[i]);
+	}
+
+	return 0;
+}
+
+int stats_display(void)
+{
+	struct request_hdr request = {
+			.length = sizeof(request),
+			.mode = MODE_STATS,
+			.operation = OP_DISPLAY,
+	};
+
+	return netlink_request(&request, request.length, stats_display_response, NULL);
+}
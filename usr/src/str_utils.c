@@ -60,6 +60,27 @@ int str_to_u16(const char *str, __u16 *u16_out, __u16 min, __u16 max)
 	return 0;
 }
 
+int str_to_u64(const char *str, __u64 *u64_out, __u64 min, __u64 max)
+{
+	unsigned long long result;
+	char *endptr;
+
+	/* strtoull() happily negates negative numbers. */
+	errno = 0;
+	result = strtoull(str, &endptr, 10);
+	if (errno != 0 || str == endptr || strchr(str, '-')) {
+		log_err(ERR_PARSE_INT, "Cannot parse '%s' as an integer value.", str);
+		return -EINVAL;
+	}
+	if (result < min || max < result) {
+		log_err(ERR_INT_OUT_OF_BOUNDS, "'%s' is out of bounds (%llu-%llu).", str, min, max);
+		return -EINVAL;
+	}
+
+	*u64_out = result;
+	return 0;
+}
+
 #define STR_MAX_LEN 2048
 int str_to_u16_array(const char *str, __u16 **array_out, __u16 *array_len_out)
 {
@@ -217,15 +238,12 @@ int str_to_addr6_port(const char *str, struct ipv6_tuple_address *addr_out)
 
 #undef STR_MAX_LEN
 #define STR_MAX_LEN (INET6_ADDRSTRLEN + 1 + 3) /* [addr + null chara] + / + pref len */
-int str_to_prefix(const char *str, struct ipv6_prefix *prefix_out)
+int str_to_network6(const char *str, struct ipv6_prefix *prefix_out)
 {
 	const char *FORMAT = "<IPv6 address>/<length> (eg. 64:ff9b::/96)";
 	/* strtok corrupts the string, so we'll be using this copy instead. */
 	char str_copy[STR_MAX_LEN];
 	char *token;
-	__u8 valid_lengths[] = POOL6_PREFIX_LENGTHS;
-	int valid_lengths_size = sizeof(valid_lengths) / sizeof(valid_lengths[0]);
-	int i;
 	int error;
 
 	if (strlen(str) + 1 > STR_MAX_LEN) {
@@ -249,7 +267,17 @@ int str_to_prefix(const char *str, struct ipv6_prefix *prefix_out)
 		log_err(ERR_PARSE_PREFIX, "'%s' does not seem to contain a mask (format: %s).", str, FORMAT);
 		return -EINVAL;
 	}
-	error = str_to_u8(token, &prefix_out->len, 0, 0xFF);
+	return str_to_u8(token, &prefix_out->len, 0, 128); /* Error msg already printed, if any. */
+}
+
+int str_to_prefix(const char *str, struct ipv6_prefix *prefix_out)
+{
+	__u8 valid_lengths[] = POOL6_PREFIX_LENGTHS;
+	int valid_lengths_size = sizeof(valid_lengths) / sizeof(valid_lengths[0]);
+	int i;
+	int error;
+
+	error = str_to_network6(str, prefix_out);
 	if (error)
 		return error; /* Error msg already printed. */
 
@@ -261,6 +289,69 @@ int str_to_prefix(const char *str, struct ipv6_prefix *prefix_out)
 	return -EINVAL;
 }
 
+#undef STR_MAX_LEN
+#define STR_MAX_LEN (5 + 1 + 5) /* port + - + port */
+int str_to_port_range(const char *str, __u16 *min_out, __u16 *max_out)
+{
+	char str_copy[STR_MAX_LEN + 1];
+	char *dash;
+	int error;
+
+	if (strlen(str) > STR_MAX_LEN) {
+		log_err(ERR_PARSE_INT, "'%s' is too long to be a port range.", str);
+		return -EINVAL;
+	}
+	strcpy(str_copy, str);
+
+	dash = strchr(str_copy, '-');
+	if (!dash) {
+		error = str_to_u16(str_copy, min_out, 0, MAX_PORT);
+		*max_out = *min_out;
+		return error;
+	}
+
+	*dash = '\0';
+	error = str_to_u16(str_copy, min_out, 0, MAX_PORT);
+	if (error)
+		return error;
+	error = str_to_u16(dash + 1, max_out, 0, MAX_PORT);
+	if (error)
+		return error;
+
+	if (*min_out > *max_out) {
+		log_err(ERR_INT_OUT_OF_BOUNDS, "The range '%s' is upside down.", str);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int str_to_tcp_state(const char *str, __u8 *state_out)
+{
+	const char *names[] = {
+		[CLOSED] = "CLOSED",
+		[V6_INIT] = "V6_INIT",
+		[V4_INIT] = "V4_INIT",
+		[ESTABLISHED] = "ESTABLISHED",
+		[V4_FIN_RCV] = "V4_FIN_RCV",
+		[V6_FIN_RCV] = "V6_FIN_RCV",
+		[V4_FIN_V6_FIN_RCV] = "V4_FIN_V6_FIN_RCV",
+		[TRANS] = "TRANS",
+	};
+	int i;
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strcasecmp(str, names[i]) == 0) {
+			*state_out = i;
+			return 0;
+		}
+	}
+
+	log_err(ERR_PARSE_INT, "'%s' is not a TCP state (CLOSED|V6_INIT|V4_INIT|ESTABLISHED|"
+			"V4_FIN_RCV|V6_FIN_RCV|V4_FIN_V6_FIN_RCV|TRANS).", str);
+	return -EINVAL;
+}
+
 void print_time(__u64 millis)
 {
 	__u64 seconds;
@@ -0,0 +1,419 @@
+#include "nat64/usr/sync.h"
+#include "nat64/comm/config_proto.h"
+#include "nat64/comm/str_utils.h"
+#include "nat64/comm/sync.h"
+#include "nat64/usr/netlink.h"
+#include "nat64/usr/dns.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+/** Length of the largest datagram the peers exchange. */
+#define BATCH_MAX_LEN (sizeof(struct sync_batch) + SYNC_BATCH_MAX * sizeof(struct sync_session))
+
+/**
+ * The state of sync_send().
+ */
+struct sender {
+	/** The UDP socket, connected to the peer. */
+	int sk;
+	/** The table records which have not been sent yet, behind room for their batch header. */
+	unsigned char buffer[BATCH_MAX_LEN];
+	__u16 count;
+	/** Some changes were lost, so the peer needs the entire table again. */
+	bool lost;
+};
+
+/**
+ * Parses "str" as an IPv6 or IPv4 transport address (ADDR#PORT).
+ */
+static int str_to_sockaddr(char *str, struct sockaddr_storage *addr, socklen_t *addr_len)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) addr;
+	struct sockaddr_in *sin = (struct sockaddr_in *) addr;
+	struct ipv6_tuple_address addr6;
+	struct ipv4_tuple_address addr4;
+	int error;
+
+	memset(addr, 0, sizeof(*addr));
+
+	if (strchr(str, ':')) {
+		error = str_to_addr6_port(str, &addr6);
+		if (error)
+			return error;
+		sin6->sin6_family = AF_INET6;
+		sin6->sin6_addr = addr6.address;
+		sin6->sin6_port = htons(addr6.l4_id);
+		*addr_len = sizeof(*sin6);
+	} else {
+		error = str_to_addr4_port(str, &addr4);
+		if (error)
+			return error;
+		sin->sin_family = AF_INET;
+		sin->sin_addr = addr4.address;
+		sin->sin_port = htons(addr4.l4_id);
+		*addr_len = sizeof(*sin);
+	}
+
+	return 0;
+}
+
+/**
+ * Opens a UDP socket, and either binds it to "str" (if "bind_it") or connects it to "str".
+ */
+static int open_udp(char *str, bool bind_it, int *result)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int sk;
+	int error;
+
+	error = str_to_sockaddr(str, &addr, &addr_len);
+	if (error)
+		return error;
+
+	sk = socket(addr.ss_family, SOCK_DGRAM, 0);
+	if (sk < 0) {
+		error = -errno;
+		log_err(ERR_UNKNOWN_ERROR, "Could not create a UDP socket: %s", strerror(-error));
+		return error;
+	}
+
+	error = bind_it
+			? bind(sk, (struct sockaddr *) &addr, addr_len)
+			: connect(sk, (struct sockaddr *) &addr, addr_len);
+	if (error) {
+		error = -errno;
+		log_err(ERR_UNKNOWN_ERROR, "Could not %s the UDP socket to %s: %s",
+				bind_it ? "bind" : "connect", str, strerror(-error));
+		close(sk);
+		return error;
+	}
+
+	*result = sk;
+	return 0;
+}
+
+static int send_datagram(struct sender *sender, void *data, size_t data_len)
+{
+	int error;
+
+	if (send(sender->sk, data, data_len, 0) >= 0)
+		return 0;
+
+	/* An ICMP error from an earlier datagram; the receiver is not running (yet). */
+	if (errno == ECONNREFUSED) {
+		log_info("(The peer is not listening; some session changes did not reach it.)");
+		return 0;
+	}
+
+	error = -errno;
+	log_err(ERR_UNKNOWN_ERROR, "Could not send the session changes: %s", strerror(-error));
+	return error;
+}
+
+/**
+ * Sends the table records "sender" has collected so far.
+ */
+static int flush(struct sender *sender)
+{
+	struct sync_batch *batch = (struct sync_batch *) sender->buffer;
+	int error;
+
+	if (!sender->count)
+		return 0;
+
+	batch->version = SYNC_VERSION;
+	batch->flags = 0;
+	batch->count = htons(sender->count);
+
+	error = send_datagram(sender, batch,
+			sizeof(*batch) + sender->count * sizeof(struct sync_session));
+	sender->count = 0;
+	return error;
+}
+
+static int table_response(struct nl_msg *msg, void *arg)
+{
+	struct sender *sender = arg;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct sync_session *records = netlink_data(hdr);
+	struct sync_session *pending = (struct sync_session *) (sender->buffer
+			+ sizeof(struct sync_batch));
+	int record_count, i;
+	int error;
+
+	record_count = netlink_datalen(hdr) / sizeof(*records);
+
+	for (i = 0; i < record_count; i++) {
+		pending[sender->count++] = records[i];
+		if (sender->count == SYNC_BATCH_MAX) {
+			error = flush(sender);
+			if (error)
+				return error;
+		}
+	}
+
+	return 0;
+}
+
+static int send_table(struct sender *sender)
+{
+	struct request_hdr request = {
+			.length = sizeof(request),
+			.mode = MODE_SYNC,
+			.operation = OP_DISPLAY,
+	};
+	int error;
+
+	sender->count = 0;
+	error = netlink_request(&request, request.length, table_response, sender);
+	if (!error)
+		error = flush(sender);
+	if (!error)
+		log_info("Sent the session table to the peer.");
+
+	return error;
+}
+
+/**
+ * Forwards one of the batches the module published to the peer. The format is the same.
+ */
+static int forward_response(struct nl_msg *msg, void *arg)
+{
+	struct sender *sender = arg;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct genlmsghdr *genl_hdr = nlmsg_data(hdr);
+	struct sync_batch *batch = netlink_data(hdr);
+	int batch_len = netlink_datalen(hdr);
+
+	if (genl_hdr->cmd != JOOL_CMD_SYNC || batch_len < sizeof(*batch))
+		return 0;
+
+	if (batch->flags & SYNC_FLAG_LOST) {
+		log_info("(The module lost some session changes; resending the table.)");
+		sender->lost = true;
+	}
+
+	return batch->count ? send_datagram(sender, batch, batch_len) : 0;
+}
+
+int sync_send(char *peer)
+{
+	struct sender sender;
+	struct nl_sock *group;
+	int error;
+
+	error = open_udp(peer, false, &sender.sk);
+	if (error)
+		return error;
+
+	/* Subscribe first, so nothing that happens during the table dump is missed. */
+	error = netlink_subscribe(JOOL_GENL_SYNC_GROUP, &group);
+	if (error)
+		goto end;
+
+	/* The peer knows nothing yet. */
+	sender.lost = true;
+
+	do {
+		if (sender.lost) {
+			sender.lost = false;
+			error = send_table(&sender);
+			if (error)
+				break;
+		}
+
+		error = netlink_receive(group, forward_response, &sender);
+		if (error == -ENOBUFS) {
+			log_info("(Some session changes were lost; resending the table.)");
+			sender.lost = true;
+			error = 0;
+		}
+	} while (!error);
+
+	netlink_close(group);
+	/* Fall through. */
+
+end:
+	close(sender.sk);
+	return error;
+}
+
+static char *l4proto_name(__u8 l4_proto)
+{
+	switch (l4_proto) {
+	case L4PROTO_TCP:
+		return "TCP";
+	case L4PROTO_UDP:
+		return "UDP";
+	case L4PROTO_ICMP:
+		return "ICMP";
+	}
+
+	return "?";
+}
+
+static void print_record(struct sync_session *record)
+{
+	struct ipv6_tuple_address remote6 = { record->remote6, ntohs(record->remote6_port) };
+	struct ipv6_tuple_address local6 = { record->local6, ntohs(record->local6_port) };
+	struct ipv4_tuple_address local4 = { record->local4, ntohs(record->local4_port) };
+	struct ipv4_tuple_address remote4 = { record->remote4, ntohs(record->remote4_port) };
+
+	printf("%s %s session: ", (record->type == SYNC_SESSION_REMOVE) ? "Remove" : "Update",
+			l4proto_name(record->l4_proto));
+	print_ipv6_tuple(&remote6, true);
+	printf(" ");
+	print_ipv6_tuple(&local6, true);
+	printf(" - ");
+	print_ipv4_tuple(&local4, true);
+	printf(" ");
+	print_ipv4_tuple(&remote4, true);
+	printf(" (state %u, %u ms)\n", record->state, ntohl(record->lifetime));
+}
+
+static bool is_valid_batch(struct sync_batch *batch, ssize_t batch_len)
+{
+	__u16 count;
+
+	if (batch_len < sizeof(*batch) || batch->version != SYNC_VERSION)
+		return false;
+
+	count = ntohs(batch->count);
+	return count <= SYNC_BATCH_MAX
+			&& batch_len == sizeof(*batch) + count * sizeof(struct sync_session);
+}
+
+static int install_response(struct nl_msg *msg, void *arg)
+{
+	return 0;
+}
+
+/**
+ * Parses "str" as an IPv6 or IPv4 address, of the same family as the "local" socket.
+ */
+static int str_to_peer(char *str, struct sockaddr_storage *local, struct sockaddr_storage *peer)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) peer;
+	struct sockaddr_in *sin = (struct sockaddr_in *) peer;
+	int error;
+
+	memset(peer, 0, sizeof(*peer));
+
+	if (local->ss_family == AF_INET6) {
+		sin6->sin6_family = AF_INET6;
+		error = str_to_addr6(str, &sin6->sin6_addr);
+	} else {
+		sin->sin_family = AF_INET;
+		error = str_to_addr4(str, &sin->sin_addr);
+	}
+
+	if (error)
+		log_info("(--from has to be of the same family as --receive.)");
+	return error;
+}
+
+/**
+ * Returns whether "src" (where a datagram came from) is "peer" (the active translator). Ports are
+ * not compared; the sender's is ephemeral.
+ */
+static bool is_peer(struct sockaddr_storage *src, struct sockaddr_storage *peer)
+{
+	struct sockaddr_in6 *src6 = (struct sockaddr_in6 *) src;
+	struct sockaddr_in6 *peer6 = (struct sockaddr_in6 *) peer;
+	struct sockaddr_in *src4 = (struct sockaddr_in *) src;
+	struct sockaddr_in *peer4 = (struct sockaddr_in *) peer;
+
+	if (src->ss_family != peer->ss_family)
+		return false;
+
+	if (src->ss_family == AF_INET6)
+		return memcmp(&src6->sin6_addr, &peer6->sin6_addr, sizeof(src6->sin6_addr)) == 0;
+	return src4->sin_addr.s_addr == peer4->sin_addr.s_addr;
+}
+
+int sync_receive(char *local, char *from, bool loopback)
+{
+	/* One byte more than a batch can need, so the longer datagrams can be told apart. */
+	unsigned char request[sizeof(struct request_hdr) + BATCH_MAX_LEN + 1];
+	struct request_hdr *hdr = (struct request_hdr *) request;
+	struct sync_batch *batch = (struct sync_batch *) (hdr + 1);
+	struct sync_session *records = (struct sync_session *) (batch + 1);
+	struct nl_sock *nl_sk = NULL;
+	struct sockaddr_storage local_addr;
+	struct sockaddr_storage peer;
+	struct sockaddr_storage src;
+	socklen_t addr_len;
+	ssize_t batch_len;
+	__u16 i;
+	int sk;
+	int error;
+
+	error = str_to_sockaddr(local, &local_addr, &addr_len);
+	if (error)
+		return error;
+	error = str_to_peer(from, &local_addr, &peer);
+	if (error)
+		return error;
+
+	error = open_udp(local, true, &sk);
+	if (error)
+		return error;
+
+	if (!loopback) {
+		error = netlink_open(&nl_sk);
+		if (error)
+			goto end;
+	}
+
+	log_info("Waiting for session changes from %s at %s.", from, local);
+
+	while (true) {
+		addr_len = sizeof(src);
+		batch_len = recvfrom(sk, batch, BATCH_MAX_LEN + 1, 0, (struct sockaddr *) &src,
+				&addr_len);
+		if (batch_len < 0) {
+			error = -errno;
+			log_err(ERR_UNKNOWN_ERROR, "Could not receive session changes: %s",
+					strerror(-error));
+			break;
+		}
+
+		/* Anyone else could install or kill sessions at will. */
+		if (!is_peer(&src, &peer)) {
+			log_info("(Ignoring a datagram which did not come from %s.)", from);
+			continue;
+		}
+
+		if (!is_valid_batch(batch, batch_len)) {
+			log_info("(Ignoring a malformed datagram of %zd bytes.)", batch_len);
+			continue;
+		}
+
+		if (loopback) {
+			for (i = 0; i < ntohs(batch->count); i++)
+				print_record(&records[i]);
+			fflush(stdout);
+			continue;
+		}
+
+		hdr->length = sizeof(*hdr) + batch_len;
+		hdr->mode = MODE_SYNC;
+		hdr->operation = OP_ADD;
+		/* The error was already printed; the next batch might fare better. */
+		netlink_send(nl_sk, request, hdr->length, install_response, NULL);
+	}
+
+	if (nl_sk)
+		netlink_close(nl_sk);
+	/* Fall through. */
+
+end:
+	close(sk);
+	return error;
+}
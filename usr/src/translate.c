@@ -6,7 +6,7 @@
 
 static int handle_display_response(struct nl_msg *msg, void *arg)
 {
-	struct translate_config *conf = nlmsg_data(nlmsg_hdr(msg));
+	struct translate_config *conf = netlink_data(nlmsg_hdr(msg));
 	__u16 *plateaus;
 	int i;
 